@@ -5,3 +5,8 @@
 -keepclasseswithmembernames class * {
     native <methods>;
 }
+
+# Called from native code by the MIDI reader thread
+-keepclassmembers class com.synthio.app.audio.SynthesizerEngine {
+    static void onNativeMidiControlChange(int, int);
+}
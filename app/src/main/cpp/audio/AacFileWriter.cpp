@@ -0,0 +1,205 @@
+#include "AacFileWriter.h"
+#include <algorithm>
+#include <cstring>
+#include <media/NdkMediaCodec.h>
+#include <media/NdkMediaFormat.h>
+#include <unistd.h>
+
+#define LOG_TAG "SynthIO_AacWriter"
+#include "Log.h"
+
+namespace synthio {
+
+namespace {
+
+constexpr const char *AAC_MIME = "audio/mp4a-latm";
+constexpr int CHANNELS = 2;
+constexpr int BYTES_PER_FRAME = CHANNELS * sizeof(int16_t);
+constexpr int AAC_PROFILE_LC = 2;
+constexpr int ADTS_HEADER_BYTES = 7;
+constexpr int END_OF_STREAM_ATTEMPTS = 500; // x TIMEOUT_US: 5 s
+
+int adtsFrequencyIndex(int sampleRate) {
+  static constexpr int RATES[] = {96000, 88200, 64000, 48000, 44100,
+                                  32000, 24000, 22050, 16000, 12000,
+                                  11025, 8000,  7350};
+  for (int i = 0; i < static_cast<int>(sizeof(RATES) / sizeof(RATES[0])); ++i) {
+    if (RATES[i] == sampleRate) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+} // namespace
+
+AacFileWriter::AacFileWriter(int fd, int sampleRate)
+    : mFd(fd), mSampleRate(sampleRate),
+      mFrequencyIndex(adtsFrequencyIndex(sampleRate)) {
+  if (mFrequencyIndex < 0) {
+    LOGE("AAC export: no ADTS index for %d Hz", sampleRate);
+    return;
+  }
+
+  AMediaFormat *format = AMediaFormat_new();
+  AMediaFormat_setString(format, AMEDIAFORMAT_KEY_MIME, AAC_MIME);
+  AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_SAMPLE_RATE, sampleRate);
+  AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_CHANNEL_COUNT, CHANNELS);
+  AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_BIT_RATE, BIT_RATE);
+  AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_AAC_PROFILE, AAC_PROFILE_LC);
+  AMediaFormat_setInt32(format, AMEDIAFORMAT_KEY_MAX_INPUT_SIZE, MAX_INPUT_SIZE);
+
+  mCodec = AMediaCodec_createEncoderByType(AAC_MIME);
+  if (mCodec != nullptr &&
+      (AMediaCodec_configure(mCodec, format, nullptr, nullptr,
+                             AMEDIACODEC_CONFIGURE_FLAG_ENCODE) != AMEDIA_OK ||
+       AMediaCodec_start(mCodec) != AMEDIA_OK)) {
+    LOGE("AAC export: encoder rejected %d Hz stereo", sampleRate);
+    AMediaCodec_delete(mCodec);
+    mCodec = nullptr;
+  }
+  AMediaFormat_delete(format);
+}
+
+AacFileWriter::~AacFileWriter() {
+  if (mCodec != nullptr) {
+    AMediaCodec_stop(mCodec);
+    AMediaCodec_delete(mCodec);
+  }
+}
+
+bool AacFileWriter::write(const int16_t *interleaved, int numFrames) {
+  if (mCodec == nullptr) {
+    return false;
+  }
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(interleaved);
+  size_t remaining = static_cast<size_t>(numFrames) * BYTES_PER_FRAME;
+  while (remaining > 0) {
+    ssize_t index = AMediaCodec_dequeueInputBuffer(mCodec, TIMEOUT_US);
+    if (index < 0 && index != AMEDIACODEC_INFO_TRY_AGAIN_LATER) {
+      LOGE("AAC export: dequeueing input failed (%zd)", index);
+      return false;
+    }
+    if (index >= 0) {
+      size_t capacity = 0;
+      uint8_t *buffer = AMediaCodec_getInputBuffer(mCodec, index, &capacity);
+      // Whole frames only, so every buffer starts on a left sample
+      const size_t count =
+          std::min(remaining, capacity - capacity % BYTES_PER_FRAME);
+      if (buffer == nullptr || count == 0) {
+        LOGE("AAC export: unusable input buffer");
+        return false;
+      }
+      std::memcpy(buffer, bytes, count);
+      const int64_t timeUs = mFramesQueued * 1000000 / mSampleRate;
+      if (AMediaCodec_queueInputBuffer(mCodec, index, 0, count, timeUs, 0) !=
+          AMEDIA_OK) {
+        LOGE("AAC export: queueing input failed");
+        return false;
+      }
+      mFramesQueued += static_cast<int64_t>(count / BYTES_PER_FRAME);
+      bytes += count;
+      remaining -= count;
+    }
+    // Keep the output moving so the codec doesn't run out of buffers
+    if (!drainOutput(0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool AacFileWriter::finish() {
+  if (mCodec == nullptr) {
+    return false;
+  }
+  ssize_t index = -1;
+  for (int attempt = 0; index < 0 && attempt < END_OF_STREAM_ATTEMPTS;
+       ++attempt) {
+    index = AMediaCodec_dequeueInputBuffer(mCodec, TIMEOUT_US);
+    if (index < 0 && index != AMEDIACODEC_INFO_TRY_AGAIN_LATER) {
+      LOGE("AAC export: dequeueing input failed (%zd)", index);
+      return false;
+    }
+    if (index < 0 && !drainOutput(0)) {
+      return false;
+    }
+  }
+  if (index < 0) {
+    LOGE("AAC export: no input buffer for the end of stream");
+    return false;
+  }
+  const int64_t timeUs = mFramesQueued * 1000000 / mSampleRate;
+  AMediaCodec_queueInputBuffer(mCodec, index, 0, 0, timeUs,
+                               AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM);
+
+  for (int attempt = 0; !mEndOfStream && attempt < END_OF_STREAM_ATTEMPTS;
+       ++attempt) {
+    if (!drainOutput(TIMEOUT_US)) {
+      return false;
+    }
+  }
+  if (!mEndOfStream) {
+    LOGE("AAC export: encoder never signalled the end of stream");
+    return false;
+  }
+  fdatasync(mFd);
+  return true;
+}
+
+bool AacFileWriter::drainOutput(int64_t timeoutUs) {
+  while (!mEndOfStream) {
+    AMediaCodecBufferInfo info;
+    ssize_t index = AMediaCodec_dequeueOutputBuffer(mCodec, &info, timeoutUs);
+    if (index == AMEDIACODEC_INFO_TRY_AGAIN_LATER) {
+      return true;
+    }
+    if (index == AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED ||
+        index == AMEDIACODEC_INFO_OUTPUT_BUFFERS_CHANGED) {
+      continue;
+    }
+    if (index < 0) {
+      LOGE("AAC export: dequeueing output failed (%zd)", index);
+      return false;
+    }
+
+    size_t capacity = 0;
+    uint8_t *data = AMediaCodec_getOutputBuffer(mCodec, index, &capacity);
+    bool ok = true;
+    // The codec config (AudioSpecificConfig) is carried by every ADTS
+    // header instead
+    if (data != nullptr && info.size > 0 &&
+        (info.flags & AMEDIACODEC_BUFFER_FLAG_CODEC_CONFIG) == 0) {
+      ok = writeFrame(data + info.offset, static_cast<size_t>(info.size));
+    }
+    AMediaCodec_releaseOutputBuffer(mCodec, index, false);
+    if (!ok) {
+      return false;
+    }
+    if ((info.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM) != 0) {
+      mEndOfStream = true;
+    }
+  }
+  return true;
+}
+
+bool AacFileWriter::writeFrame(const uint8_t *data, size_t size) {
+  // ADTS header: MPEG-4, no CRC, AAC LC, stereo
+  const size_t frameLength = size + ADTS_HEADER_BYTES;
+  constexpr int channelConfig = CHANNELS;
+  mFrame.resize(frameLength);
+  mFrame[0] = 0xFF;
+  mFrame[1] = 0xF9;
+  mFrame[2] = static_cast<uint8_t>(((AAC_PROFILE_LC - 1) << 6) |
+                                   (mFrequencyIndex << 2) |
+                                   (channelConfig >> 2));
+  mFrame[3] = static_cast<uint8_t>(((channelConfig & 3) << 6) |
+                                   (frameLength >> 11));
+  mFrame[4] = static_cast<uint8_t>((frameLength >> 3) & 0xFF);
+  mFrame[5] = static_cast<uint8_t>(((frameLength & 7) << 5) | 0x1F);
+  mFrame[6] = 0xFC;
+  std::memcpy(mFrame.data() + ADTS_HEADER_BYTES, data, size);
+  return writeToFd(mFd, mFrame.data(), frameLength);
+}
+
+} // namespace synthio
@@ -0,0 +1,55 @@
+#ifndef SYNTHIO_AAC_FILE_WRITER_H
+#define SYNTHIO_AAC_FILE_WRITER_H
+
+#include "ExportPipeline.h"
+#include <cstdint>
+#include <vector>
+
+struct AMediaCodec;
+
+namespace synthio {
+
+/**
+ * AAC-LC export through the platform encoder (AMediaCodec), written to a
+ * file descriptor as a raw ADTS stream so the file plays on its own.
+ *
+ * Runs on the export pipeline's writer thread: each chunk is fed into the
+ * codec's input buffers and whatever the codec has finished is drained to
+ * the descriptor straight away, so neither side holds more than a few
+ * codec frames. The descriptor stays owned by the caller. Android only.
+ */
+class AacFileWriter : public ExportWriter {
+public:
+  static constexpr int BIT_RATE = 128000;
+
+  AacFileWriter(int fd, int sampleRate);
+  ~AacFileWriter() override;
+  AacFileWriter(const AacFileWriter &) = delete;
+  AacFileWriter &operator=(const AacFileWriter &) = delete;
+
+  // False if no AAC encoder could be started (e.g. unsupported rate)
+  bool isOpen() const { return mCodec != nullptr; }
+
+  bool write(const int16_t *interleaved, int numFrames) override;
+  bool finish() override;
+
+private:
+  static constexpr int64_t TIMEOUT_US = 10000;
+  static constexpr int MAX_INPUT_SIZE = 16384;
+
+  int mFd;
+  int mSampleRate;
+  int mFrequencyIndex; // ADTS sampling frequency index
+  AMediaCodec *mCodec = nullptr;
+  int64_t mFramesQueued = 0;
+  std::vector<uint8_t> mFrame; // ADTS header + one AAC frame
+  bool mEndOfStream = false;
+
+  // Moves finished codec output to the file. Returns false on error.
+  bool drainOutput(int64_t timeoutUs);
+  bool writeFrame(const uint8_t *data, size_t size);
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_AAC_FILE_WRITER_H
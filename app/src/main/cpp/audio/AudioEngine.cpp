@@ -1,11 +1,16 @@
 #include "AudioEngine.h"
+#include "AacFileWriter.h"
+#include "Denormals.h"
+#include "ExportPipeline.h"
+#include "RtLog.h"
 #include <algorithm>
-#include <android/log.h>
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <ctime>
 
 #define LOG_TAG "SynthIO"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#include "Log.h"
 
 namespace synthio {
 
@@ -61,16 +66,12 @@ static TrueLimiter g_masterLimiterR;
 static bool g_limitersInitialized = false;
 
 AudioEngine::AudioEngine() {
-  mPolyphonyManager.setSampleRate(SAMPLE_RATE);
-  mWurlitzerEngine.setSampleRate(SAMPLE_RATE);
-  mDrumMachine.setSampleRate(SAMPLE_RATE);
-  mLooper.setSampleRate(SAMPLE_RATE);
-  mMetronome.setSampleRate(SAMPLE_RATE);
-
-  // Initialize synth effects
-  mSynthTremolo.setSampleRate(SAMPLE_RATE);
-  mSynthDelay.setSampleRate(SAMPLE_RATE);
-  mSynthReverb.setSampleRate(SAMPLE_RATE);
+  RtLog::start();
+  mPolyphonyManager.setEffectArena(&mEffectArena);
+  mWurlitzerEngine.setEffectArena(&mEffectArena);
+  mSynthDelay.setArena(&mEffectArena);
+  mSynthReverb.setArena(&mEffectArena);
+  applySampleRate(DEFAULT_SAMPLE_RATE);
 
   // Set default values for synth effects (off by default)
   mSynthTremolo.setRate(5.0f);
@@ -80,11 +81,55 @@ AudioEngine::AudioEngine() {
   mSynthDelay.setMix(0.0f); // Off by default
   mSynthReverb.setSize(0.5f);
   mSynthReverb.setMix(0.0f); // Off by default
+
+  // Wavetables for the default patch (saw) and the sub-oscillator (square)
+  // are needed immediately; every other combination is built in the
+  // background. Until a table exists the oscillators fall back to polyBLEP.
+  WavetableBank::prepare(mControlWaveformMask.load());
+  WavetableBank::prepare(1 << static_cast<int>(Waveform::SQUARE));
+  mWavetableBuilder = std::thread([] {
+    for (int mask = 1; mask < WavetableBank::NUM_COMBINATIONS; ++mask) {
+      WavetableBank::prepare(mask);
+    }
+  });
+
+  // Helper cores are worth it once there are a couple to spare
+  mMultiCoreRequested = std::thread::hardware_concurrency() >= 4;
 }
 
-AudioEngine::~AudioEngine() { stop(); }
+AudioEngine::~AudioEngine() {
+  stop();
+  if (mWavetableBuilder.joinable()) {
+    mWavetableBuilder.join();
+  }
+  RtLog::stop();
+}
 
 bool AudioEngine::start() {
+  if (mMultiCoreRequested.load()) {
+    startWorkerPool();
+  }
+
+  // Measure once, before the stream competes for the core
+  if (mBenchmarkedTier.load() == QUALITY_TIER_AUTO) {
+    QualityTier tier = benchmarkQualityTier(static_cast<float>(mSampleRate.load()));
+    mBenchmarkedTier = static_cast<int>(tier);
+    LOGI("Quality benchmark picked tier %d", static_cast<int>(tier));
+    if (mQualityRequest.load() == QUALITY_TIER_AUTO) {
+      postEvent({Command::SetQualityTier, static_cast<int>(tier)});
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mReopenMutex);
+    mReopenRequested = false;
+    mReopenExit = false;
+  }
+  if (!mReopenThread.joinable()) {
+    mReopenThread = std::thread(&AudioEngine::reopenLoop, this);
+  }
+
+  std::lock_guard<Mutex> lock(mStreamMutex);
   auto result = createStream();
   if (result != oboe::Result::OK) {
     LOGE("Failed to create audio stream: %s", oboe::convertToText(result));
@@ -102,420 +147,1101 @@ bool AudioEngine::start() {
 }
 
 void AudioEngine::stop() {
+  // A reopen in flight would hand us a fresh stream right after closing it
+  stopReopenThread();
+  {
+    std::lock_guard<Mutex> lock(mStreamMutex);
+    if (mStream) {
+      closeStream();
+      LOGI("Audio engine stopped");
+    }
+  }
+  // No callback can be using the pool once the stream is closed
+  mWorkerPool.stop();
+}
+
+void AudioEngine::closeStream() {
   if (mStream) {
     mStream->requestStop();
     mStream->close();
     mStream.reset();
-    LOGI("Audio engine stopped");
   }
+  mOutputDeviceId = 0;
+}
+
+void AudioEngine::startWorkerPool() {
+  // Already running after a disable/re-enable: the workers are parked, so
+  // only the audio thread needs switching back
+  if (!mWorkerPool.isRunning()) {
+    // One helper per parallel stage, leaving a core for everything else
+    int cpus = static_cast<int>(std::thread::hardware_concurrency());
+    int workers = std::min(2, cpus - 2);
+    if (workers <= 0 || !mWorkerPool.start(workers)) {
+      return;
+    }
+  }
+  postEvent({Command::SetMultiCoreRendering, 1});
 }
 
 void AudioEngine::restart() {
-  // Prevent multiple simultaneous restarts
-  bool expected = false;
-  if (!mIsRestarting.compare_exchange_strong(expected, true)) {
-    LOGI("Audio engine restart already in progress");
-    return;
+  // Requests that arrive while a reopen is running fold into one more pass
+  {
+    std::lock_guard<std::mutex> lock(mReopenMutex);
+    mReopenRequested = true;
   }
-
-  LOGI("Restarting audio engine for device change...");
-  stop();
-  start();
-
-  mIsRestarting = false;
+  mReopenCondition.notify_one();
 }
 
 void AudioEngine::onErrorAfterClose(oboe::AudioStream *audioStream,
                                     oboe::Result error) {
   // This callback is triggered when the audio stream is disconnected
-  // (e.g., Bluetooth device connected/disconnected, USB audio changes)
-  LOGI("Audio stream disconnected (error: %s), restarting...",
+  // (e.g., Bluetooth device connected/disconnected, USB audio changes).
+  // Oboe has already closed the stream; the new one is opened on the
+  // recovery thread so this thread returns right away.
+  LOGI("Audio stream disconnected (error: %s), reopening...",
        oboe::convertToText(error));
-
-  // Restart the stream to connect to the new audio device
-  // Use a small delay to allow the system to settle
   restart();
 }
 
-oboe::Result AudioEngine::createStream() {
-  oboe::AudioStreamBuilder builder;
+// ===== STREAM RECOVERY =====
 
-  builder.setDirection(oboe::Direction::Output)
-      ->setPerformanceMode(oboe::PerformanceMode::LowLatency)
-      ->setSharingMode(
-          oboe::SharingMode::Shared) // Shared mode for Bluetooth compatibility
-      ->setFormat(oboe::AudioFormat::Float)
-      ->setChannelCount(CHANNEL_COUNT)
-      ->setSampleRate(SAMPLE_RATE)
-      ->setUsage(oboe::Usage::Game) // Game audio gets lower latency treatment
-      ->setContentType(oboe::ContentType::Music) // Mark as music content
-      ->setDataCallback(this)
-      ->setErrorCallback(this); // Handle device changes
+void AudioEngine::reopenLoop() {
+  std::unique_lock<std::mutex> lock(mReopenMutex);
+  while (true) {
+    mReopenCondition.wait(lock,
+                          [this] { return mReopenRequested || mReopenExit; });
+    if (mReopenExit) {
+      return;
+    }
+    mReopenRequested = false;
+    lock.unlock();
+    reopenStream();
+    lock.lock();
+  }
+}
+
+void AudioEngine::reopenStream() {
+  std::lock_guard<Mutex> lock(mStreamMutex);
+  const auto begin = std::chrono::steady_clock::now();
+
+  // Only the stream goes away; the graph keeps its state while no callback
+  // runs and picks up on the new device from the same sample
+  closeStream();
+  for (int attempt = 0; attempt < REOPEN_ATTEMPTS; ++attempt) {
+    if (attempt > 0) {
+      // The new route is often not ready on the first try
+      std::unique_lock<std::mutex> reopenLock(mReopenMutex);
+      if (mReopenCondition.wait_for(
+              reopenLock,
+              std::chrono::milliseconds(REOPEN_BACKOFF_MS * attempt),
+              [this] { return mReopenExit; })) {
+        return;
+      }
+    }
+
+    oboe::Result result = createStream();
+    if (result == oboe::Result::OK) {
+      result = mStream->requestStart();
+    }
+    if (result == oboe::Result::OK) {
+      auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - begin);
+      LOGI("Audio stream reopened in %lld ms (attempt %d)",
+           static_cast<long long>(elapsed.count()), attempt + 1);
+      return;
+    }
+    LOGE("Reopen attempt %d failed: %s", attempt + 1,
+         oboe::convertToText(result));
+    closeStream();
+  }
+  LOGE("Could not reopen the audio stream after %d attempts", REOPEN_ATTEMPTS);
+}
+
+void AudioEngine::stopReopenThread() {
+  {
+    std::lock_guard<std::mutex> lock(mReopenMutex);
+    mReopenExit = true;
+  }
+  mReopenCondition.notify_all();
+  if (mReopenThread.joinable()) {
+    mReopenThread.join();
+  }
+}
+
+void AudioEngine::applySampleRate(int sampleRate) {
+  const float rate = static_cast<float>(sampleRate);
+  // Every effect on the arena allocates its lines again below
+  mEffectArena.reset();
+  mPolyphonyManager.setSampleRate(rate);
+  mWurlitzerEngine.setSampleRate(rate);
+  mDrumMachine.setSampleRate(rate);
+  mMetronome.setSampleRate(rate);
+  mTransport.setSampleRate(rate); // Keeps its place inside the bar
+  mSynthTremolo.setSampleRate(rate);
+  mSynthDelay.setSampleRate(rate);
+  mSynthReverb.setSampleRate(rate);
+  mSynthVolume.setRampTime(PARAMETER_RAMP_TIME, rate);
+  mMetronomeVolume.setRampTime(PARAMETER_RAMP_TIME, rate);
+
+  // Resizing the looper clears its tracks, so it only follows while empty;
+  // createStream() keeps the rate fixed otherwise
+  if (mLooper.getState() == Looper::State::IDLE && !mLooper.hasAnyLoop()) {
+    mLooper.setSampleRate(rate);
+  } else {
+    LOGE("Looper stays at %d Hz while it holds audio", mSampleRate.load());
+  }
+  mSampleRate = sampleRate;
+}
 
-  oboe::Result result = builder.openStream(mStream);
+oboe::Result AudioEngine::createStream() {
+  // Run at the device's native rate so the framework doesn't resample.
+  // Recorded loops are only valid at the rate they were taken at, so while
+  // the looper holds audio the stream is asked for the current rate instead.
+  const bool followDevice =
+      mLooper.getState() == Looper::State::IDLE && !mLooper.hasAnyLoop();
+  const int32_t requestedRate =
+      followDevice ? oboe::kUnspecified : mSampleRate.load();
+
+  // Exclusive streams bypass the mixer (MMAP) and allow a one-burst buffer.
+  // Bluetooth goes through the shared mixer anyway, and some stacks reject
+  // exclusive requests, so it stays shared.
+  bool bluetooth = mBluetoothOutput.load();
+  oboe::Result result = openStream(bluetooth ? oboe::SharingMode::Shared
+                                             : oboe::SharingMode::Exclusive,
+                                   requestedRate);
+  if (result != oboe::Result::OK && !bluetooth) {
+    LOGI("Exclusive stream unavailable (%s), falling back to shared",
+         oboe::convertToText(result));
+    result = openStream(oboe::SharingMode::Shared, requestedRate);
+  }
 
   if (result == oboe::Result::OK && mStream) {
+    // No callback has run on the new stream yet, so the graph can be
+    // retuned in place
+    if (mStream->getSampleRate() != mSampleRate.load()) {
+      LOGI("Sample rate %d -> %d Hz", mSampleRate.load(),
+           mStream->getSampleRate());
+      applySampleRate(mStream->getSampleRate());
+    }
+    // Event offsets restart from the first callback of this stream, and the
+    // new route's latency is measured from that callback on
+    mLastCallbackNanos = 0;
+    mLatencyCountdown = 0;
+    mOutputLatencyFrames = -1;
+    mOutputDeviceId = mStream->getDeviceId();
+
     // Log the actual stream configuration for debugging latency
-    int32_t bufferSize = mStream->getBufferSizeInFrames();
     int32_t framesPerBurst = mStream->getFramesPerBurst();
     int32_t sampleRate = mStream->getSampleRate();
+    bool exclusive = mStream->getSharingMode() == oboe::SharingMode::Exclusive;
 
-    // Calculate approximate latency contribution from buffer
-    double bufferLatencyMs = (bufferSize * 1000.0) / sampleRate;
     double burstLatencyMs = (framesPerBurst * 1000.0) / sampleRate;
 
     LOGI("Audio stream opened:");
     LOGI("  Sample rate: %d Hz", sampleRate);
-    LOGI("  Buffer size: %d frames (%.1f ms)", bufferSize, bufferLatencyMs);
     LOGI("  Burst size: %d frames (%.1f ms)", framesPerBurst, burstLatencyMs);
-    LOGI("  Sharing mode: %s",
-         mStream->getSharingMode() == oboe::SharingMode::Exclusive ? "Exclusive"
-                                                                   : "Shared");
+    LOGI("  Sharing mode: %s", exclusive ? "Exclusive" : "Shared");
+    LOGI("  Device id: %d", mStream->getDeviceId());
     LOGI("  Performance mode: %s",
          mStream->getPerformanceMode() == oboe::PerformanceMode::LowLatency
              ? "LowLatency"
              : "Other");
 
-    // Try to minimize buffer size for lowest latency
-    // Set buffer to 2x burst size (minimum safe value)
-    int32_t desiredBuffer = framesPerBurst * 2;
-    if (desiredBuffer < bufferSize) {
-      mStream->setBufferSizeInFrames(desiredBuffer);
-      LOGI("  Reduced buffer to: %d frames (%.1f ms)", desiredBuffer,
-           (desiredBuffer * 1000.0) / sampleRate);
-    }
+    // Start as small as the path allows and let tuneBufferSize() grow it
+    // only if this device actually underruns. The shared mixer wakes on its
+    // own schedule, so it starts at two bursts.
+    int32_t desiredBuffer = exclusive ? framesPerBurst : framesPerBurst * 2;
+    auto applied = mStream->setBufferSizeInFrames(desiredBuffer);
+    int32_t bufferSize =
+        applied ? applied.value() : mStream->getBufferSizeInFrames();
+    LOGI("  Buffer size: %d frames (%.1f ms), capacity %d", bufferSize,
+         (bufferSize * 1000.0) / sampleRate,
+         mStream->getBufferCapacityInFrames());
+    mTunerLastXRuns = -1;
   }
 
   return result;
 }
 
-void AudioEngine::noteOn(int midiNote, float frequency) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  if (mWurlitzerMode) {
-    mWurlitzerEngine.noteOn(midiNote, frequency, 0.7f); // Default velocity
-  } else {
-    mPolyphonyManager.noteOn(midiNote, frequency);
+oboe::Result AudioEngine::openStream(oboe::SharingMode sharingMode,
+                                     int32_t sampleRate) {
+  oboe::AudioStreamBuilder builder;
+
+  builder.setDirection(oboe::Direction::Output)
+      ->setPerformanceMode(oboe::PerformanceMode::LowLatency)
+      ->setSharingMode(sharingMode)
+      ->setFormat(oboe::AudioFormat::Float)
+      ->setChannelCount(CHANNEL_COUNT)
+      ->setSampleRate(sampleRate)
+      // Only kicks in when a fixed rate was asked for and the device differs
+      ->setSampleRateConversionQuality(
+          oboe::SampleRateConversionQuality::Medium)
+      ->setUsage(oboe::Usage::Game) // Game audio gets lower latency treatment
+      ->setContentType(oboe::ContentType::Music) // Mark as music content
+      ->setDataCallback(this)
+      ->setErrorCallback(this); // Handle device changes
+
+  return builder.openStream(mStream);
+}
+
+void AudioEngine::tuneBufferSize(oboe::AudioStream *stream, int32_t xRuns) {
+  if (xRuns < 0) {
+    return; // Not reported by this stream (OpenSL ES)
+  }
+  if (mTunerLastXRuns >= 0 && xRuns > mTunerLastXRuns) {
+    int32_t bufferSize = stream->getBufferSizeInFrames();
+    int32_t grown = bufferSize + stream->getFramesPerBurst();
+    if (grown <= stream->getBufferCapacityInFrames()) {
+      stream->setBufferSizeInFrames(grown);
+    }
   }
+  mTunerLastXRuns = xRuns;
 }
 
-void AudioEngine::noteOn(int midiNote, float frequency, float velocity) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  if (mWurlitzerMode) {
-    mWurlitzerEngine.noteOn(midiNote, frequency, velocity);
-  } else {
-    mPolyphonyManager.noteOn(midiNote, frequency);
+void AudioEngine::setBluetoothOutput(bool bluetooth) {
+  bool previous = mBluetoothOutput.exchange(bluetooth);
+  std::lock_guard<Mutex> lock(mStreamMutex);
+  if (previous == bluetooth || !mStream) {
+    return;
+  }
+  // The stream may have been reopened for the new device before the route
+  // was reported; reopen with the sharing mode that suits it
+  bool exclusive = mStream->getSharingMode() == oboe::SharingMode::Exclusive;
+  if (exclusive == bluetooth) {
+    LOGI("Output route changed (bluetooth=%d), reopening stream", bluetooth);
+    restart();
   }
 }
 
-void AudioEngine::noteOff(int midiNote) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  if (mWurlitzerMode) {
-    mWurlitzerEngine.noteOff(midiNote);
+double AudioEngine::getOutputLatencyMillis() const {
+  int32_t frames = mOutputLatencyFrames.load();
+  if (frames < 0) {
+    return -1.0;
+  }
+  return frames * 1000.0 / mSampleRate.load();
+}
+
+void AudioEngine::measureOutputLatency(oboe::AudioStream *stream,
+                                       int32_t numFrames) {
+  mLatencyCountdown -= numFrames;
+  if (mLatencyCountdown > 0) {
+    return;
+  }
+
+  const int32_t sampleRate = stream->getSampleRate();
+  int64_t latencyFrames = 0;
+  auto timestamp = stream->getTimestamp(CLOCK_MONOTONIC);
+  if (timestamp) {
+    // When the next frame we write will be presented, relative to now
+    // (steady_clock is CLOCK_MONOTONIC)
+    int64_t framesAhead =
+        stream->getFramesWritten() - timestamp.value().position;
+    int64_t presentNanos = timestamp.value().timestamp +
+                           framesAhead * 1000000000LL / sampleRate;
+    int64_t nowNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+    latencyFrames = (presentNanos - nowNanos) * sampleRate / 1000000000LL;
+  } else if (timestamp.error() == oboe::Result::ErrorUnimplemented) {
+    // No timestamps on this path (OpenSL ES); the buffer is the best guess
+    latencyFrames = stream->getBufferSizeInFrames();
   } else {
-    mPolyphonyManager.noteOff(midiNote);
+    return; // Not available until the stream is flowing; retry next burst
   }
+  mLatencyCountdown =
+      static_cast<int64_t>(sampleRate) * LATENCY_MEASURE_INTERVAL_MS / 1000;
+
+  latencyFrames = std::max<int64_t>(0, latencyFrames);
+  mOutputLatencyFrames.store(static_cast<int32_t>(latencyFrames),
+                             std::memory_order_relaxed);
+  // Notes also reach the graph one callback after they are played, since
+  // events are replayed at their offset in the following burst
+  mLooper.setRecordLatency(latencyFrames + numFrames);
 }
 
-void AudioEngine::allNotesOff() {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.allNotesOff();
-  mWurlitzerEngine.allNotesOff();
+int AudioEngine::getBufferSizeFrames() const {
+  std::lock_guard<Mutex> lock(mStreamMutex);
+  return mStream ? mStream->getBufferSizeInFrames() : 0;
 }
 
-void AudioEngine::setWurlitzerMode(bool enabled) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  if (mWurlitzerMode != enabled) {
-    mWurlitzerMode = enabled;
-    // Kill all notes when switching modes to prevent stuck notes
+bool AudioEngine::isExclusiveStream() const {
+  std::lock_guard<Mutex> lock(mStreamMutex);
+  return mStream && mStream->getSharingMode() == oboe::SharingMode::Exclusive;
+}
+
+// ===== CONTROL EVENTS =====
+
+bool AudioEngine::postEvent(EngineEvent event) {
+  return postEvent(event, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                       .count());
+}
+
+bool AudioEngine::postEvent(EngineEvent event, int64_t timeNanos) {
+  event.timeNanos = timeNanos;
+  if (!mEventQueue.tryPush(event)) {
+    // Never block the caller: drop and count so it shows up in the logs
+    uint32_t dropped = mDroppedEvents.fetch_add(1) + 1;
+    LOGE("Event queue full, dropped event %d (total %u)",
+         static_cast<int>(event.command), dropped);
+    return false;
+  }
+  return true;
+}
+
+int AudioEngine::drainEvents(int32_t numFrames, int64_t callbackNanos) {
+  // Events posted during the previous callback period are replayed at the
+  // same relative offset in this buffer: constant one-buffer latency, no
+  // jitter from where the UI thread happened to land between callbacks.
+  const double framesPerNano = mSampleRate.load() / 1.0e9;
+  const int32_t lastFrame = std::max<int32_t>(0, numFrames - 1);
+  int count = 0;
+  EngineEvent event;
+  while (count < static_cast<int>(mScheduledEvents.size()) &&
+         mEventQueue.tryPop(event)) {
+    int32_t frame = 0;
+    if (mLastCallbackNanos > 0 && event.timeNanos > mLastCallbackNanos) {
+      double offset = (event.timeNanos - mLastCallbackNanos) * framesPerNano;
+      frame = static_cast<int32_t>(std::min<double>(offset, lastFrame));
+    }
+
+    // Insertion sort keeps per-producer order for events on the same frame
+    int i = count++;
+    while (i > 0 && mScheduledEvents[i - 1].frame > frame) {
+      mScheduledEvents[i] = mScheduledEvents[i - 1];
+      --i;
+    }
+    mScheduledEvents[i] = {event, frame};
+  }
+  mLastCallbackNanos = callbackNanos;
+  return count;
+}
+
+void AudioEngine::applyEvent(const EngineEvent &event) {
+  const int i = event.intArg;
+  const float f = event.floatArg;
+  const bool wurli = mWurlitzerMode.load(std::memory_order_relaxed);
+
+  switch (event.command) {
+  // ----- Notes -----
+  case Command::NoteOn:
+    if (wurli) {
+      mWurlitzerEngine.noteOn(i, f, event.floatArg2);
+    } else {
+      mPolyphonyManager.noteOn(i, f);
+    }
+    break;
+  case Command::NoteOff:
+    if (wurli) {
+      mWurlitzerEngine.noteOff(i);
+    } else {
+      mPolyphonyManager.noteOff(i);
+    }
+    break;
+  case Command::AllNotesOff:
     mPolyphonyManager.allNotesOff();
     mWurlitzerEngine.allNotesOff();
+    break;
+  case Command::SetWurlitzerMode:
+    if (wurli != (i != 0)) {
+      mWurlitzerMode.store(i != 0, std::memory_order_relaxed);
+      // Kill all notes when switching modes to prevent stuck notes
+      mPolyphonyManager.allNotesOff();
+      mWurlitzerEngine.allNotesOff();
+    }
+    break;
+
+  // ----- Oscillator -----
+  case Command::SetWaveform:
+    mPolyphonyManager.setWaveform(static_cast<Waveform>(i));
+    break;
+  case Command::ToggleWaveform:
+    mPolyphonyManager.setWaveformEnabled(static_cast<Waveform>(i),
+                                         event.intArg2 != 0);
+    break;
+  case Command::SetPulseWidth:
+    mPolyphonyManager.setPulseWidth(f);
+    break;
+  case Command::SetSubOscLevel:
+    mPolyphonyManager.setSubOscLevel(f);
+    break;
+  case Command::SetNoiseLevel:
+    mPolyphonyManager.setNoiseLevel(f);
+    break;
+
+  // ----- Filter -----
+  case Command::SetFilterCutoff:
+    mPolyphonyManager.setFilterCutoff(f);
+    break;
+  case Command::SetFilterResonance:
+    mPolyphonyManager.setFilterResonance(f);
+    break;
+  case Command::SetFilterEnvelopeAmount:
+    mPolyphonyManager.setFilterEnvelopeAmount(f);
+    break;
+  case Command::SetFilterKeyTracking:
+    mPolyphonyManager.setFilterKeyTracking(f);
+    break;
+  case Command::SetHPFCutoff:
+    mPolyphonyManager.setHPFCutoff(f);
+    break;
+
+  // ----- Envelope -----
+  case Command::SetAttack:
+    mPolyphonyManager.setAttack(f);
+    break;
+  case Command::SetDecay:
+    mPolyphonyManager.setDecay(f);
+    break;
+  case Command::SetSustain:
+    mPolyphonyManager.setSustain(f);
+    break;
+  case Command::SetRelease:
+    mPolyphonyManager.setRelease(f);
+    break;
+
+  // ----- LFO / Chorus -----
+  case Command::SetLFORate:
+    mPolyphonyManager.setLFORate(f);
+    break;
+  case Command::SetLFOPitchDepth:
+    mPolyphonyManager.setLFOPitchDepth(f);
+    break;
+  case Command::SetLFOFilterDepth:
+    mPolyphonyManager.setLFOFilterDepth(f);
+    break;
+  case Command::SetLFOPWMDepth:
+    mPolyphonyManager.setLFOPWMDepth(f);
+    break;
+  case Command::SetChorusMode:
+    mPolyphonyManager.setChorusMode(i);
+    break;
+
+  // ----- Synth effects -----
+  case Command::SetSynthTremoloRate:
+    mSynthTremolo.setRate(f);
+    break;
+  case Command::SetSynthTremoloDepth:
+    mSynthTremolo.setDepth(f);
+    break;
+  case Command::SetSynthReverbSize:
+    mSynthReverb.setSize(f);
+    break;
+  case Command::SetSynthReverbMix:
+    mSynthReverb.setMix(f);
+    break;
+  case Command::SetReverbMode: {
+    const Reverb::Mode mode = i == 1 ? Reverb::Mode::FDN : Reverb::Mode::COMBS;
+    mSynthReverb.setMode(mode);
+    mWurlitzerEngine.setReverbMode(mode);
+    break;
+  }
+  case Command::SetSynthDelayTime:
+    mSynthDelay.setTime(f);
+    break;
+  case Command::SetSynthDelayFeedback:
+    mSynthDelay.setFeedback(f);
+    break;
+  case Command::SetSynthDelayMix:
+    mSynthDelay.setMix(f);
+    break;
+
+  // ----- Glide / Unison -----
+  case Command::SetGlideTime:
+    mPolyphonyManager.setGlideTime(f);
+    break;
+  case Command::SetGlideEnabled:
+    mPolyphonyManager.setGlideEnabled(i != 0);
+    break;
+  case Command::SetUnisonEnabled:
+    mPolyphonyManager.setUnisonEnabled(i != 0);
+    break;
+  case Command::SetUnisonVoices:
+    mPolyphonyManager.setUnisonVoices(i);
+    break;
+  case Command::SetUnisonDetune:
+    mPolyphonyManager.setUnisonDetune(f);
+    break;
+  case Command::SetStackedUnisonEnabled:
+    mPolyphonyManager.setStackedUnisonEnabled(i != 0);
+    break;
+  case Command::SetSimdVoicesEnabled:
+    mPolyphonyManager.setVoiceBankEnabled(i != 0);
+    mWurlitzerEngine.setVoiceBankEnabled(i != 0);
+    break;
+  case Command::SetWavetablesEnabled:
+    mWavetablesByUser = i != 0;
+    applyWavetables();
+    break;
+  case Command::SetMultiCoreRendering:
+    mUseWorkerPool = i != 0;
+    mPolyphonyManager.setWorkerPool(mUseWorkerPool ? &mWorkerPool : nullptr);
+    break;
+  case Command::SetDrumOneShotsEnabled:
+    mDrumOneShotsByUser = i != 0;
+    applyDrumOneShots();
+    break;
+  case Command::SetPolyphony:
+    mPolyphonyManager.setPolyphony(i);
+    mWurlitzerEngine.setPolyphony(i);
+    break;
+  case Command::SetQualityTier:
+    applyQualityTier(static_cast<QualityTier>(i));
+    break;
+
+  // ----- Wurlitzer -----
+  case Command::SetWurliTremoloRate:
+    mWurlitzerEngine.setTremoloRate(f);
+    break;
+  case Command::SetWurliTremoloDepth:
+    mWurlitzerEngine.setTremoloDepth(f);
+    break;
+  case Command::SetWurliChorusMode:
+    mWurlitzerEngine.setChorusMode(i);
+    break;
+  case Command::SetWurliReverbSize:
+    mWurlitzerEngine.setReverbSize(f);
+    break;
+  case Command::SetWurliReverbMix:
+    mWurlitzerEngine.setReverbMix(f);
+    break;
+  case Command::SetWurliDelayTime:
+    mWurlitzerEngine.setDelayTime(f);
+    break;
+  case Command::SetWurliDelayFeedback:
+    mWurlitzerEngine.setDelayFeedback(f);
+    break;
+  case Command::SetWurliDelayMix:
+    mWurlitzerEngine.setDelayMix(f);
+    break;
+  case Command::SetWurliVolume:
+    mWurlitzerEngine.setVolume(f);
+    break;
+
+  // ----- Volumes -----
+  case Command::SetSynthVolume:
+    mSynthVolume.setTarget(std::max(0.0f, std::min(1.0f, f)));
+    break;
+  case Command::ApplyPatch:
+    applyPatch(mPatchSlots[i]);
+    mPatchSlotBusy[i].store(false, std::memory_order_release);
+    break;
+  case Command::SetDrumVolume:
+    mDrumMachine.setVolume(f);
+    break;
+  case Command::SetMetronomeVolume:
+    mMetronomeVolume.setTarget(std::max(0.0f, std::min(2.0f, f)));
+    break;
+
+  // ----- Drum machine -----
+  case Command::SetDrumEnabled:
+    applyDrumEnabled(i != 0);
+    break;
+  case Command::SetDrumBPM:
+    mDrumMachine.setBPM(f);
+    mLooper.setBPM(f); // Keep looper in sync
+    mTransport.setBPM(mDrumMachine.getBPM()); // Phase-coherent
+    break;
+  case Command::SetKickEnabled:
+    mDrumMachine.setKickEnabled(i != 0);
+    break;
+  case Command::SetSnareEnabled:
+    mDrumMachine.setSnareEnabled(i != 0);
+    break;
+  case Command::SetHiHatEnabled:
+    mDrumMachine.setHiHatEnabled(i != 0);
+    break;
+  case Command::SetHiHat16thNotes:
+    mDrumMachine.setHiHat16thNotes(i != 0);
+    break;
+  case Command::SetDrumStep:
+    mDrumMachine.setStep(i, event.intArg2, f);
+    break;
+  case Command::ToggleDrumStep:
+    mDrumMachine.toggleStep(i, event.intArg2);
+    break;
+  case Command::SetDrumInstrumentVolume:
+    mDrumMachine.setInstrumentVolume(i, f);
+    break;
+  case Command::ResetDrumPattern:
+    mDrumMachine.resetToDefaultPattern();
+    break;
+  case Command::SyncDrumToLoop:
+    // Move the transport to the loop's position; from the next wrap on it
+    // restarts with the loop by itself (see renderBlock)
+    if (mLooper.hasLoop() && mLooper.getLoopLengthSamples() > 0) {
+      mTransport.locate(static_cast<double>(mLooper.getPlaybackPosition()) /
+                        mTransport.getSamplesPerStep());
+    }
+    break;
+
+  // ----- Looper -----
+  case Command::LooperStartRecordingTrack:
+    applyLooperStartRecording(i);
+    break;
+  case Command::LooperStartPlayback: {
+    // Bar 1 of the drums lands on the loop's first frame
+    const bool wasPlaying = mLooper.isPlaying();
+    mLooper.startPlayback();
+    if (!wasPlaying && mLooper.isPlaying()) {
+      mTransport.start();
+    }
+    break;
+  }
+  case Command::LooperStopPlayback:
+    mLooper.stopPlayback();
+    break;
+  case Command::LooperClearTrack:
+    mLooper.clearTrack(i);
+    break;
+  case Command::LooperClearAllTracks:
+    mLooper.clearAllTracks();
+    break;
+  case Command::LooperCancelRecording:
+    mLooper.cancelRecording();
+    break;
+  case Command::LooperSetTrackVolume:
+    mLooper.setTrackVolume(i, f);
+    break;
+  case Command::LooperSetTrackMuted:
+    mLooper.setTrackMuted(i, event.intArg2 != 0);
+    break;
+  case Command::LooperSetTrackSolo:
+    mLooper.setTrackSolo(i, event.intArg2 != 0);
+    break;
+  case Command::LooperSetBarCount:
+    mLooper.setBarCount(i);
+    break;
+  case Command::LooperBounceTracks:
+    mLooper.bounceTracks(i);
+    break;
+  case Command::CaptureExport:
+    // The exporter may have given up on this request
+    if (static_cast<uint32_t>(event.intArg2) ==
+        mExportRequest.load(std::memory_order_acquire)) {
+      captureExportSnapshot(i);
+      mExportCaptured.store(static_cast<uint32_t>(event.intArg2),
+                            std::memory_order_release);
+    }
+    break;
+  }
+}
+
+void AudioEngine::applyDrumEnabled(bool enabled) {
+  const bool starting = enabled && !mDrumEnabledByUser;
+  mDrumEnabledByUser = enabled;
+
+  // During loop playback the drums join at the loop's position; otherwise
+  // the bar starts now. The count-in and recording keep the metronome's bar.
+  const Looper::State looperState = mLooper.getState();
+  if (starting && looperState == Looper::State::PLAYING) {
+    applyEvent({Command::SyncDrumToLoop});
+  } else if (starting && looperState != Looper::State::PRE_COUNT &&
+             looperState != Looper::State::RECORDING) {
+    mTransport.start();
+  }
+
+  mDrumMachine.setEnabled(enabled);
+}
+
+void AudioEngine::applyLooperStartRecording(int trackIndex) {
+  // Sync looper BPM with drum machine
+  mLooper.setBPM(mDrumMachine.getBPM());
+
+  // The count-in starts on the transport's downbeat (metronome, not drums)
+  mLooper.startRecordingTrack(trackIndex);
+  if (mLooper.isPreCounting()) {
+    mTransport.start();
+  }
+}
+
+// ===== NOTE CONTROL =====
+
+void AudioEngine::noteOn(int midiNote, float frequency) {
+  // Wurlitzer uses a default velocity; the synth ignores it
+  postEvent({Command::NoteOn, midiNote, 0, frequency, 0.7f});
+}
+
+void AudioEngine::noteOn(int midiNote, float frequency, float velocity) {
+  postEvent({Command::NoteOn, midiNote, 0, frequency, velocity});
+}
+
+void AudioEngine::noteOff(int midiNote) {
+  postEvent({Command::NoteOff, midiNote});
+}
+
+void AudioEngine::allNotesOff() { postEvent({Command::AllNotesOff}); }
+
+// ===== MIDI INPUT =====
+
+void AudioEngine::midiNoteOn(int midiNote, float velocity, int64_t timeNanos) {
+  float frequency = 440.0f * std::pow(2.0f, (midiNote - 69) / 12.0f);
+  postEvent({Command::NoteOn, midiNote, 0, frequency, velocity}, timeNanos);
+}
+
+void AudioEngine::midiNoteOff(int midiNote, int64_t timeNanos) {
+  postEvent({Command::NoteOff, midiNote}, timeNanos);
+}
+
+void AudioEngine::setWurlitzerMode(bool enabled) {
+  postEvent({Command::SetWurlitzerMode, enabled ? 1 : 0});
+}
+
+// ===== PATCHES =====
+
+bool AudioEngine::setPatch(const SynthPatch &patch) {
+  int mask = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (patch.voice.waveforms[i]) {
+      mask |= 1 << i;
+    }
   }
+  mControlWaveformMask.store(mask);
+  WavetableBank::prepare(mask);
+
+  std::lock_guard<Mutex> lock(mPatchMutex);
+  for (int slot = 0; slot < PATCH_SLOTS; ++slot) {
+    if (mPatchSlotBusy[slot].load(std::memory_order_acquire)) {
+      continue;
+    }
+    PreparedPatch &prepared = mPatchSlots[slot];
+    prepared.patch = patch;
+    prepared.coefficients = VoiceCoefficients::compute(
+        patch.voice, static_cast<float>(mSampleRate.load()));
+    mPatchSlotBusy[slot].store(true, std::memory_order_relaxed);
+    if (!postEvent({Command::ApplyPatch, slot})) {
+      mPatchSlotBusy[slot].store(false, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+  LOGE("All patch slots busy, patch dropped");
+  return false;
+}
+
+void AudioEngine::applyPatch(const PreparedPatch &prepared) {
+  const SynthPatch &patch = prepared.patch;
+  mPolyphonyManager.applyPatch(patch, prepared.coefficients);
+
+  mSynthTremolo.setRate(patch.tremoloRate);
+  mSynthTremolo.setDepth(patch.tremoloDepth);
+  mSynthReverb.setSize(patch.reverbSize);
+  mSynthReverb.setMix(patch.reverbMix);
+  mSynthDelay.setTime(patch.delayTime);
+  mSynthDelay.setFeedback(patch.delayFeedback);
+  mSynthDelay.setMix(patch.delayMix);
+  mSynthVolume.setTarget(std::max(0.0f, std::min(1.0f, patch.volume)));
 }
 
 // ===== OSCILLATOR PARAMETERS =====
 void AudioEngine::setWaveform(int waveform) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setWaveform(static_cast<Waveform>(waveform));
+  int mask = 1 << waveform;
+  mControlWaveformMask.store(mask);
+  WavetableBank::prepare(mask); // No-op once the background build is done
+  postEvent({Command::SetWaveform, waveform});
 }
 
 void AudioEngine::toggleWaveform(int waveformId, bool enabled) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setWaveformEnabled(static_cast<Waveform>(waveformId),
-                                       enabled);
+  int bit = 1 << waveformId;
+  int mask = enabled ? (mControlWaveformMask.fetch_or(bit) | bit)
+                     : (mControlWaveformMask.fetch_and(~bit) & ~bit);
+  WavetableBank::prepare(mask);
+  postEvent({Command::ToggleWaveform, waveformId, enabled ? 1 : 0});
 }
 
 void AudioEngine::setPulseWidth(float width) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setPulseWidth(width);
+  postEvent({Command::SetPulseWidth, 0, 0, width});
 }
 
 void AudioEngine::setSubOscLevel(float level) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setSubOscLevel(level);
+  postEvent({Command::SetSubOscLevel, 0, 0, level});
 }
 
 void AudioEngine::setNoiseLevel(float level) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setNoiseLevel(level);
+  postEvent({Command::SetNoiseLevel, 0, 0, level});
 }
 
 // ===== FILTER PARAMETERS =====
 void AudioEngine::setFilterCutoff(float cutoffHz) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setFilterCutoff(cutoffHz);
+  postEvent({Command::SetFilterCutoff, 0, 0, cutoffHz});
 }
 
 void AudioEngine::setFilterResonance(float resonance) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setFilterResonance(resonance);
+  postEvent({Command::SetFilterResonance, 0, 0, resonance});
 }
 
 void AudioEngine::setFilterEnvelopeAmount(float amount) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setFilterEnvelopeAmount(amount);
+  postEvent({Command::SetFilterEnvelopeAmount, 0, 0, amount});
 }
 
 void AudioEngine::setFilterKeyTracking(float amount) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setFilterKeyTracking(amount);
+  postEvent({Command::SetFilterKeyTracking, 0, 0, amount});
 }
 
 void AudioEngine::setHPFCutoff(float cutoffHz) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setHPFCutoff(cutoffHz);
+  postEvent({Command::SetHPFCutoff, 0, 0, cutoffHz});
 }
 
 // ===== ENVELOPE (ADSR) =====
 void AudioEngine::setAttack(float time) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setAttack(time);
+  postEvent({Command::SetAttack, 0, 0, time});
 }
 
 void AudioEngine::setDecay(float time) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setDecay(time);
+  postEvent({Command::SetDecay, 0, 0, time});
 }
 
 void AudioEngine::setSustain(float level) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setSustain(level);
+  postEvent({Command::SetSustain, 0, 0, level});
 }
 
 void AudioEngine::setRelease(float time) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setRelease(time);
+  postEvent({Command::SetRelease, 0, 0, time});
 }
 
 // ===== LFO PARAMETERS =====
 void AudioEngine::setLFORate(float rateHz) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setLFORate(rateHz);
+  postEvent({Command::SetLFORate, 0, 0, rateHz});
 }
 
 void AudioEngine::setLFOPitchDepth(float depth) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setLFOPitchDepth(depth);
+  postEvent({Command::SetLFOPitchDepth, 0, 0, depth});
 }
 
 void AudioEngine::setLFOFilterDepth(float depth) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setLFOFilterDepth(depth);
+  postEvent({Command::SetLFOFilterDepth, 0, 0, depth});
 }
 
 void AudioEngine::setLFOPWMDepth(float depth) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setLFOPWMDepth(depth);
+  postEvent({Command::SetLFOPWMDepth, 0, 0, depth});
 }
 
 // ===== CHORUS =====
 void AudioEngine::setChorusMode(int mode) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setChorusMode(mode);
+  postEvent({Command::SetChorusMode, mode});
 }
 
 // ===== SYNTH EFFECTS (Delay, Reverb, Tremolo) =====
 void AudioEngine::setSynthTremoloRate(float rate) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mSynthTremolo.setRate(rate);
+  postEvent({Command::SetSynthTremoloRate, 0, 0, rate});
 }
 
 void AudioEngine::setSynthTremoloDepth(float depth) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mSynthTremolo.setDepth(depth);
+  postEvent({Command::SetSynthTremoloDepth, 0, 0, depth});
 }
 
 void AudioEngine::setSynthReverbSize(float size) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mSynthReverb.setSize(size);
+  postEvent({Command::SetSynthReverbSize, 0, 0, size});
 }
 
 void AudioEngine::setSynthReverbMix(float mix) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mSynthReverb.setMix(mix);
+  postEvent({Command::SetSynthReverbMix, 0, 0, mix});
+}
+
+void AudioEngine::setReverbMode(int mode) {
+  postEvent({Command::SetReverbMode, mode});
 }
 
 void AudioEngine::setSynthDelayTime(float time) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mSynthDelay.setTime(time);
+  postEvent({Command::SetSynthDelayTime, 0, 0, time});
 }
 
 void AudioEngine::setSynthDelayFeedback(float feedback) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mSynthDelay.setFeedback(feedback);
+  postEvent({Command::SetSynthDelayFeedback, 0, 0, feedback});
 }
 
 void AudioEngine::setSynthDelayMix(float mix) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mSynthDelay.setMix(mix);
+  postEvent({Command::SetSynthDelayMix, 0, 0, mix});
 }
 
 // ===== GLIDE/PORTAMENTO =====
 void AudioEngine::setGlideTime(float time) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setGlideTime(time);
+  postEvent({Command::SetGlideTime, 0, 0, time});
 }
 
 void AudioEngine::setGlideEnabled(bool enabled) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setGlideEnabled(enabled);
+  postEvent({Command::SetGlideEnabled, enabled ? 1 : 0});
 }
 
 // ===== UNISON MODE =====
 void AudioEngine::setUnisonEnabled(bool enabled) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setUnisonEnabled(enabled);
+  postEvent({Command::SetUnisonEnabled, enabled ? 1 : 0});
 }
 
 void AudioEngine::setUnisonVoices(int count) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setUnisonVoices(count);
+  postEvent({Command::SetUnisonVoices, count});
 }
 
 void AudioEngine::setUnisonDetune(float cents) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mPolyphonyManager.setUnisonDetune(cents);
+  postEvent({Command::SetUnisonDetune, 0, 0, cents});
+}
+
+void AudioEngine::setStackedUnisonEnabled(bool enabled) {
+  postEvent({Command::SetStackedUnisonEnabled, enabled ? 1 : 0});
+}
+
+// ===== VOICE RENDERING =====
+void AudioEngine::setSimdVoicesEnabled(bool enabled) {
+  postEvent({Command::SetSimdVoicesEnabled, enabled ? 1 : 0});
+}
+
+void AudioEngine::setWavetablesEnabled(bool enabled) {
+  postEvent({Command::SetWavetablesEnabled, enabled ? 1 : 0});
+}
+
+void AudioEngine::setPolyphony(int count) {
+  postEvent({Command::SetPolyphony, count});
+}
+
+// ===== PERFORMANCE =====
+PerfSnapshot AudioEngine::getPerfStats() const {
+  PerfSnapshot stats = mPerfMonitor.snapshot();
+  RtViolations violations = rtViolations();
+  stats.rtAllocations = violations.allocations;
+  stats.rtLocks = violations.locks;
+  stats.rtLogDropped = RtLog::droppedCount();
+  return stats;
+}
+
+// ===== QUALITY =====
+void AudioEngine::setQualityTier(int tier) {
+  if (tier < static_cast<int>(QualityTier::ECO) ||
+      tier > static_cast<int>(QualityTier::HIGH)) {
+    tier = QUALITY_TIER_AUTO;
+  }
+  mQualityRequest = tier;
+  if (tier == QUALITY_TIER_AUTO) {
+    tier = mBenchmarkedTier.load();
+    if (tier == QUALITY_TIER_AUTO) {
+      return; // start() applies the benchmark result
+    }
+  }
+  postEvent({Command::SetQualityTier, tier});
+}
+
+void AudioEngine::applyQualityTier(QualityTier tier) {
+  const QualitySettings settings = QualitySettings::forTier(tier);
+  mPolyphonyManager.setFilterQuality(settings.filterControlInterval,
+                                     settings.filterOversampling);
+  mTierWavetables = settings.wavetables;
+  mTierDrumOneShots = settings.drumOneShots;
+  applyWavetables();
+  applyDrumOneShots();
+  mSynthReverb.setStereo(settings.stereoReverb);
+  mWurlitzerEngine.setReverbStereo(settings.stereoReverb);
+  mQualityTier = static_cast<int>(tier);
+}
+
+void AudioEngine::applyWavetables() {
+  mPolyphonyManager.setWavetableEnabled(mWavetablesByUser && mTierWavetables);
+}
+
+void AudioEngine::applyDrumOneShots() {
+  const bool enabled = mDrumOneShotsByUser && mTierDrumOneShots;
+  mDrumMachine.setOneShotsEnabled(enabled);
+  mMetronome.setOneShotsEnabled(enabled);
+}
+
+void AudioEngine::setMultiCoreRenderingEnabled(bool enabled) {
+  mMultiCoreRequested = enabled;
+  std::unique_lock<Mutex> lock(mStreamMutex);
+  bool running = mStream != nullptr;
+  lock.unlock();
+  if (enabled && running) {
+    startWorkerPool(); // Switched on once the workers exist
+  } else if (!enabled) {
+    // Workers stay parked until stop(); the audio thread just stops using
+    // them at the next block
+    postEvent({Command::SetMultiCoreRendering, 0});
+  }
+}
+
+void AudioEngine::setDrumOneShotsEnabled(bool enabled) {
+  postEvent({Command::SetDrumOneShotsEnabled, enabled ? 1 : 0});
 }
 
 // ===== WURLITZER CONTROLS =====
 void AudioEngine::setWurliTremoloRate(float rate) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mWurlitzerEngine.setTremoloRate(rate);
+  postEvent({Command::SetWurliTremoloRate, 0, 0, rate});
 }
 
 void AudioEngine::setWurliTremoloDepth(float depth) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mWurlitzerEngine.setTremoloDepth(depth);
+  postEvent({Command::SetWurliTremoloDepth, 0, 0, depth});
 }
 
 void AudioEngine::setWurliChorusMode(int mode) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mWurlitzerEngine.setChorusMode(mode);
+  postEvent({Command::SetWurliChorusMode, mode});
 }
 
 void AudioEngine::setWurliReverbSize(float size) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mWurlitzerEngine.setReverbSize(size);
+  postEvent({Command::SetWurliReverbSize, 0, 0, size});
 }
 
 void AudioEngine::setWurliReverbMix(float mix) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mWurlitzerEngine.setReverbMix(mix);
+  postEvent({Command::SetWurliReverbMix, 0, 0, mix});
 }
 
 void AudioEngine::setWurliDelayTime(float time) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mWurlitzerEngine.setDelayTime(time);
+  postEvent({Command::SetWurliDelayTime, 0, 0, time});
 }
 
 void AudioEngine::setWurliDelayFeedback(float feedback) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mWurlitzerEngine.setDelayFeedback(feedback);
+  postEvent({Command::SetWurliDelayFeedback, 0, 0, feedback});
 }
 
 void AudioEngine::setWurliDelayMix(float mix) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mWurlitzerEngine.setDelayMix(mix);
+  postEvent({Command::SetWurliDelayMix, 0, 0, mix});
 }
 
 void AudioEngine::setWurliVolume(float volume) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mWurlitzerEngine.setVolume(volume);
+  postEvent({Command::SetWurliVolume, 0, 0, volume});
 }
 
 // Volume controls
 void AudioEngine::setSynthVolume(float volume) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mSynthVolume = std::max(0.0f, std::min(1.0f, volume));
+  postEvent({Command::SetSynthVolume, 0, 0, volume});
 }
 
 void AudioEngine::setDrumVolume(float volume) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mDrumMachine.setVolume(volume);
+  postEvent({Command::SetDrumVolume, 0, 0, volume});
 }
 
 void AudioEngine::setMetronomeVolume(float volume) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mMetronomeVolume = std::max(0.0f, std::min(2.0f, volume));
+  postEvent({Command::SetMetronomeVolume, 0, 0, volume});
 }
 
 // Drum machine controls
 void AudioEngine::setDrumEnabled(bool enabled) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mDrumEnabledByUser = enabled;
-
-  // If enabling drums during loop playback, sync to loop position
-  if (enabled && mLooper.getState() == Looper::State::PLAYING) {
-    syncDrumToLoop();
-  }
-
-  mDrumMachine.setEnabled(enabled);
-  LOGI("Drum machine %s (user: %s)", enabled ? "enabled" : "disabled",
-       mDrumEnabledByUser ? "yes" : "no");
+  postEvent({Command::SetDrumEnabled, enabled ? 1 : 0});
+  LOGI("Drum machine %s", enabled ? "enabled" : "disabled");
 }
 
-void AudioEngine::syncDrumToLoop() {
-  // Sync drum machine beat position to match loop position
-  // This ensures drums are on-beat with the loop
-  if (mLooper.hasLoop() && mLooper.getLoopLengthSamples() > 0) {
-    // The loop and drums should be at the same beat position
-    // Reset drums to current loop beat
-    mDrumMachine.resetBeat();
-    LOGI("Drum machine synced to loop");
-  }
-}
+void AudioEngine::syncDrumToLoop() { postEvent({Command::SyncDrumToLoop}); }
 
 void AudioEngine::setDrumBPM(float bpm) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mDrumMachine.setBPM(bpm);
-  mLooper.setBPM(bpm);    // Keep looper in sync
-  mMetronome.setBPM(bpm); // Keep metronome in sync
+  postEvent({Command::SetDrumBPM, 0, 0, bpm});
 }
 
 void AudioEngine::setKickEnabled(bool enabled) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mDrumMachine.setKickEnabled(enabled);
+  postEvent({Command::SetKickEnabled, enabled ? 1 : 0});
 }
 
 void AudioEngine::setSnareEnabled(bool enabled) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mDrumMachine.setSnareEnabled(enabled);
+  postEvent({Command::SetSnareEnabled, enabled ? 1 : 0});
 }
 
 void AudioEngine::setHiHatEnabled(bool enabled) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mDrumMachine.setHiHatEnabled(enabled);
+  postEvent({Command::SetHiHatEnabled, enabled ? 1 : 0});
 }
 
 void AudioEngine::setHiHat16thNotes(bool is16th) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mDrumMachine.setHiHat16thNotes(is16th);
+  postEvent({Command::SetHiHat16thNotes, is16th ? 1 : 0});
 }
 
 // ===== DRUM PATTERN CONTROLS =====
 
 void AudioEngine::setDrumStep(int instrument, int step, float velocity) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mDrumMachine.setStep(instrument, step, velocity);
+  postEvent({Command::SetDrumStep, instrument, step, velocity});
 }
 
 float AudioEngine::getDrumStep(int instrument, int step) const {
@@ -524,13 +1250,11 @@ float AudioEngine::getDrumStep(int instrument, int step) const {
 }
 
 void AudioEngine::toggleDrumStep(int instrument, int step) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mDrumMachine.toggleStep(instrument, step);
+  postEvent({Command::ToggleDrumStep, instrument, step});
 }
 
 void AudioEngine::setDrumInstrumentVolume(int instrument, float volume) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mDrumMachine.setInstrumentVolume(instrument, volume);
+  postEvent({Command::SetDrumInstrumentVolume, instrument, 0, volume});
 }
 
 float AudioEngine::getDrumInstrumentVolume(int instrument) const {
@@ -538,56 +1262,29 @@ float AudioEngine::getDrumInstrumentVolume(int instrument) const {
 }
 
 void AudioEngine::resetDrumPattern() {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mDrumMachine.resetToDefaultPattern();
+  postEvent({Command::ResetDrumPattern});
   LOGI("Drum pattern reset to default");
 }
 
 // ===== LOOPER CONTROLS =====
 void AudioEngine::looperStartRecording() {
-  std::lock_guard<std::mutex> lock(mMutex);
-
-  // Sync looper and metronome BPM with drum machine
-  float bpm = mDrumMachine.getBPM();
-  mLooper.setBPM(bpm);
-  mMetronome.setBPM(bpm);
-
-  // Start metronome for the count-in (not drum machine)
-  mMetronome.start();
-
-  mLooper.startRecording();
-
-  LOGI("Looper: Starting recording (pre-count) with metronome at %.1f BPM",
-       bpm);
+  mLooper.prepareRecordingTrack(0);
+  postEvent({Command::LooperStartRecordingTrack, 0});
+  LOGI("Looper: Starting recording (pre-count) with metronome");
 }
 
 void AudioEngine::looperStartPlayback() {
-  std::lock_guard<std::mutex> lock(mMutex);
-
-  // Stop metronome if it was somehow still running
-  mMetronome.stop();
-
-  // If user has drums enabled, sync them to the loop start
-  if (mDrumEnabledByUser) {
-    mDrumMachine.resetBeat();
-  }
-
-  mLooper.startPlayback();
-  LOGI("Looper: Starting playback (drums %s)",
-       mDrumEnabledByUser ? "synced" : "off");
+  postEvent({Command::LooperStartPlayback});
+  LOGI("Looper: Starting playback");
 }
 
 void AudioEngine::looperStopPlayback() {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mLooper.stopPlayback();
-  mMetronome.stop(); // Ensure metronome is stopped
+  postEvent({Command::LooperStopPlayback});
   LOGI("Looper: Stopped playback");
 }
 
 void AudioEngine::looperClearLoop() {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mLooper.clearLoop();
-  mMetronome.stop();
+  postEvent({Command::LooperClearAllTracks});
   LOGI("Looper: Loop cleared");
 }
 
@@ -604,54 +1301,36 @@ int AudioEngine::getLooperCurrentBeat() const {
 int AudioEngine::getLooperCurrentBar() const { return mLooper.getCurrentBar(); }
 
 void AudioEngine::looperStartRecordingTrack(int trackIndex) {
-  std::lock_guard<std::mutex> lock(mMutex);
-
-  // Sync BPM
-  float bpm = mDrumMachine.getBPM();
-  mLooper.setBPM(bpm);
-  mMetronome.setBPM(bpm);
-
-  // Start metronome for count-in
-  mMetronome.start();
-
-  mLooper.startRecordingTrack(trackIndex);
-  LOGI("Looper: Starting recording track %d with metronome at %.1f BPM",
-       trackIndex, bpm);
+  mLooper.prepareRecordingTrack(trackIndex);
+  postEvent({Command::LooperStartRecordingTrack, trackIndex});
+  LOGI("Looper: Starting recording track %d with metronome", trackIndex);
 }
 
 void AudioEngine::looperClearTrack(int trackIndex) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mLooper.clearTrack(trackIndex);
+  postEvent({Command::LooperClearTrack, trackIndex});
   LOGI("Looper: Track %d cleared", trackIndex);
 }
 
 void AudioEngine::looperClearAllTracks() {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mLooper.clearAllTracks();
-  mMetronome.stop();
+  postEvent({Command::LooperClearAllTracks});
   LOGI("Looper: All tracks cleared");
 }
 
 void AudioEngine::looperCancelRecording() {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mLooper.cancelRecording();
-  mMetronome.stop(); // Stop metronome when canceling
+  postEvent({Command::LooperCancelRecording});
   LOGI("Looper: Recording canceled");
 }
 
 void AudioEngine::looperSetTrackVolume(int trackIndex, float volume) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mLooper.setTrackVolume(trackIndex, volume);
+  postEvent({Command::LooperSetTrackVolume, trackIndex, 0, volume});
 }
 
 void AudioEngine::looperSetTrackMuted(int trackIndex, bool muted) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mLooper.setTrackMuted(trackIndex, muted);
+  postEvent({Command::LooperSetTrackMuted, trackIndex, muted ? 1 : 0});
 }
 
 void AudioEngine::looperSetTrackSolo(int trackIndex, bool solo) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mLooper.setTrackSolo(trackIndex, solo);
+  postEvent({Command::LooperSetTrackSolo, trackIndex, solo ? 1 : 0});
 }
 
 bool AudioEngine::looperTrackHasContent(int trackIndex) const {
@@ -679,12 +1358,48 @@ int AudioEngine::looperGetUsedTrackCount() const {
 }
 
 void AudioEngine::looperSetBarCount(int bars) {
-  std::lock_guard<std::mutex> lock(mMutex);
-  mLooper.setBarCount(bars);
+  postEvent({Command::LooperSetBarCount, bars});
 }
 
 int AudioEngine::looperGetBarCount() const { return mLooper.getBarCount(); }
 
+bool AudioEngine::looperConfigure(int trackCount, int maxBars,
+                                  int64_t memoryBudget,
+                                  const char *sessionPath) {
+  std::lock_guard<Mutex> lock(mStreamMutex);
+  if (mStream) {
+    LOGE("Looper capacity can only change while the stream is stopped");
+    return false;
+  }
+  size_t budget = static_cast<size_t>(std::max<int64_t>(0, memoryBudget));
+  bool ok = mLooper.configure(trackCount, maxBars, budget, sessionPath);
+  // A reopened session keeps the rate it was recorded at; the stream is
+  // then requested at that rate (see createStream)
+  const int looperRate = static_cast<int>(mLooper.getSampleRate());
+  if (looperRate != mSampleRate.load()) {
+    LOGI("Looper session at %d Hz, engine follows", looperRate);
+    applySampleRate(looperRate);
+  }
+  LOGI("Looper capacity: %d tracks, %d bars at current tempo (%.1f MB)",
+       mLooper.getTrackCount(), mLooper.getMaxBars(),
+       mLooper.getReservedBytes() / (1024.0 * 1024.0));
+  return ok;
+}
+
+bool AudioEngine::looperSaveSession(bool wait) {
+  return mLooper.saveSession(wait);
+}
+
+int AudioEngine::looperGetTrackCount() const {
+  return mLooper.getTrackCount();
+}
+
+int AudioEngine::looperGetMaxBars() const { return mLooper.getMaxBars(); }
+
+bool AudioEngine::looperBounceTracks(int trackMask) {
+  return postEvent({Command::LooperBounceTracks, trackMask});
+}
+
 std::vector<float> AudioEngine::looperGetMixedBuffer(int trackMask) const {
   return mLooper.getMixedBuffer(trackMask);
 }
@@ -693,133 +1408,351 @@ int64_t AudioEngine::looperGetBufferSize() const {
   return mLooper.getLoopLengthSamples() * 2; // Stereo interleaved
 }
 
+void AudioEngine::captureExportSnapshot(int trackMask) {
+  ExportSnapshot &snapshot = mExportSnapshot;
+  // The track being recorded is still being written by the audio thread
+  const int recordingTrack = mLooper.getActiveRecordingTrack();
+  snapshot.loopLength = mLooper.getLoopLengthSamples();
+  snapshot.barCount = mLooper.getBarCount();
+  snapshot.numTracks = 0;
+  for (int t = 0; t < mLooper.getTrackCount(); ++t) {
+    if ((trackMask & (1 << t)) == 0 || t == recordingTrack ||
+        !mLooper.trackHasContent(t)) {
+      continue;
+    }
+    snapshot.tracks[snapshot.numTracks++] = {
+        mLooper.getTrackFrames(t),
+        std::min(snapshot.loopLength, mLooper.getTrackBufferSize(t)),
+        mLooper.getTrackMixVolume(t)};
+  }
+  snapshot.drums.copyPatternFrom(mDrumMachine);
+}
+
+std::unique_ptr<OfflineRenderer>
+AudioEngine::createOfflineRenderer(int trackMask, bool includeDrums, int bars,
+                                   int64_t &numFrames) {
+  numFrames = 0;
+  // Pinned before the capture, so no track captured can be cleared until
+  // the render is done
+  mLooper.pinTracks();
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(EXPORT_CAPTURE_TIMEOUT_MS);
+
+  // A bounce started before the pin may be overwriting a track; none can
+  // start in place from here on
+  while (mLooper.isBouncingInPlace() &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  if (mLooper.isBouncingInPlace()) {
+    LOGE("Export not started, a bounce is still rewriting a track");
+    mLooper.unpinTracks();
+    return nullptr;
+  }
+
+  std::unique_lock<Mutex> streamLock(mStreamMutex);
+  if (mStream) {
+    const uint32_t request = mExportRequest.load() + 1;
+    mExportRequest.store(request);
+    streamLock.unlock();
+    const bool posted = postEvent(
+        {Command::CaptureExport, trackMask, static_cast<int32_t>(request)});
+    auto captured = [this, request] {
+      return mExportCaptured.load(std::memory_order_acquire) == request;
+    };
+    while (posted && !captured() &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (!captured()) {
+      // The stream may have gone away meanwhile; with no callback left the
+      // graph can be read here
+      streamLock.lock();
+      if (mStream) {
+        LOGE("Export snapshot not taken, the audio callback is stalled");
+        mExportRequest.store(request + 1); // Drop the late capture
+        mLooper.unpinTracks();
+        return nullptr;
+      }
+      mExportRequest.store(request + 1);
+      captureExportSnapshot(trackMask);
+    }
+  } else {
+    // No callback to race; holding the lock keeps one from starting
+    captureExportSnapshot(trackMask);
+  }
+  if (streamLock.owns_lock()) {
+    streamLock.unlock();
+  }
+
+  const ExportSnapshot &snapshot = mExportSnapshot;
+  auto renderer =
+      std::make_unique<OfflineRenderer>(static_cast<float>(mSampleRate.load()));
+  bool hasTracks = false;
+  for (int t = 0; t < snapshot.numTracks; ++t) {
+    const ExportTrack &track = snapshot.tracks[t];
+    renderer->addLoopTrack(track.frames, track.length, track.volume);
+    hasTracks = hasTracks || track.length > 0;
+  }
+  if (includeDrums) {
+    renderer->setDrums(snapshot.drums);
+  }
+
+  if (!hasTracks && !includeDrums) {
+    mLooper.unpinTracks();
+    return nullptr;
+  }
+
+  // Tracks and drums share the drum machine's tempo
+  if (bars <= 0 && hasTracks) {
+    numFrames = snapshot.loopLength;
+  } else {
+    if (bars <= 0) {
+      bars = snapshot.barCount;
+    }
+    double samplesPerBar = mSampleRate.load() * 60.0 /
+                           snapshot.drums.getBPM() * Looper::BEATS_PER_BAR;
+    numFrames = static_cast<int64_t>(samplesPerBar * bars);
+  }
+  return renderer;
+}
+
+std::vector<float> AudioEngine::renderOffline(int trackMask, bool includeDrums,
+                                              int bars) {
+  std::lock_guard<Mutex> lock(mExportMutex);
+  int64_t numFrames = 0;
+  auto renderer = createOfflineRenderer(trackMask, includeDrums, bars, numFrames);
+  if (!renderer) {
+    return std::vector<float>();
+  }
+  std::vector<float> mix = renderer->render(numFrames);
+  mLooper.unpinTracks();
+  return mix;
+}
+
+int64_t AudioEngine::exportToFile(int fd, ExportFormat format, int trackMask,
+                                  bool includeDrums, int bars) {
+  std::lock_guard<Mutex> lock(mExportMutex);
+  mExportProgress = 0.0f;
+  int64_t numFrames = 0;
+  std::unique_ptr<OfflineRenderer> renderer =
+      createOfflineRenderer(trackMask, includeDrums, bars, numFrames);
+  if (!renderer) {
+    return 0;
+  }
+
+  // The renderer runs at the engine rate, so the file does too
+  const int sampleRate = mSampleRate.load();
+  std::unique_ptr<ExportWriter> writer;
+  if (format == ExportFormat::AAC) {
+    auto aac = std::make_unique<AacFileWriter>(fd, sampleRate);
+    if (!aac->isOpen()) {
+      mLooper.unpinTracks();
+      return -1;
+    }
+    writer = std::move(aac);
+  } else {
+    writer = std::make_unique<WavFileWriter>(fd, sampleRate);
+  }
+
+  const auto startTime = std::chrono::steady_clock::now();
+  renderer->start(numFrames);
+  ExportPipeline pipeline;
+  const int64_t written =
+      pipeline.run(*renderer, *writer, numFrames, &mExportProgress);
+  mLooper.unpinTracks();
+  auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - startTime)
+                       .count();
+  LOGI("Export wrote %lld frames (%s) in %lld ms",
+       static_cast<long long>(written),
+       format == ExportFormat::AAC ? "AAC" : "WAV",
+       static_cast<long long>(elapsedMs));
+  return written;
+}
+
 oboe::DataCallbackResult
 AudioEngine::onAudioReady(oboe::AudioStream *audioStream, void *audioData,
                           int32_t numFrames) {
-  // Clear buffer
-  memset(audioData, 0, numFrames * CHANNEL_COUNT * sizeof(float));
-
+  AudioThreadScope audioThread;
+  ScopedFlushToZero flushToZero;
   float *output = static_cast<float *>(audioData);
 
-  for (int i = 0; i < numFrames; ++i) {
-    float synthL = 0.0f;
-    float synthR = 0.0f;
+  int64_t callbackNanos =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+  mPerfMonitor.beginCallback(callbackNanos, numFrames,
+                             audioStream->getSampleRate());
+  int numEvents = drainEvents(numFrames, callbackNanos);
+
+  // Render the burst in blocks so every stage runs as one tight loop,
+  // splitting at each event so it lands on its exact frame
+  int nextEvent = 0;
+  int32_t frame = 0;
+  while (frame < numFrames) {
+    while (nextEvent < numEvents && mScheduledEvents[nextEvent].frame <= frame) {
+      applyEvent(mScheduledEvents[nextEvent++].event);
+    }
 
-    // Render Synth or Wurlitzer (live input)
-    if (mWurlitzerMode) {
-      mWurlitzerEngine.process(synthL, synthR);
-    } else {
-      mPolyphonyManager.nextSample(synthL, synthR);
+    int32_t end = std::min<int32_t>(frame + MAX_BLOCK_SIZE, numFrames);
+    if (nextEvent < numEvents) {
+      end = std::min(end, mScheduledEvents[nextEvent].frame);
+    }
+    renderBlock(output + frame * CHANNEL_COUNT, end - frame);
+    frame = end;
+  }
+
+  const bool wurlitzer = mWurlitzerMode.load(std::memory_order_relaxed);
+  int activeVoices = wurlitzer ? mWurlitzerEngine.getActiveVoiceCount()
+                               : mPolyphonyManager.getActiveVoiceCount();
+  int voiceLimit = wurlitzer ? mWurlitzerEngine.getVoiceLimit()
+                             : mPolyphonyManager.getVoiceLimit();
+  auto xRunResult = audioStream->getXRunCount();
+  int32_t xRuns = xRunResult ? xRunResult.value() : -1;
+  float load = mPerfMonitor.endCallback(activeVoices, voiceLimit, xRuns);
+  governVoices(load, activeVoices, numFrames, audioStream->getSampleRate());
+  tuneBufferSize(audioStream, xRuns);
+  measureOutputLatency(audioStream, numFrames);
+
+  return oboe::DataCallbackResult::Continue;
+}
+
+void AudioEngine::governVoices(float load, int activeVoices, int numFrames,
+                                int sampleRate) {
+  mVoiceGovernor.update(load, activeVoices, numFrames, sampleRate);
+  // Both engines follow the same budget, so switching modes under load
+  // doesn't start from an unaffordable voice count
+  const int budget = mVoiceGovernor.getBudget();
+  const bool underPressure = mVoiceGovernor.isUnderPressure();
+  mPolyphonyManager.setVoiceBudget(budget, underPressure);
+  mWurlitzerEngine.setVoiceBudget(budget, underPressure);
+}
+
+void AudioEngine::renderDrumBusJob(void *context) {
+  auto *job = static_cast<DrumBusJob *>(context);
+  job->engine->renderDrumBus(job->looperState, job->numFrames);
+}
+
+void AudioEngine::renderDrumBus(Looper::State looperState, int numFrames) {
+  const int64_t stageStart = PerfMonitor::now();
+
+  // Metronome plays during pre-count and recording to provide timing;
+  // outside them it only lets a last click ring out
+  float *metronome = mMetronomeBuffer;
+  bool needsMetronome = (looperState == Looper::State::PRE_COUNT ||
+                         looperState == Looper::State::RECORDING);
+  mMetronome.processBlock(metronome, numFrames, mTransportEvents,
+                          needsMetronome ? mNumTransportEvents : 0);
+
+  // Drum machine plays only when:
+  // 1. User has explicitly enabled it (mDrumEnabledByUser), OR
+  // 2. During loop playback if user has drums enabled
+  // NOT during pre-count or recording (metronome is used instead)
+  float *drums = mDrumBuffer;
+  bool shouldPlayDrums = mDrumEnabledByUser &&
+                         looperState != Looper::State::PRE_COUNT &&
+                         looperState != Looper::State::RECORDING;
+
+  if (shouldPlayDrums) {
+    mDrumMachine.processBlock(drums, numFrames, mTransportEvents,
+                              mNumTransportEvents);
+  } else {
+    std::fill(drums, drums + numFrames, 0.0f);
+  }
+
+  mPerfMonitor.endStage(PERF_STAGE_DRUMS, stageStart);
+}
 
-      // Apply synth effects chain: Tremolo -> Delay -> Reverb
-      mSynthTremolo.process(synthL, synthR);
-      mSynthDelay.process(synthL, synthR);
-      mSynthReverb.process(synthL, synthR);
+void AudioEngine::renderBlock(float *output, int numFrames) {
+  float *synthL = mSynthBufferL;
+  float *synthR = mSynthBufferR;
 
-      // Bass boost: Simple low-shelf filter to enhance sub-200Hz frequencies
-      // Using a one-pole lowpass to extract bass, then adding it back
-      static float bassFilterL = 0.0f;
-      static float bassFilterR = 0.0f;
-      constexpr float BASS_CUTOFF = 0.02f;      // ~200Hz at 48kHz (lower = lower cutoff)
-      constexpr float BASS_BOOST_AMOUNT = 0.4f; // ~3dB boost to low end
+  // Looper state for audio routing decisions. Sampled before the looper runs
+  // so the drum bus, which only depends on it, can start right away; a
+  // transition inside the looper reaches the drums one block later.
+  Looper::State looperState = mLooper.getState();
 
+  // Steps of this block for the drum bus, with the bar restarting wherever
+  // the loop does, so drums and metronome stay locked to the looper
+  mNumTransportEvents = mTransport.advance(
+      numFrames, mLooper.getFramesToLoopStart(), mTransportEvents);
+
+  // The drum bus is independent of the synth path: hand it to a worker and
+  // pick it up before the final mix
+  DrumBusJob drumBusJob{this, looperState, numFrames};
+  if (mUseWorkerPool) {
+    mWorkerPool.submit(&AudioEngine::renderDrumBusJob, &drumBusJob);
+  } else {
+    renderDrumBus(looperState, numFrames);
+  }
+
+  // Render Synth or Wurlitzer (live input)
+  int64_t stageStart = PerfMonitor::now();
+  if (mWurlitzerMode.load(std::memory_order_relaxed)) {
+    mWurlitzerEngine.processBlock(synthL, synthR, numFrames);
+    stageStart = mPerfMonitor.endStage(PERF_STAGE_POLYPHONY, stageStart);
+  } else {
+    mPolyphonyManager.processBlock(synthL, synthR, numFrames);
+    stageStart = mPerfMonitor.endStage(PERF_STAGE_POLYPHONY, stageStart);
+
+    // Apply synth effects chain: Tremolo -> Delay -> Reverb
+    mSynthTremolo.processBlock(synthL, synthR, numFrames);
+    mSynthDelay.processBlock(synthL, synthR, numFrames);
+    mSynthReverb.processBlock(synthL, synthR, numFrames);
+
+    // Bass boost: Simple low-shelf filter to enhance sub-200Hz frequencies
+    // Using a one-pole lowpass to extract bass, then adding it back
+    static float bassFilterL = 0.0f;
+    static float bassFilterR = 0.0f;
+    constexpr float BASS_CUTOFF = 0.02f;      // ~200Hz at 48kHz (lower = lower cutoff)
+    constexpr float BASS_BOOST_AMOUNT = 0.4f; // ~3dB boost to low end
+
+    for (int i = 0; i < numFrames; ++i) {
       // One-pole lowpass to extract bass
-      bassFilterL += BASS_CUTOFF * (synthL - bassFilterL);
-      bassFilterR += BASS_CUTOFF * (synthR - bassFilterR);
+      bassFilterL += BASS_CUTOFF * (synthL[i] - bassFilterL);
+      bassFilterR += BASS_CUTOFF * (synthR[i] - bassFilterR);
 
       // Add extracted bass back for boost
-      synthL += bassFilterL * BASS_BOOST_AMOUNT;
-      synthR += bassFilterR * BASS_BOOST_AMOUNT;
-    }
-
-    // Apply Master Volume to both Synth and Wurlitzer
-    synthL *= mSynthVolume;
-    synthR *= mSynthVolume;
-
-    // Process looper - records synth audio and/or plays back loop
-    float loopL = 0.0f;
-    float loopR = 0.0f;
-    mLooper.process(synthL, synthR, loopL, loopR);
-
-    // Get looper state for audio routing decisions
-    Looper::State looperState = mLooper.getState();
-
-    // Metronome plays during pre-count and recording to provide timing
-    // We use the drum machine's kick directly since it's proven to work
-    float metronomeSample = 0.0f;
-    bool needsMetronome = (looperState == Looper::State::PRE_COUNT ||
-                           looperState == Looper::State::RECORDING);
-
-    // Static variables for metronome timing (outside if/else for proper scope)
-    static bool metronomeWasActive = false;
-    static float metroSampleCounter = 0.0f;
-    static int metroBeat = 0;
-    static float metroSamplesPerBeat = 0.0f;
-
-    if (needsMetronome) {
-      // Initialize on first frame of metronome
-      if (!metronomeWasActive) {
-        metronomeWasActive = true;
-        metroSampleCounter = 0.0f;
-        metroBeat = 0;
-        metroSamplesPerBeat = SAMPLE_RATE * 60.0f / mDrumMachine.getBPM();
-
-        // Trigger first snare immediately (higher pitch than kick, cuts through
-        // better)
-        mDrumMachine.triggerSnare();
-        LOGI("Metronome started via DrumMachine snare, BPM=%.1f",
-             mDrumMachine.getBPM());
-      }
+      synthL[i] += bassFilterL * BASS_BOOST_AMOUNT;
+      synthR[i] += bassFilterR * BASS_BOOST_AMOUNT;
+    }
+  }
 
-      // Get the drum synth output
-      // Note: Volume is applied later in mixing stage
-      constexpr float METRONOME_VOLUME = 1.8f; // Loud metronome
-      metronomeSample = mDrumMachine.getDrumSynthSample() * METRONOME_VOLUME;
-
-      // Advance timing
-      metroSampleCounter += 1.0f;
-      if (metroSampleCounter >= metroSamplesPerBeat) {
-        metroSampleCounter -= metroSamplesPerBeat;
-        metroBeat = (metroBeat + 1) % 4;
-        mDrumMachine.triggerSnare(); // Use snare for all metronome beats
-        LOGI("Metronome beat %d", metroBeat);
-      }
-    } else {
-      // Reset metronome state when not active
-      metronomeWasActive = false;
-    }
-
-    // Drum machine plays only when:
-    // 1. User has explicitly enabled it (mDrumEnabledByUser), OR
-    // 2. During loop playback if user has drums enabled
-    // NOT during pre-count or recording (metronome is used instead)
-    float drumSample = 0.0f;
-    bool shouldPlayDrums = mDrumEnabledByUser &&
-                           looperState != Looper::State::PRE_COUNT &&
-                           looperState != Looper::State::RECORDING;
-
-    if (shouldPlayDrums) {
-      drumSample = mDrumMachine.nextSample();
-    }
-
-    // =========== CLEAN GAIN STAGING (No Limiter) ===========
-    // Best practice: Set gains so sum of ALL sources at MAX stays under 1.0
-    // This gives linear volume response with no compression artifacts
-    //
-    // 2x overall volume boost for louder output
-    // Drum ratio changed from 15x to 12x (synth more audible)
-    // Metronome matches drum ratio for consistent volume
-    //
-    constexpr float SYNTH_GAIN = 0.09f; // 2x boost (was 0.045)
-    constexpr float DRUM_GAIN = 1.08f;  // 12x relative to synth (was 15x/0.675)
-    constexpr float METRO_GAIN =
-        1.08f; // Same as drums for consistent metronome volume
+  // Apply Master Volume to both Synth and Wurlitzer
+  mSynthVolume.applyGain(synthL, synthR, numFrames);
+
+  stageStart = mPerfMonitor.endStage(PERF_STAGE_EFFECTS, stageStart);
+
+  // Process looper - records synth audio and/or plays back loop
+  mLooper.processBlock(synthL, synthR, mLoopBufferL, mLoopBufferR, numFrames);
+  mPerfMonitor.endStage(PERF_STAGE_LOOPER, stageStart);
+
+  // Every job of the block (drum bus, voice split) is done after this
+  if (mUseWorkerPool) {
+    mWorkerPool.waitAll();
+  }
+  const float *metronome = mMetronomeBuffer;
+  const float *drums = mDrumBuffer;
+
+  // =========== CLEAN GAIN STAGING (No Limiter) ===========
+  // Best practice: Set gains so sum of ALL sources at MAX stays under 1.0
+  // This gives linear volume response with no compression artifacts
+  //
+  // 2x overall volume boost for louder output
+  // Drum ratio changed from 15x to 12x (synth more audible)
+  // Metronome matches drum ratio for consistent volume
+  //
+  constexpr float SYNTH_GAIN = MIX_SYNTH_GAIN; // 2x boost (was 0.045)
+  constexpr float DRUM_GAIN = MIX_DRUM_GAIN;   // 12x relative to synth (was 15x/0.675)
+  const SmoothedParameter::Ramp metronomeVolume = mMetronomeVolume.nextBlock(numFrames);
 
+  for (int i = 0; i < numFrames; ++i) {
     // Apply gain to each source - completely independent, no interaction
-    float synthMixL = (synthL + loopL) * SYNTH_GAIN;
-    float synthMixR = (synthR + loopR) * SYNTH_GAIN;
-    float drumMix = drumSample * DRUM_GAIN;
-    float metroMix = metronomeSample * mMetronomeVolume;
+    float synthMixL = (synthL[i] + mLoopBufferL[i]) * SYNTH_GAIN;
+    float synthMixR = (synthR[i] + mLoopBufferR[i]) * SYNTH_GAIN;
+    float drumMix = drums[i] * DRUM_GAIN;
+    float metroMix = metronome[i] * metronomeVolume.at(i);
 
     // =========== SIMPLE SUM ===========
     // No limiter = no pumping, no ducking, no artifacts
@@ -836,8 +1769,6 @@ AudioEngine::onAudioReady(oboe::AudioStream *audioStream, void *audioData,
     output[i * 2] = finalL;
     output[i * 2 + 1] = finalR;
   }
-
-  return oboe::DataCallbackResult::Continue;
 }
 
 } // namespace synthio
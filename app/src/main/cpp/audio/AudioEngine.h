@@ -1,17 +1,33 @@
 #ifndef SYNTHIO_AUDIO_ENGINE_H
 #define SYNTHIO_AUDIO_ENGINE_H
 
+#include "DSPConfig.h"
 #include "Delay.h"
 #include "DrumMachine.h"
+#include "EventQueue.h"
 #include "Looper.h"
 #include "Metronome.h"
+#include "OfflineRenderer.h"
+#include "PerfMonitor.h"
 #include "PolyphonyManager.h"
+#include "QualityTier.h"
 #include "Reverb.h"
+#include "RtCheck.h"
+#include "SmoothedParameter.h"
+#include "SynthPatch.h"
+#include "Transport.h"
 #include "Tremolo.h"
+#include "VoiceGovernor.h"
+#include "WorkerPool.h"
 #include "WurlitzerEngine.h"
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <oboe/Oboe.h>
+#include <thread>
 
 namespace synthio {
 
@@ -19,6 +35,11 @@ namespace synthio {
  * Main audio engine using Oboe for low-latency audio output.
  * Supports Bluetooth audio devices through shared mode and proper audio
  * attributes. Handles audio device changes (connect/disconnect) automatically.
+ *
+ * Threading: every setter/note method below is safe to call from any thread.
+ * They never touch DSP state directly - each call is timestamped and pushed
+ * onto a lock-free event queue that the audio callback drains and applies at
+ * the matching frame offset inside the next buffer.
  */
 class AudioEngine : public oboe::AudioStreamDataCallback,
                     public oboe::AudioStreamErrorCallback {
@@ -29,7 +50,24 @@ public:
   // Lifecycle
   bool start();
   void stop();
-  void restart(); // Restart audio stream (e.g., after device change)
+  // Reopens the stream on the recovery thread (e.g., after device change);
+  // returns immediately and keeps voices, looper and drum transport running
+  void restart();
+
+  // ===== OUTPUT LATENCY =====
+  // Bluetooth outputs get a shared stream; wired/built-in outputs try an
+  // exclusive (MMAP) stream first. Reopens the stream when the route
+  // changes while running.
+  void setBluetoothOutput(bool bluetooth);
+  // Measured from stream timestamps on the audio thread; -1 if not
+  // available yet. Looper takes are compensated by the same figure.
+  double getOutputLatencyMillis() const;
+  int getBufferSizeFrames() const;
+  bool isExclusiveStream() const;
+  // Device the open stream is routed to (AudioDeviceInfo id), 0 if closed
+  int32_t getOutputDeviceId() const { return mOutputDeviceId.load(); }
+  // Rate the DSP graph runs at; follows the device's native rate
+  int getSampleRate() const { return mSampleRate.load(); }
 
   // Note control
   void noteOn(int midiNote, float frequency);
@@ -38,9 +76,25 @@ public:
   void noteOff(int midiNote);
   void allNotesOff();
 
+  // ===== MIDI INPUT =====
+  // Notes from the native MIDI reader. timeNanos is the message timestamp
+  // (CLOCK_MONOTONIC, the steady_clock base), so the callback places the
+  // note where the key was struck rather than where the reader woke up.
+  void midiNoteOn(int midiNote, float velocity, int64_t timeNanos);
+  void midiNoteOff(int midiNote, int64_t timeNanos);
+
+  // ===== PATCHES =====
+  // Applies a whole synth preset at once. The derived voice coefficients
+  // are computed on the calling thread; the callback picks the result up
+  // as a single event, so a preset change is one render segment instead of
+  // dozens. Returns false if too many patches are still in flight.
+  bool setPatch(const SynthPatch &patch);
+
   // ===== MODE SWITCHING =====
   void setWurlitzerMode(bool enabled);
-  bool isWurlitzerMode() const { return mWurlitzerMode; }
+  bool isWurlitzerMode() const {
+    return mWurlitzerMode.load(std::memory_order_relaxed);
+  }
 
   // ===== OSCILLATOR PARAMETERS =====
   void setWaveform(int waveform);
@@ -76,6 +130,8 @@ public:
   void setSynthTremoloDepth(float depth);
   void setSynthReverbSize(float size);
   void setSynthReverbMix(float mix);
+  // Reverb::Mode for the synth and Wurlitzer reverbs (0 = combs, 1 = FDN)
+  void setReverbMode(int mode);
   void setSynthDelayTime(float time);
   void setSynthDelayFeedback(float feedback);
   void setSynthDelayMix(float mix);
@@ -88,6 +144,29 @@ public:
   void setUnisonEnabled(bool enabled);
   void setUnisonVoices(int count);
   void setUnisonDetune(float cents);
+  // Detuned oscillator stacks inside one voice per note (default) vs one
+  // whole voice per unison copy
+  void setStackedUnisonEnabled(bool enabled);
+
+  // ===== VOICE RENDERING =====
+  void setSimdVoicesEnabled(bool enabled); // Vectorized bank vs scalar voices
+  void setWavetablesEnabled(bool enabled);  // Wavetable vs polyBLEP oscillators
+  // Render graph on helper cores (drum bus and half the voices in parallel
+  // with the rest of the synth). On by default with 4+ CPUs.
+  void setMultiCoreRenderingEnabled(bool enabled);
+  // Pre-rendered drum hits vs per-sample drum synthesis (drum machine and
+  // metronome). On by default; the quality tier can still hold either of
+  // these and the wavetables off.
+  void setDrumOneShotsEnabled(bool enabled);
+  // Voices that may sound at once, synth and Wurlitzer (1 - 32, default
+  // 12). Under CPU pressure the governor lowers the effective limit.
+  void setPolyphony(int count);
+
+  // ===== QUALITY =====
+  // QualityTier value, or QUALITY_TIER_AUTO (default) for the tier the
+  // start-up benchmark picked
+  void setQualityTier(int tier);
+  int getQualityTier() const { return mQualityTier.load(); } // In effect
 
   // ===== WURLITZER CONTROLS =====
   void setWurliTremoloRate(float rate);
@@ -158,10 +237,52 @@ public:
   void looperSetBarCount(int bars);
   int looperGetBarCount() const;
 
+  // Looper capacity: reserves trackCount tracks of up to maxBars within
+  // memoryBudget bytes, backed by the session file at sessionPath if given
+  // (reopening the session stored there). Allocates, so it is refused
+  // (returns false) while the stream is running; call it between create and
+  // start.
+  bool looperConfigure(int trackCount, int maxBars, int64_t memoryBudget,
+                       const char *sessionPath);
+  // Flushes the looper session file (no-op without one)
+  bool looperSaveSession(bool wait);
+  int looperGetTrackCount() const;
+  int looperGetMaxBars() const;
+
+  // Merges the selected tracks into one free track, or the lowest selected
+  // one when none is free, and frees the rest (see Looper::bounceTracks). Queued: the callback reserves the target and the
+  // looper's worker mixes it in the background. Returns false only if the
+  // request couldn't be queued; the state callback reports the merge.
+  bool looperBounceTracks(int trackMask);
+
   // Looper audio export
   std::vector<float> looperGetMixedBuffer(int trackMask) const;
   int64_t looperGetBufferSize() const;
 
+  // Offline mixdown of the selected loop tracks (and optionally the drum
+  // pattern) for bars bars, rendered faster than realtime on the calling
+  // thread plus workers. bars <= 0 renders one loop length. Returns
+  // interleaved stereo, or an empty vector if there is nothing to render.
+  std::vector<float> renderOffline(int trackMask, bool includeDrums,
+                                   int bars);
+
+  // Export of the same mixdown straight into a file descriptor (owned and
+  // closed by the caller). Rendering runs on the calling thread while a
+  // writer thread encodes the previous chunk, so memory is bounded by a few
+  // chunks whatever the length. Blocks until done: returns the frames
+  // written, 0 if there is nothing to export, -1 on failure. One export at a
+  // time, from control threads only.
+  enum class ExportFormat { WAV = 0, AAC = 1 };
+  int64_t exportToFile(int fd, ExportFormat format, int trackMask,
+                       bool includeDrums, int bars);
+  // Progress of the running (or last) export, 0..1, from any thread
+  float getExportProgress() const { return mExportProgress.load(); }
+
+  // ===== PERFORMANCE STATS =====
+  // Callback telemetry, readable from any thread without blocking audio
+  PerfSnapshot getPerfStats() const;
+  void resetPerfStats() { mPerfMonitor.reset(); }
+
   // Oboe data callback
   oboe::DataCallbackResult onAudioReady(oboe::AudioStream *audioStream,
                                         void *audioData,
@@ -173,29 +294,298 @@ public:
 
 private:
   std::shared_ptr<oboe::AudioStream> mStream;
+
+  // Delay memory of every effect in both chains, laid out again on each
+  // sample rate change
+  EffectArena mEffectArena;
+
   PolyphonyManager mPolyphonyManager;
   WurlitzerEngine mWurlitzerEngine;
   DrumMachine mDrumMachine;
   Looper mLooper;
   Metronome mMetronome;
 
+  // Musical clock for the drum machine and metronome (audio thread).
+  // renderBlock() advances it once per block into mTransportEvents, which
+  // the drum bus consumes.
+  Transport mTransport;
+  TransportEvent mTransportEvents[Transport::MAX_EVENTS];
+  int mNumTransportEvents = 0;
+
   // Synth effects chain (applied after polyphony manager)
   Tremolo mSynthTremolo;
   Delay mSynthDelay;
   Reverb mSynthReverb;
 
-  std::mutex mMutex;
-
-  bool mWurlitzerMode = false;
-  float mSynthVolume = 0.7f;
-  float mMetronomeVolume = 0.3f; // Default louder than previous 0.1f equivalent
+  std::atomic<bool> mWurlitzerMode{false};
+  SmoothedParameter mSynthVolume{0.7f};
+  SmoothedParameter mMetronomeVolume{0.3f}; // Default louder than previous 0.1f equivalent
   bool mDrumEnabledByUser = false; // Track if user manually enabled drums
-  std::atomic<bool> mIsRestarting{false}; // Prevent multiple restarts
 
-  static constexpr int SAMPLE_RATE = 48000;
+  // Control-side mirror of the enabled waveform bitmask, so the wavetable for
+  // a combination can be built before the audio thread switches to it
+  std::atomic<int> mControlWaveformMask{1 << static_cast<int>(Waveform::SAWTOOTH)};
+  std::thread mWavetableBuilder; // Pre-builds the remaining combinations
+
+  // Serializes exports (control threads only)
+  Mutex mExportMutex;
+  std::atomic<float> mExportProgress{0.0f};
+
+  // What an export renders, captured by the callback between blocks
+  // (CaptureExport) so the track list and drum pattern match what is
+  // playing. The exporter posts request n and reads the snapshot once
+  // mExportCaptured reaches n; a request it gave up on is skipped.
+  struct ExportTrack {
+    const int16_t *frames;
+    int64_t length;
+    float volume;
+  };
+  struct ExportSnapshot {
+    std::array<ExportTrack, Looper::MAX_TRACKS> tracks;
+    int numTracks = 0;
+    int64_t loopLength = 0;
+    int barCount = 0;
+    DrumMachine drums;
+  };
+  ExportSnapshot mExportSnapshot;
+  std::atomic<uint32_t> mExportRequest{0};
+  std::atomic<uint32_t> mExportCaptured{0};
+  static constexpr int EXPORT_CAPTURE_TIMEOUT_MS = 2000;
+  // Audio thread, or the exporter while no stream exists
+  void captureExportSnapshot(int trackMask);
+
+  PerfMonitor mPerfMonitor;
+  // Audio thread: trims the voice limit when callbacks run out of budget
+  VoiceGovernor mVoiceGovernor{MAX_POLYPHONY};
+  void governVoices(float load, int activeVoices, int numFrames,
+                    int sampleRate);
+
+  // Until the first stream reports its native rate
+  static constexpr int DEFAULT_SAMPLE_RATE = 48000;
+  std::atomic<int> mSampleRate{DEFAULT_SAMPLE_RATE};
   static constexpr int CHANNEL_COUNT = 2; // Stereo
 
+  // Scratch buffers for one block of the signal chain (audio thread only)
+  float mSynthBufferL[MAX_BLOCK_SIZE];
+  float mSynthBufferR[MAX_BLOCK_SIZE];
+  float mLoopBufferL[MAX_BLOCK_SIZE];
+  float mLoopBufferR[MAX_BLOCK_SIZE];
+  float mMetronomeBuffer[MAX_BLOCK_SIZE];
+  float mDrumBuffer[MAX_BLOCK_SIZE];
+
+  // ===== RENDER GRAPH =====
+  // Independent stages of a block run as pool jobs: the drum bus (drum
+  // machine + metronome) alongside the synth/Wurlitzer, and half of the
+  // sounding voices inside PolyphonyManager. The threads live from start()
+  // to stop(); the audio thread only sees the pool via mPolyphonyManager's
+  // pointer and mUseWorkerPool, both switched by event.
+  WorkerPool mWorkerPool;
+  std::atomic<bool> mMultiCoreRequested{false};
+  bool mUseWorkerPool = false; // Audio thread
+
+  // ===== QUALITY =====
+  // The benchmark runs on the first start(); until then (and for manual
+  // tiers) the requested tier applies as is
+  std::atomic<int> mQualityRequest{QUALITY_TIER_AUTO};
+  std::atomic<int> mBenchmarkedTier{QUALITY_TIER_AUTO};
+  std::atomic<int> mQualityTier{static_cast<int>(QualityTier::STANDARD)};
+  void applyQualityTier(QualityTier tier); // Audio thread
+  // The tier caps the user's choices rather than overriding them: each
+  // feature is on only while both allow it (audio thread)
+  bool mWavetablesByUser = true;
+  bool mDrumOneShotsByUser = true;
+  bool mTierWavetables = true;
+  bool mTierDrumOneShots = true;
+  void applyWavetables();
+  void applyDrumOneShots();
+  struct DrumBusJob {
+    AudioEngine *engine;
+    Looper::State looperState;
+    int numFrames;
+  };
+  static void renderDrumBusJob(void *context);
+  // Fills mMetronomeBuffer and mDrumBuffer for the block
+  void renderDrumBus(Looper::State looperState, int numFrames);
+  void startWorkerPool(); // Control thread
+
+  // ===== CONTROL EVENTS (UI/MIDI -> audio thread) =====
+  enum class Command : uint8_t {
+    NoteOn,
+    NoteOff,
+    AllNotesOff,
+    SetWurlitzerMode,
+    SetWaveform,
+    ToggleWaveform,
+    SetPulseWidth,
+    SetSubOscLevel,
+    SetNoiseLevel,
+    SetFilterCutoff,
+    SetFilterResonance,
+    SetFilterEnvelopeAmount,
+    SetFilterKeyTracking,
+    SetHPFCutoff,
+    SetAttack,
+    SetDecay,
+    SetSustain,
+    SetRelease,
+    SetLFORate,
+    SetLFOPitchDepth,
+    SetLFOFilterDepth,
+    SetLFOPWMDepth,
+    SetChorusMode,
+    SetSynthTremoloRate,
+    SetSynthTremoloDepth,
+    SetSynthReverbSize,
+    SetSynthReverbMix,
+    SetReverbMode,
+    SetSynthDelayTime,
+    SetSynthDelayFeedback,
+    SetSynthDelayMix,
+    SetGlideTime,
+    SetGlideEnabled,
+    SetUnisonEnabled,
+    SetUnisonVoices,
+    SetUnisonDetune,
+    SetStackedUnisonEnabled,
+    SetSimdVoicesEnabled,
+    SetWavetablesEnabled,
+    SetMultiCoreRendering,
+    SetDrumOneShotsEnabled,
+    SetPolyphony,
+    SetQualityTier,
+    SetWurliTremoloRate,
+    SetWurliTremoloDepth,
+    SetWurliChorusMode,
+    SetWurliReverbSize,
+    SetWurliReverbMix,
+    SetWurliDelayTime,
+    SetWurliDelayFeedback,
+    SetWurliDelayMix,
+    SetWurliVolume,
+    SetSynthVolume,
+    ApplyPatch,
+    SetDrumVolume,
+    SetMetronomeVolume,
+    SetDrumEnabled,
+    SetDrumBPM,
+    SetKickEnabled,
+    SetSnareEnabled,
+    SetHiHatEnabled,
+    SetHiHat16thNotes,
+    SetDrumStep,
+    ToggleDrumStep,
+    SetDrumInstrumentVolume,
+    ResetDrumPattern,
+    SyncDrumToLoop,
+    LooperStartRecordingTrack,
+    LooperStartPlayback,
+    LooperStopPlayback,
+    LooperClearTrack,
+    LooperClearAllTracks,
+    LooperCancelRecording,
+    LooperSetTrackVolume,
+    LooperSetTrackMuted,
+    LooperSetTrackSolo,
+    LooperSetBarCount,
+    LooperBounceTracks,
+    CaptureExport
+  };
+
+  struct EngineEvent {
+    Command command;
+    int32_t intArg = 0;   // Note, index, mode or bool
+    int32_t intArg2 = 0;  // Secondary index (e.g. drum step)
+    float floatArg = 0.0f;
+    float floatArg2 = 0.0f;
+    int64_t timeNanos = 0; // Stamped by postEvent() or the MIDI source
+  };
+
+  // An event resolved to a frame offset within the current callback
+  struct ScheduledEvent {
+    EngineEvent event;
+    int32_t frame;
+  };
+
+  static constexpr size_t EVENT_QUEUE_CAPACITY = 1024;
+  EventQueue<EngineEvent, EVENT_QUEUE_CAPACITY> mEventQueue;
+  std::array<ScheduledEvent, EVENT_QUEUE_CAPACITY> mScheduledEvents;
+  int64_t mLastCallbackNanos = 0; // Audio thread only
+  std::atomic<uint32_t> mDroppedEvents{0};
+
+  // Any thread: timestamps the event and queues it (never blocks). Returns
+  // false if the queue was full and the event dropped.
+  bool postEvent(EngineEvent event);
+  // Same, with a timestamp taken at the source
+  bool postEvent(EngineEvent event, int64_t timeNanos);
+  // Audio thread: pops pending events and sorts them by frame offset
+  int drainEvents(int32_t numFrames, int64_t callbackNanos);
+  // Audio thread: applies one event to the DSP graph
+  void applyEvent(const EngineEvent &event);
+  void applyDrumEnabled(bool enabled);
+  void applyPatch(const PreparedPatch &prepared);
+
+  // Prepared patches waiting for the callback. A writer claims a free slot,
+  // fills it and posts ApplyPatch with its index; the callback frees the
+  // slot once applied.
+  static constexpr int PATCH_SLOTS = 4;
+  std::array<PreparedPatch, PATCH_SLOTS> mPatchSlots;
+  std::array<std::atomic<bool>, PATCH_SLOTS> mPatchSlotBusy{};
+  Mutex mPatchMutex; // Writers only
+  void applyLooperStartRecording(int trackIndex);
+
+  // Offline graph for the selected stems; numFrames receives the render
+  // length. Returns nullptr if there is nothing to render. Otherwise the
+  // looper's tracks are pinned and the caller unpins them once the render
+  // is done. Caller holds mExportMutex.
+  std::unique_ptr<OfflineRenderer>
+  createOfflineRenderer(int trackMask, bool includeDrums, int bars,
+                        int64_t &numFrames);
+
   oboe::Result createStream();
+  oboe::Result openStream(oboe::SharingMode sharingMode, int32_t sampleRate);
+  void closeStream(); // Caller holds mStreamMutex
+
+  // ===== STREAM RECOVERY =====
+  // Device changes are handled on a dedicated thread that only swaps the
+  // stream: the DSP graph, pending events and all transport positions are
+  // left alone, so playback resumes exactly where the old device stopped.
+  // mStream is only replaced under mStreamMutex; the audio thread never
+  // takes it.
+  mutable Mutex mStreamMutex;
+  std::mutex mReopenMutex;
+  std::condition_variable mReopenCondition;
+  std::thread mReopenThread;
+  bool mReopenRequested = false; // Guarded by mReopenMutex
+  bool mReopenExit = false;      // Guarded by mReopenMutex
+  static constexpr int REOPEN_ATTEMPTS = 5;
+  static constexpr int REOPEN_BACKOFF_MS = 20; // Grows linearly per attempt
+  void reopenLoop();
+  void reopenStream();
+  void stopReopenThread();
+  // Moves every DSP block to a new rate while no stream is running
+  void applySampleRate(int sampleRate);
+
+  // Adaptive buffer sizing: the stream opens at its minimum safe size and
+  // grows one burst whenever the underrun count goes up (audio thread)
+  void tuneBufferSize(oboe::AudioStream *stream, int32_t xRuns);
+  int32_t mTunerLastXRuns = -1;
+  std::atomic<bool> mBluetoothOutput{false};
+
+  // ===== LATENCY COMPENSATION =====
+  // The audio thread re-measures how long a rendered frame takes to reach
+  // the output (Bluetooth included, where the stack reports it) right after
+  // every (re)open and then every LATENCY_MEASURE_INTERVAL_MS, and hands it
+  // to the looper's record head.
+  void measureOutputLatency(oboe::AudioStream *stream, int32_t numFrames);
+  static constexpr int LATENCY_MEASURE_INTERVAL_MS = 250;
+  int64_t mLatencyCountdown = 0; // Frames to the next measurement
+  std::atomic<int32_t> mOutputLatencyFrames{-1};
+  // Routed device of mStream, mirrored so the UI can read it without
+  // taking mStreamMutex
+  std::atomic<int32_t> mOutputDeviceId{0};
+
+  // Renders numFrames (<= MAX_BLOCK_SIZE) interleaved stereo frames
+  void renderBlock(float *output, int numFrames);
 };
 
 } // namespace synthio
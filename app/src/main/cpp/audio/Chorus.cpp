@@ -1,4 +1,6 @@
 #include "Chorus.h"
+#include "DSPConfig.h"
+#include "FastMath.h"
 #include <algorithm>
 #include <cstring>
 
@@ -9,7 +11,7 @@ constexpr float TWO_PI = 2.0f * M_PI;
 Chorus::Chorus() {
     // Initialize delay line for max 50ms at 48kHz
     mDelayLineSize = static_cast<int>(0.05f * 48000.0f);
-    mDelayLine.resize(mDelayLineSize, 0.0f);
+    allocateLine();
 }
 
 void Chorus::setSampleRate(float sampleRate) {
@@ -17,7 +19,18 @@ void Chorus::setSampleRate(float sampleRate) {
     
     // Resize delay line for new sample rate (max 50ms)
     mDelayLineSize = static_cast<int>(0.05f * mSampleRate);
-    mDelayLine.resize(mDelayLineSize, 0.0f);
+    allocateLine();
+}
+
+void Chorus::setArena(EffectArena* arena) {
+    mMemory.share(arena);
+    allocateLine();
+}
+
+void Chorus::allocateLine() {
+    // Blocks are written ahead of being read, hence the block of slack
+    mDelayLine.allocate(mMemory.beginLayout(), static_cast<uint32_t>(mDelayLineSize),
+                        MAX_BLOCK_SIZE);
     reset();
 }
 
@@ -40,7 +53,7 @@ void Chorus::updateModeParams() {
 }
 
 void Chorus::reset() {
-    std::fill(mDelayLine.begin(), mDelayLine.end(), 0.0f);
+    mDelayLine.clear(mMemory.data());
     mWriteIndex = 0;
     mLfoPhase = 0.0f;
 }
@@ -53,10 +66,11 @@ void Chorus::process(float input, float& outLeft, float& outRight) {
     }
     
     // Write input to delay line
-    mDelayLine[mWriteIndex] = input;
+    float* memory = mMemory.data();
+    mDelayLine.write(memory, mWriteIndex, input);
     
     // Generate sine LFO for smooth modulation
-    float lfoValue = std::sin(mLfoPhase * TWO_PI);
+    float lfoValue = sinTwoPi(mLfoPhase);
     
     // Calculate delay times for left and right (inverted modulation)
     float baseDelaySamples = mCurrentParams.baseDelay * mSampleRate;
@@ -70,8 +84,8 @@ void Chorus::process(float input, float& outLeft, float& outRight) {
     delayRight = std::max(1.0f, std::min(delayRight, static_cast<float>(mDelayLineSize - 1)));
     
     // Read from delay lines
-    float wetLeft = readDelayLine(delayLeft);
-    float wetRight = readDelayLine(delayRight);
+    float wetLeft = mDelayLine.readFractional(memory, mWriteIndex, delayLeft);
+    float wetRight = mDelayLine.readFractional(memory, mWriteIndex, delayRight);
     
     // Mix dry and wet signals
     float wetMix = mCurrentParams.wetMix;
@@ -81,7 +95,7 @@ void Chorus::process(float input, float& outLeft, float& outRight) {
     outRight = input * dryMix + wetRight * wetMix;
     
     // Advance write index
-    mWriteIndex = (mWriteIndex + 1) % mDelayLineSize;
+    mWriteIndex++;
     
     // Advance LFO phase
     mLfoPhase += mCurrentParams.rate / mSampleRate;
@@ -90,19 +104,42 @@ void Chorus::process(float input, float& outLeft, float& outRight) {
     }
 }
 
-float Chorus::readDelayLine(float delaySamples) {
-    // Calculate read position with linear interpolation
-    float readPos = static_cast<float>(mWriteIndex) - delaySamples;
-    if (readPos < 0) {
-        readPos += static_cast<float>(mDelayLineSize);
+void Chorus::processBlock(const float* input, float* outLeft, float* outRight, int numFrames) {
+    if (mMode == Mode::OFF) {
+        std::copy(input, input + numFrames, outLeft);
+        std::copy(input, input + numFrames, outRight);
+        return;
     }
     
-    int index0 = static_cast<int>(readPos);
-    int index1 = (index0 + 1) % mDelayLineSize;
-    float frac = readPos - static_cast<float>(index0);
+    // Mode parameters are fixed for the block
+    const float baseDelaySamples = mCurrentParams.baseDelay * mSampleRate;
+    const float modDepthSamples = mCurrentParams.depth * mSampleRate;
+    const float maxDelay = static_cast<float>(mDelayLineSize - 1);
+    const float wetMix = mCurrentParams.wetMix;
+    const float dryMix = 1.0f - wetMix * 0.5f;
+    const float lfoIncrement = mCurrentParams.rate / mSampleRate;
     
-    // Linear interpolation
-    return mDelayLine[index0] * (1.0f - frac) + mDelayLine[index1] * frac;
+    // Every delay is at least one sample, so the block can go in first
+    float* memory = mMemory.data();
+    mDelayLine.writeBlock(memory, mWriteIndex, input, numFrames);
+    
+    for (int i = 0; i < numFrames; ++i) {
+        const float in = input[i];
+        const uint32_t position = mWriteIndex + static_cast<uint32_t>(i);
+        
+        float lfoValue = sinTwoPi(mLfoPhase);
+        float delayLeft = std::max(1.0f, std::min(baseDelaySamples + lfoValue * modDepthSamples, maxDelay));
+        float delayRight = std::max(1.0f, std::min(baseDelaySamples - lfoValue * modDepthSamples, maxDelay));
+        
+        outLeft[i] = in * dryMix + mDelayLine.readFractional(memory, position, delayLeft) * wetMix;
+        outRight[i] = in * dryMix + mDelayLine.readFractional(memory, position, delayRight) * wetMix;
+        
+        mLfoPhase += lfoIncrement;
+        if (mLfoPhase >= 1.0f) {
+            mLfoPhase -= 1.0f;
+        }
+    }
+    mWriteIndex += static_cast<uint32_t>(numFrames);
 }
 
 } // namespace synthio
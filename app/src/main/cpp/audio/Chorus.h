@@ -2,8 +2,8 @@
 #define SYNTHIO_CHORUS_H
 
 #define _USE_MATH_DEFINES
+#include "DelayLine.h"
 #include <cmath>
-#include <vector>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -27,12 +27,19 @@ public:
     Chorus();
     
     void setSampleRate(float sampleRate);
+    
+    // Line comes from the chain's arena (nullptr: a private one)
+    void setArena(EffectArena* arena);
+    
     void setMode(Mode mode);
     Mode getMode() const { return mMode; }
     
     // Process mono input, returns stereo pair (left, right)
     void process(float input, float& outLeft, float& outRight);
     
+    // Block processing: mono input block to stereo output blocks
+    void processBlock(const float* input, float* outLeft, float* outRight, int numFrames);
+    
     // Reset delay lines
     void reset();
 
@@ -40,10 +47,12 @@ private:
     float mSampleRate = 48000.0f;
     Mode mMode = Mode::OFF;
     
-    // Delay line (circular buffer)
-    std::vector<float> mDelayLine;
+    // Delay line; mDelayLineSize is the longest delay in samples, the
+    // line itself is padded to a power of two
+    EffectMemory mMemory;
+    DelayLine mDelayLine;
     int mDelayLineSize = 0;
-    int mWriteIndex = 0;
+    uint32_t mWriteIndex = 0;
     
     // Two LFOs for stereo modulation (inverted phase)
     float mLfoPhase = 0.0f;
@@ -64,8 +73,7 @@ private:
     
     ModeParams mCurrentParams = MODE_I_PARAMS;
     
-    // Read from delay line with linear interpolation
-    float readDelayLine(float delaySamples);
+    void allocateLine();
     
     // Update parameters based on mode
     void updateModeParams();
@@ -0,0 +1,53 @@
+#ifndef SYNTHIO_DSP_CONFIG_H
+#define SYNTHIO_DSP_CONFIG_H
+
+#include <cmath>
+#include <cstdint>
+
+namespace synthio {
+
+// Largest number of frames any processBlock() call renders at once.
+// Callers with longer bursts split them into chunks of this size, which lets
+// DSP classes keep their scratch buffers on the stack.
+constexpr int MAX_BLOCK_SIZE = 256;
+
+// Level (~-100 dBFS) below which an effect's input and tail count as silent.
+// Effects with a tail go dormant once they have been silent for their full
+// memory length and wake on the next block with input above it.
+constexpr float SILENCE_THRESHOLD = 1.0e-5f;
+
+// Output gain staging, shared by the live callback and offline renders so
+// both keep the same synth/drum balance
+constexpr float MIX_SYNTH_GAIN = 0.09f; // Synth + loop playback
+constexpr float MIX_DRUM_GAIN = 1.08f;  // 12x relative to synth
+
+// 16-bit PCM full scale, shared by looper track storage and exports
+constexpr float PCM16_SCALE = 32767.0f;
+
+// Looper takes are stored at this gain: the synth bus isn't normalized
+// (the bass boost after the limiter alone takes it to ~1.3), so full scale
+// is kept for peaks up to 4.0. Track playback undoes it per sample.
+constexpr float LOOP_RECORD_GAIN = 0.25f;
+constexpr float LOOP_PLAYBACK_SCALE = 1.0f / (LOOP_RECORD_GAIN * PCM16_SCALE);
+
+// Clipped, rounded float -> 16-bit conversion
+inline int16_t toPcm16(float sample) {
+  sample = sample < -1.0f ? -1.0f : (sample > 1.0f ? 1.0f : sample);
+  return static_cast<int16_t>(std::lrint(sample * PCM16_SCALE));
+}
+
+// Largest absolute sample of a stereo block
+inline float blockPeak(const float *left, const float *right, int numFrames) {
+  float peak = 0.0f;
+  for (int i = 0; i < numFrames; ++i) {
+    float l = left[i] < 0.0f ? -left[i] : left[i];
+    float r = right[i] < 0.0f ? -right[i] : right[i];
+    peak = l > peak ? l : peak;
+    peak = r > peak ? r : peak;
+  }
+  return peak;
+}
+
+} // namespace synthio
+
+#endif // SYNTHIO_DSP_CONFIG_H
@@ -1,4 +1,5 @@
 #include "Delay.h"
+#include "DSPConfig.h"
 #include <algorithm>
 #include <cmath>
 
@@ -7,48 +8,98 @@ namespace synthio {
 Delay::Delay() {
     // Max delay of 1 second at 48kHz
     mMaxDelaySamples = 48000;
-    mBufferL.resize(mMaxDelaySamples, 0.0f);
-    mBufferR.resize(mMaxDelaySamples, 0.0f);
+    allocateLines();
     updateDelaySamples();
+    mDelaySamples.snap();
 }
 
 void Delay::setSampleRate(float sampleRate) {
     mSampleRate = sampleRate;
     mMaxDelaySamples = static_cast<int>(sampleRate);
-    mBufferL.resize(mMaxDelaySamples, 0.0f);
-    mBufferR.resize(mMaxDelaySamples, 0.0f);
+    allocateLines();
+    mFeedback.setRampTime(PARAMETER_RAMP_TIME, sampleRate);
+    mMix.setRampTime(PARAMETER_RAMP_TIME, sampleRate);
     updateDelaySamples();
+    mDelaySamples.snap();  // The old position means nothing in the new buffer
     
     // Update filter coefficient for ~3kHz cutoff
     float cutoff = 3000.0f;
     mFilterCoeff = 1.0f - std::exp(-2.0f * 3.14159f * cutoff / mSampleRate);
 }
 
+void Delay::setArena(EffectArena* arena) {
+    mMemory.share(arena);
+    allocateLines();
+}
+
+void Delay::allocateLines() {
+    EffectArena& arena = mMemory.beginLayout();
+    mLineL.allocate(arena, static_cast<uint32_t>(mMaxDelaySamples));
+    mLineR.allocate(arena, static_cast<uint32_t>(mMaxDelaySamples));
+    mWritePos = 0;
+    
+    // Fresh lines are silent
+    mFilterStateL = 0.0f;
+    mFilterStateR = 0.0f;
+    mSilentFrames = 0;
+    mDormant = true;
+}
+
 void Delay::setTime(float timeSeconds) {
     mTime = std::max(0.05f, std::min(0.5f, timeSeconds));
     updateDelaySamples();
 }
 
 void Delay::setFeedback(float feedback) {
-    mFeedback = std::max(0.0f, std::min(0.8f, feedback));
+    mFeedback.setTarget(std::max(0.0f, std::min(0.8f, feedback)));
 }
 
 void Delay::setMix(float mix) {
-    mMix = std::max(0.0f, std::min(1.0f, mix));
+    mMix.setTarget(std::max(0.0f, std::min(1.0f, mix)));
 }
 
 void Delay::updateDelaySamples() {
-    mDelaySamples = static_cast<int>(mTime * mSampleRate);
-    mDelaySamples = std::min(mDelaySamples, mMaxDelaySamples - 1);
+    // Whole samples at rest, so a settled delay reads exactly one tap
+    int delaySamples = static_cast<int>(mTime * mSampleRate);
+    delaySamples = std::min(delaySamples, mMaxDelaySamples - 2);
+    
+    float distance = std::fabs(static_cast<float>(delaySamples) - mDelaySamples.getCurrent());
+    mDelaySamples.setRampFrames(static_cast<int>(
+        std::max(TIME_RAMP_SECONDS * mSampleRate, distance / MAX_TIME_SLEW)));
+    mDelaySamples.setTarget(static_cast<float>(delaySamples));
+}
+
+void Delay::enterDormancy() {
+    // Drop the sub-threshold residue so waking up starts from true silence
+    float* memory = mMemory.data();
+    mLineL.clear(memory);
+    mLineR.clear(memory);
+    mFilterStateL = 0.0f;
+    mFilterStateR = 0.0f;
+    mSilentFrames = 0;
+    mDormant = true;
+    landRamps();
+}
+
+void Delay::landRamps() {
+    // Nothing is audible while dormant, so parameter changes need no ramp
+    mDelaySamples.snap();
+    mFeedback.snap();
+    mMix.snap();
 }
 
 void Delay::process(float& left, float& right) {
+    // The per-sample path doesn't track the tail
+    mDormant = false;
+    
     // Read from delay buffer
-    int readPos = mWritePos - mDelaySamples;
-    if (readPos < 0) readPos += mMaxDelaySamples;
+    float delaySamples = mDelaySamples.nextValue();
+    float feedback = mFeedback.nextValue();
+    float mix = mMix.nextValue();
     
-    float delayedL = mBufferL[readPos];
-    float delayedR = mBufferR[readPos];
+    float* memory = mMemory.data();
+    float delayedL = mLineL.readFractional(memory, mWritePos, delaySamples);
+    float delayedR = mLineR.readFractional(memory, mWritePos, delaySamples);
     
     // Low-pass filter the delayed signal for warmth
     mFilterStateL += mFilterCoeff * (delayedL - mFilterStateL);
@@ -58,16 +109,76 @@ void Delay::process(float& left, float& right) {
     float filteredR = mFilterStateR;
     
     // Write to delay buffer (input + filtered feedback)
-    mBufferL[mWritePos] = left + filteredL * mFeedback;
-    mBufferR[mWritePos] = right + filteredR * mFeedback;
-    
-    // Increment write position
+    mLineL.write(memory, mWritePos, left + filteredL * feedback);
+    mLineR.write(memory, mWritePos, right + filteredR * feedback);
     mWritePos++;
-    if (mWritePos >= mMaxDelaySamples) mWritePos = 0;
     
     // Mix dry and wet signals
-    left = left * (1.0f - mMix) + delayedL * mMix;
-    right = right * (1.0f - mMix) + delayedR * mMix;
+    left = left * (1.0f - mix) + delayedL * mix;
+    right = right * (1.0f - mix) + delayedR * mix;
+}
+
+void Delay::processBlock(float* left, float* right, int numFrames) {
+    const float inputPeak = blockPeak(left, right, numFrames);
+    if (mDormant) {
+        if (inputPeak < SILENCE_THRESHOLD) {
+            return;  // Empty buffer: no echoes, dry signal is already silent
+        }
+        landRamps();
+        mDormant = false;
+    }
+    
+    const SmoothedParameter::Ramp delayRamp = mDelaySamples.nextBlock(numFrames);
+    const SmoothedParameter::Ramp feedbackRamp = mFeedback.nextBlock(numFrames);
+    const SmoothedParameter::Ramp mixRamp = mMix.nextBlock(numFrames);
+    float* memory = mMemory.data();
+    
+    // Delays are at least 50 ms, longer than any block, so the whole block
+    // is read before any of it is written. At rest that's a straight copy.
+    float delayedL[MAX_BLOCK_SIZE];
+    float delayedR[MAX_BLOCK_SIZE];
+    if (delayRamp.isConstant()) {
+        const uint32_t delay = static_cast<uint32_t>(delayRamp.start);
+        mLineL.readBlock(memory, mWritePos, delay, delayedL, numFrames);
+        mLineR.readBlock(memory, mWritePos, delay, delayedR, numFrames);
+    } else {
+        for (int i = 0; i < numFrames; ++i) {
+            delayedL[i] = mLineL.readFractional(memory, mWritePos + i, delayRamp.at(i));
+            delayedR[i] = mLineR.readFractional(memory, mWritePos + i, delayRamp.at(i));
+        }
+    }
+    
+    // The scratch blocks take the feedback writes once each frame has
+    // been mixed
+    float wetPeak = 0.0f;
+    for (int i = 0; i < numFrames; ++i) {
+        const float feedback = feedbackRamp.at(i);
+        const float mix = mixRamp.at(i);
+        const float wetL = delayedL[i];
+        const float wetR = delayedR[i];
+        wetPeak = std::max(wetPeak, std::max(std::fabs(wetL), std::fabs(wetR)));
+        
+        mFilterStateL += mFilterCoeff * (wetL - mFilterStateL);
+        mFilterStateR += mFilterCoeff * (wetR - mFilterStateR);
+        delayedL[i] = left[i] + mFilterStateL * feedback;
+        delayedR[i] = right[i] + mFilterStateR * feedback;
+        
+        left[i] = left[i] * (1.0f - mix) + wetL * mix;
+        right[i] = right[i] * (1.0f - mix) + wetR * mix;
+    }
+    mLineL.writeBlock(memory, mWritePos, delayedL, numFrames);
+    mLineR.writeBlock(memory, mWritePos, delayedR, numFrames);
+    mWritePos += static_cast<uint32_t>(numFrames);
+    
+    // Every sample the delay can still read back was written while silent
+    if (inputPeak < SILENCE_THRESHOLD && wetPeak < SILENCE_THRESHOLD) {
+        mSilentFrames += numFrames;
+        if (mSilentFrames >= mMaxDelaySamples) {
+            enterDormancy();
+        }
+    } else {
+        mSilentFrames = 0;
+    }
 }
 
 } // namespace synthio
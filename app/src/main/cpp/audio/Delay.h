@@ -1,7 +1,8 @@
 #ifndef SYNTHIO_DELAY_H
 #define SYNTHIO_DELAY_H
 
-#include <vector>
+#include "DelayLine.h"
+#include "SmoothedParameter.h"
 
 namespace synthio {
 
@@ -15,7 +16,12 @@ public:
     
     void setSampleRate(float sampleRate);
     
-    // Delay time in seconds (0.05 - 0.5)
+    // Lines come from the chain's arena (nullptr: a private one). Starts
+    // again from silence.
+    void setArena(EffectArena* arena);
+    
+    // Delay time in seconds (0.05 - 0.5). Changes glide the read pointer
+    // to the new position instead of jumping it.
     void setTime(float timeSeconds);
     
     // Feedback 0.0 - 0.8
@@ -26,18 +32,31 @@ public:
     
     // Process stereo
     void process(float& left, float& right);
+    
+    // Block processing (in place). Goes dormant once the input and the
+    // echoes have been silent for a full buffer length.
+    void processBlock(float* left, float* right, int numFrames);
+    
+    bool isDormant() const { return mDormant; }
 
 private:
     float mSampleRate = 48000.0f;
     float mTime = 0.25f;
-    float mFeedback = 0.3f;
-    float mMix = 0.3f;
-    
-    // Delay buffers
-    std::vector<float> mBufferL;
-    std::vector<float> mBufferR;
-    int mWritePos = 0;
-    int mDelaySamples = 0;
+    SmoothedParameter mFeedback{0.3f};
+    SmoothedParameter mMix{0.3f};
+    
+    // Time changes sweep the read pointer like a tape head: at least
+    // TIME_RAMP_SECONDS, and slow enough that the echo pitch moves by no
+    // more than MAX_TIME_SLEW (delay samples per sample)
+    static constexpr float TIME_RAMP_SECONDS = 0.1f;
+    static constexpr float MAX_TIME_SLEW = 0.5f;
+    
+    // Delay lines
+    EffectMemory mMemory;
+    DelayLine mLineL;
+    DelayLine mLineR;
+    uint32_t mWritePos = 0;
+    SmoothedParameter mDelaySamples;  // Fractional while gliding
     int mMaxDelaySamples = 0;
     
     // Low-pass filter in feedback path for warmth
@@ -45,7 +64,14 @@ private:
     float mFilterStateR = 0.0f;
     float mFilterCoeff = 0.3f;  // ~3kHz cutoff
     
+    // Tail detection. The buffers start out empty, so a new delay is dormant.
+    bool mDormant = true;
+    int mSilentFrames = 0;
+    
+    void allocateLines();
     void updateDelaySamples();
+    void enterDormancy();
+    void landRamps();
 };
 
 } // namespace synthio
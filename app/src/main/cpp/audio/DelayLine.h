@@ -0,0 +1,154 @@
+#ifndef SYNTHIO_DELAY_LINE_H
+#define SYNTHIO_DELAY_LINE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace synthio {
+
+/**
+ * Delay memory for an effects chain: one cache-aligned allocation that the
+ * delay lines of every effect in the chain are carved from, so a chain's
+ * lines sit next to each other instead of in a vector per line per effect.
+ *
+ * Lines are laid out off the audio thread (construction and sample rate
+ * changes): the owner resets the arena, then each effect allocates its lines
+ * again. Allocating may move the memory, so lines hold offsets and effects
+ * look the base pointer up once per block.
+ */
+class EffectArena {
+public:
+  static constexpr int ALIGNMENT = 64; // One cache line
+
+  // Forgets every line; the memory is kept for the next layout
+  void reset() { mBlocks.clear(); }
+
+  // Hands the memory back, e.g. once an effect moves to a shared arena
+  void release() { std::vector<Block>().swap(mBlocks); }
+
+  // A zeroed span of at least samples floats starting on a cache line.
+  // Returns its offset from data().
+  uint32_t allocate(uint32_t samples) {
+    const size_t first = mBlocks.size();
+    mBlocks.resize(first + (samples + FLOATS_PER_BLOCK - 1) / FLOATS_PER_BLOCK);
+    return static_cast<uint32_t>(first * FLOATS_PER_BLOCK);
+  }
+
+  float *data() { return mBlocks.empty() ? nullptr : mBlocks.front().samples; }
+  size_t size() const { return mBlocks.size() * FLOATS_PER_BLOCK; }
+
+private:
+  static constexpr int FLOATS_PER_BLOCK = ALIGNMENT / sizeof(float);
+
+  struct alignas(ALIGNMENT) Block {
+    float samples[FLOATS_PER_BLOCK];
+  };
+
+  std::vector<Block> mBlocks;
+};
+
+/**
+ * An effect's view of its arena: a private one, so the effect works on its
+ * own, until the owner of a chain hands it the chain's shared arena.
+ */
+class EffectMemory {
+public:
+  // nullptr goes back to a private arena. The effect lays its lines out
+  // again afterwards.
+  void share(EffectArena *arena) {
+    mShared = arena;
+    mOwn.release();
+  }
+
+  // Where the next layout goes. A private arena starts over; a shared one
+  // is reset by its owner before every effect lays out again.
+  EffectArena &beginLayout() {
+    if (mShared != nullptr) {
+      return *mShared;
+    }
+    mOwn.reset();
+    return mOwn;
+  }
+
+  float *data() { return mShared != nullptr ? mShared->data() : mOwn.data(); }
+
+private:
+  EffectArena mOwn;
+  EffectArena *mShared = nullptr;
+};
+
+/**
+ * A power-of-two ring buffer inside an EffectArena.
+ *
+ * The line keeps no write position of its own: the effect passes a counter
+ * that wraps freely (one counter can drive all of its lines) and the mask
+ * does the wrapping, so no read or write tests for the end of the buffer.
+ * read(memory, position, delay) is the sample written delay steps before
+ * position.
+ */
+struct DelayLine {
+  uint32_t offset = 0;
+  uint32_t mask = 0;
+
+  // Room for delays up to maxDelay, plus extra samples for effects that
+  // write a block ahead of reading it
+  void allocate(EffectArena &arena, uint32_t maxDelay, uint32_t extra = 0) {
+    uint32_t size = 1;
+    while (size < maxDelay + 1 + extra) {
+      size <<= 1;
+    }
+    offset = arena.allocate(size);
+    mask = size - 1;
+  }
+
+  uint32_t capacity() const { return mask + 1; }
+
+  float read(const float *memory, uint32_t position, uint32_t delay) const {
+    return memory[offset + ((position - delay) & mask)];
+  }
+
+  void write(float *memory, uint32_t position, float value) const {
+    memory[offset + (position & mask)] = value;
+  }
+
+  // Linear interpolation between the taps either side of delay
+  float readFractional(const float *memory, uint32_t position,
+                       float delay) const {
+    const uint32_t whole = static_cast<uint32_t>(delay);
+    const float frac = delay - static_cast<float>(whole);
+    const float newer = read(memory, position, whole);
+    return newer + (read(memory, position, whole + 1) - newer) * frac;
+  }
+
+  // What frames position .. position + numFrames - 1 read at a fixed delay.
+  // Needs delay >= numFrames when the same block is written afterwards.
+  void readBlock(const float *memory, uint32_t position, uint32_t delay,
+                 float *out, int numFrames) const {
+    const uint32_t start = (position - delay) & mask;
+    const uint32_t first = std::min(static_cast<uint32_t>(numFrames),
+                                    capacity() - start);
+    std::memcpy(out, memory + offset + start, first * sizeof(float));
+    std::memcpy(out + first, memory + offset,
+                (numFrames - first) * sizeof(float));
+  }
+
+  void writeBlock(float *memory, uint32_t position, const float *in,
+                  int numFrames) const {
+    const uint32_t start = position & mask;
+    const uint32_t first = std::min(static_cast<uint32_t>(numFrames),
+                                    capacity() - start);
+    std::memcpy(memory + offset + start, in, first * sizeof(float));
+    std::memcpy(memory + offset, in + first,
+                (numFrames - first) * sizeof(float));
+  }
+
+  void clear(float *memory) const {
+    std::fill(memory + offset, memory + offset + capacity(), 0.0f);
+  }
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_DELAY_LINE_H
@@ -0,0 +1,101 @@
+#ifndef SYNTHIO_DENORMALS_H
+#define SYNTHIO_DENORMALS_H
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(__x86_64__)
+#include <xmmintrin.h>
+#endif
+
+namespace synthio {
+
+/**
+ * Denormal-safe floating-point mode for the audio threads.
+ *
+ * Decaying filter and reverb state drifts into the denormal range, where
+ * arithmetic on most cores is many times slower. Instead of testing state
+ * against a threshold every sample, each render entry point (the Oboe
+ * callback, the render workers, offline renders) holds a ScopedFlushToZero
+ * so the FPU flushes denormal results and inputs to zero.
+ *
+ * ARM: FPCR.FZ (aarch64) / FPSCR.FZ (armv7; NEON always flushes). x86:
+ * MXCSR FTZ and DAZ. Elsewhere (WebAssembly has no FP control register) the
+ * scope does nothing and SYNTHIO_HAS_FTZ is 0, so code that relied on the
+ * hardware flush falls back to explicit checks.
+ *
+ * The previous mode is restored on destruction, so nesting is harmless.
+ */
+#if defined(__aarch64__)
+
+#define SYNTHIO_HAS_FTZ 1
+
+class ScopedFlushToZero {
+public:
+  ScopedFlushToZero() {
+    uint64_t fpcr;
+    asm volatile("mrs %0, fpcr" : "=r"(fpcr));
+    mSaved = fpcr;
+    asm volatile("msr fpcr, %0" : : "r"(fpcr | FZ_BIT));
+  }
+  ~ScopedFlushToZero() { asm volatile("msr fpcr, %0" : : "r"(mSaved)); }
+  ScopedFlushToZero(const ScopedFlushToZero &) = delete;
+  ScopedFlushToZero &operator=(const ScopedFlushToZero &) = delete;
+
+private:
+  static constexpr uint64_t FZ_BIT = 1ull << 24;
+  uint64_t mSaved;
+};
+
+#elif defined(__arm__) && defined(__ARM_FP)
+
+#define SYNTHIO_HAS_FTZ 1
+
+class ScopedFlushToZero {
+public:
+  ScopedFlushToZero() {
+    uint32_t fpscr;
+    asm volatile("vmrs %0, fpscr" : "=r"(fpscr));
+    mSaved = fpscr;
+    asm volatile("vmsr fpscr, %0" : : "r"(fpscr | FZ_BIT));
+  }
+  ~ScopedFlushToZero() { asm volatile("vmsr fpscr, %0" : : "r"(mSaved)); }
+  ScopedFlushToZero(const ScopedFlushToZero &) = delete;
+  ScopedFlushToZero &operator=(const ScopedFlushToZero &) = delete;
+
+private:
+  static constexpr uint32_t FZ_BIT = 1u << 24;
+  uint32_t mSaved;
+};
+
+#elif defined(__SSE2__) || defined(_M_X64) || defined(__x86_64__)
+
+#define SYNTHIO_HAS_FTZ 1
+
+class ScopedFlushToZero {
+public:
+  ScopedFlushToZero() : mSaved(_mm_getcsr()) {
+    _mm_setcsr(mSaved | FTZ_DAZ_BITS);
+  }
+  ~ScopedFlushToZero() { _mm_setcsr(mSaved); }
+  ScopedFlushToZero(const ScopedFlushToZero &) = delete;
+  ScopedFlushToZero &operator=(const ScopedFlushToZero &) = delete;
+
+private:
+  static constexpr unsigned FTZ_DAZ_BITS = 0x8040; // FTZ (15) | DAZ (6)
+  unsigned mSaved;
+};
+
+#else
+
+#define SYNTHIO_HAS_FTZ 0
+
+class ScopedFlushToZero {
+public:
+  ScopedFlushToZero() {}
+};
+
+#endif
+
+} // namespace synthio
+
+#endif // SYNTHIO_DENORMALS_H
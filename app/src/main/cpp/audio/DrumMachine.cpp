@@ -3,34 +3,31 @@
 
 namespace synthio {
 
-DrumMachine::DrumMachine() {
-  resetToDefaultPattern();
-  calculateSamplesPerSixteenth();
-}
+DrumMachine::DrumMachine() { resetToDefaultPattern(); }
 
 void DrumMachine::setSampleRate(float sampleRate) {
   mSampleRate = sampleRate;
   mDrumSynth.setSampleRate(sampleRate);
-  calculateSamplesPerSixteenth();
+  mDrumSynth.setOneShots(DrumOneShotBank::prepare(sampleRate));
+  mVolume.setRampTime(PARAMETER_RAMP_TIME, sampleRate);
+  mTransport.setSampleRate(sampleRate); // Keeps its place inside the bar
 }
 
 void DrumMachine::setEnabled(bool enabled) {
   if (enabled && !mEnabled) {
-    // Starting playback - reset to start of measure
-    mCurrentSixteenth = 0;
-    mSampleCounter = 0.0f;
-    triggerSixteenth(0); // Trigger immediately on start
+    // Starting playback: the bar starts on the next frame
+    mTransport.start();
   }
   mEnabled = enabled;
 }
 
 void DrumMachine::setBPM(float bpm) {
   mBPM = std::max(60.0f, std::min(200.0f, bpm));
-  calculateSamplesPerSixteenth();
+  mTransport.setBPM(mBPM);
 }
 
 void DrumMachine::setVolume(float volume) {
-  mVolume = std::max(0.0f, std::min(1.0f, volume));
+  mVolume.setTarget(std::max(0.0f, std::min(1.0f, volume)));
 }
 
 // ===== PATTERN CONTROL =====
@@ -154,17 +151,20 @@ void DrumMachine::resetToDefaultPattern() {
   mHiHatVolume = 1.0f;
 }
 
-void DrumMachine::resetBeat() {
-  mCurrentSixteenth = 0;
-  mSampleCounter = 0.0f;
-  triggerSixteenth(0); // Trigger first 16th note immediately
-}
-
-void DrumMachine::calculateSamplesPerSixteenth() {
-  // Samples per 16th note = samples per beat / 4
-  // Samples per beat = (samples per second) / (beats per second)
-  float samplesPerBeat = mSampleRate * 60.0f / mBPM;
-  mSamplesPerSixteenth = samplesPerBeat / 4.0f;
+void DrumMachine::copyPatternFrom(const DrumMachine &other) {
+  mKickPattern = other.mKickPattern;
+  mSnarePattern = other.mSnarePattern;
+  mHiHatPattern = other.mHiHatPattern;
+  mKickVolume = other.mKickVolume;
+  mSnareVolume = other.mSnareVolume;
+  mHiHatVolume = other.mHiHatVolume;
+  mKickEnabled = other.mKickEnabled;
+  mSnareEnabled = other.mSnareEnabled;
+  mHiHatEnabled = other.mHiHatEnabled;
+  mHiHat16thNotes = other.mHiHat16thNotes;
+  mVolume.snap(other.mVolume.getTarget());
+  setOneShotsEnabled(other.isOneShotsEnabled());
+  setBPM(other.mBPM);
 }
 
 void DrumMachine::triggerSixteenth(int sixteenth) {
@@ -191,26 +191,28 @@ void DrumMachine::triggerSixteenth(int sixteenth) {
   }
 }
 
-float DrumMachine::nextSample() {
-  if (!mEnabled) {
-    // Still process drum synth for any active sounds to decay
-    return mDrumSynth.nextSample() * mVolume;
+void DrumMachine::processBlock(float *out, int numFrames,
+                               const TransportEvent *events, int numEvents) {
+  // Render the synth in segments between steps so each hit starts on
+  // exactly its frame
+  int segmentStart = 0;
+  if (mEnabled) {
+    for (int e = 0; e < numEvents; ++e) {
+      const int frame = std::min(events[e].frame, numFrames);
+      mDrumSynth.processBlock(out + segmentStart, frame - segmentStart);
+      segmentStart = frame;
+      triggerSixteenth(events[e].step);
+    }
   }
+  mDrumSynth.processBlock(out + segmentStart, numFrames - segmentStart);
 
-  // Check if it's time for the next 16th note
-  mSampleCounter += 1.0f;
-
-  if (mSampleCounter >= mSamplesPerSixteenth) {
-    mSampleCounter -=
-        mSamplesPerSixteenth; // Keep the fractional part for accuracy
-
-    // Advance to next 16th note
-    mCurrentSixteenth = (mCurrentSixteenth + 1) % NUM_STEPS;
-    triggerSixteenth(mCurrentSixteenth);
-  }
+  mVolume.applyGain(out, numFrames);
+}
 
-  // Get drum sample and apply master volume
-  return mDrumSynth.nextSample() * mVolume;
+void DrumMachine::processBlock(float *out, int numFrames) {
+  TransportEvent events[Transport::MAX_EVENTS];
+  const int numEvents = mEnabled ? mTransport.advance(numFrames, -1, events) : 0;
+  processBlock(out, numFrames, events, numEvents);
 }
 
 } // namespace synthio
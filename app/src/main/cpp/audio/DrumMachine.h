@@ -2,6 +2,8 @@
 #define SYNTHIO_DRUM_MACHINE_H
 
 #include "DrumSynth.h"
+#include "SmoothedParameter.h"
+#include "Transport.h"
 #include <array>
 
 namespace synthio {
@@ -14,6 +16,11 @@ namespace synthio {
  * - Per-step velocity control
  * - Per-instrument volume control
  * - Default pattern: Kick on 1,3 / Snare on 2,4 / Hi-hat on 16ths
+ *
+ * Steps come from a Transport. The engine drives the machine from its own
+ * transport (shared with the metronome and synced to the looper); offline
+ * renders, the benchmark and the web build use the machine's built-in one
+ * through the self-clocked processBlock().
  */
 class DrumMachine {
 public:
@@ -22,11 +29,12 @@ public:
   static constexpr int SNARE = 1;
   static constexpr int HIHAT = 2;
   static constexpr int NUM_INSTRUMENTS = 3;
-  static constexpr int NUM_STEPS = 16;
+  static constexpr int NUM_STEPS = Transport::STEPS_PER_BAR;
 
   DrumMachine();
 
   void setSampleRate(float sampleRate);
+  void seedNoise(uint32_t seed) { mDrumSynth.seedNoise(seed); }
 
   // Enable/disable playback
   void setEnabled(bool enabled);
@@ -50,7 +58,7 @@ public:
 
   // Master volume control (0.0 - 1.0)
   void setVolume(float volume);
-  float getVolume() const { return mVolume; }
+  float getVolume() const { return mVolume.getTarget(); }
 
   // ===== PATTERN CONTROL =====
 
@@ -68,6 +76,10 @@ public:
   // Reset to default pattern (kick 1,3 / snare 2,4 / hihat 16ths)
   void resetToDefaultPattern();
 
+  // Copy pattern, tempo, toggles and levels (not playback state) from
+  // another machine, e.g. into an offline render graph
+  void copyPatternFrom(const DrumMachine &other);
+
   // Get pattern arrays for UI sync
   const std::array<float, NUM_STEPS> &getKickPattern() const {
     return mKickPattern;
@@ -79,24 +91,26 @@ public:
     return mHiHatPattern;
   }
 
-  // Reset beat position (for loop sync)
-  void resetBeat();
+  // Writes numFrames samples to out, playing each step in events (from
+  // Transport::advance() for the same block) on its frame. Steps only sound
+  // while enabled; hits already playing always ring out.
+  void processBlock(float *out, int numFrames, const TransportEvent *events,
+                    int numEvents);
 
-  // Get next sample
-  float nextSample();
+  // Self-clocked version: advances the built-in transport, which starts at
+  // the top of the bar whenever playback is enabled
+  void processBlock(float *out, int numFrames);
 
-  // Trigger sounds externally (for metronome use)
-  void triggerKick() { mDrumSynth.triggerKick(); }
-  void triggerSnare() { mDrumSynth.triggerSnare(); }
-  void triggerHiHat(float velocity = 1.0f) {
-    mDrumSynth.triggerHiHat(velocity);
+  // Pre-rendered hits (the default) or per-sample synthesis; the cache
+  // for the current rate is prepared by setSampleRate() (audio thread)
+  void setOneShotsEnabled(bool enabled) {
+    mDrumSynth.setOneShotsEnabled(enabled);
   }
-
-  // Get just the drum synth output (without advancing sequencer)
-  float getDrumSynthSample() { return mDrumSynth.nextSample(); }
+  bool isOneShotsEnabled() const { return mDrumSynth.isOneShotsEnabled(); }
 
 private:
   DrumSynth mDrumSynth;
+  Transport mTransport; // Only used by the self-clocked processBlock()
 
   float mSampleRate = 48000.0f;
   bool mEnabled = false;
@@ -105,7 +119,7 @@ private:
   bool mSnareEnabled = true;   // Master toggle for snare
   bool mHiHat16thNotes = true; // Legacy flag (pattern takes priority)
   float mBPM = 100.0f;
-  float mVolume = 0.7f; // Master drum volume
+  SmoothedParameter mVolume{0.7f}; // Master drum volume
 
   // ===== PATTERN DATA =====
   // 16 steps per instrument, values 0.0-1.0 (0 = off, >0 = velocity)
@@ -118,12 +132,6 @@ private:
   float mSnareVolume = 1.0f;
   float mHiHatVolume = 1.0f;
 
-  // Sequencer state
-  int mCurrentSixteenth = 0;   // 0-15 for 16th notes in a measure
-  float mSampleCounter = 0.0f; // Samples since last 16th note
-  float mSamplesPerSixteenth = 0.0f;
-
-  void calculateSamplesPerSixteenth();
   void triggerSixteenth(int sixteenth);
   bool isValidInstrument(int instrument) const {
     return instrument >= 0 && instrument < NUM_INSTRUMENTS;
@@ -0,0 +1,65 @@
+#include "DrumOneShots.h"
+#include "DrumSynth.h"
+#include "RtCheck.h"
+#include <memory>
+#include <mutex>
+
+namespace synthio {
+
+namespace {
+
+// Kick noise only colours the first 2 ms click, so one take is enough
+constexpr int VARIANTS[DrumOneShots::NUM_INSTRUMENTS] = {1, 4, 4};
+constexpr uint32_t RENDER_SEED = 0x707u;
+
+Mutex sBankMutex;
+std::vector<std::unique_ptr<DrumOneShots>> sSets;
+
+void renderHit(DrumSynth &synth, int instrument, std::vector<float> &out) {
+  switch (instrument) {
+  case 0:
+    synth.triggerKick(1.0f);
+    break;
+  case 1:
+    synth.triggerSnare(1.0f);
+    break;
+  default:
+    synth.triggerHiHat(1.0f);
+    break;
+  }
+  // Each voice switches itself off once its envelope is inaudible
+  while (synth.isActive()) {
+    out.push_back(synth.nextSample());
+  }
+  out.shrink_to_fit();
+}
+
+} // namespace
+
+const DrumOneShots *DrumOneShotBank::prepare(float sampleRate) {
+  std::lock_guard<Mutex> lock(sBankMutex);
+  for (const auto &set : sSets) {
+    if (set->sampleRate == sampleRate) {
+      return set.get();
+    }
+  }
+
+  auto set = std::make_unique<DrumOneShots>();
+  set->sampleRate = sampleRate;
+  DrumSynth synth;
+  synth.setSampleRate(sampleRate);
+  for (int instrument = 0; instrument < DrumOneShots::NUM_INSTRUMENTS;
+       ++instrument) {
+    set->variantCount[instrument] = VARIANTS[instrument];
+    for (int variant = 0; variant < VARIANTS[instrument]; ++variant) {
+      // Fixed seeds keep renders reproducible
+      synth.seedNoise(RENDER_SEED + instrument * DrumOneShots::MAX_VARIANTS +
+                      variant);
+      renderHit(synth, instrument, set->hits[instrument][variant]);
+    }
+  }
+  sSets.push_back(std::move(set));
+  return sSets.back().get();
+}
+
+} // namespace synthio
@@ -0,0 +1,39 @@
+#ifndef SYNTHIO_DRUM_ONE_SHOTS_H
+#define SYNTHIO_DRUM_ONE_SHOTS_H
+
+#include <vector>
+
+namespace synthio {
+
+/**
+ * Pre-rendered DrumSynth hits for one sample rate.
+ *
+ * Every instrument's output is linear in velocity, so a single hit at full
+ * velocity per variant covers the whole range; the variants are separate
+ * noise takes played round-robin so repeated snares and hats don't sound
+ * frozen.
+ */
+struct DrumOneShots {
+  static constexpr int NUM_INSTRUMENTS = 3; // Kick, snare, hi-hat
+  static constexpr int MAX_VARIANTS = 4;
+
+  float sampleRate = 0.0f;
+  int variantCount[NUM_INSTRUMENTS] = {};
+  std::vector<float> hits[NUM_INSTRUMENTS][MAX_VARIANTS];
+};
+
+/**
+ * Process-wide cache of one-shot sets, one per sample rate.
+ *
+ * prepare() renders a set (a few milliseconds) and must only be called from
+ * control threads, while no audio thread is playing from the result. Sets
+ * live for the lifetime of the process, so players can hold raw pointers.
+ */
+class DrumOneShotBank {
+public:
+  static const DrumOneShots *prepare(float sampleRate);
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_DRUM_ONE_SHOTS_H
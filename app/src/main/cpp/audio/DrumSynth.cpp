@@ -1,7 +1,9 @@
 #define _USE_MATH_DEFINES
 #include "DrumSynth.h"
+#include "FastMath.h"
 #include <algorithm>
 #include <cmath>
+#include <random>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -9,14 +11,28 @@
 
 namespace synthio {
 
-DrumSynth::DrumSynth() : mRng(std::random_device{}()) {}
+DrumSynth::DrumSynth() : mNoise(std::random_device{}()) {
+  setSampleRate(mSampleRate);
+}
 
-void DrumSynth::setSampleRate(float sampleRate) { mSampleRate = sampleRate; }
+void DrumSynth::setSampleRate(float sampleRate) {
+  mSampleRate = sampleRate;
+  // Fixed-frequency filter coefficients, once per rate instead of per sample
+  mSnareBandpassF = 2.0f * std::sin(static_cast<float>(M_PI) *
+                                    SnareState::BP_FREQ / mSampleRate);
+  mHiHatHighpassCoeff = 1.0f - std::exp(-2.0f * static_cast<float>(M_PI) *
+                                        HiHatState::HP_FREQ / mSampleRate);
+}
 
 void DrumSynth::triggerKick(float velocity) {
+  // Velocity curve: squared for more natural response
+  float level = std::max(0.0f, std::min(1.0f, velocity));
+  float gain = level * level;
+  if (playOneShot(KICK_SHOT, gain)) {
+    return;
+  }
   mKick.active = true;
-  // Velocity curve: exponential for more natural response
-  mKick.velocity = std::pow(std::max(0.0f, std::min(1.0f, velocity)), 2.0f);
+  mKick.velocity = gain;
   mKick.phase = 0.0f;
   mKick.pitchEnv = 1.0f;
   mKick.ampEnv = 1.0f;
@@ -24,8 +40,13 @@ void DrumSynth::triggerKick(float velocity) {
 }
 
 void DrumSynth::triggerSnare(float velocity) {
+  float level = std::max(0.0f, std::min(1.0f, velocity));
+  float gain = level * level;
+  if (playOneShot(SNARE_SHOT, gain)) {
+    return;
+  }
   mSnare.active = true;
-  mSnare.velocity = std::pow(std::max(0.0f, std::min(1.0f, velocity)), 2.0f);
+  mSnare.velocity = gain;
   mSnare.bodyPhase = 0.0f;
   mSnare.toneEnv = 1.0f;
   mSnare.noiseEnv = 1.0f;
@@ -35,9 +56,12 @@ void DrumSynth::triggerSnare(float velocity) {
 }
 
 void DrumSynth::triggerHiHat(float velocity) {
+  float gain = std::max(0.3f, std::min(1.0f, velocity)); // Clamp with minimum
+  if (playOneShot(HIHAT_SHOT, gain)) {
+    return;
+  }
   mHiHat.active = true;
-  mHiHat.velocity =
-      std::max(0.3f, std::min(1.0f, velocity)); // Clamp with minimum
+  mHiHat.velocity = gain;
   mHiHat.ampEnv = 1.0f;
   mHiHat.sampleCount = 0;
   // Reset oscillator phases for consistent attack
@@ -62,11 +86,107 @@ float DrumSynth::nextSample() {
     output += generateHiHatSample();
   }
 
+  renderOneShots(&output, 1);
   return output;
 }
 
+void DrumSynth::processBlock(float *out, int numFrames) {
+  std::fill(out, out + numFrames, 0.0f);
+
+  // Render each voice for as long as it stays active; voices that finish
+  // mid-block simply stop contributing, matching nextSample()
+  for (int i = 0; i < numFrames && mKick.active; i++) {
+    out[i] += generateKickSample();
+  }
+  for (int i = 0; i < numFrames && mSnare.active; i++) {
+    out[i] += generateSnareSample();
+  }
+  for (int i = 0; i < numFrames && mHiHat.active; i++) {
+    out[i] += generateHiHatSample();
+  }
+  renderOneShots(out, numFrames);
+}
+
 bool DrumSynth::isActive() const {
-  return mKick.active || mSnare.active || mHiHat.active;
+  if (mKick.active || mSnare.active || mHiHat.active) {
+    return true;
+  }
+  for (const auto &voice : mOneShotVoices) {
+    if (voice.samples) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// ===== ONE-SHOT CACHE =====
+
+bool DrumSynth::playOneShot(int instrument, float gain) {
+  if (!mOneShotsEnabled || !mOneShots ||
+      mOneShots->variantCount[instrument] <= 0) {
+    return false;
+  }
+  int variant = mNextVariant[instrument];
+  mNextVariant[instrument] = (variant + 1) % mOneShots->variantCount[instrument];
+  const std::vector<float> &hit = mOneShots->hits[instrument][variant];
+
+  // Choke the instrument's ringing hits, then take a free voice or else the
+  // one furthest into its tail
+  const float chokeStep = 1.0f / (CHOKE_MS * 0.001f * mSampleRate);
+  OneShotVoice *target = nullptr;
+  for (auto &voice : mOneShotVoices) {
+    if (!voice.samples) {
+      if (!target || target->samples) {
+        target = &voice;
+      }
+      continue;
+    }
+    if (voice.instrument == instrument && voice.fadeStep == 0.0f) {
+      voice.fadeStep = chokeStep;
+    }
+    if (!target || (target->samples && voice.position > target->position)) {
+      target = &voice;
+    }
+  }
+
+  target->samples = hit.data();
+  target->length = static_cast<int>(hit.size());
+  target->position = 0;
+  target->instrument = instrument;
+  target->gain = gain;
+  target->fade = 1.0f;
+  target->fadeStep = 0.0f;
+  return true;
+}
+
+void DrumSynth::renderOneShots(float *out, int numFrames) {
+  for (auto &voice : mOneShotVoices) {
+    if (!voice.samples) {
+      continue;
+    }
+    const float *src = voice.samples + voice.position;
+    int count = std::min(numFrames, voice.length - voice.position);
+    if (voice.fadeStep == 0.0f) {
+      for (int i = 0; i < count; i++) {
+        out[i] += src[i] * voice.gain;
+      }
+    } else {
+      int i = 0;
+      for (; i < count && voice.fade > 0.0f; i++) {
+        out[i] += src[i] * voice.gain * voice.fade;
+        voice.fade -= voice.fadeStep;
+      }
+      count = i;
+      if (voice.fade <= 0.0f) {
+        voice.samples = nullptr;
+        continue;
+      }
+    }
+    voice.position += count;
+    if (voice.position >= voice.length) {
+      voice.samples = nullptr;
+    }
+  }
 }
 
 float DrumSynth::generateKickSample() {
@@ -76,7 +196,7 @@ float DrumSynth::generateKickSample() {
       (KickState::START_FREQ - KickState::END_FREQ) * mKick.pitchEnv;
 
   // Generate sine wave
-  float sample = std::sin(mKick.phase * 2.0f * static_cast<float>(M_PI));
+  float sample = sinTwoPi(mKick.phase);
 
   // Tiny click at start
   float clickDurationSamples =
@@ -112,7 +232,7 @@ float DrumSynth::generateSnareSample() {
   // 707-style snare: mellow body tone + bandpass filtered noise
 
   // Body tone: sine wave around 200Hz for warmth
-  float body = std::sin(mSnare.bodyPhase * 2.0f * static_cast<float>(M_PI));
+  float body = sinTwoPi(mSnare.bodyPhase);
   float toneSample = body * SnareState::BODY_MIX * mSnare.toneEnv;
 
   // Bandpass filtered noise using state variable filter
@@ -120,8 +240,7 @@ float DrumSynth::generateSnareSample() {
   float rawNoise = generateNoise();
 
   // SVF bandpass filter coefficients
-  float f = 2.0f * std::sin(static_cast<float>(M_PI) * SnareState::BP_FREQ /
-                            mSampleRate);
+  float f = mSnareBandpassF;
   float q = 1.0f / SnareState::BP_Q;
 
   // State variable filter iteration
@@ -177,8 +296,7 @@ float DrumSynth::generateHiHatSample() {
   toneSum /= 6.0f;
 
   // High-pass filter the tone for brightness (simple one-pole HP)
-  float hpCoeff = 1.0f - std::exp(-2.0f * static_cast<float>(M_PI) *
-                                  HiHatState::HP_FREQ / mSampleRate);
+  float hpCoeff = mHiHatHighpassCoeff;
   mHiHat.hpState += hpCoeff * (toneSum - mHiHat.hpState);
   float filteredTone = toneSum - mHiHat.hpState;
 
@@ -210,6 +328,6 @@ float DrumSynth::generateHiHatSample() {
   return sample * 0.175f; // Half volume relative to kick/snare
 }
 
-float DrumSynth::generateNoise() { return mNoiseDist(mRng); }
+float DrumSynth::generateNoise() { return mNoise.next(); }
 
 } // namespace synthio
@@ -1,21 +1,30 @@
 #ifndef SYNTHIO_DRUM_SYNTH_H
 #define SYNTHIO_DRUM_SYNTH_H
 
+#include "DrumOneShots.h"
+#include "NoiseSource.h"
+#include <array>
 #include <cstdint>
-#include <random>
 
 namespace synthio {
 
 /**
  * Classic 808/707-style drum synthesizer
  * Produces dry, punchy kick, snare, and metallic hi-hat sounds
+ *
+ * The per-sample synthesis state (the three instruments, noise and filter
+ * coefficients) leads the layout; one-shot playback follows, and the
+ * sample rate and one-shot bookkeeping used only on hits come last.
  */
-class DrumSynth {
+class alignas(64) DrumSynth {
 public:
   DrumSynth();
 
   void setSampleRate(float sampleRate);
 
+  // Restarts the noise sequence from seed (reproducible renders)
+  void seedNoise(uint32_t seed) { mNoise.seed(seed); }
+
   // Trigger drum hits
   void triggerKick(float velocity = 1.0f);
   void triggerSnare(float velocity = 1.0f);
@@ -24,15 +33,27 @@ public:
   // Get next sample (mix of all active drum voices)
   float nextSample();
 
+  // Block processing: writes numFrames samples (mix of all active voices)
+  void processBlock(float *out, int numFrames);
+
   // Check if any drums are currently sounding
   bool isActive() const;
 
-private:
-  float mSampleRate = 48000.0f;
+  // ===== ONE-SHOT CACHE =====
+  // With a set attached and enabled, hits play pre-rendered samples instead
+  // of running the synthesis per sample. Hits overlap; retriggering an
+  // instrument fades its previous hit out over CHOKE_MS, where the
+  // synthesized voice would restart. The set must match the sample rate and
+  // is attached on a control thread while no audio thread renders.
+  void setOneShots(const DrumOneShots *oneShots) { mOneShots = oneShots; }
+  void setOneShotsEnabled(bool enabled) { mOneShotsEnabled = enabled; }
+  bool isOneShotsEnabled() const { return mOneShotsEnabled; }
 
-  // Random generator for noise
-  std::mt19937 mRng;
-  std::uniform_real_distribution<float> mNoiseDist{-1.0f, 1.0f};
+private:
+  // ===== HOT: per-sample synthesis =====
+  NoiseSource mNoise;
+  float mSnareBandpassF = 0.0f;     // SVF frequency coefficient
+  float mHiHatHighpassCoeff = 0.0f; // One-pole high-pass coefficient
 
   // ========== KICK DRUM ==========
   // Punchy 808-style kick with controlled decay
@@ -109,6 +130,36 @@ private:
     static constexpr float NOISE_MIX = 0.4f;  // Filtered noise for sizzle
   } mHiHat;
 
+  // ===== ONE-SHOT PLAYBACK =====
+  static constexpr int KICK_SHOT = 0;
+  static constexpr int SNARE_SHOT = 1;
+  static constexpr int HIHAT_SHOT = 2;
+  static constexpr int MAX_ONE_SHOT_VOICES = 12;
+  static constexpr float CHOKE_MS = 5.0f;
+
+  struct OneShotVoice {
+    const float *samples = nullptr; // nullptr = free
+    int length = 0;
+    int position = 0;
+    int instrument = 0;
+    float gain = 0.0f;
+    float fade = 1.0f;
+    float fadeStep = 0.0f; // Non-zero once choked
+  };
+
+  std::array<OneShotVoice, MAX_ONE_SHOT_VOICES> mOneShotVoices;
+
+  // ===== COLD: hits and configuration =====
+  float mSampleRate = 48000.0f;
+  const DrumOneShots *mOneShots = nullptr;
+  bool mOneShotsEnabled = true;
+  int mNextVariant[DrumOneShots::NUM_INSTRUMENTS] = {};
+
+  // Returns false if there is no cached hit to play (synthesize instead)
+  bool playOneShot(int instrument, float gain);
+  // Adds numFrames of every playing one-shot to out
+  void renderOneShots(float *out, int numFrames);
+
   // Helper methods
   float generateKickSample();
   float generateSnareSample();
@@ -32,6 +32,25 @@ void Envelope::setRelease(float releaseTime) {
     mReleaseRate = calculateRate(mReleaseTime);
 }
 
+Envelope::Rates Envelope::computeRates(float attackTime, float decayTime,
+                                       float releaseTime, float sampleRate) {
+    // Same clamping and formula as the setters
+    return {1.0f / (std::max(0.001f, attackTime) * sampleRate),
+            1.0f / (std::max(0.001f, decayTime) * sampleRate),
+            1.0f / (std::max(0.001f, releaseTime) * sampleRate)};
+}
+
+void Envelope::setADSR(float attackTime, float decayTime, float sustainLevel,
+                       float releaseTime, const Rates& rates) {
+    mAttackTime = std::max(0.001f, attackTime);
+    mDecayTime = std::max(0.001f, decayTime);
+    mReleaseTime = std::max(0.001f, releaseTime);
+    mAttackRate = rates.attack;
+    mDecayRate = rates.decay;
+    mReleaseRate = rates.release;
+    setSustain(sustainLevel);
+}
+
 void Envelope::gate(bool isOn) {
     if (isOn) {
         mStage = EnvelopeStage::ATTACK;
@@ -41,10 +60,20 @@ void Envelope::gate(bool isOn) {
     }
 }
 
+void Envelope::fadeOut(float time) {
+    if (mStage == EnvelopeStage::IDLE) {
+        return;
+    }
+    // The next setRelease()/setADSR() restores the configured rate
+    mReleaseRate = std::max(mReleaseRate, calculateRate(time));
+    mStage = EnvelopeStage::RELEASE;
+}
+
 void Envelope::calculateRates() {
     mAttackRate = calculateRate(mAttackTime);
     mDecayRate = calculateRate(mDecayTime);
     mReleaseRate = calculateRate(mReleaseTime);
+    mSustainGlide = 1.0f - std::exp(-1.0f / (SUSTAIN_GLIDE_TIME * mSampleRate));
 }
 
 float Envelope::calculateRate(float time) {
@@ -54,6 +83,22 @@ float Envelope::calculateRate(float time) {
     return 1.0f / (time * mSampleRate);
 }
 
+void Envelope::processBlock(float* out, int numFrames) {
+    // Flat stages stay flat for the whole block, so fill them directly
+    if (mStage == EnvelopeStage::IDLE ||
+        (mStage == EnvelopeStage::SUSTAIN && mCurrentLevel == mSustainLevel)) {
+        mCurrentLevel = (mStage == EnvelopeStage::IDLE) ? 0.0f : mSustainLevel;
+        for (int i = 0; i < numFrames; ++i) {
+            out[i] = mCurrentLevel;
+        }
+        return;
+    }
+    
+    for (int i = 0; i < numFrames; ++i) {
+        out[i] = nextSample();
+    }
+}
+
 float Envelope::nextSample() {
     switch (mStage) {
         case EnvelopeStage::IDLE:
@@ -79,8 +124,11 @@ float Envelope::nextSample() {
             break;
             
         case EnvelopeStage::SUSTAIN:
-            // Hold at sustain level
-            mCurrentLevel = mSustainLevel;
+            // Hold at sustain level, gliding there if it was changed
+            mCurrentLevel += (mSustainLevel - mCurrentLevel) * mSustainGlide;
+            if (std::abs(mCurrentLevel - mSustainLevel) < 0.0001f) {
+                mCurrentLevel = mSustainLevel;
+            }
             break;
             
         case EnvelopeStage::RELEASE:
@@ -13,8 +13,18 @@ enum class EnvelopeStage {
 
 class Envelope {
 public:
+    // Per-sample stage rates for a set of stage times
+    struct Rates {
+        float attack;
+        float decay;
+        float release;
+    };
+    
     Envelope();
     
+    static Rates computeRates(float attackTime, float decayTime,
+                              float releaseTime, float sampleRate);
+    
     void setSampleRate(float sampleRate);
     
     // Set times in seconds
@@ -22,12 +32,21 @@ public:
     void setDecay(float decayTime);
     void setSustain(float sustainLevel); // 0.0 to 1.0
     void setRelease(float releaseTime);
+    // All four at once with rates from computeRates() at this sample rate
+    void setADSR(float attackTime, float decayTime, float sustainLevel,
+                 float releaseTime, const Rates& rates);
     
     void gate(bool isOn);
+    // Releases over at most time seconds, however long the release is set
+    void fadeOut(float time);
     float nextSample();
     
+    // Block processing: writes numFrames envelope levels to out
+    void processBlock(float* out, int numFrames);
+    
     bool isActive() const { return mStage != EnvelopeStage::IDLE; }
     EnvelopeStage getStage() const { return mStage; }
+    float getLevel() const { return mCurrentLevel; }
 
 private:
     float mSampleRate = 48000.0f;
@@ -36,6 +55,7 @@ private:
     float mDecayRate = 0.0f;
     float mSustainLevel = 0.7f;
     float mReleaseRate = 0.0f;
+    float mSustainGlide = 1.0f; // Per-sample glide to a changed sustain level
     
     float mAttackTime = 0.01f;
     float mDecayTime = 0.1f;
@@ -49,6 +69,8 @@ private:
     
     // Exponential curve coefficient
     static constexpr float CURVE_COEFFICIENT = 0.0001f;
+    // Time constant of the glide when the sustain level moves mid-note
+    static constexpr float SUSTAIN_GLIDE_TIME = 0.005f;
 };
 
 } // namespace synthio
@@ -0,0 +1,90 @@
+#ifndef SYNTHIO_EVENT_QUEUE_H
+#define SYNTHIO_EVENT_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace synthio {
+
+/**
+ * Bounded lock-free event queue (multi-producer, single-consumer).
+ *
+ * Producers (UI / MIDI threads) never block: tryPush() returns false when the
+ * queue is full. The single consumer is the audio callback, which drains it
+ * with tryPop() without taking any lock or allocating.
+ *
+ * Each cell carries a sequence number (Vyukov bounded queue) so several
+ * producers can claim slots with one CAS while the consumer side stays a
+ * plain load/store pair.
+ */
+template <typename T, size_t Capacity> class EventQueue {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "EventQueue capacity must be a power of two");
+
+public:
+  EventQueue() {
+    for (size_t i = 0; i < Capacity; ++i) {
+      mCells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  EventQueue(const EventQueue &) = delete;
+  EventQueue &operator=(const EventQueue &) = delete;
+
+  // Safe to call from any thread. Returns false if the queue is full.
+  bool tryPush(const T &item) {
+    size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+      cell = &mCells[pos & MASK];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (mEnqueuePos.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false; // Full
+      } else {
+        pos = mEnqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = item;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer (audio thread) only. Returns false if the queue is empty.
+  bool tryPop(T &item) {
+    Cell &cell = mCells[mDequeuePos & MASK];
+    size_t seq = cell.sequence.load(std::memory_order_acquire);
+    if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(mDequeuePos + 1) <
+        0) {
+      return false; // Empty (or a producer is still writing this cell)
+    }
+    item = cell.data;
+    cell.sequence.store(mDequeuePos + Capacity, std::memory_order_release);
+    ++mDequeuePos;
+    return true;
+  }
+
+  static constexpr size_t capacity() { return Capacity; }
+
+private:
+  static constexpr size_t MASK = Capacity - 1;
+
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  Cell mCells[Capacity];
+  alignas(64) std::atomic<size_t> mEnqueuePos{0};
+  alignas(64) size_t mDequeuePos = 0; // Consumer-owned
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_EVENT_QUEUE_H
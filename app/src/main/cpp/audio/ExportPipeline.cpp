@@ -0,0 +1,207 @@
+#include "ExportPipeline.h"
+#include "OfflineRenderer.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+
+#define LOG_TAG "SynthIO_Export"
+#include "Log.h"
+
+namespace synthio {
+
+namespace {
+
+constexpr int CHANNELS = 2;
+constexpr int BYTES_PER_FRAME = CHANNELS * sizeof(int16_t);
+constexpr int WAV_HEADER_BYTES = 44;
+constexpr int64_t WAV_MAX_DATA_BYTES = 0xFFFFFFFFll - 36;
+
+// Both sides run for long stretches, so a full or empty ring is the
+// exception: spin briefly, then sleep
+void backOff(int &attempts) {
+  if (++attempts < 64) {
+    std::this_thread::yield();
+  } else {
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+}
+
+void putLE16(uint8_t *out, uint32_t value) {
+  out[0] = static_cast<uint8_t>(value);
+  out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void putLE32(uint8_t *out, uint32_t value) {
+  putLE16(out, value);
+  putLE16(out + 2, value >> 16);
+}
+
+} // namespace
+
+bool writeToFd(int fd, const void *data, size_t bytes, off_t offset) {
+  const uint8_t *bytesLeft = static_cast<const uint8_t *>(data);
+  while (bytes > 0) {
+    ssize_t count = offset < 0 ? ::write(fd, bytesLeft, bytes)
+                               : ::pwrite(fd, bytesLeft, bytes, offset);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOGE("Export write failed: %s", strerror(errno));
+      return false;
+    }
+    bytesLeft += count;
+    bytes -= static_cast<size_t>(count);
+    if (offset >= 0) {
+      offset += count;
+    }
+  }
+  return true;
+}
+
+// ===== WAV WRITER =====
+
+WavFileWriter::WavFileWriter(int fd, int sampleRate)
+    : mFd(fd), mSampleRate(sampleRate) {}
+
+bool WavFileWriter::writeHeader(int64_t dataBytes, bool patch) {
+  const uint32_t dataSize =
+      static_cast<uint32_t>(std::min(dataBytes, WAV_MAX_DATA_BYTES));
+  uint8_t header[WAV_HEADER_BYTES];
+  std::memcpy(header, "RIFF", 4);
+  putLE32(header + 4, 36 + dataSize);
+  std::memcpy(header + 8, "WAVEfmt ", 8);
+  putLE32(header + 16, 16); // PCM fmt chunk size
+  putLE16(header + 20, 1);  // PCM
+  putLE16(header + 22, CHANNELS);
+  putLE32(header + 24, static_cast<uint32_t>(mSampleRate));
+  putLE32(header + 28, static_cast<uint32_t>(mSampleRate * BYTES_PER_FRAME));
+  putLE16(header + 32, BYTES_PER_FRAME);
+  putLE16(header + 34, 16);
+  std::memcpy(header + 36, "data", 4);
+  putLE32(header + 40, dataSize);
+  return writeToFd(mFd, header, sizeof(header), patch ? 0 : -1);
+}
+
+bool WavFileWriter::write(const int16_t *interleaved, int numFrames) {
+  if (!mHeaderWritten) {
+    if (!writeHeader(0, false)) {
+      return false;
+    }
+    mHeaderWritten = true;
+  }
+  // Samples are already little-endian on every Android ABI
+  if (!writeToFd(mFd, interleaved,
+                 static_cast<size_t>(numFrames) * BYTES_PER_FRAME)) {
+    return false;
+  }
+  mFramesWritten += numFrames;
+  return true;
+}
+
+bool WavFileWriter::finish() {
+  if (!mHeaderWritten) {
+    if (!writeHeader(0, false)) {
+      return false;
+    }
+    mHeaderWritten = true;
+  }
+  // Patch the RIFF and data sizes now that the length is known
+  if (!writeHeader(mFramesWritten * BYTES_PER_FRAME, true)) {
+    return false;
+  }
+  fdatasync(mFd);
+  return true;
+}
+
+// ===== PIPELINE =====
+
+ExportPipeline::ExportPipeline()
+    : mSamples(static_cast<size_t>(QUEUE_CHUNKS) * CHUNK_FRAMES * CHANNELS) {}
+
+int64_t ExportPipeline::run(OfflineRenderer &renderer, ExportWriter &writer,
+                            int64_t expectedFrames,
+                            std::atomic<float> *progress) {
+  mWriteCount.store(0);
+  mReadCount.store(0);
+  mFailed.store(false);
+  mFramesWritten = 0;
+  if (progress != nullptr) {
+    progress->store(0.0f);
+  }
+
+  std::thread writerThread(
+      [this, &writer, expectedFrames, progress] {
+        drain(writer, expectedFrames, progress);
+      });
+
+  // Producer: render into free slots until the renderer runs dry, then
+  // push the empty end-of-export chunk
+  bool done = false;
+  while (!done && !mFailed.load(std::memory_order_acquire)) {
+    const uint32_t count = mWriteCount.load(std::memory_order_relaxed);
+    int attempts = 0;
+    while (count - mReadCount.load(std::memory_order_acquire) >=
+               QUEUE_CHUNKS &&
+           !mFailed.load(std::memory_order_acquire)) {
+      backOff(attempts);
+    }
+    if (mFailed.load(std::memory_order_acquire)) {
+      break; // The writer gave up and stopped reading
+    }
+
+    const int frames = renderer.renderChunk(slot(count), CHUNK_FRAMES);
+    mChunks[count % QUEUE_CHUNKS].numFrames = frames;
+    done = frames == 0;
+    mWriteCount.store(count + 1, std::memory_order_release);
+  }
+
+  writerThread.join();
+  return mFailed.load() ? -1 : mFramesWritten;
+}
+
+void ExportPipeline::drain(ExportWriter &writer, int64_t expectedFrames,
+                           std::atomic<float> *progress) {
+  const double scale =
+      1.0 / static_cast<double>(std::max<int64_t>(expectedFrames, 1));
+  int64_t written = 0;
+  bool ok = true;
+  while (true) {
+    const uint32_t count = mReadCount.load(std::memory_order_relaxed);
+    int attempts = 0;
+    while (mWriteCount.load(std::memory_order_acquire) == count) {
+      backOff(attempts);
+    }
+
+    const int frames = mChunks[count % QUEUE_CHUNKS].numFrames;
+    if (frames == 0) {
+      ok = writer.finish();
+      break;
+    }
+    if (!writer.write(slot(count), frames)) {
+      ok = false;
+      break;
+    }
+    written += frames;
+    mReadCount.store(count + 1, std::memory_order_release);
+
+    // The drum tail isn't in expectedFrames; hold short of done until the
+    // writer has finished
+    if (progress != nullptr) {
+      progress->store(static_cast<float>(
+          std::min(0.99, static_cast<double>(written) * scale)));
+    }
+  }
+
+  mFramesWritten = written;
+  if (!ok) {
+    mFailed.store(true, std::memory_order_release);
+  } else if (progress != nullptr) {
+    progress->store(1.0f);
+  }
+}
+
+} // namespace synthio
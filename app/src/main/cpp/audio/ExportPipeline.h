@@ -0,0 +1,101 @@
+#ifndef SYNTHIO_EXPORT_PIPELINE_H
+#define SYNTHIO_EXPORT_PIPELINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <sys/types.h>
+#include <vector>
+
+namespace synthio {
+
+class OfflineRenderer;
+
+/**
+ * Destination of an export. Receives interleaved 16-bit stereo chunks, in
+ * order, on the pipeline's writer thread.
+ */
+class ExportWriter {
+public:
+  virtual ~ExportWriter() = default;
+
+  // Returns false on an I/O or codec error, which ends the export
+  virtual bool write(const int16_t *interleaved, int numFrames) = 0;
+
+  // After the last chunk: flush, end the stream, patch headers
+  virtual bool finish() = 0;
+};
+
+// Writes all of data to fd, appending (offset < 0) or at offset. Retries
+// short and interrupted writes; false on error.
+bool writeToFd(int fd, const void *data, size_t bytes, off_t offset = -1);
+
+/**
+ * 16-bit stereo WAV written straight to a file descriptor. The header goes
+ * out with placeholder sizes that finish() patches, so the length needn't
+ * be known up front. The descriptor stays owned by the caller.
+ */
+class WavFileWriter : public ExportWriter {
+public:
+  WavFileWriter(int fd, int sampleRate);
+
+  bool write(const int16_t *interleaved, int numFrames) override;
+  bool finish() override;
+
+private:
+  int mFd;
+  int mSampleRate;
+  int64_t mFramesWritten = 0;
+  bool mHeaderWritten = false;
+
+  bool writeHeader(int64_t dataBytes, bool patch);
+};
+
+/**
+ * Export with rendering and encoding overlapped.
+ *
+ * The calling thread renders chunks into a small ring of chunk slots while
+ * a writer thread hands them to the ExportWriter, so the mixdown of one
+ * chunk runs while the previous one is being encoded and written. The ring
+ * is single-producer / single-consumer and lock-free; either side only
+ * waits (yielding, then sleeping) when the ring is full or empty. Memory is
+ * the ring, whatever the length of the export.
+ */
+class ExportPipeline {
+public:
+  static constexpr int CHUNK_FRAMES = 4096;
+  static constexpr int QUEUE_CHUNKS = 4;
+
+  ExportPipeline();
+
+  // Renders the started renderer to its end into writer. expectedFrames
+  // (the length before the drum tail) scales progress, which goes from 0
+  // to 1 as chunks are written. Returns the frames written, or -1 if the
+  // writer failed.
+  int64_t run(OfflineRenderer &renderer, ExportWriter &writer,
+              int64_t expectedFrames, std::atomic<float> *progress);
+
+private:
+  struct Chunk {
+    int numFrames = 0; // 0 marks the end of the export
+  };
+
+  std::vector<int16_t> mSamples; // QUEUE_CHUNKS slots of CHUNK_FRAMES
+  Chunk mChunks[QUEUE_CHUNKS];
+  // Free-running counts of chunks pushed and popped
+  std::atomic<uint32_t> mWriteCount{0};
+  std::atomic<uint32_t> mReadCount{0};
+  std::atomic<bool> mFailed{false};
+  int64_t mFramesWritten = 0; // Set by the writer thread, read after join
+
+  int16_t *slot(uint32_t count) {
+    return mSamples.data() +
+           static_cast<size_t>(count % QUEUE_CHUNKS) * CHUNK_FRAMES * 2;
+  }
+
+  void drain(ExportWriter &writer, int64_t expectedFrames,
+             std::atomic<float> *progress);
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_EXPORT_PIPELINE_H
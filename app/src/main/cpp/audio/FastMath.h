@@ -0,0 +1,238 @@
+#ifndef SYNTHIO_FAST_MATH_H
+#define SYNTHIO_FAST_MATH_H
+
+#include "SimdMath.h"
+#include <cstdint>
+#include <cstring>
+
+namespace synthio {
+
+/**
+ * Shared approximations of the transcendental functions the audio path
+ * calls per sample, so every module uses the same (measured) kernel rather
+ * than libm or its own hand-rolled version.
+ *
+ * Each scalar kernel performs the same operations in the same order as its
+ * float4 counterpart, so the scalar and vectorized render paths agree. The
+ * bounds below are the largest errors against double-precision libm over
+ * the stated domain, re-measured by `synthio_bench --math`.
+ *
+ *   sinTwoPi(phase)  phase in [0, 1)     abs error <= 3e-7
+ *   fastTanh(x)      any x               abs error <= 1.2e-4
+ *   fastExp2(x)      x in [-126, 127]    rel error <= 3e-7
+ *   fastLog2(x)      normal positive x   abs error <= 3e-7 (relative once
+ *                                        |log2 x| > 1, where the float
+ *                                        result's own rounding dominates)
+ *
+ * fastExp2 and fastLog2 need integer access to the float bits, which float4
+ * doesn't provide; they are only used at control rate and stay scalar.
+ */
+
+namespace fastmath {
+
+// a * b + c as two roundings, like madd4
+inline float madd(float a, float b, float c) {
+  float product = a * b;
+  return product + c;
+}
+
+inline float bitsToFloat(uint32_t bits) {
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+inline uint32_t floatToBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// ===== CONSTANT TABLES =====
+// Built at compile time from double-precision series, so there is no
+// start-up cost and no libm dependency.
+
+constexpr int TABLE_BITS = 5;
+constexpr int TABLE_SIZE = 1 << TABLE_BITS;
+constexpr double LN2 = 0.69314718055994530942;
+
+// e^x by its Taylor series; |x| < 1 in the uses below
+constexpr double seriesExp(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  for (int n = 1; n < 30; ++n) {
+    term *= x / n;
+    sum += term;
+  }
+  return sum;
+}
+
+// ln(x) = 2 atanh((x - 1) / (x + 1)); x in [1, 2] in the uses below
+constexpr double seriesLog(double x) {
+  const double z = (x - 1.0) / (x + 1.0);
+  const double z2 = z * z;
+  double sum = 0.0;
+  double power = z;
+  for (int n = 1; n < 60; n += 2) {
+    sum += power / n;
+    power *= z2;
+  }
+  return 2.0 * sum;
+}
+
+struct Exp2Table {
+  float value[TABLE_SIZE] = {}; // 2^(i / 32)
+  constexpr Exp2Table() {
+    for (int i = 0; i < TABLE_SIZE; ++i) {
+      value[i] = static_cast<float>(seriesExp(LN2 * i / TABLE_SIZE));
+    }
+  }
+};
+
+struct Log2Table {
+  float log2Centre[TABLE_SIZE] = {};  // log2(1 + i / 32)
+  float invCentre[TABLE_SIZE] = {};   // 1 / (1 + i / 32)
+  constexpr Log2Table() {
+    for (int i = 0; i < TABLE_SIZE; ++i) {
+      const double centre = 1.0 + static_cast<double>(i) / TABLE_SIZE;
+      log2Centre[i] = static_cast<float>(seriesLog(centre) / LN2);
+      invCentre[i] = static_cast<float>(1.0 / centre);
+    }
+  }
+};
+
+constexpr Exp2Table EXP2_TABLE{};
+constexpr Log2Table LOG2_TABLE{};
+
+} // namespace fastmath
+
+// ===== SINE =====
+
+// sin(2*pi*phase) for phase in [0, 1). Odd Taylor polynomial on the
+// quarter-wave after folding.
+inline float sinTwoPi(float phase) {
+  using fastmath::madd;
+  // Map [0, 1) to [-0.5, 0.5)
+  float x = phase >= 0.5f ? phase - 1.0f : phase;
+  // Fold to [-0.25, 0.25] where the polynomial is accurate
+  x = x > 0.25f ? 0.5f - x : x;
+  x = x < -0.25f ? -0.5f - x : x;
+
+  float y = x * 6.28318530717958647692f;
+  float y2 = y * y;
+  float p = -2.5052108385441720e-8f;      // -1/11!
+  p = madd(p, y2, 2.7557319223985893e-6f);  //  1/9!
+  p = madd(p, y2, -1.9841269841269841e-4f); // -1/7!
+  p = madd(p, y2, 8.3333333333333333e-3f);  //  1/5!
+  p = madd(p, y2, -1.6666666666666667e-1f); // -1/3!
+  p = madd(p, y2, 1.0f);
+  return p * y;
+}
+
+inline float4 sinTwoPi4(float4 phase) {
+  const float4 half = splat4(0.5f);
+  const float4 quarter = splat4(0.25f);
+  float4 x = select4(ge4(phase, half), sub4(phase, splat4(1.0f)), phase);
+  x = select4(gt4(x, quarter), sub4(half, x), x);
+  x = select4(lt4(x, splat4(-0.25f)), sub4(splat4(-0.5f), x), x);
+
+  float4 y = mul4(x, splat4(6.28318530717958647692f));
+  float4 y2 = mul4(y, y);
+  float4 p = splat4(-2.5052108385441720e-8f);
+  p = madd4(p, y2, splat4(2.7557319223985893e-6f));
+  p = madd4(p, y2, splat4(-1.9841269841269841e-4f));
+  p = madd4(p, y2, splat4(8.3333333333333333e-3f));
+  p = madd4(p, y2, splat4(-1.6666666666666667e-1f));
+  p = madd4(p, y2, splat4(1.0f));
+  return mul4(p, y);
+}
+
+// ===== TANH =====
+
+// tanh via a [7/6] Pade approximant, clamped to [-1, 1]. Worst near |x| = 4.5
+// where it overshoots slightly into the clamp; transparent below |x| = 1.
+inline float fastTanh(float x) {
+  using fastmath::madd;
+  x = x < 9.0f ? x : 9.0f;
+  x = x > -9.0f ? x : -9.0f;
+  float x2 = x * x;
+  float num = madd(x2, 1.0f, 378.0f);
+  num = madd(num, x2, 17325.0f);
+  num = madd(num, x2, 135135.0f);
+  num = num * x;
+  float den = madd(x2, 28.0f, 3150.0f);
+  den = madd(den, x2, 62370.0f);
+  den = madd(den, x2, 135135.0f);
+  float r = num / den;
+  r = r < 1.0f ? r : 1.0f;
+  return r > -1.0f ? r : -1.0f;
+}
+
+inline float4 tanh4(float4 x) {
+  x = max4(min4(x, splat4(9.0f)), splat4(-9.0f));
+  float4 x2 = mul4(x, x);
+  float4 num = madd4(x2, splat4(1.0f), splat4(378.0f));
+  num = madd4(num, x2, splat4(17325.0f));
+  num = madd4(num, x2, splat4(135135.0f));
+  num = mul4(num, x);
+  float4 den = madd4(x2, splat4(28.0f), splat4(3150.0f));
+  den = madd4(den, x2, splat4(62370.0f));
+  den = madd4(den, x2, splat4(135135.0f));
+  float4 r = div4(num, den);
+  return max4(min4(r, splat4(1.0f)), splat4(-1.0f));
+}
+
+// ===== EXP2 / LOG2 =====
+
+// 2^x: x * 32 splits into a table entry 2^(i/32), a power of two applied
+// through the exponent bits, and a remainder below 1/32 handled by a cubic.
+// Inputs outside [-126, 127] are clamped.
+inline float fastExp2(float x) {
+  using fastmath::madd;
+  x = x < 127.0f ? x : 127.0f;
+  x = x > -126.0f ? x : -126.0f;
+  const float scaled = x * static_cast<float>(fastmath::TABLE_SIZE);
+  int k = static_cast<int>(scaled);
+  k -= (static_cast<float>(k) > scaled) ? 1 : 0; // Floor for negatives
+  const float r = (scaled - static_cast<float>(k)) *
+                  (static_cast<float>(fastmath::LN2) / fastmath::TABLE_SIZE);
+  // e^r, r in [0, ln2 / 32)
+  float p = 1.0f / 6.0f;
+  p = madd(p, r, 0.5f);
+  p = madd(p, r, 1.0f);
+  p = madd(p, r, 1.0f);
+  const int octave = k >> fastmath::TABLE_BITS; // Arithmetic: floors
+  const float scale =
+      fastmath::bitsToFloat(static_cast<uint32_t>(octave + 127) << 23);
+  return fastmath::EXP2_TABLE.value[k & (fastmath::TABLE_SIZE - 1)] * p *
+         scale;
+}
+
+// log2(x) for normal x > 0: exponent from the float bits, the top mantissa
+// bits pick a table centre c, and log2(m / c) comes from a short series.
+// Zero, negative and denormal inputs are the caller's to avoid.
+inline float fastLog2(float x) {
+  using fastmath::madd;
+  const uint32_t bits = fastmath::floatToBits(x);
+  const int exponent = static_cast<int>((bits >> 23) & 0xFF) - 127;
+  const int index = static_cast<int>((bits >> (23 - fastmath::TABLE_BITS)) &
+                                     (fastmath::TABLE_SIZE - 1));
+  const float mantissa = fastmath::bitsToFloat((bits & 0x007FFFFFu) |
+                                               0x3F800000u);
+  const float centre =
+      1.0f + static_cast<float>(index) / fastmath::TABLE_SIZE;
+  // m / c - 1, in [0, 1/32)
+  const float r = (mantissa - centre) * fastmath::LOG2_TABLE.invCentre[index];
+  // ln(1 + r) = r - r^2/2 + r^3/3 - r^4/4
+  float p = -0.25f;
+  p = madd(p, r, 1.0f / 3.0f);
+  p = madd(p, r, -0.5f);
+  p = madd(p, r, 1.0f);
+  const float log2Fraction = p * r * static_cast<float>(1.0 / fastmath::LN2);
+  return (static_cast<float>(exponent) + fastmath::LOG2_TABLE.log2Centre[index]) +
+         log2Fraction;
+}
+
+} // namespace synthio
+
+#endif // SYNTHIO_FAST_MATH_H
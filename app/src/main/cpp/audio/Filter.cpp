@@ -1,5 +1,7 @@
 #define _USE_MATH_DEFINES
 #include "Filter.h"
+#include "Denormals.h"
+#include "FastMath.h"
 #include <cmath>
 #include <algorithm>
 
@@ -12,6 +14,7 @@ namespace synthio {
 constexpr float PI = M_PI;
 
 Filter::Filter() {
+    updateSegmentSmoothing();
     calculateLPFCoefficients();
     calculateHPFCoefficient();
 }
@@ -32,11 +35,51 @@ void Filter::setResonance(float resonance) {
     calculateLPFCoefficients();
 }
 
+void Filter::rampResonance(float resonance) {
+    mResonance = std::max(0.0f, std::min(1.0f, resonance));
+    float a0, a1, a2, b1, b2;
+    designLPF(mCutoff, a0, a1, a2, b1, b2);
+    const float rampScale = 1.0f / mControlInterval;
+    mDA0 = (a0 - mA0) * rampScale;
+    mDA1 = (a1 - mA1) * rampScale;
+    mDA2 = (a2 - mA2) * rampScale;
+    mDB1 = (b1 - mB1) * rampScale;
+    mDB2 = (b2 - mB2) * rampScale;
+    mControlCountdown = mControlInterval;
+}
+
+void Filter::setControlInterval(int samples) {
+    // A segment in flight finishes at the old length
+    mControlInterval = std::max(1, samples);
+    updateSegmentSmoothing();
+}
+
+void Filter::setOversampling(bool enabled) {
+    if (enabled == mOversample) {
+        return;
+    }
+    mOversample = enabled;
+    std::fill(mUpHistory, mUpHistory + 3, 0.0f);
+    std::fill(mDownHistory, mDownHistory + 5, 0.0f);
+    // Same cutoff, designed for the new rate
+    rampResonance(mResonance);
+}
+
+void Filter::updateSegmentSmoothing() {
+    mSegmentSmoothing = 1.0f - std::pow(1.0f - mSmoothingFactor,
+                                        static_cast<float>(mControlInterval));
+}
+
 void Filter::setHPFCutoff(float cutoffHz) {
     mHPFCutoff = std::max(0.0f, std::min(1000.0f, cutoffHz));
     calculateHPFCoefficient();
 }
 
+void Filter::setHPFCutoff(float cutoffHz, float coefficient) {
+    mHPFCutoff = std::max(0.0f, std::min(1000.0f, cutoffHz));
+    mHPFCoeff = coefficient;
+}
+
 void Filter::setKeyTracking(float amount) {
     mKeyTracking = std::max(0.0f, std::min(1.0f, amount));
 }
@@ -46,30 +89,106 @@ void Filter::setNoteFrequency(float freq) {
 }
 
 void Filter::reset() {
+    // Land any coefficient ramp still in flight, then re-evaluate the
+    // cutoff on the next sample
+    if (mControlCountdown > 0) {
+        mA0 += mDA0 * mControlCountdown;
+        mA1 += mDA1 * mControlCountdown;
+        mA2 += mDA2 * mControlCountdown;
+        mB1 += mDB1 * mControlCountdown;
+        mB2 += mDB2 * mControlCountdown;
+    }
+    mDA0 = mDA1 = mDA2 = mDB1 = mDB2 = 0.0f;
+    mControlCountdown = 0;
     mX1 = mX2 = mY1 = mY2 = 0.0f;
+    std::fill(mUpHistory, mUpHistory + 3, 0.0f);
+    std::fill(mDownHistory, mDownHistory + 5, 0.0f);
     mHPFState = 0.0f;
     mDCBlockState = 0.0f;
 }
 
 float Filter::process(float input) {
-    // Apply key tracking to cutoff
-    float keyTrackOffset = 0.0f;
-    if (mKeyTracking > 0.0f) {
-        // Track relative to middle C (261.63 Hz)
-        float octaveOffset = std::log2(mNoteFrequency / 261.63f);
-        // Each octave adds/subtracts from cutoff (scaled by tracking amount)
-        keyTrackOffset = octaveOffset * 2000.0f * mKeyTracking;
+    return processSample(input, keyTrackOffset());
+}
+
+void Filter::processBlock(float* buffer, const float* cutoffs, int numFrames) {
+    // Key tracking only depends on the note, so hoist the log2 out of the loop
+    const float keyOffset = keyTrackOffset();
+    for (int i = 0; i < numFrames; ++i) {
+        if (cutoffs) {
+            mTargetCutoff = std::max(20.0f, std::min(20000.0f, cutoffs[i]));
+        }
+        buffer[i] = processSample(buffer[i], keyOffset);
+    }
+}
+
+void Filter::computeCoefficients(const float* cutoffs, FilterCoefficientBlock& out,
+                                 int numFrames) {
+    const float keyOffset = keyTrackOffset();
+    for (int i = 0; i < numFrames; ++i) {
+        mTargetCutoff = std::max(20.0f, std::min(20000.0f, cutoffs[i]));
+        tickControl(keyOffset);
+        out.a0[i] = mA0;
+        out.a1[i] = mA1;
+        out.a2[i] = mA2;
+        out.b1[i] = mB1;
+        out.b2[i] = mB2;
+        advanceCoefficientRamp();
+    }
+}
+
+float Filter::keyTrackOffset() const {
+    if (mKeyTracking <= 0.0f) {
+        return 0.0f;
     }
+    // Track relative to middle C (261.63 Hz)
+    float octaveOffset = fastLog2(mNoteFrequency / 261.63f);
+    // Each octave adds/subtracts from cutoff (scaled by tracking amount)
+    return octaveOffset * 2000.0f * mKeyTracking;
+}
+
+void Filter::tickControl(float keyTrackOffset) {
+    if (mControlCountdown <= 0) {
+        beginControlSegment(keyTrackOffset);
+    }
+    --mControlCountdown;
+}
+
+void Filter::beginControlSegment(float keyTrackOffset) {
+    mControlCountdown = mControlInterval;
     
     float effectiveCutoff = mTargetCutoff + keyTrackOffset;
     effectiveCutoff = std::max(20.0f, std::min(20000.0f, effectiveCutoff));
     
-    // Smooth cutoff changes
-    if (std::abs(mCutoff - effectiveCutoff) > 1.0f) {
-        mCutoff += (effectiveCutoff - mCutoff) * mSmoothingFactor;
-        calculateLPFCoefficients();
+    // Settled: hold the current coefficients
+    if (std::abs(mCutoff - effectiveCutoff) <= 1.0f) {
+        mDA0 = mDA1 = mDA2 = mDB1 = mDB2 = 0.0f;
+        return;
     }
     
+    // Smooth cutoff changes (one step equivalent to mControlInterval
+    // per-sample steps), then ramp the coefficients to the new design
+    mCutoff += (effectiveCutoff - mCutoff) * mSegmentSmoothing;
+    
+    float a0, a1, a2, b1, b2;
+    designLPF(mCutoff, a0, a1, a2, b1, b2);
+    const float rampScale = 1.0f / mControlInterval;
+    mDA0 = (a0 - mA0) * rampScale;
+    mDA1 = (a1 - mA1) * rampScale;
+    mDA2 = (a2 - mA2) * rampScale;
+    mDB1 = (b1 - mB1) * rampScale;
+    mDB2 = (b2 - mB2) * rampScale;
+}
+
+void Filter::advanceCoefficientRamp() {
+    mA0 += mDA0;
+    mA1 += mDA1;
+    mA2 += mDA2;
+    mB1 += mDB1;
+    mB2 += mDB2;
+}
+
+float Filter::lowPass(float input) {
     // Low-pass filter (Biquad Direct Form I)
     float lpfOutput = mA0 * input + mA1 * mX1 + mA2 * mX2 - mB1 * mY1 - mB2 * mY2;
     
@@ -83,13 +202,48 @@ float Filter::process(float input) {
     mY2 = mY1;
     mY1 = softSaturate(lpfOutput);  // Saturate state to prevent feedback runaway
     
-    // Prevent denormalized values and infinities in state variables
-    // Denormals cause performance issues and accumulate to corrupt state
-    const float antiDenormal = 1e-20f;
-    if (std::abs(mY1) < antiDenormal) mY1 = 0.0f;
-    if (std::abs(mY2) < antiDenormal) mY2 = 0.0f;
-    if (!std::isfinite(mY1)) mY1 = 0.0f;
-    if (!std::isfinite(mY2)) mY2 = 0.0f;
+    // Denormals are flushed by the audio threads' FP mode (Denormals.h);
+    // only targets without one flush the decaying state by hand. mY2 is
+    // last sample's mY1, so checking mY1 covers both. softSaturate bounds
+    // the state; the NaN check catches a corrupted input or coefficient.
+#if !SYNTHIO_HAS_FTZ
+    if (std::abs(mY1) < 1e-20f) mY1 = 0.0f;
+#endif
+    if (mY1 != mY1) mY1 = 0.0f;
+    
+    return lpfOutput;
+}
+
+float Filter::lowPassOversampled(float input) {
+    // Upsample: the previous input and the half-sample point after it
+    // (4-point halfband interpolator, -1 9 9 -1 / 16)
+    const float* up = mUpHistory;
+    const float mid = (9.0f * (up[0] + up[1]) - (up[2] + input)) * (1.0f / 16.0f);
+    const float first = lowPass(up[1]);
+    const float second = lowPass(mid);
+    mUpHistory[2] = mUpHistory[1];
+    mUpHistory[1] = mUpHistory[0];
+    mUpHistory[0] = input;
+    
+    // Downsample: 7-tap halfband (-1 0 9 16 9 0 -1 / 32) over the newest
+    // oversampled outputs
+    float* down = mDownHistory;
+    const float output =
+        (9.0f * (down[0] + down[2]) + 16.0f * down[1] - (second + down[4])) *
+        (1.0f / 32.0f);
+    down[4] = down[2];
+    down[3] = down[1];
+    down[2] = down[0];
+    down[1] = first;
+    down[0] = second;
+    return output;
+}
+
+float Filter::processSample(float input, float keyTrackOffset) {
+    tickControl(keyTrackOffset);
+    
+    float lpfOutput = mOversample ? lowPassOversampled(input) : lowPass(input);
+    advanceCoefficientRamp();
     
     // Apply resonance gain compensation
     // High resonance boosts signal, so we reduce output proportionally
@@ -126,11 +280,17 @@ float Filter::softSaturate(float x) {
     // Soft knee saturation above threshold
     float sign = (x > 0) ? 1.0f : -1.0f;
     float excess = absX - threshold;
-    float compressed = threshold + (1.0f - threshold) * std::tanh(excess * 3.0f);
+    float compressed = threshold + (1.0f - threshold) * fastTanh(excess * 3.0f);
     return sign * compressed;
 }
 
 void Filter::calculateLPFCoefficients() {
+    designLPF(mCutoff, mA0, mA1, mA2, mB1, mB2);
+    mDA0 = mDA1 = mDA2 = mDB1 = mDB2 = 0.0f;
+}
+
+void Filter::designLPF(float cutoff, float& outA0, float& outA1, float& outA2,
+                       float& outB1, float& outB2) const {
     // Map resonance 0-1 to Q
     // At resonance = 1.0, Q goes high enough for self-oscillation
     float Q;
@@ -144,10 +304,11 @@ void Filter::calculateLPFCoefficients() {
     }
     
     // Clamp cutoff to valid range
-    float fc = std::min(mCutoff, mSampleRate * 0.499f);
+    const float rate = mOversample ? mSampleRate * 2.0f : mSampleRate;
+    float fc = std::min(cutoff, rate * 0.499f);
     
     // Angular frequency
-    float omega = 2.0f * PI * fc / mSampleRate;
+    float omega = 2.0f * PI * fc / rate;
     float sinOmega = std::sin(omega);
     float cosOmega = std::cos(omega);
     float alpha = sinOmega / (2.0f * Q);
@@ -161,21 +322,24 @@ void Filter::calculateLPFCoefficients() {
     float a2 = 1.0f - alpha;
     
     // Normalize coefficients
-    mA0 = b0 / a0;
-    mA1 = b1 / a0;
-    mA2 = b2 / a0;
-    mB1 = a1 / a0;
-    mB2 = a2 / a0;
+    outA0 = b0 / a0;
+    outA1 = b1 / a0;
+    outA2 = b2 / a0;
+    outB1 = a1 / a0;
+    outB2 = a2 / a0;
 }
 
 void Filter::calculateHPFCoefficient() {
-    if (mHPFCutoff < 1.0f) {
-        mHPFCoeff = 0.0f;
-    } else {
-        // Simple one-pole HPF coefficient
-        float fc = std::min(mHPFCutoff, mSampleRate * 0.499f);
-        mHPFCoeff = 1.0f - std::exp(-2.0f * PI * fc / mSampleRate);
+    mHPFCoeff = computeHPFCoefficient(mHPFCutoff, mSampleRate);
+}
+
+float Filter::computeHPFCoefficient(float cutoffHz, float sampleRate) {
+    if (cutoffHz < 1.0f) {
+        return 0.0f;
     }
+    // Simple one-pole HPF coefficient
+    float fc = std::min(cutoffHz, sampleRate * 0.499f);
+    return 1.0f - std::exp(-2.0f * PI * fc / sampleRate);
 }
 
 } // namespace synthio
@@ -1,8 +1,20 @@
 #ifndef SYNTHIO_FILTER_H
 #define SYNTHIO_FILTER_H
 
+#include "DSPConfig.h"
+
 namespace synthio {
 
+// Per-frame LPF biquad coefficients for one block (see
+// Filter::computeCoefficients)
+struct FilterCoefficientBlock {
+    float a0[MAX_BLOCK_SIZE];
+    float a1[MAX_BLOCK_SIZE];
+    float a2[MAX_BLOCK_SIZE];
+    float b1[MAX_BLOCK_SIZE];
+    float b2[MAX_BLOCK_SIZE];
+};
+
 /**
  * Enhanced filter with Juno-106 style characteristics
  * - Resonant low-pass filter with self-oscillation capability
@@ -18,9 +30,15 @@ public:
     // Low-pass filter
     void setCutoff(float cutoffHz);
     void setResonance(float resonance);  // 0.0 to 1.0 (1.0 = self-oscillation)
+    // Same, but ramps the coefficients to the new design over one control
+    // segment instead of jumping (for changes while the voice sounds)
+    void rampResonance(float resonance);
     
     // High-pass filter (0 = bass boost, higher = more bass cut)
     void setHPFCutoff(float cutoffHz);   // 0 to 1000 Hz
+    // Same, with the coefficient from computeHPFCoefficient()
+    void setHPFCutoff(float cutoffHz, float coefficient);
+    static float computeHPFCoefficient(float cutoffHz, float sampleRate);
     
     // Key tracking: filter follows pitch (0.0 = off, 1.0 = full tracking)
     void setKeyTracking(float amount);
@@ -29,18 +47,58 @@ public:
     float process(float input);
     void reset();
     
+    // Block processing (in place). cutoffs is an optional per-frame cutoff
+    // array (nullptr = keep the current target cutoff).
+    void processBlock(float* buffer, const float* cutoffs, int numFrames);
+    
+    // Runs only the cutoff smoothing for a block and records the biquad
+    // coefficients each frame would use. Used by VoiceBank, which runs the
+    // biquad itself.
+    void computeCoefficients(const float* cutoffs, FilterCoefficientBlock& out,
+                             int numFrames);
+    
+    // Quality settings (see QualityTier.h). The control interval is how many
+    // samples one cutoff design covers; oversampling runs the LPF biquad and
+    // its saturation at twice the sample rate so the clipping doesn't alias
+    // at high resonance, at the cost of 3.5 samples of latency.
+    void setControlInterval(int samples);
+    void setOversampling(bool enabled);
+    bool isOversampling() const { return mOversample; }
+    
 private:
+    friend class VoiceBank;  // Loads/stores biquad and HPF state
+    
     float mSampleRate = 48000.0f;
     
     // LPF parameters
     float mCutoff = 10000.0f;
     float mResonance = 0.0f;
     float mTargetCutoff = 10000.0f;
-    float mSmoothingFactor = 0.001f;
+    float mSmoothingFactor = 0.001f;  // Per-sample one-pole cutoff glide
+    
+    // Cutoff modulation runs at control rate: every mControlInterval samples
+    // the smoothed cutoff takes one (equivalent) multi-sample step, the biquad
+    // is designed once for it, and the coefficients are ramped linearly
+    // towards that design in between. One sin/cos per 16 samples instead of
+    // one per sample while the filter envelope or LFO is sweeping.
+    static constexpr int CONTROL_INTERVAL = 16;
+    int mControlInterval = CONTROL_INTERVAL;
+    int mControlCountdown = 0;
+    float mSegmentSmoothing = 0.0f;   // 1 - (1 - mSmoothingFactor)^interval
     
-    // LPF Biquad coefficients
+    // 2x oversampling: input history for the half-sample interpolator and
+    // oversampled LPF output history for the halfband decimator (newest
+    // first). Coefficients are designed for twice the sample rate and held
+    // for both sub-samples of a frame.
+    bool mOversample = false;
+    float mUpHistory[3] = {};
+    float mDownHistory[5] = {};
+    
+    // LPF Biquad coefficients (current) and their per-sample ramp
     float mA0 = 1.0f, mA1 = 0.0f, mA2 = 0.0f;
     float mB1 = 0.0f, mB2 = 0.0f;
+    float mDA0 = 0.0f, mDA1 = 0.0f, mDA2 = 0.0f;
+    float mDB1 = 0.0f, mDB2 = 0.0f;
     
     // LPF state
     float mX1 = 0.0f, mX2 = 0.0f;
@@ -61,9 +119,25 @@ private:
     // DC blocker state for bass boost mode
     float mDCBlockState = 0.0f;
     
+    // Sets the coefficients for mCutoff immediately (no ramp)
     void calculateLPFCoefficients();
+    // Designs the LPF biquad for a cutoff at the current resonance
+    void designLPF(float cutoff, float& a0, float& a1, float& a2,
+                   float& b1, float& b2) const;
     void calculateHPFCoefficient();
     
+    // Cutoff offset from key tracking (constant for the current note)
+    float keyTrackOffset() const;
+    float processSample(float input, float keyTrackOffset);
+    // Biquad and saturation for one (possibly oversampled) sample
+    float lowPass(float input);
+    float lowPassOversampled(float input);
+    void updateSegmentSmoothing();
+    // Starts a new control segment when due; call once per sample
+    void tickControl(float keyTrackOffset);
+    void beginControlSegment(float keyTrackOffset);
+    void advanceCoefficientRamp();
+    
     // Soft saturation to prevent clipping at high resonance
     float softSaturate(float x);
 };
@@ -0,0 +1,41 @@
+#ifndef SYNTHIO_FUTEX_H
+#define SYNTHIO_FUTEX_H
+
+#include <atomic>
+#if !defined(__EMSCRIPTEN__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace synthio {
+
+// Sleep/wake on an atomic word for helper threads woken by the audio
+// thread. A wake is one syscall that takes no lock in user space, so unlike
+// notifying a condition variable it is safe in the callback. Waiters
+// re-check the word after waking: spurious wakes are allowed.
+
+inline int *futexWord(std::atomic<int> &word) {
+  return reinterpret_cast<int *>(&word);
+}
+
+#if !defined(__EMSCRIPTEN__)
+// Sleeps while word == expected
+inline void futexWait(std::atomic<int> &word, int expected) {
+  syscall(SYS_futex, futexWord(word), FUTEX_WAIT_PRIVATE, expected, nullptr,
+          nullptr, 0);
+}
+
+inline void futexWake(std::atomic<int> &word, int count) {
+  syscall(SYS_futex, futexWord(word), FUTEX_WAKE_PRIVATE, count, nullptr,
+          nullptr, 0);
+}
+#else
+// The WebAssembly build has no threads, so no worker ever waits
+inline void futexWait(std::atomic<int> &, int) {}
+inline void futexWake(std::atomic<int> &, int) {}
+#endif
+
+} // namespace synthio
+
+#endif // SYNTHIO_FUTEX_H
@@ -47,6 +47,15 @@ void LFO::tick() {
     }
 }
 
+void LFO::processBlock(float* pitchMod, float* filterMod, float* pwmMod, int numFrames) {
+    for (int i = 0; i < numFrames; ++i) {
+        tick();
+        pitchMod[i] = getPitchMod();
+        filterMod[i] = getFilterMod();
+        pwmMod[i] = getPWMMod();
+    }
+}
+
 float LFO::generateTriangle() {
     // Triangle wave: -1 to 1
     if (mPhase < 0.5f) {
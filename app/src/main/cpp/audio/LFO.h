@@ -35,6 +35,10 @@ public:
     // Process one sample (advances LFO phase)
     void tick();
     
+    // Block processing: ticks numFrames times and writes the scaled pitch,
+    // filter and PWM modulation for each frame
+    void processBlock(float* pitchMod, float* filterMod, float* pwmMod, int numFrames);
+    
     // Reset phase
     void reset();
     
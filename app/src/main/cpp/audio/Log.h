@@ -0,0 +1,44 @@
+#ifndef SYNTHIO_LOG_H
+#define SYNTHIO_LOG_H
+
+// Logging for the audio code. Goes to logcat on Android; host builds (the
+// benchmark) print to stderr only when built with SYNTHIO_HOST_LOGGING, so
+// per-beat messages don't drown the timings. Each source file defines
+// LOG_TAG before including this header.
+//
+// LOGI / LOGE format and write on the calling thread, which can block, so
+// they are for control threads. Code on the audio thread uses RT_LOGI /
+// RT_LOGE: same arguments, but the message is queued raw and formatted later
+// by RtLog's flusher thread (string literal formats, numeric or static
+// string arguments).
+
+#if defined(__ANDROID__)
+#include <android/log.h>
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#elif defined(SYNTHIO_HOST_LOGGING)
+#include <cstdio>
+#define SYNTHIO_HOST_LOG(level, ...)                                           \
+  (std::fprintf(stderr, "%s/%s: ", level, LOG_TAG),                            \
+   std::fprintf(stderr, __VA_ARGS__), std::fputc('\n', stderr))
+#define LOGI(...) SYNTHIO_HOST_LOG("I", __VA_ARGS__)
+#define LOGE(...) SYNTHIO_HOST_LOG("E", __VA_ARGS__)
+#else
+#define LOGI(...) ((void)0)
+#define LOGE(...) ((void)0)
+#endif
+
+#if defined(__ANDROID__) || defined(SYNTHIO_HOST_LOGGING)
+#include "RtLog.h"
+// The unevaluated printf keeps the compiler's format checking
+#define SYNTHIO_RT_LOG(level, ...)                                             \
+  (false ? (void)std::printf(__VA_ARGS__)                                      \
+         : synthio::RtLog::post(level, LOG_TAG, __VA_ARGS__))
+#define RT_LOGI(...) SYNTHIO_RT_LOG(synthio::RtLog::INFO, __VA_ARGS__)
+#define RT_LOGE(...) SYNTHIO_RT_LOG(synthio::RtLog::ERROR, __VA_ARGS__)
+#else
+#define RT_LOGI(...) ((void)0)
+#define RT_LOGE(...) ((void)0)
+#endif
+
+#endif // SYNTHIO_LOG_H
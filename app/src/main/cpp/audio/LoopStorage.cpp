@@ -0,0 +1,164 @@
+#include "LoopStorage.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_TAG "SynthIO_LoopStorage"
+#include "Log.h"
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23 // Linux 5.14; older headers lack it
+#endif
+
+namespace synthio {
+
+LoopStorage::~LoopStorage() { release(); }
+
+size_t LoopStorage::pageSize() {
+  static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return page;
+}
+
+size_t LoopStorage::alignToPage(size_t bytes) {
+  const size_t page = pageSize();
+  return (bytes + page - 1) / page * page;
+}
+
+bool LoopStorage::allocate(size_t bytes) {
+  release();
+  if (bytes == 0) {
+    return false;
+  }
+
+  size_t size = alignToPage(bytes);
+  void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED) {
+    LOGE("Failed to reserve %zu bytes: %s", size, strerror(errno));
+    return false;
+  }
+  mData = static_cast<uint8_t *>(data);
+  mSize = size;
+  return true;
+}
+
+bool LoopStorage::map(const char *path, size_t bytes) {
+  release();
+
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    LOGE("Failed to open %s: %s", path, strerror(errno));
+    return false;
+  }
+
+  size_t size = alignToPage(bytes);
+  if (size == 0) {
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+      close(fd);
+      return false;
+    }
+    size = static_cast<size_t>(info.st_size);
+  } else if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    LOGE("Failed to size %s to %zu bytes: %s", path, size, strerror(errno));
+    close(fd);
+    return false;
+  }
+
+  void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    LOGE("Failed to map %s: %s", path, strerror(errno));
+    close(fd);
+    return false;
+  }
+
+  mData = static_cast<uint8_t *>(data);
+  mSize = size;
+  mFd = fd;
+  LOGI("Mapped %s (%.1f MB)", path, size / (1024.0 * 1024.0));
+  return true;
+}
+
+void LoopStorage::release() {
+  if (mData) {
+    if (mFd >= 0) {
+      msync(mData, mSize, MS_ASYNC);
+    }
+    munmap(mData, mSize);
+    mData = nullptr;
+    mSize = 0;
+  }
+  if (mFd >= 0) {
+    close(mFd);
+    mFd = -1;
+  }
+}
+
+bool LoopStorage::sync(bool wait) const {
+  if (!mData || mFd < 0) {
+    return false;
+  }
+  return msync(mData, mSize, wait ? MS_SYNC : MS_ASYNC) == 0;
+}
+
+void LoopStorage::prefetch(size_t offset, size_t length) const {
+  if (!mData || mFd < 0 || offset >= mSize || length == 0) {
+    return;
+  }
+
+  // madvise wants a page-aligned start
+  const size_t page = pageSize();
+  size_t begin = offset / page * page;
+  size_t end = std::min(mSize, alignToPage(offset + length));
+  madvise(mData + begin, end - begin, MADV_WILLNEED);
+}
+
+void LoopStorage::discard(size_t offset, size_t length) {
+  if (!mData || offset >= mSize || length == 0) {
+    return;
+  }
+
+  // Partial pages at either end may still hold live data
+  const size_t page = pageSize();
+  size_t begin = alignToPage(offset);
+  size_t end = std::min(mSize, offset + length) / page * page;
+  if (end <= begin) {
+    return;
+  }
+  const int advice = mFd >= 0 ? MADV_REMOVE : MADV_DONTNEED;
+  if (madvise(mData + begin, end - begin, advice) != 0) {
+    LOGE("Failed to discard %zu bytes: %s", end - begin, strerror(errno));
+  }
+}
+
+void LoopStorage::prefault(size_t offset, size_t length) {
+  if (!mData || offset >= mSize || length == 0) {
+    return;
+  }
+
+  const size_t page = pageSize();
+  size_t begin = offset / page * page;
+  size_t end = std::min(mSize, alignToPage(offset + length));
+  // Otherwise the first write to each hole allocates a block inside the
+  // page fault
+  if (mFd >= 0 && fallocate(mFd, 0, static_cast<off_t>(begin),
+                            static_cast<off_t>(end - begin)) != 0) {
+    LOGE("Failed to allocate %zu bytes: %s", end - begin, strerror(errno));
+  }
+  if (madvise(mData + begin, end - begin, MADV_POPULATE_WRITE) == 0) {
+    return;
+  }
+
+  // Older kernels: reading maps each page in, so the first write only takes
+  // a minor fault
+  volatile const uint8_t *bytes = mData;
+  for (size_t i = begin; i < end; i += page) {
+    (void)bytes[i];
+  }
+}
+
+} // namespace synthio
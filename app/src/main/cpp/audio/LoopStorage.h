@@ -0,0 +1,70 @@
+#ifndef SYNTHIO_LOOP_STORAGE_H
+#define SYNTHIO_LOOP_STORAGE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace synthio {
+
+/**
+ * Page-aligned backing memory for the looper arena.
+ *
+ * Either an anonymous mapping (RAM only, committed lazily) or a shared
+ * mapping of a session file in app storage. With a file, everything written
+ * into the memory lands in the page cache and is written back by the
+ * kernel, so reopening the file is an mmap rather than a bulk read, and the
+ * mapping can be larger than physical RAM. Mapping and unmapping are
+ * control-thread operations; only reads and writes of the memory itself are
+ * safe on the audio thread.
+ */
+class LoopStorage {
+public:
+  LoopStorage() = default;
+  ~LoopStorage();
+  LoopStorage(const LoopStorage &) = delete;
+  LoopStorage &operator=(const LoopStorage &) = delete;
+
+  // Anonymous zero-filled memory of at least bytes. Returns false on failure.
+  bool allocate(size_t bytes);
+
+  // Maps the file at path, creating it if needed. bytes == 0 maps the file
+  // at its current size (fails if it is empty); otherwise the file is grown
+  // (sparsely) or truncated to bytes first.
+  bool map(const char *path, size_t bytes);
+
+  void release();
+
+  uint8_t *data() const { return mData; }
+  size_t size() const { return mSize; }
+  bool isMapped() const { return mFd >= 0; }
+
+  // Flushes dirty pages of a file mapping. wait = false only schedules the
+  // writeback.
+  bool sync(bool wait) const;
+
+  // Asks the kernel to read [offset, offset + length) ahead of use. No-op
+  // for anonymous memory.
+  void prefetch(size_t offset, size_t length) const;
+
+  // Gives the whole pages inside [offset, offset + length) back to the
+  // system; they read as zeros afterwards. For a file this punches a hole,
+  // so the session file shrinks on disk too.
+  void discard(size_t offset, size_t length);
+
+  // Makes [offset, offset + length) writable without faulting: allocates the
+  // file blocks behind it (the file is sparse) and populates the page
+  // tables, leaving the contents as they are. Control thread; may block.
+  void prefault(size_t offset, size_t length);
+
+  static size_t pageSize();
+  static size_t alignToPage(size_t bytes);
+
+private:
+  uint8_t *mData = nullptr;
+  size_t mSize = 0;
+  int mFd = -1;
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_LOOP_STORAGE_H
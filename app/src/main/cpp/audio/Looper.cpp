@@ -1,22 +1,353 @@
 #include "Looper.h"
+#include "DSPConfig.h"
+#include "Futex.h"
 #include <algorithm>
-#include <android/log.h>
+#include <chrono>
 #include <cmath>
 
 #define LOG_TAG "SynthIO_Looper"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#include "Log.h"
 
 namespace synthio {
 
-Looper::Looper() { updateTiming(); }
+// Session file layout: one header page, then the track spans. All fields
+// are written in place in the shared mapping whenever they change.
+namespace {
+
+constexpr uint32_t SESSION_MAGIC = 0x534C4F4F; // "SLOO"
+// 2: takes stored at LOOP_RECORD_GAIN; 3: per-track trim
+constexpr uint32_t SESSION_VERSION = 3;
+// Rates a session may have been recorded at
+constexpr float MIN_SESSION_RATE = 8000.0f;
+constexpr float MAX_SESSION_RATE = 192000.0f;
+
+struct SessionTrack {
+  int64_t length;
+  uint32_t hasContent;
+  float volume;
+  uint32_t muted;
+  uint32_t solo;
+  float trim;
+};
+
+struct SessionHeader {
+  uint32_t magic;
+  uint32_t version;
+  float sampleRate;
+  int32_t numTracks;
+  int64_t trackCapacity;
+  int64_t trackStride;
+  int32_t barCapacity;
+  int32_t barsToRecord;
+  float bpm;
+  uint32_t loopLengthLocked;
+  int64_t loopLengthSamples;
+  SessionTrack tracks[Looper::MAX_TRACKS];
+};
+
+} // namespace
+
+Looper::Looper() {
+  allocateArena();
+  updateTiming();
+  startPremix();
+}
+
+Looper::~Looper() {
+  stopPrefetch();
+  stopPremix();
+}
 
 void Looper::setSampleRate(float sampleRate) {
+  const bool prefetching = mStorage.isMapped();
+  stopPrefetch();
+  stopPremix();
   mSampleRate = sampleRate;
+  allocateArena();
+  updateTiming();
+  writeSessionHeader();
+  if (prefetching && mStorage.isMapped()) {
+    startPrefetch();
+  }
+  startPremix();
+}
+
+bool Looper::configure(int trackCount, int maxBars, size_t memoryBudget,
+                       const char *sessionPath) {
+  if (isPinned()) {
+    LOGE("Looper not reconfigured, an export is reading its tracks");
+    return false;
+  }
+  stopPrefetch();
+  stopPremix();
+  mNumTracks = std::max(1, std::min(MAX_TRACKS, trackCount));
+  mBarCapacity = std::max(MIN_BARS, std::min(MAX_BARS, maxBars));
+  mMemoryBudget = memoryBudget;
+  mSessionPath = sessionPath ? sessionPath : "";
+  mStorage.release(); // Always re-reserve, even if the size is unchanged
+
+  mState = State::IDLE;
+  mActiveRecordingTrack = -1;
+  mLoopLengthLocked = false;
+  mPlaybackPosition = 0;
+  mRecordPosition = 0;
+  // Anything in flight referred to the old arena
+  mBounceTarget.store(-1, std::memory_order_relaxed);
+  mBounceRequest.store(0, std::memory_order_relaxed);
+  mPendingBounce.store(0, std::memory_order_relaxed);
+  mReleaseMask.store(0, std::memory_order_relaxed);
+  mBounceInPlace.store(false);
+  mCurrentBeat = 0;
+  mCurrentBar = 0;
+
+  if (!mSessionPath.empty() && openSession()) {
+    LOGI("Reopened looper session %s (%d tracks in use)",
+         mSessionPath.c_str(), getUsedTrackCount());
+  } else {
+    allocateArena();
+    mBarsToRecord = std::min(mBarsToRecord, mBarCapacity);
+    updateTiming();
+    writeSessionHeader();
+  }
+
+  if (mStorage.isMapped()) {
+    startPrefetch();
+  }
+  startPremix();
+  return mSamplesPerBar > 0 && mTrackCapacity >= mSamplesPerBar;
+}
+
+int Looper::getMaxBars() const {
+  if (mSamplesPerBar <= 0) {
+    return 0;
+  }
+  return static_cast<int>(std::min<int64_t>(mBarCapacity,
+                                            mTrackCapacity / mSamplesPerBar));
+}
+
+size_t Looper::getReservedBytes() const {
+  return mStorage.size() + mPremixStorage.size();
+}
+
+void Looper::allocateArena() {
+  // Enough for mBarCapacity bars at the slowest tempo, unless the budget
+  // (which also covers the premix) runs out first; then faster tempos still
+  // reach the full bar count
+  int64_t samplesPerBar =
+      static_cast<int64_t>(60.0f / MIN_BPM * mSampleRate) * BEATS_PER_BAR;
+  int64_t capacity = std::min<int64_t>(
+      samplesPerBar * mBarCapacity,
+      static_cast<int64_t>(mMemoryBudget / (BYTES_PER_FRAME * mNumTracks +
+                                            PREMIX_BYTES_PER_FRAME)));
+  if (mStorage.data() && capacity == mTrackCapacity) {
+    return;
+  }
+
+  // Deliberately not cleared: a take overwrites every frame before the
+  // track is marked as having content, so nothing is read before it is
+  // written.
+  mTrackCapacity = capacity;
+  mTrackStride =
+      LoopStorage::alignToPage(static_cast<size_t>(capacity) * BYTES_PER_FRAME);
+  size_t bytes = LoopStorage::alignToPage(sizeof(SessionHeader)) +
+                 mTrackStride * mNumTracks;
+  bool ok = false;
+  if (!mSessionPath.empty()) {
+    ok = mStorage.map(mSessionPath.c_str(), bytes);
+  }
+  if (!ok && !mStorage.allocate(bytes)) {
+    mTrackCapacity = 0; // Nothing to record into; takes end immediately
+  }
+
+  layoutTracks();
+  for (int t = 0; t < MAX_TRACKS; t++) {
+    resetTrack(mTracks[t]);
+  }
+  allocatePremix();
+  updateMix();
+  LOGI("Looper arena: %d tracks x %lld frames (%.1f MB reserved%s)",
+       mNumTracks, static_cast<long long>(mTrackCapacity),
+       getReservedBytes() / (1024.0 * 1024.0),
+       mStorage.isMapped() ? ", file-backed" : "");
+}
+
+void Looper::layoutTracks() {
+  uint8_t *base = mStorage.data();
+  size_t offset = LoopStorage::alignToPage(sizeof(SessionHeader));
+  for (int t = 0; t < MAX_TRACKS; t++) {
+    bool mapped = base && t < mNumTracks && mTrackCapacity > 0;
+    mTracks[t].frames =
+        mapped ? reinterpret_cast<int16_t *>(base + offset + mTrackStride * t)
+               : nullptr;
+  }
+}
+
+// ===== SESSIONS =====
+
+bool Looper::openSession() {
+  if (!mStorage.map(mSessionPath.c_str(), 0)) {
+    return false;
+  }
+
+  const auto *header = reinterpret_cast<const SessionHeader *>(mStorage.data());
+  const size_t headerBytes = LoopStorage::alignToPage(sizeof(SessionHeader));
+  bool valid = mStorage.size() >= headerBytes &&
+               header->magic == SESSION_MAGIC &&
+               header->version == SESSION_VERSION &&
+               header->sampleRate >= MIN_SESSION_RATE &&
+               header->sampleRate <= MAX_SESSION_RATE &&
+               header->numTracks >= 1 &&
+               header->numTracks <= MAX_TRACKS && header->trackCapacity > 0 &&
+               header->trackStride >=
+                   header->trackCapacity * BYTES_PER_FRAME &&
+               header->barCapacity >= MIN_BARS &&
+               header->barCapacity <= MAX_BARS &&
+               headerBytes + header->trackStride * header->numTracks <=
+                   mStorage.size();
+  for (int t = 0; valid && t < header->numTracks; t++) {
+    valid = header->tracks[t].length >= 0 &&
+            header->tracks[t].length <= header->trackCapacity;
+  }
+  if (!valid) {
+    LOGI("No usable looper session at %s, starting a new one",
+         mSessionPath.c_str());
+    mStorage.release();
+    return false;
+  }
+
+  // The session's layout and rate win over the requested ones: its takes
+  // are only valid at the rate they were recorded at, and the engine was
+  // configured before the device's rate was known
+  if (header->sampleRate != mSampleRate) {
+    LOGI("Looper session recorded at %.0f Hz (configured for %.0f Hz)",
+         header->sampleRate, mSampleRate);
+  }
+  mSampleRate = header->sampleRate;
+  mNumTracks = header->numTracks;
+  mTrackCapacity = header->trackCapacity;
+  mTrackStride = static_cast<size_t>(header->trackStride);
+  mBarCapacity = header->barCapacity;
+  mBarsToRecord = std::max(
+      MIN_BARS, std::min(mBarCapacity, static_cast<int>(header->barsToRecord)));
+  mBPM = std::max(MIN_BPM, std::min(MAX_BPM, header->bpm));
+  mLoopLengthLocked = header->loopLengthLocked != 0;
+  mLoopLengthSamples =
+      std::max<int64_t>(0, std::min(header->loopLengthSamples, mTrackCapacity));
+
+  layoutTracks();
+  for (int t = 0; t < MAX_TRACKS; t++) {
+    resetTrack(mTracks[t]);
+    if (t < mNumTracks) {
+      const SessionTrack &saved = header->tracks[t];
+      mTracks[t].hasContent = saved.hasContent != 0 && saved.length > 0;
+      mTracks[t].length = mTracks[t].hasContent ? saved.length : 0;
+      mTracks[t].volume = std::max(0.0f, std::min(1.0f, saved.volume));
+      mTracks[t].muted = saved.muted != 0;
+      mTracks[t].solo = saved.solo != 0;
+      if (std::isfinite(saved.trim) && saved.trim > 0.0f) {
+        mTracks[t].trim = saved.trim;
+      }
+    }
+  }
+
   updateTiming();
+  mState = hasAnyLoop() ? State::STOPPED : State::IDLE;
+  // No reliable content means nothing to stay locked to
+  mLoopLengthLocked = mLoopLengthLocked && hasAnyLoop();
+  allocatePremix();
+  updateMix();
+  return true;
+}
+
+void Looper::writeSessionHeader() {
+  if (!mStorage.isMapped()) {
+    return;
+  }
+
+  auto *header = reinterpret_cast<SessionHeader *>(mStorage.data());
+  header->magic = SESSION_MAGIC;
+  header->version = SESSION_VERSION;
+  header->sampleRate = mSampleRate;
+  header->numTracks = mNumTracks;
+  header->trackCapacity = mTrackCapacity;
+  header->trackStride = static_cast<int64_t>(mTrackStride);
+  header->barCapacity = mBarCapacity;
+  header->barsToRecord = mBarsToRecord;
+  header->bpm = mBPM;
+  header->loopLengthLocked = mLoopLengthLocked ? 1 : 0;
+  header->loopLengthSamples = mLoopLengthSamples;
+  for (int t = 0; t < MAX_TRACKS; t++) {
+    const LoopTrack &track = mTracks[t];
+    header->tracks[t] = {track.length, track.hasContent ? 1u : 0u,
+                         track.volume, track.muted ? 1u : 0u,
+                         track.solo ? 1u : 0u, track.trim};
+  }
+}
+
+bool Looper::saveSession(bool wait) { return mStorage.sync(wait); }
+
+void Looper::startPrefetch() {
+  stopPrefetch();
+  mPrefetchRunning = true;
+  mPrefetchThread = std::thread(&Looper::prefetchLoop, this);
+}
+
+void Looper::stopPrefetch() {
+  {
+    std::lock_guard<std::mutex> lock(mPrefetchMutex);
+    mPrefetchRunning = false;
+  }
+  mPrefetchWake.notify_all();
+  if (mPrefetchThread.joinable()) {
+    mPrefetchThread.join();
+  }
+}
+
+void Looper::prefetchLoop() {
+  const size_t headerBytes = LoopStorage::alignToPage(sizeof(SessionHeader));
+  const int64_t window = static_cast<int64_t>(PREFETCH_SECONDS * mSampleRate);
+
+  std::unique_lock<std::mutex> lock(mPrefetchMutex);
+  while (mPrefetchRunning) {
+    int64_t position = mPrefetchPosition.load(std::memory_order_relaxed);
+    int64_t loopLength = mPrefetchLoopLength.load(std::memory_order_relaxed);
+    loopLength = std::max<int64_t>(1, std::min(loopLength, mTrackCapacity));
+    position = std::max<int64_t>(0, std::min(position, loopLength - 1));
+
+    // Header (rewritten on every track change) plus the next window of each
+    // span, wrapping at the loop end
+    mStorage.prefetch(0, headerBytes);
+    int64_t ahead = std::min(window, loopLength - position);
+    int64_t wrapped = std::min(window - ahead, position);
+    for (int t = 0; t < mNumTracks; t++) {
+      size_t span = headerBytes + mTrackStride * t;
+      mStorage.prefetch(span + position * BYTES_PER_FRAME,
+                        ahead * BYTES_PER_FRAME);
+      if (wrapped > 0) {
+        mStorage.prefetch(span, wrapped * BYTES_PER_FRAME);
+      }
+    }
+
+    mPrefetchWake.wait_for(lock,
+                           std::chrono::milliseconds(PREFETCH_INTERVAL_MS));
+  }
+}
+
+void Looper::resetTrack(LoopTrack &track) {
+  track.length = 0;
+  track.hasContent = false;
+  track.volume = 0.7f;
+  track.muted = false;
+  track.solo = false;
+  track.trim = 1.0f;
+}
+
+float Looper::trackGain(const LoopTrack &track) {
+  return track.volume * track.trim * LOOP_PLAYBACK_SCALE;
 }
 
 void Looper::setBPM(float bpm) {
-  mBPM = std::max(30.0f, std::min(300.0f, bpm));
+  mBPM = std::max(MIN_BPM, std::min(MAX_BPM, bpm));
   updateTiming();
 }
 
@@ -25,16 +356,23 @@ void Looper::updateTiming() {
   float secondsPerBeat = 60.0f / mBPM;
   mSamplesPerBeat = static_cast<int>(secondsPerBeat * mSampleRate);
   mSamplesPerBar = mSamplesPerBeat * BEATS_PER_BAR;
+  for (SmoothedParameter &gain : mTrackGains) {
+    gain.setRampTime(PARAMETER_RAMP_TIME, mSampleRate);
+  }
 
-  // Only update loop length if not locked (first recording sets the length)
+  // Only update loop length if not locked (first recording sets the length).
+  // At tempos too slow for the whole bar count, record as many bars as fit.
   if (!mLoopLengthLocked) {
-    mLoopLengthSamples = mSamplesPerBar * mBarsToRecord;
+    int bars = std::max(MIN_BARS, std::min(mBarsToRecord, getMaxBars()));
+    mLoopLengthSamples =
+        std::min<int64_t>(static_cast<int64_t>(mSamplesPerBar) * bars,
+                          mTrackCapacity);
   }
 }
 
 void Looper::setBarCount(int bars) {
   // Clamp to valid range
-  bars = std::max(MIN_BARS, std::min(MAX_BARS, bars));
+  bars = std::max(MIN_BARS, std::min(mBarCapacity, bars));
 
   if (bars == mBarsToRecord) {
     return; // No change
@@ -43,14 +381,15 @@ void Looper::setBarCount(int bars) {
   // Only allow changing when there's no recorded content
   // The Kotlin layer should handle warning the user and clearing first
   if (hasAnyLoop()) {
-    LOGI("Cannot change bar count while loops exist - clear first");
+    RT_LOGI("Cannot change bar count while loops exist - clear first");
     return;
   }
 
   mBarsToRecord = bars;
   updateTiming();
-  LOGI("Bar count set to %d, loop length: %lld samples", mBarsToRecord,
-       mLoopLengthSamples);
+  writeSessionHeader();
+  RT_LOGI("Bar count set to %d, loop length: %lld samples", mBarsToRecord,
+          static_cast<long long>(mLoopLengthSamples));
 }
 
 // ===== MAIN CONTROL =====
@@ -61,18 +400,17 @@ void Looper::startRecording() {
 }
 
 void Looper::startRecordingTrack(int trackIndex) {
-  if (!isValidTrackIndex(trackIndex)) {
-    LOGI("Invalid track index: %d", trackIndex);
+  // Audio thread: nothing here allocates or logs. A refused take just
+  // leaves the state unchanged, which the UI sees.
+  if (!isValidTrackIndex(trackIndex) || mTracks[trackIndex].hasContent) {
     return;
   }
-
-  if (mTracks[trackIndex].hasContent) {
-    LOGI("Track %d already has content, clear it first", trackIndex);
+  if (mState == State::RECORDING || mState == State::PRE_COUNT) {
     return;
   }
-
-  if (mState == State::RECORDING || mState == State::PRE_COUNT) {
-    LOGI("Already recording, cannot start another track");
+  // A bounce is writing into it, or its old pages are still being freed
+  if (mBounceTarget.load(std::memory_order_acquire) == trackIndex ||
+      (mReleaseMask.load(std::memory_order_acquire) & (1u << trackIndex))) {
     return;
   }
 
@@ -85,13 +423,9 @@ void Looper::startRecordingTrack(int trackIndex) {
     updateTiming();
   }
 
-  // Allocate buffer for this track
-  mTracks[trackIndex].bufferL.resize(mLoopLengthSamples, 0.0f);
-  mTracks[trackIndex].bufferR.resize(mLoopLengthSamples, 0.0f);
-  std::fill(mTracks[trackIndex].bufferL.begin(),
-            mTracks[trackIndex].bufferL.end(), 0.0f);
-  std::fill(mTracks[trackIndex].bufferR.begin(),
-            mTracks[trackIndex].bufferR.end(), 0.0f);
+  // The track's span is preallocated and the take overwrites all of it, so
+  // there is nothing to allocate or clear here (runs on the audio thread)
+  mTracks[trackIndex].length = 0;
 
   mActiveRecordingTrack = trackIndex;
   mState = State::PRE_COUNT;
@@ -99,17 +433,23 @@ void Looper::startRecordingTrack(int trackIndex) {
   mRecordPosition = 0;
   mCurrentBeat = 0;
   mCurrentBar = 0;
-
-  LOGI("Starting pre-count for track %d, loop length: %lld samples", trackIndex,
-       mLoopLengthSamples);
   notifyStateChange();
 }
 
+void Looper::prepareRecordingTrack(int trackIndex) {
+  if (trackIndex < 0 || trackIndex >= mNumTracks || mTrackCapacity == 0) {
+    return;
+  }
+  const size_t headerBytes = LoopStorage::alignToPage(sizeof(SessionHeader));
+  mStorage.prefault(0, headerBytes);
+  mStorage.prefault(headerBytes + mTrackStride * trackIndex, mTrackStride);
+}
+
 void Looper::stopPlayback() {
   if (mState == State::PLAYING) {
     mState = State::STOPPED;
     mPlaybackPosition = 0;
-    LOGI("Playback stopped");
+    RT_LOGI("Playback stopped");
     notifyStateChange();
   }
 }
@@ -120,7 +460,7 @@ void Looper::startPlayback() {
     mPlaybackPosition = 0;
     mCurrentBeat = 0;
     mCurrentBar = 0;
-    LOGI("Playback started");
+    RT_LOGI("Playback started");
     notifyStateChange();
   }
 }
@@ -133,16 +473,15 @@ void Looper::clearLoop() {
 void Looper::cancelRecording() {
   // Only cancel if we're in pre-count or recording state
   if (mState != State::PRE_COUNT && mState != State::RECORDING) {
-    LOGI("cancelRecording called but not in recording state");
+    RT_LOGI("cancelRecording called but not in recording state");
     return;
   }
 
-  LOGI("Canceling recording on track %d", mActiveRecordingTrack);
+  RT_LOGI("Canceling recording on track %d", mActiveRecordingTrack);
 
   // Clear the active track's buffer (discard any recorded audio)
   if (isValidTrackIndex(mActiveRecordingTrack)) {
-    mTracks[mActiveRecordingTrack].bufferL.clear();
-    mTracks[mActiveRecordingTrack].bufferR.clear();
+    mTracks[mActiveRecordingTrack].length = 0;
     mTracks[mActiveRecordingTrack].hasContent = false;
   }
 
@@ -164,7 +503,7 @@ void Looper::cancelRecording() {
     mLoopLengthLocked = false;
   }
 
-  LOGI("Recording canceled, state now: %d", static_cast<int>(mState));
+  RT_LOGI("Recording canceled, state now: %d", static_cast<int>(mState));
   notifyStateChange();
 }
 
@@ -173,18 +512,21 @@ void Looper::cancelRecording() {
 void Looper::setTrackVolume(int trackIndex, float volume) {
   if (isValidTrackIndex(trackIndex)) {
     mTracks[trackIndex].volume = std::max(0.0f, std::min(1.0f, volume));
+    tracksChanged(true);
   }
 }
 
 void Looper::setTrackMuted(int trackIndex, bool muted) {
   if (isValidTrackIndex(trackIndex)) {
     mTracks[trackIndex].muted = muted;
+    tracksChanged(true);
   }
 }
 
 void Looper::setTrackSolo(int trackIndex, bool solo) {
   if (isValidTrackIndex(trackIndex)) {
     mTracks[trackIndex].solo = solo;
+    tracksChanged(true);
   }
 }
 
@@ -198,14 +540,13 @@ void Looper::clearTrack(int trackIndex) {
     return;
   }
 
-  mTracks[trackIndex].bufferL.clear();
-  mTracks[trackIndex].bufferR.clear();
-  mTracks[trackIndex].hasContent = false;
-  mTracks[trackIndex].volume = 0.7f;
-  mTracks[trackIndex].muted = false;
-  mTracks[trackIndex].solo = false;
+  // An export is reading it, or a bounce is overwriting one of the tracks
+  if (isPinned() || isBouncingInPlace()) {
+    mDeferredClearMask |= 1u << trackIndex;
+    return;
+  }
 
-  LOGI("Track %d cleared", trackIndex);
+  resetTrack(mTracks[trackIndex]);
 
   // If no tracks have content anymore, reset state
   if (!hasAnyLoop()) {
@@ -214,20 +555,22 @@ void Looper::clearTrack(int trackIndex) {
     mPlaybackPosition = 0;
     notifyStateChange();
   }
+  tracksChanged();
 }
 
 void Looper::clearAllTracks() {
+  if (isPinned() || isBouncingInPlace()) {
+    mDeferredClearAll = true;
+    RT_LOGI("Tracks will clear once the export finishes");
+    return;
+  }
+
   if (mState == State::PLAYING) {
     stopPlayback();
   }
 
-  for (int i = 0; i < MAX_TRACKS; i++) {
-    mTracks[i].bufferL.clear();
-    mTracks[i].bufferR.clear();
-    mTracks[i].hasContent = false;
-    mTracks[i].volume = 0.7f;
-    mTracks[i].muted = false;
-    mTracks[i].solo = false;
+  for (int i = 0; i < mNumTracks; i++) {
+    resetTrack(mTracks[i]);
   }
 
   mState = State::IDLE;
@@ -237,15 +580,36 @@ void Looper::clearAllTracks() {
   mRecordPosition = 0;
   mCurrentBeat = 0;
   mCurrentBar = 0;
+  tracksChanged();
 
-  LOGI("All tracks cleared");
+  RT_LOGI("All tracks cleared");
   notifyStateChange();
 }
 
+void Looper::applyDeferredClears() {
+  if ((mDeferredClearMask == 0 && !mDeferredClearAll) || isPinned() ||
+      isBouncingInPlace()) {
+    return;
+  }
+  const uint32_t mask = mDeferredClearMask;
+  const bool all = mDeferredClearAll;
+  mDeferredClearMask = 0;
+  mDeferredClearAll = false;
+  if (all) {
+    clearAllTracks();
+    return;
+  }
+  for (int t = 0; t < mNumTracks; t++) {
+    if (mask & (1u << t)) {
+      clearTrack(t);
+    }
+  }
+}
+
 // ===== STATE/TRACK QUERIES =====
 
 bool Looper::hasAnyLoop() const {
-  for (int i = 0; i < MAX_TRACKS; i++) {
+  for (int i = 0; i < mNumTracks; i++) {
     if (mTracks[i].hasContent)
       return true;
   }
@@ -264,6 +628,12 @@ float Looper::getTrackVolume(int trackIndex) const {
   return mTracks[trackIndex].volume;
 }
 
+float Looper::getTrackMixVolume(int trackIndex) const {
+  if (!isValidTrackIndex(trackIndex))
+    return 0.0f;
+  return mTracks[trackIndex].volume * mTracks[trackIndex].trim;
+}
+
 bool Looper::isTrackMuted(int trackIndex) const {
   if (!isValidTrackIndex(trackIndex))
     return false;
@@ -278,7 +648,7 @@ bool Looper::isTrackSolo(int trackIndex) const {
 
 int Looper::getUsedTrackCount() const {
   int count = 0;
-  for (int i = 0; i < MAX_TRACKS; i++) {
+  for (int i = 0; i < mNumTracks; i++) {
     if (mTracks[i].hasContent)
       count++;
   }
@@ -286,7 +656,7 @@ int Looper::getUsedTrackCount() const {
 }
 
 bool Looper::anySolo() const {
-  for (int i = 0; i < MAX_TRACKS; i++) {
+  for (int i = 0; i < mNumTracks; i++) {
     if (mTracks[i].hasContent && mTracks[i].solo)
       return true;
   }
@@ -301,47 +671,25 @@ void Looper::process(float synthL, float synthR, float &loopOutL,
   loopOutR = 0.0f;
 
   switch (mState) {
-  case State::PRE_COUNT: {
+  case State::PRE_COUNT:
     // During pre-count, DON'T play existing tracks - only metronome plays
-    // (handled by AudioEngine). Just update timing for pre-count.
-    // No audio output during pre-count from looper.
-
-    // Track pre-count progress
-    mPreCountPosition++;
-    int beatInPreCount = static_cast<int>(mPreCountPosition / mSamplesPerBeat);
-    if (beatInPreCount != mCurrentBeat) {
-      mCurrentBeat = beatInPreCount;
-      notifyStateChange();
-    }
-
-    // Check if pre-count is complete
-    if (mPreCountPosition >= mSamplesPerBeat * PRE_COUNT_BEATS) {
-      mState = State::RECORDING;
-      mRecordPosition = 0;
-      mCurrentBeat = 0;
-      mCurrentBar = 0;
-
-      // Sync playback position to start of loop
-      mPlaybackPosition = 0;
-
-      LOGI("Pre-count complete, starting recording on track %d",
-           mActiveRecordingTrack);
-      notifyStateChange();
-    }
+    // (handled by AudioEngine). No audio output during pre-count from looper.
+    advancePreCount(1);
     break;
-  }
 
   case State::RECORDING: {
-    // Record synth audio to active track
-    if (isValidTrackIndex(mActiveRecordingTrack) &&
-        mRecordPosition < mLoopLengthSamples) {
-      mTracks[mActiveRecordingTrack].bufferL[mRecordPosition] = synthL;
-      mTracks[mActiveRecordingTrack].bufferR[mRecordPosition] = synthR;
+    // Record synth audio to active track, at the position the player heard
+    if (isValidTrackIndex(mActiveRecordingTrack) && mWritePosition >= 0 &&
+        mWritePosition < mLoopLengthSamples) {
+      int16_t *frame =
+          mTracks[mActiveRecordingTrack].frames + mWritePosition * 2;
+      frame[0] = toPcm16(synthL * LOOP_RECORD_GAIN);
+      frame[1] = toPcm16(synthR * LOOP_RECORD_GAIN);
     }
 
     // Also play back other tracks while recording
     bool hasSolo = anySolo();
-    for (int i = 0; i < MAX_TRACKS; i++) {
+    for (int i = 0; i < mNumTracks; i++) {
       if (i == mActiveRecordingTrack)
         continue; // Don't play the track we're recording
       if (!mTracks[i].hasContent)
@@ -351,27 +699,35 @@ void Looper::process(float synthL, float synthR, float &loopOutL,
       if (hasSolo && !mTracks[i].solo)
         continue;
 
-      if (mRecordPosition < static_cast<int64_t>(mTracks[i].bufferL.size())) {
-        loopOutL += mTracks[i].bufferL[mRecordPosition] * mTracks[i].volume;
-        loopOutR += mTracks[i].bufferR[mRecordPosition] * mTracks[i].volume;
+      if (mRecordPosition < mTracks[i].length) {
+        const int16_t *frame = mTracks[i].frames + mRecordPosition * 2;
+        float gain = trackGain(mTracks[i]);
+        loopOutL += frame[0] * gain;
+        loopOutR += frame[1] * gain;
       }
     }
 
     mRecordPosition++;
+    mWritePosition++;
     updateBeatBar();
 
     // Check if recording is complete
-    if (mRecordPosition >= mLoopLengthSamples) {
+    if (mWritePosition >= mLoopLengthSamples) {
+      mTracks[mActiveRecordingTrack].length = mLoopLengthSamples;
       mTracks[mActiveRecordingTrack].hasContent = true;
       mLoopLengthLocked = true; // Lock loop length after first recording
+      tracksChanged();
       mState = State::STOPPED;
       mActiveRecordingTrack = -1;
       mPlaybackPosition = 0;
       mCurrentBeat = 0;
       mCurrentBar = 0;
 
-      LOGI("Recording complete, track now has content");
+      RT_LOGI("Recording complete, track now has content");
       notifyStateChange();
+    } else if (mRecordPosition >= mLoopLengthSamples) {
+      // The last frames are still on their way to the player
+      mRecordPosition = 0;
     }
     break;
   }
@@ -380,7 +736,7 @@ void Looper::process(float synthL, float synthR, float &loopOutL,
     // Mix all non-muted tracks (respecting solo)
     bool hasSolo = anySolo();
 
-    for (int i = 0; i < MAX_TRACKS; i++) {
+    for (int i = 0; i < mNumTracks; i++) {
       if (!mTracks[i].hasContent)
         continue;
       if (mTracks[i].muted)
@@ -388,9 +744,11 @@ void Looper::process(float synthL, float synthR, float &loopOutL,
       if (hasSolo && !mTracks[i].solo)
         continue;
 
-      if (mPlaybackPosition < static_cast<int64_t>(mTracks[i].bufferL.size())) {
-        loopOutL += mTracks[i].bufferL[mPlaybackPosition] * mTracks[i].volume;
-        loopOutR += mTracks[i].bufferR[mPlaybackPosition] * mTracks[i].volume;
+      if (mPlaybackPosition < mTracks[i].length) {
+        const int16_t *frame = mTracks[i].frames + mPlaybackPosition * 2;
+        float gain = trackGain(mTracks[i]);
+        loopOutL += frame[0] * gain;
+        loopOutR += frame[1] * gain;
       }
     }
 
@@ -414,6 +772,242 @@ void Looper::process(float synthL, float synthR, float &loopOutL,
   }
 }
 
+void Looper::mixTracks(float *outL, float *outR, int64_t position,
+                       int numFrames, const MixSnapshot &mix) const {
+  for (int t = 0; t < mNumTracks; t++) {
+    if ((mix.trackMask & (1u << t)) == 0)
+      continue;
+
+    int64_t available = mix.length[t] - position;
+    int count = static_cast<int>(std::min<int64_t>(numFrames, available));
+    const int16_t *src = mTracks[t].frames + position * 2;
+    const float gain = mix.gain[t];
+    for (int i = 0; i < count; i++) {
+      outL[i] += src[i * 2] * gain;
+      outR[i] += src[i * 2 + 1] * gain;
+    }
+  }
+}
+
+void Looper::mixTracksInterleaved(float *out, int64_t position,
+                                  int64_t numFrames,
+                                  const MixSnapshot &mix) const {
+  for (int t = 0; t < mNumTracks; t++) {
+    if ((mix.trackMask & (1u << t)) == 0)
+      continue;
+
+    int64_t count = std::min(numFrames, mix.length[t] - position);
+    const int16_t *src = mTracks[t].frames + position * 2;
+    const float gain = mix.gain[t];
+    for (int64_t i = 0; i < count * 2; i++) {
+      out[i] += src[i] * gain;
+    }
+  }
+}
+
+void Looper::mixTracksRamped(float *outL, float *outR, int64_t position,
+                             int numFrames) {
+  bool ramping = false;
+  for (int t = 0; t < mNumTracks; t++) {
+    const SmoothedParameter::Ramp ramp = mTrackGains[t].nextBlock(numFrames);
+    ramping = ramping || mTrackGains[t].isSmoothing();
+    if (!mTracks[t].hasContent || (ramp.isConstant() && ramp.start == 0.0f))
+      continue;
+
+    int64_t available = mTracks[t].length - position;
+    int count = static_cast<int>(std::min<int64_t>(numFrames, available));
+    const int16_t *src = mTracks[t].frames + position * 2;
+    for (int i = 0; i < count; i++) {
+      const float gain = ramp.at(i);
+      outL[i] += src[i * 2] * gain;
+      outR[i] += src[i * 2 + 1] * gain;
+    }
+  }
+  mGainsRamping = ramping;
+}
+
+void Looper::mixLoop(float *outL, float *outR, int64_t position,
+                     int numFrames) {
+  if (mGainsRamping) {
+    mixTracksRamped(outL, outR, position, numFrames);
+    return;
+  }
+  if (!usesPremix(mMix)) {
+    mixTracks(outL, outR, position, numFrames, mMix);
+    return;
+  }
+
+  // Region by region; a region the worker hasn't rebuilt for this mix yet
+  // is mixed from the tracks
+  int i = 0;
+  while (i < numFrames) {
+    int64_t start = position + i;
+    int64_t regionEnd =
+        (start / PREMIX_REGION_FRAMES + 1) * PREMIX_REGION_FRAMES;
+    int count = static_cast<int>(
+        std::min<int64_t>(numFrames - i, regionEnd - start));
+    if (!readPremix(outL + i, outR + i, start, count, mMix.generation)) {
+      mixTracks(outL + i, outR + i, start, count, mMix);
+    }
+    i += count;
+  }
+}
+
+void Looper::processBlock(const float *synthL, const float *synthR,
+                          float *loopOutL, float *loopOutR, int numFrames) {
+  std::fill(loopOutL, loopOutL + numFrames, 0.0f);
+  std::fill(loopOutR, loopOutR + numFrames, 0.0f);
+  applyDeferredClears();
+  applyPendingBounce();
+
+  // Walk the block in segments that end at state changes or the loop end
+  int i = 0;
+  while (i < numFrames) {
+    int remaining = numFrames - i;
+
+    switch (mState) {
+    case State::PRE_COUNT: {
+      // Silent; segments end on count-in beats, where the UI is notified
+      int64_t nextBeat =
+          (mPreCountPosition / mSamplesPerBeat + 1) * mSamplesPerBeat;
+      int count = static_cast<int>(
+          std::min<int64_t>(remaining, nextBeat - mPreCountPosition));
+      advancePreCount(count);
+      i += count;
+      break;
+    }
+
+    case State::RECORDING: {
+      // Segments end where the transport wraps or the take completes
+      int count = static_cast<int>(std::min<int64_t>(
+          remaining, std::min(mLoopLengthSamples - mRecordPosition,
+                              mLoopLengthSamples - mWritePosition)));
+      if (count <= 0) {
+        // Defensive: fall back to the per-sample path to finish the take
+        process(synthL[i], synthR[i], loopOutL[i], loopOutR[i]);
+        i++;
+        break;
+      }
+
+      if (isValidTrackIndex(mActiveRecordingTrack)) {
+        // Frames rendered before the write head reaches the loop start were
+        // heard during the pre-count
+        int skip = static_cast<int>(
+            std::min<int64_t>(count, std::max<int64_t>(0, -mWritePosition)));
+        int16_t *dst = mTracks[mActiveRecordingTrack].frames +
+                       (mWritePosition + skip) * 2;
+        for (int j = skip; j < count; j++) {
+          dst[(j - skip) * 2] = toPcm16(synthL[i + j] * LOOP_RECORD_GAIN);
+          dst[(j - skip) * 2 + 1] =
+              toPcm16(synthR[i + j] * LOOP_RECORD_GAIN);
+        }
+      }
+      // The take in progress has no content yet, so isn't in the mix
+      mixLoop(loopOutL + i, loopOutR + i, mRecordPosition, count);
+
+      mRecordPosition += count;
+      mWritePosition += count;
+      updateBeatBar();
+      i += count;
+
+      if (mWritePosition >= mLoopLengthSamples) {
+        mTracks[mActiveRecordingTrack].length = mLoopLengthSamples;
+        mTracks[mActiveRecordingTrack].hasContent = true;
+        mLoopLengthLocked = true;
+        tracksChanged();
+        mState = State::STOPPED;
+        mActiveRecordingTrack = -1;
+        mPlaybackPosition = 0;
+        mCurrentBeat = 0;
+        mCurrentBar = 0;
+
+        RT_LOGI("Recording complete, track now has content");
+        notifyStateChange();
+      } else if (mRecordPosition >= mLoopLengthSamples) {
+        mRecordPosition = 0;
+      }
+      break;
+    }
+
+    case State::PLAYING: {
+      if (mLoopLengthSamples <= 0) {
+        i = numFrames;
+        break;
+      }
+      int count = static_cast<int>(std::min<int64_t>(
+          remaining, mLoopLengthSamples - mPlaybackPosition));
+      if (count > 0) {
+        mixLoop(loopOutL + i, loopOutR + i, mPlaybackPosition, count);
+        mPlaybackPosition += count;
+        updateBeatBar();
+        i += count;
+      }
+
+      if (mPlaybackPosition >= mLoopLengthSamples) {
+        mPlaybackPosition = 0;
+        mCurrentBeat = 0;
+        mCurrentBar = 0;
+      }
+      break;
+    }
+
+    case State::IDLE:
+    case State::STOPPED:
+    default:
+      i = numFrames;
+      break;
+    }
+  }
+
+  // Head for the session read-ahead worker
+  mPrefetchPosition.store(
+      mState == State::RECORDING ? mRecordPosition : mPlaybackPosition,
+      std::memory_order_relaxed);
+  mPrefetchLoopLength.store(mLoopLengthSamples, std::memory_order_relaxed);
+}
+
+void Looper::advancePreCount(int frames) {
+  mPreCountPosition += frames;
+  int beatInPreCount = static_cast<int>(mPreCountPosition / mSamplesPerBeat);
+  if (beatInPreCount != mCurrentBeat) {
+    mCurrentBeat = beatInPreCount;
+    notifyStateChange();
+  }
+
+  // Check if pre-count is complete
+  const int64_t preCountLength =
+      static_cast<int64_t>(mSamplesPerBeat) * PRE_COUNT_BEATS;
+  if (mPreCountPosition >= preCountLength) {
+    mState = State::RECORDING;
+    mRecordPosition = 0;
+    // Never more than half the loop, so the tail finishes within one wrap
+    mWritePosition = -std::min(mRecordLatency, mLoopLengthSamples / 2);
+    mCurrentBeat = 0;
+    mCurrentBar = 0;
+
+    // Sync playback position to start of loop
+    mPlaybackPosition = 0;
+
+    RT_LOGI("Pre-count complete, starting recording on track %d",
+            mActiveRecordingTrack);
+    notifyStateChange();
+  }
+}
+
+int64_t Looper::getFramesToLoopStart() const {
+  switch (mState) {
+  case State::PRE_COUNT:
+    return static_cast<int64_t>(mSamplesPerBeat) * PRE_COUNT_BEATS -
+           mPreCountPosition;
+  case State::RECORDING:
+    return mLoopLengthSamples - mRecordPosition;
+  case State::PLAYING:
+    return mLoopLengthSamples - mPlaybackPosition;
+  default:
+    return -1;
+  }
+}
+
 void Looper::updateBeatBar() {
   int64_t position =
       (mState == State::RECORDING) ? mRecordPosition : mPlaybackPosition;
@@ -439,25 +1033,18 @@ void Looper::notifyStateChange() {
 
 // ===== AUDIO EXPORT =====
 
-const float *Looper::getTrackBufferL(int trackIndex) const {
+const int16_t *Looper::getTrackFrames(int trackIndex) const {
   if (!isValidTrackIndex(trackIndex) || !mTracks[trackIndex].hasContent) {
     return nullptr;
   }
-  return mTracks[trackIndex].bufferL.data();
-}
-
-const float *Looper::getTrackBufferR(int trackIndex) const {
-  if (!isValidTrackIndex(trackIndex) || !mTracks[trackIndex].hasContent) {
-    return nullptr;
-  }
-  return mTracks[trackIndex].bufferR.data();
+  return mTracks[trackIndex].frames;
 }
 
 int64_t Looper::getTrackBufferSize(int trackIndex) const {
   if (!isValidTrackIndex(trackIndex) || !mTracks[trackIndex].hasContent) {
     return 0;
   }
-  return static_cast<int64_t>(mTracks[trackIndex].bufferL.size());
+  return mTracks[trackIndex].length;
 }
 
 std::vector<float> Looper::getMixedBuffer(int trackMask) const {
@@ -469,22 +1056,46 @@ std::vector<float> Looper::getMixedBuffer(int trackMask) const {
   int64_t numSamples = mLoopLengthSamples;
   std::vector<float> mixedBuffer(numSamples * 2, 0.0f); // Interleaved stereo
 
-  // Mix all selected tracks
-  for (int t = 0; t < MAX_TRACKS; t++) {
-    if ((trackMask & (1 << t)) == 0)
-      continue;
-    if (!mTracks[t].hasContent)
+  // Selected tracks at their volumes, mute and solo aside
+  MixSnapshot mix{};
+  mix.loopLength = numSamples;
+  for (int t = 0; t < mNumTracks; t++) {
+    if ((trackMask & (1 << t)) == 0 || !mTracks[t].hasContent)
       continue;
+    mix.trackMask |= 1u << t;
+    mix.gain[t] = trackGain(mTracks[t]);
+    mix.length[t] = mTracks[t].length;
+  }
 
-    const auto &track = mTracks[t];
-    float volume = track.volume;
+  // The same sums as the playback mix: reuse what the premix has
+  const MixSnapshot published = mPublishedMix.load();
+  bool samePremix = usesPremix(published) &&
+                    published.trackMask == mix.trackMask &&
+                    published.loopLength == mix.loopLength;
+  for (int t = 0; samePremix && t < mNumTracks; t++) {
+    samePremix = (mix.trackMask & (1u << t)) == 0 ||
+                 (published.gain[t] == mix.gain[t] &&
+                  published.length[t] == mix.length[t]);
+  }
 
-    for (int64_t i = 0;
-         i < numSamples && i < static_cast<int64_t>(track.bufferL.size());
-         i++) {
-      mixedBuffer[i * 2] += track.bufferL[i] * volume;
-      mixedBuffer[i * 2 + 1] += track.bufferR[i] * volume;
+  int64_t reused = 0;
+  for (int64_t start = 0; start < numSamples; start += PREMIX_REGION_FRAMES) {
+    int count = static_cast<int>(
+        std::min<int64_t>(PREMIX_REGION_FRAMES, numSamples - start));
+    float *out = mixedBuffer.data() + start * 2;
+    if (samePremix) {
+      // Deinterleaved through the reader the audio thread uses
+      float left[PREMIX_REGION_FRAMES], right[PREMIX_REGION_FRAMES];
+      if (readPremix(left, right, start, count, published.generation)) {
+        for (int i = 0; i < count; i++) {
+          out[i * 2] = left[i];
+          out[i * 2 + 1] = right[i];
+        }
+        reused += count;
+        continue;
+      }
     }
+    mixTracksInterleaved(out, start, count, mix);
   }
 
   // Clamp output to prevent clipping
@@ -492,8 +1103,361 @@ std::vector<float> Looper::getMixedBuffer(int trackMask) const {
     sample = std::max(-1.0f, std::min(1.0f, sample));
   }
 
-  LOGI("getMixedBuffer: created buffer with %lld samples (stereo)", numSamples);
+  LOGI("getMixedBuffer: created buffer with %lld samples (stereo), %lld from "
+       "the premix",
+       static_cast<long long>(numSamples), static_cast<long long>(reused));
   return mixedBuffer;
 }
 
+// ===== PREMIX =====
+
+void Looper::allocatePremix() {
+  mPremix = nullptr;
+  mNumPremixRegions = 0;
+  mPremixRegions.reset();
+  if (mTrackCapacity <= 0 ||
+      !mPremixStorage.allocate(static_cast<size_t>(mTrackCapacity) *
+                               PREMIX_BYTES_PER_FRAME)) {
+    mPremixStorage.release();
+    return; // Playback mixes the tracks directly
+  }
+  mPremix = reinterpret_cast<float *>(mPremixStorage.data());
+  mNumPremixRegions = static_cast<int>(
+      (mTrackCapacity + PREMIX_REGION_FRAMES - 1) / PREMIX_REGION_FRAMES);
+  mPremixRegions.reset(new std::atomic<uint32_t>[mNumPremixRegions]);
+  for (int r = 0; r < mNumPremixRegions; r++) {
+    mPremixRegions[r].store(0, std::memory_order_relaxed);
+  }
+}
+
+void Looper::updateMix(bool rampGains) {
+  // Playback reads the premix built for the mix before an in-place bounce
+  // while the target is rewritten; the commit publishes the new mix
+  if (isBouncingInPlace()) {
+    return;
+  }
+  MixSnapshot mix{};
+  mix.generation = mMix.generation + 1;
+  mix.loopLength = mLoopLengthSamples;
+  bool hasSolo = anySolo();
+  for (int t = 0; t < mNumTracks; t++) {
+    const auto &track = mTracks[t];
+    if (!track.hasContent || track.muted || (hasSolo && !track.solo))
+      continue;
+    mix.trackMask |= 1u << t;
+    mix.gain[t] = trackGain(track);
+    mix.length[t] = track.length;
+  }
+  mMix = mix;
+  mPublishedMix.store(mix);
+  wakePremix();
+
+  mGainsRamping = false;
+  for (int t = 0; t < MAX_TRACKS; t++) {
+    const float gain = (mix.trackMask & (1u << t)) ? mix.gain[t] : 0.0f;
+    if (rampGains) {
+      mTrackGains[t].setTarget(gain);
+    } else {
+      mTrackGains[t].snap(gain);
+    }
+    mGainsRamping = mGainsRamping || mTrackGains[t].isSmoothing();
+  }
+}
+
+void Looper::tracksChanged(bool rampGains) {
+  updateMix(rampGains);
+  writeSessionHeader();
+}
+
+bool Looper::usesPremix(const MixSnapshot &mix) const {
+  int tracks = 0;
+  for (int t = 0; t < mNumTracks; t++) {
+    tracks += (mix.trackMask >> t) & 1;
+  }
+  return tracks >= 2 && mPremix && mix.loopLength > 0 &&
+         mix.loopLength <= mTrackCapacity;
+}
+
+bool Looper::readPremix(float *outL, float *outR, int64_t position,
+                        int numFrames, uint32_t generation) const {
+  const std::atomic<uint32_t> &region =
+      mPremixRegions[position / PREMIX_REGION_FRAMES];
+  if (region.load(std::memory_order_acquire) != generation) {
+    return false;
+  }
+  const float *src = mPremix + position * 2;
+  for (int i = 0; i < numFrames; i++) {
+    outL[i] = src[i * 2];
+    outR[i] = src[i * 2 + 1];
+  }
+  // Rewritten while we copied (only possible for readers other than the
+  // audio thread, which never reads a region the worker may write)
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return region.load(std::memory_order_relaxed) == generation;
+}
+
+bool Looper::isPremixReady() const {
+  const MixSnapshot mix = mPublishedMix.load();
+  if (!usesPremix(mix)) {
+    return true;
+  }
+  int64_t regions =
+      (mix.loopLength + PREMIX_REGION_FRAMES - 1) / PREMIX_REGION_FRAMES;
+  for (int64_t r = 0; r < regions; r++) {
+    if (mPremixRegions[r].load(std::memory_order_acquire) != mix.generation) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Looper::startPremix() {
+  stopPremix();
+  mPremixRunning.store(true, std::memory_order_release);
+  mPremixThread = std::thread(&Looper::premixLoop, this);
+}
+
+void Looper::stopPremix() {
+  mPremixRunning.store(false, std::memory_order_release);
+  wakePremix();
+  if (mPremixThread.joinable()) {
+    mPremixThread.join();
+  }
+}
+
+void Looper::wakePremix() {
+  mPremixWakeCount.fetch_add(1, std::memory_order_acq_rel);
+  futexWake(mPremixWakeCount, 1);
+}
+
+void Looper::premixLoop() {
+  while (mPremixRunning.load(std::memory_order_acquire)) {
+    // Anything published after this is seen on the next pass
+    const int seen = mPremixWakeCount.load(std::memory_order_acquire);
+    releaseBouncedTracks();
+
+    // Rebuild every region not yet at the published generation. The audio
+    // thread only reads regions already at its generation, so it never
+    // sees one being written; a newer mix restarts the pass.
+    const MixSnapshot mix = mPublishedMix.load();
+    if (usesPremix(mix)) {
+      int64_t regions =
+          (mix.loopLength + PREMIX_REGION_FRAMES - 1) / PREMIX_REGION_FRAMES;
+      for (int64_t r = 0;
+           r < regions && mPremixRunning.load(std::memory_order_relaxed);
+           r++) {
+        std::atomic<uint32_t> &region = mPremixRegions[r];
+        if (region.load(std::memory_order_relaxed) == mix.generation) {
+          continue;
+        }
+        if (mPublishedMix.load().generation != mix.generation) {
+          break;
+        }
+
+        int64_t start = r * PREMIX_REGION_FRAMES;
+        int64_t count = std::min<int64_t>(PREMIX_REGION_FRAMES,
+                                          mix.loopLength - start);
+        region.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        float *out = mPremix + start * 2;
+        std::fill(out, out + count * 2, 0.0f);
+        mixTracksInterleaved(out, start, count, mix);
+        region.store(mix.generation, std::memory_order_release);
+      }
+    }
+    // After the premix, which an in-place bounce plays from meanwhile
+    mixBounce();
+
+    if (mPremixWakeCount.load(std::memory_order_acquire) == seen) {
+      futexWait(mPremixWakeCount, seen);
+    }
+  }
+}
+
+// ===== BOUNCE =====
+
+bool Looper::bounceTracks(int trackMask) {
+  if (mBounceTarget.load(std::memory_order_relaxed) >= 0) {
+    RT_LOGI("Bounce still pending");
+    return false;
+  }
+
+  // Sources at their current volumes; a muted track stays as it is
+  MixSnapshot mix{};
+  mix.loopLength = mLoopLengthSamples;
+  int sources = 0;
+  for (int t = 0; t < mNumTracks; t++) {
+    const auto &track = mTracks[t];
+    if ((trackMask & (1 << t)) == 0 || !track.hasContent || track.muted)
+      continue;
+    mix.trackMask |= 1u << t;
+    mix.gain[t] = trackGain(track);
+    mix.length[t] = track.length;
+    sources++;
+  }
+  if (sources < 2 || mix.loopLength <= 0) {
+    RT_LOGI("Bounce needs at least two unmuted tracks with content");
+    return false;
+  }
+
+  // An empty track not being recorded, whose memory isn't being freed.
+  // Picked here, on the thread that starts takes, so nothing can claim it
+  // before the reservation.
+  const uint32_t releasing = mReleaseMask.load(std::memory_order_acquire);
+  int target = -1;
+  for (int t = 0; t < mNumTracks && target < 0; t++) {
+    if (!mTracks[t].hasContent && t != mActiveRecordingTrack &&
+        (releasing & (1u << t)) == 0) {
+      target = t;
+    }
+  }
+  if (target < 0) {
+    // Every track is in use: the lowest source is overwritten. Playback
+    // must not read it directly meanwhile, and no export may read it.
+    for (int t = 0; t < mNumTracks && target < 0; t++) {
+      if (mix.trackMask & (1u << t)) {
+        target = t;
+      }
+    }
+    if ((mMix.trackMask & (1u << target)) != 0 && !usesPremix(mMix)) {
+      RT_LOGI("Bounce needs an empty track, there is no premix to play");
+      return false;
+    }
+    mBounceInPlace.store(true);
+    if (mExportPins.load() > 0) {
+      mBounceInPlace.store(false);
+      RT_LOGI("Bounce needs an empty track while an export runs");
+      return false;
+    }
+  }
+
+  mBounceTarget.store(target, std::memory_order_relaxed);
+  mBounceMix = mix;
+  mBounceRequest.store(mix.trackMask | static_cast<uint32_t>(target + 1) << 16,
+                       std::memory_order_release);
+  wakePremix();
+  RT_LOGI("Bouncing %d tracks into track %d", sources, target);
+  return true;
+}
+
+void Looper::mixBounce() {
+  const uint32_t request = mBounceRequest.load(std::memory_order_acquire);
+  if (request == 0) {
+    return;
+  }
+  // A source is only overwritten once playback reads the premix throughout.
+  // The mix is held, so the pass before this one has built it.
+  if (isBouncingInPlace() && !isPremixReady()) {
+    return;
+  }
+  const int target = static_cast<int>(request >> 16) - 1;
+  const MixSnapshot mix = mBounceMix;
+
+  // Mixed a region at a time through float, like the premix: once for the
+  // peak, then again to write it normalized to full scale, so the sum never
+  // clips. Each region is mixed before it is written, which lets the
+  // target be one of the sources.
+  std::vector<float> scratch(PREMIX_REGION_FRAMES * 2);
+  float peak = 0.0f;
+  for (int64_t start = 0; start < mix.loopLength;
+       start += PREMIX_REGION_FRAMES) {
+    int64_t count =
+        std::min<int64_t>(PREMIX_REGION_FRAMES, mix.loopLength - start);
+    std::fill(scratch.begin(), scratch.end(), 0.0f);
+    mixTracksInterleaved(scratch.data(), start, count, mix);
+    for (int64_t i = 0; i < count * 2; i++) {
+      peak = std::max(peak, std::fabs(scratch[i]));
+    }
+  }
+  const float scale = peak > 0.0f ? 1.0f / peak : 1.0f;
+
+  int16_t *dst = mTracks[target].frames;
+  for (int64_t start = 0; start < mix.loopLength;
+       start += PREMIX_REGION_FRAMES) {
+    int64_t count =
+        std::min<int64_t>(PREMIX_REGION_FRAMES, mix.loopLength - start);
+    std::fill(scratch.begin(), scratch.end(), 0.0f);
+    mixTracksInterleaved(scratch.data(), start, count, mix);
+    for (int64_t i = 0; i < count * 2; i++) {
+      dst[start * 2 + i] = toPcm16(scratch[i] * scale);
+    }
+  }
+
+  // Playback undoes the normalization: frames * trim * LOOP_PLAYBACK_SCALE
+  mBounceTrim.store(peak > 0.0f ? peak * LOOP_RECORD_GAIN : 1.0f,
+                    std::memory_order_relaxed);
+  mBounceRequest.store(0, std::memory_order_relaxed);
+  mPendingBounce.store(request, std::memory_order_release);
+}
+
+void Looper::applyPendingBounce() {
+  // The sources stay as they are while an export reads them. An in-place
+  // bounce has already overwritten its target, and exports wait for it
+  // instead of reading.
+  const bool inPlace = isBouncingInPlace();
+  if (mPendingBounce.load(std::memory_order_relaxed) == 0 ||
+      (isPinned() && !inPlace)) {
+    return;
+  }
+  uint32_t pending = mPendingBounce.exchange(0, std::memory_order_acquire);
+  int target = static_cast<int>(pending >> 16) - 1;
+  uint32_t sources = pending & 0xFFFFu;
+
+  // Dropped if a source was cleared (or the loop changed) in the meantime.
+  // Clears wait for an in-place bounce, so it always lands.
+  bool valid = inPlace || (!mTracks[target].hasContent &&
+                           target != mActiveRecordingTrack);
+  bool solo = false;
+  for (int t = 0; t < mNumTracks; t++) {
+    if (sources & (1u << t)) {
+      valid = valid && mTracks[t].hasContent &&
+              mTracks[t].length == mLoopLengthSamples;
+      solo = solo || mTracks[t].solo;
+    }
+  }
+
+  // The mix is published again from here on
+  mBounceInPlace.store(false);
+  if (valid) {
+    const uint32_t freed = sources & ~(1u << target);
+    for (int t = 0; t < mNumTracks; t++) {
+      if (freed & (1u << t)) {
+        resetTrack(mTracks[t]);
+      }
+    }
+    LoopTrack &merged = mTracks[target];
+    merged.length = mLoopLengthSamples;
+    merged.hasContent = true;
+    merged.volume = 1.0f; // Volumes are in the mix
+    merged.trim = mBounceTrim.load(std::memory_order_relaxed);
+    merged.muted = false;
+    merged.solo = solo;
+    mReleaseMask.fetch_or(freed, std::memory_order_release);
+    tracksChanged();
+    RT_LOGI("Bounce committed into track %d", target);
+    notifyStateChange();
+  } else {
+    if (inPlace) {
+      updateMix(); // Changes held back meanwhile
+    }
+    RT_LOGI("Bounce into track %d dropped, its tracks changed", target);
+  }
+  mBounceTarget.store(-1, std::memory_order_release);
+}
+
+void Looper::releaseBouncedTracks() {
+  // Worker thread: the audio thread won't record into these until cleared
+  uint32_t mask = mReleaseMask.load(std::memory_order_acquire);
+  if (mask == 0 || isPinned()) {
+    return;
+  }
+  const size_t headerBytes = LoopStorage::alignToPage(sizeof(SessionHeader));
+  for (int t = 0; t < mNumTracks; t++) {
+    if (mask & (1u << t)) {
+      mStorage.discard(headerBytes + mTrackStride * t, mTrackStride);
+    }
+  }
+  mReleaseMask.fetch_and(~mask, std::memory_order_release);
+}
+
 } // namespace synthio
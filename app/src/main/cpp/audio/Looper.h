@@ -1,32 +1,58 @@
 #ifndef SYNTHIO_LOOPER_H
 #define SYNTHIO_LOOPER_H
 
+#include "LoopStorage.h"
+#include "SeqLock.h"
+#include "SmoothedParameter.h"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
 namespace synthio {
 
 /**
- * Multi-track audio looper with 4 synchronized tracks.
+ * Multi-track audio looper with up to MAX_TRACKS synchronized tracks.
  *
  * Features:
- * - 4 concurrent loop tracks, all synced to the same timing
+ * - Up to 8 (default) concurrent loop tracks, all synced to the same timing
  * - Per-track volume, mute, and solo controls
  * - 4-beat pre-count before recording
  * - 4-bar loop recording per track
  * - Records synth audio only (not drums)
  * - Can hear existing tracks while recording a new one
+ * - Playback reads one cached premix of the audible tracks, so its cost
+ *   doesn't grow with the track count; bounceTracks() merges tracks to free
+ *   their memory
  */
 class Looper {
 public:
-  static constexpr int MAX_TRACKS = 4;
+  // Hard limits; the usable track count and bar count are runtime
+  // capacities set by configure() within a memory budget
+  static constexpr int MAX_TRACKS = 16;
+  static constexpr int MAX_BARS = 32;
+  static constexpr int DEFAULT_TRACK_COUNT = 8;
+  static constexpr int DEFAULT_MAX_BARS = 16;
+  static constexpr size_t DEFAULT_MEMORY_BUDGET = 96u * 1024u * 1024u;
   static constexpr int PRE_COUNT_BEATS = 4;
   static constexpr int MIN_BARS = 1;
-  static constexpr int MAX_BARS = 8;
   static constexpr int DEFAULT_BARS = 4;
   static constexpr int BEATS_PER_BAR = 4;
+  static constexpr float MIN_BPM = 30.0f;
+  static constexpr float MAX_BPM = 300.0f;
+
+  // Tracks are stored as interleaved 16-bit stereo frames
+  static constexpr int BYTES_PER_FRAME = 2 * sizeof(int16_t);
+  // The premix is interleaved float stereo, one frame per track frame
+  static constexpr int PREMIX_BYTES_PER_FRAME = 2 * sizeof(float);
 
   enum class State {
     IDLE,      // No loops, ready to record
@@ -36,31 +62,65 @@ public:
     PLAYING    // Playing back loops
   };
 
-  // Individual track data
+  // Individual track data. frames is a fixed span of interleaved int16
+  // stereo in the looper's arena; recording and clearing never reallocate it.
   struct LoopTrack {
-    std::vector<float> bufferL;
-    std::vector<float> bufferR;
+    int16_t *frames = nullptr;
+    int64_t length = 0; // Recorded frames (valid once hasContent)
     bool hasContent = false;
     float volume = 0.7f;
     bool muted = false;
     bool solo = false;
+    // Playback scale of the stored frames on top of volume: takes are 1,
+    // bounces are normalized to full scale and carry the inverse here
+    float trim = 1.0f;
   };
 
   // Callback for state changes (to notify UI)
   using StateCallback = std::function<void(State, int)>; // state, beat number
 
   Looper();
+  ~Looper();
 
   void setSampleRate(float sampleRate);
+  float getSampleRate() const { return mSampleRate; }
   void setBPM(float bpm);
 
+  // ===== CAPACITY =====
+  // Reserves storage for trackCount tracks of up to maxBars bars each, plus
+  // the premix, limited to memoryBudget bytes. Allocates, so it must only be
+  // called while the audio stream is stopped; clears every track. Returns
+  // false if not even one bar per track fits the budget at the current tempo.
+  //
+  // With a sessionPath the arena is a shared mapping of that file: a valid
+  // session there is reopened as-is (its layout and sample rate win over the
+  // arguments and its tracks come back), otherwise a new session is created
+  // in its place. The engine then runs at getSampleRate() while the
+  // session holds audio.
+  bool configure(int trackCount, int maxBars, size_t memoryBudget,
+                 const char *sessionPath = nullptr);
+  int getTrackCount() const { return mNumTracks; }
+  // Longest loop that fits each track's span at the current tempo
+  int getMaxBars() const;
+  size_t getReservedBytes() const;
+
+  // ===== SESSIONS =====
+  bool hasSession() const { return mStorage.isMapped(); }
+  // Track audio and state are written into the mapping as they change; this
+  // only flushes the dirty pages to disk (wait = false schedules it)
+  bool saveSession(bool wait);
+
   // ===== BAR COUNT CONFIGURATION =====
-  void setBarCount(int bars); // Set number of bars per loop (1-8)
+  void setBarCount(int bars); // Set number of bars per loop (1-getMaxBars())
   int getBarCount() const { return mBarsToRecord; }
 
   // ===== MAIN CONTROL =====
   void startRecording(); // Start recording track 0 (backward compat)
   void startRecordingTrack(int trackIndex); // Start recording specific track
+  // Control thread, before posting startRecordingTrack(): faults in the
+  // track's span and the header so the take doesn't page-fault on the
+  // audio thread. Never changes their contents.
+  void prepareRecordingTrack(int trackIndex);
   void stopPlayback();                      // Stop playing all loops
   void startPlayback();                     // Start playing all loops
   void clearLoop();                         // Clear all loops (backward compat)
@@ -73,6 +133,36 @@ public:
   void clearTrack(int trackIndex);
   void clearAllTracks();
 
+  // ===== BOUNCE =====
+  // Merges the unmuted tracks in trackMask, at their current volumes, into
+  // one track and frees the others' memory. Audio thread: reserves an empty
+  // track and hands the mix to the worker, which writes the whole loop into
+  // it, scaled to full scale; the result replaces the sources at the start
+  // of a later processBlock(). With no empty track the lowest source is
+  // overwritten instead: playback then reads the premix, the mix and any
+  // clears are held until the commit, and exports wait for it. Returns
+  // false if fewer than two tracks would be merged, a bounce is in flight,
+  // or an in-place bounce can't start (an export is running, or the audible
+  // target has no premix to play from).
+  bool bounceTracks(int trackMask);
+  bool isBouncingInPlace() const { return mBounceInPlace.load(); }
+
+  // ===== EXPORT PINS =====
+  // Exports read track frames straight from the arena. While any pin is
+  // held, tracks keep their audio: clears and bounce commits wait for the
+  // first block after the last unpin, freed pages stay mapped and
+  // configure() refuses. An in-place bounce already running when the pin
+  // is taken must be waited out (isBouncingInPlace()). Any thread.
+  void pinTracks() { mExportPins.fetch_add(1); }
+  void unpinTracks() {
+    if (mExportPins.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      wakePremix(); // Releases held back by the pin
+    }
+  }
+  bool isPinned() const {
+    return mExportPins.load(std::memory_order_acquire) > 0;
+  }
+
   // ===== STATE QUERIES =====
   State getState() const { return mState; }
   bool hasLoop() const { return hasAnyLoop(); } // Backward compat
@@ -86,29 +176,55 @@ public:
   // ===== TRACK QUERIES =====
   bool trackHasContent(int trackIndex) const;
   float getTrackVolume(int trackIndex) const;
+  // Volume times the track's trim: what its frames are scaled by (with
+  // LOOP_PLAYBACK_SCALE) in the mix and in exports
+  float getTrackMixVolume(int trackIndex) const;
   bool isTrackMuted(int trackIndex) const;
   bool isTrackSolo(int trackIndex) const;
   int getActiveRecordingTrack() const { return mActiveRecordingTrack; }
   int getUsedTrackCount() const;
+  // True once the premix holds the whole loop for the current mix settings
+  // (or the mix is too simple to need one). Any thread.
+  bool isPremixReady() const;
 
   // ===== AUDIO PROCESSING =====
   // inputL/R = synth audio to potentially record
   // Returns the mixed loop playback to add to output
   void process(float synthL, float synthR, float &loopOutL, float &loopOutR);
 
+  // Block version of process(): records/plays numFrames frames at once
+  void processBlock(const float *synthL, const float *synthR, float *loopOutL,
+                    float *loopOutR, int numFrames);
+
+  // ===== LATENCY COMPENSATION =====
+  // Frames between rendering a sample and the player hearing it. Takes are
+  // written this far behind the transport, so an overdub lands where the
+  // backing was when the player heard it; the tail keeps recording while
+  // the transport wraps. Latched when a take starts (audio thread).
+  void setRecordLatency(int64_t frames) {
+    mRecordLatency = std::max<int64_t>(0, frames);
+  }
+  int64_t getRecordLatency() const { return mRecordLatency; }
+
   // ===== SYNC INFO =====
   int64_t getPlaybackPosition() const { return mPlaybackPosition; }
   int64_t getLoopLengthSamples() const { return mLoopLengthSamples; }
+  // Frames until the loop (re)starts on its first beat: the end of the
+  // count-in, or the record/playback head wrapping. -1 while neither runs.
+  // The engine's transport restarts its bar there.
+  int64_t getFramesToLoopStart() const;
 
   // ===== AUDIO EXPORT =====
-  // Get raw track buffer data for export
-  const float *getTrackBufferL(int trackIndex) const;
-  const float *getTrackBufferR(int trackIndex) const;
+  // Raw track data for export: getTrackBufferSize() interleaved int16
+  // stereo frames
+  const int16_t *getTrackFrames(int trackIndex) const;
   int64_t getTrackBufferSize(int trackIndex) const;
 
   // Get mixed stereo buffer (interleaved L/R) for specified tracks
   // trackMask: bitmask of tracks to include (bit 0 = track 0, etc.)
-  // includeDrums is handled at Kotlin level
+  // includeDrums is handled at Kotlin level. When the tracks and volumes
+  // match the playback mix, regions the premix already holds are copied
+  // rather than mixed again.
   std::vector<float> getMixedBuffer(int trackMask) const;
 
   // Set callback for state changes
@@ -120,7 +236,18 @@ private:
   float mBPM = 100.0f;
   int mBarsToRecord = DEFAULT_BARS; // Configurable bar count
 
-  // Multi-track storage
+  // Multi-track storage. One mapping holds a session header page followed by
+  // every track at its maximum length, each span page-aligned; it is only
+  // made by configure()/setSampleRate() on a control thread. Pages are
+  // committed lazily as they are first recorded, so the budget bounds the
+  // worst case rather than the typical footprint.
+  LoopStorage mStorage;
+  std::string mSessionPath;   // Empty = RAM only
+  int64_t mTrackCapacity = 0; // Frames per track span
+  size_t mTrackStride = 0;    // Bytes between track spans
+  int mNumTracks = DEFAULT_TRACK_COUNT;
+  int mBarCapacity = DEFAULT_MAX_BARS;
+  size_t mMemoryBudget = DEFAULT_MEMORY_BUDGET;
   std::array<LoopTrack, MAX_TRACKS> mTracks;
   int mActiveRecordingTrack = -1; // -1 = not recording any track
 
@@ -131,7 +258,9 @@ private:
   bool mLoopLengthLocked = false; // True once first loop is recorded
 
   // Position tracking (shared by all tracks)
-  int64_t mRecordPosition = 0;
+  int64_t mRecordPosition = 0; // Transport while recording, wraps at the end
+  int64_t mWritePosition = 0;  // Take write head, mRecordLatency behind
+  int64_t mRecordLatency = 0;
   int64_t mPlaybackPosition = 0;
   int64_t mPreCountPosition = 0;
 
@@ -141,12 +270,127 @@ private:
 
   StateCallback mStateCallback = nullptr;
 
+  // Session read-ahead. Touching a file page the kernel has evicted would
+  // block the audio thread on I/O, so a worker keeps the pages just ahead of
+  // the published play/record head resident.
+  static constexpr float PREFETCH_SECONDS = 2.0f;
+  static constexpr int PREFETCH_INTERVAL_MS = 100;
+  std::thread mPrefetchThread;
+  std::mutex mPrefetchMutex;
+  std::condition_variable mPrefetchWake;
+  bool mPrefetchRunning = false;
+  std::atomic<int64_t> mPrefetchPosition{0};
+  std::atomic<int64_t> mPrefetchLoopLength{0};
+
+  // ===== PREMIX =====
+  // The audible tracks summed once, for playback to read instead of every
+  // track. A worker keeps it current: any change to the mix (volume, mute,
+  // solo, a take, a clear, a bounce) publishes a new MixSnapshot under a
+  // new generation, and the worker rebuilds each region for it. A region
+  // still holding an older generation is mixed from the tracks as before,
+  // with the same arithmetic, so changes are heard immediately and the
+  // output is identical either way. With fewer than two audible tracks
+  // there is nothing to save and the premix is not used.
+  static constexpr int PREMIX_REGION_FRAMES = 4096;
+
+  struct MixSnapshot {
+    uint32_t generation;
+    uint32_t trackMask; // Tracks in the mix
+    int64_t loopLength;
+    float gain[MAX_TRACKS];     // volume * LOOP_PLAYBACK_SCALE
+    int64_t length[MAX_TRACKS]; // Frames of each track
+  };
+
+  LoopStorage mPremixStorage;
+  float *mPremix = nullptr; // Interleaved stereo, mTrackCapacity frames
+  int mNumPremixRegions = 0;
+  // Generation each region was built for (0 = never). The worker zeroes it
+  // while rewriting a region, like a sequence lock.
+  std::unique_ptr<std::atomic<uint32_t>[]> mPremixRegions;
+  MixSnapshot mMix{};                // Current mix (audio thread)
+  // What playback actually applies per track (0 outside the mix). Volume,
+  // mute and solo changes ramp these over PARAMETER_RAMP_TIME; until every
+  // ramp lands, playback mixes the tracks directly at the ramped gains,
+  // then picks the premix up again at the same values. Content changes
+  // (takes, clears, bounces) snap.
+  SmoothedParameter mTrackGains[MAX_TRACKS];
+  bool mGainsRamping = false;
+  SeqLock<MixSnapshot> mPublishedMix; // For the worker and exports
+  std::thread mPremixThread;
+  std::atomic<bool> mPremixRunning{false};
+  // Futex word the worker sleeps on, bumped by wakePremix() whenever the
+  // mix, a bounce or a release gives it something to do
+  std::atomic<int> mPremixWakeCount{0};
+  void wakePremix(); // Any thread, including the audio thread
+
+  // Bounces. bounceTracks() reserves the target and posts the request
+  // (sources | (target + 1) << 16) with its mix in mBounceMix; the worker
+  // writes the target and moves the request to mPendingBounce; the audio
+  // thread commits it, and the worker then discards the sources' pages.
+  // Tracks with memory still to discard can't be recorded into.
+  static_assert(MAX_TRACKS <= 16, "Bounce commits pack the mask in 16 bits");
+  std::atomic<int> mBounceTarget{-1};
+  MixSnapshot mBounceMix{}; // Written before mBounceRequest is published
+  std::atomic<uint32_t> mBounceRequest{0};
+  std::atomic<uint32_t> mPendingBounce{0};
+  std::atomic<float> mBounceTrim{1.0f}; // Written before mPendingBounce
+  std::atomic<uint32_t> mReleaseMask{0};
+  // The target is one of the sources. Sequentially consistent against the
+  // pins: bounceTracks() sets it before reading them, an export pins before
+  // reading it, so one of the two always sees the other.
+  std::atomic<bool> mBounceInPlace{false};
+  void mixBounce(); // Worker: writes a requested bounce into its target
+
+  // ===== EXPORT PINS =====
+  std::atomic<int> mExportPins{0};
+  uint32_t mDeferredClearMask = 0; // Audio thread: clears waiting on pins
+  bool mDeferredClearAll = false;
+  void applyDeferredClears(); // Audio thread, once the pins are released
+
   void updateTiming();
+  void allocateArena(); // Reserves mNumTracks spans within mMemoryBudget
+  void layoutTracks();
+  void resetTrack(LoopTrack &track);
+  static float trackGain(const LoopTrack &track); // Per-sample mix gain
+  bool openSession(); // Restores the session at mSessionPath, if valid
+  void writeSessionHeader();
+  void startPrefetch();
+  void stopPrefetch();
+  void prefetchLoop();
+  void allocatePremix(); // Sized for mTrackCapacity; worker stopped
+  void startPremix();
+  void stopPremix();
+  void premixLoop();
+  // Publishes the current track settings as a new mix generation;
+  // rampGains moves playback to them gradually
+  void updateMix(bool rampGains = false);
+  // After any change to track content or settings: mix and session header
+  void tracksChanged(bool rampGains = false);
+  bool usesPremix(const MixSnapshot &mix) const;
+  // Copies frames [position, position + numFrames) of one region if it holds
+  // generation; false if it doesn't (or was rewritten meanwhile)
+  bool readPremix(float *outL, float *outR, int64_t position, int numFrames,
+                  uint32_t generation) const;
+  void applyPendingBounce();
+  void releaseBouncedTracks();
+  void advancePreCount(int frames);
   void updateBeatBar();
   void notifyStateChange();
   bool anySolo() const; // Returns true if any track has solo enabled
+  // Adds numFrames of the current mix starting at position: from the
+  // premix where it is current, otherwise from the tracks
+  void mixLoop(float *outL, float *outR, int64_t position, int numFrames);
+  // Adds numFrames of every track with a gain, each along its own ramp
+  void mixTracksRamped(float *outL, float *outR, int64_t position,
+                       int numFrames);
+  // Adds numFrames of every track in mix starting at position
+  void mixTracks(float *outL, float *outR, int64_t position, int numFrames,
+                 const MixSnapshot &mix) const;
+  // Same sums, interleaved stereo (premix regions, exports, bounces)
+  void mixTracksInterleaved(float *out, int64_t position, int64_t numFrames,
+                            const MixSnapshot &mix) const;
   bool isValidTrackIndex(int index) const {
-    return index >= 0 && index < MAX_TRACKS;
+    return index >= 0 && index < mNumTracks;
   }
 };
 
@@ -1,93 +1,37 @@
 #include "Metronome.h"
 #include <algorithm>
-#include <android/log.h>
-#include <cmath>
 
 #define LOG_TAG "SynthIO-Metronome"
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#include "Log.h"
 
 namespace synthio {
 
-Metronome::Metronome() { calculateTiming(); }
-
 void Metronome::setSampleRate(float sampleRate) {
-  mSampleRate = sampleRate;
   mDrumSynth.setSampleRate(sampleRate);
-  calculateTiming();
-}
-
-void Metronome::setBPM(float bpm) {
-  mBPM = std::max(30.0f, std::min(300.0f, bpm));
-  calculateTiming();
-  LOGI("Metronome BPM set to %.1f", mBPM);
-}
-
-void Metronome::calculateTiming() {
-  mSamplesPerBeat = mSampleRate * 60.0f / mBPM;
-}
-
-void Metronome::start() {
-  LOGI("Metronome::start() - BPM=%.1f, sampleRate=%.0f, samplesPerBeat=%.0f",
-       mBPM, mSampleRate, mSamplesPerBeat);
-
-  mRunning = true;
-  mCurrentBeat = 0;
-  mSampleCounter = 0.0f;
-
-  // Trigger first click immediately
-  triggerClick();
-
-  LOGI("Metronome started, first kick triggered, mRunning=%d", mRunning);
-}
-
-void Metronome::stop() {
-  LOGI("Metronome::stop()");
-  mRunning = false;
-}
-
-void Metronome::reset() {
-  mCurrentBeat = 0;
-  mSampleCounter = 0.0f;
+  mDrumSynth.setOneShots(DrumOneShotBank::prepare(sampleRate));
 }
 
-void Metronome::triggerClick() {
-  // Use kick drum for a reliable, audible click
-  mDrumSynth.triggerKick();
-  LOGI("Metronome KICK on beat %d", mCurrentBeat);
-}
-
-float Metronome::nextSample() {
-  // Always get the drum synth sample (for decay of active sounds)
-  float output = mDrumSynth.nextSample() * mVolume;
-
-  // Debug: log periodically to verify we're being called
-  static int callCount = 0;
-  static float maxOutput = 0.0f;
-  callCount++;
-  if (output > maxOutput)
-    maxOutput = output;
+void Metronome::processBlock(float *out, int numFrames,
+                             const TransportEvent *events, int numEvents) {
+  // Render between beats so each click starts on exactly its frame
+  int segmentStart = 0;
+  for (int e = 0; e < numEvents; ++e) {
+    if (events[e].step % Transport::STEPS_PER_BEAT != 0) {
+      continue;
+    }
+    const int frame = std::min(events[e].frame, numFrames);
+    mDrumSynth.processBlock(out + segmentStart, frame - segmentStart);
+    segmentStart = frame;
 
-  if (callCount % 48000 == 0) { // Log once per second
-    LOGI("Metronome::nextSample() called %d times, mRunning=%d, "
-         "maxOutput=%.4f, beat=%d",
-         callCount, mRunning, maxOutput, mCurrentBeat);
-    maxOutput = 0.0f;
+    mCurrentBeat = events[e].step / Transport::STEPS_PER_BEAT;
+    mDrumSynth.triggerSnare();
+    RT_LOGI("Metronome beat %d", mCurrentBeat);
   }
+  mDrumSynth.processBlock(out + segmentStart, numFrames - segmentStart);
 
-  // Handle timing if running - advance to next beat
-  if (mRunning) {
-    mSampleCounter += 1.0f;
-
-    if (mSampleCounter >= mSamplesPerBeat) {
-      mSampleCounter -= mSamplesPerBeat;
-
-      // Advance to next beat
-      mCurrentBeat = (mCurrentBeat + 1) % 4;
-      triggerClick();
-    }
+  for (int i = 0; i < numFrames; ++i) {
+    out[i] *= VOLUME;
   }
-
-  return output;
 }
 
 } // namespace synthio
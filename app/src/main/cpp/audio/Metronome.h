@@ -2,55 +2,38 @@
 #define SYNTHIO_METRONOME_H
 
 #include "DrumSynth.h"
+#include "Transport.h"
 
 namespace synthio {
 
 /**
- * Simple metronome that uses the kick drum sound for reliable, audible clicks.
+ * Count-in and recording click: a snare hit on every beat of the transport.
  * Used during loop recording to keep time without playing the full drum
- * pattern.
+ * pattern. Timing comes entirely from the engine's Transport, so the clicks
+ * sit on the same grid as the drum machine and the looper.
  */
 class Metronome {
 public:
-  Metronome();
-
   void setSampleRate(float sampleRate);
-  void setBPM(float bpm);
-
-  // Control
-  void start();
-  void stop();
-  bool isRunning() const { return mRunning; }
+  void setOneShotsEnabled(bool enabled) {
+    mDrumSynth.setOneShotsEnabled(enabled);
+  }
 
-  // Get next sample - call every audio frame
-  float nextSample();
+  // Writes numFrames samples to out, clicking on each beat among events
+  // (from Transport::advance() for the same block). Pass no events to keep
+  // quiet; clicks already playing ring out.
+  void processBlock(float *out, int numFrames, const TransportEvent *events,
+                    int numEvents);
 
-  // Get current beat (0-3)
+  // Beat (0-3) of the last click
   int getCurrentBeat() const { return mCurrentBeat; }
 
-  // Reset to beat 0
-  void reset();
-
 private:
-  DrumSynth mDrumSynth; // Use kick drum for metronome sound
-
-  float mSampleRate = 48000.0f;
-  float mBPM = 100.0f;
-  bool mRunning = false;
-
-  // Timing
+  DrumSynth mDrumSynth;
   int mCurrentBeat = 0;
-  float mSampleCounter = 0.0f;
-  float mSamplesPerBeat = 0.0f;
-
-  // Volume for metronome clicks
-  float mVolume = 0.9f;
-
-  void setVolume(float volume) { mVolume = volume; }
-  float getVolume() const { return mVolume; }
 
-  void calculateTiming();
-  void triggerClick();
+  // Loud enough to cut through the synth being recorded over it
+  static constexpr float VOLUME = 1.8f;
 };
 
 } // namespace synthio
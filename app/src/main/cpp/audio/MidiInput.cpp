@@ -0,0 +1,331 @@
+#include "MidiInput.h"
+#include "AudioEngine.h"
+#include <algorithm>
+#include <chrono>
+#include <dlfcn.h>
+#include <sys/types.h>
+
+#define LOG_TAG "MidiInput"
+#include "Log.h"
+
+namespace synthio {
+
+namespace {
+
+// AMidi entry points (API 29), resolved from libamidi.so at runtime. The
+// NDK header only declares them when the minimum API level is 29.
+using DeviceFromJavaFn = int32_t (*)(JNIEnv *, jobject, AMidiDevice **);
+using DeviceReleaseFn = int32_t (*)(const AMidiDevice *);
+using OutputPortOpenFn = int32_t (*)(const AMidiDevice *, int32_t,
+                                     AMidiOutputPort **);
+using OutputPortCloseFn = void (*)(const AMidiOutputPort *);
+using OutputPortReceiveFn = ssize_t (*)(const AMidiOutputPort *, int32_t *,
+                                        uint8_t *, size_t, size_t *,
+                                        int64_t *);
+
+constexpr int32_t AMEDIA_OK = 0;
+constexpr int32_t AMIDI_OPCODE_DATA = 1;
+
+struct AMidiApi {
+  DeviceFromJavaFn deviceFromJava = nullptr;
+  DeviceReleaseFn deviceRelease = nullptr;
+  OutputPortOpenFn outputPortOpen = nullptr;
+  OutputPortCloseFn outputPortClose = nullptr;
+  OutputPortReceiveFn outputPortReceive = nullptr;
+  bool loaded = false;
+
+  AMidiApi() {
+    void *library = dlopen("libamidi.so", RTLD_NOW | RTLD_LOCAL);
+    if (library == nullptr) {
+      LOGI("libamidi not available, MIDI stays on the Java path");
+      return;
+    }
+    deviceFromJava = reinterpret_cast<DeviceFromJavaFn>(
+        dlsym(library, "AMidiDevice_fromJava"));
+    deviceRelease = reinterpret_cast<DeviceReleaseFn>(
+        dlsym(library, "AMidiDevice_release"));
+    outputPortOpen = reinterpret_cast<OutputPortOpenFn>(
+        dlsym(library, "AMidiOutputPort_open"));
+    outputPortClose = reinterpret_cast<OutputPortCloseFn>(
+        dlsym(library, "AMidiOutputPort_close"));
+    outputPortReceive = reinterpret_cast<OutputPortReceiveFn>(
+        dlsym(library, "AMidiOutputPort_receive"));
+    loaded = deviceFromJava && deviceRelease && outputPortOpen &&
+             outputPortClose && outputPortReceive;
+  }
+};
+
+const AMidiApi &amidi() {
+  static const AMidiApi api;
+  return api;
+}
+
+int64_t nowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+MidiInput::MidiInput(AudioEngine &engine) : mEngine(engine) {}
+
+MidiInput::~MidiInput() { closeAll(); }
+
+bool MidiInput::isAvailable() { return amidi().loaded; }
+
+// ===== CONNECTIONS =====
+
+bool MidiInput::openDevice(JNIEnv *env, jobject midiDevice, int32_t deviceId,
+                           int32_t numPorts) {
+  const AMidiApi &api = amidi();
+  if (!api.loaded || numPorts <= 0) {
+    return false;
+  }
+
+  if (mEngineClass == nullptr) {
+    // Class lookups only work from a Java thread, so resolve the callback
+    // here rather than on the reader
+    env->GetJavaVM(&mJavaVM);
+    jclass engineClass = env->FindClass("com/synthio/app/audio/SynthesizerEngine");
+    if (engineClass == nullptr) {
+      env->ExceptionClear();
+      return false;
+    }
+    mEngineClass = static_cast<jclass>(env->NewGlobalRef(engineClass));
+    mControlChangeMethod = env->GetStaticMethodID(
+        mEngineClass, "onNativeMidiControlChange", "(II)V");
+    env->DeleteLocalRef(engineClass);
+    if (mControlChangeMethod == nullptr) {
+      env->ExceptionClear();
+    }
+  }
+
+  Connection connection{deviceId, nullptr, {}};
+  if (api.deviceFromJava(env, midiDevice, &connection.device) != AMEDIA_OK) {
+    LOGE("AMidiDevice_fromJava failed for device %d", deviceId);
+    return false;
+  }
+  for (int32_t port = 0; port < numPorts; ++port) {
+    AMidiOutputPort *outputPort = nullptr;
+    if (api.outputPortOpen(connection.device, port, &outputPort) != AMEDIA_OK) {
+      LOGE("Could not open output port %d of device %d", port, deviceId);
+      release(connection);
+      return false;
+    }
+    connection.ports.push_back(outputPort);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mConnections.push_back(std::move(connection));
+  }
+  if (!mReader.joinable()) {
+    mReaderExit.store(false);
+    mReader = std::thread(&MidiInput::readLoop, this);
+  }
+  LOGI("Native MIDI input on device %d (%d ports)", deviceId, numPorts);
+  return true;
+}
+
+void MidiInput::closeDevice(int32_t deviceId) {
+  // Stop the reader so the note state can be reset from here: the closed
+  // device may still be holding keys
+  stopReader();
+  bool remaining;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = std::find_if(
+        mConnections.begin(), mConnections.end(),
+        [deviceId](const Connection &c) { return c.deviceId == deviceId; });
+    if (it != mConnections.end()) {
+      release(*it);
+      mConnections.erase(it);
+    }
+    remaining = !mConnections.empty();
+  }
+  releaseAllNotes(nowNanos());
+  if (remaining) {
+    mReaderExit.store(false);
+    mReader = std::thread(&MidiInput::readLoop, this);
+  }
+}
+
+void MidiInput::closeAll() {
+  stopReader();
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (Connection &connection : mConnections) {
+      release(connection);
+    }
+    mConnections.clear();
+  }
+  releaseAllNotes(nowNanos());
+
+  if (mEngineClass != nullptr && mJavaVM != nullptr) {
+    JNIEnv *env = nullptr;
+    if (mJavaVM->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) ==
+        JNI_OK) {
+      env->DeleteGlobalRef(mEngineClass);
+      mEngineClass = nullptr;
+      mControlChangeMethod = nullptr;
+    }
+  }
+}
+
+void MidiInput::release(Connection &connection) {
+  const AMidiApi &api = amidi();
+  for (AMidiOutputPort *port : connection.ports) {
+    api.outputPortClose(port);
+  }
+  connection.ports.clear();
+  if (connection.device != nullptr) {
+    api.deviceRelease(connection.device);
+    connection.device = nullptr;
+  }
+}
+
+void MidiInput::stopReader() {
+  if (mReader.joinable()) {
+    mReaderExit.store(true);
+    mReader.join();
+  }
+}
+
+// ===== READER THREAD =====
+
+void MidiInput::readLoop() {
+  // AMidi has no blocking receive; a 1 ms poll costs nothing next to the
+  // transport, and the timestamps hide the wake-up jitter anyway
+  if (mJavaVM != nullptr) {
+    mJavaVM->AttachCurrentThread(&mReaderEnv, nullptr);
+  }
+
+  const AMidiApi &api = amidi();
+  uint8_t buffer[MAX_MESSAGE_BYTES];
+  while (!mReaderExit.load()) {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      for (const Connection &connection : mConnections) {
+        for (AMidiOutputPort *port : connection.ports) {
+          int32_t opcode = 0;
+          size_t numBytes = 0;
+          int64_t timestamp = 0;
+          while (api.outputPortReceive(port, &opcode, buffer, sizeof(buffer),
+                                       &numBytes, &timestamp) > 0) {
+            if (opcode == AMIDI_OPCODE_DATA && numBytes > 0) {
+              // Unstamped or future timestamps fall back to "now"
+              int64_t now = nowNanos();
+              parse(buffer, numBytes,
+                    timestamp > 0 && timestamp <= now ? timestamp : now);
+            }
+          }
+        }
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(POLL_INTERVAL_MICROS));
+  }
+
+  if (mJavaVM != nullptr && mReaderEnv != nullptr) {
+    mJavaVM->DetachCurrentThread();
+    mReaderEnv = nullptr;
+  }
+}
+
+void MidiInput::parse(const uint8_t *data, size_t size, int64_t timeNanos) {
+  size_t i = 0;
+  while (i < size) {
+    const int status = data[i];
+    if (status < 0x80 || status >= 0xF0) {
+      // Stray data and system messages (clock, sysex) are skipped
+      ++i;
+      continue;
+    }
+    const int messageType = status & 0xF0;
+    const size_t length =
+        (messageType == 0xC0 || messageType == 0xD0) ? 2 : 3;
+    if (i + length > size) {
+      break;
+    }
+    const int data1 = data[i + 1] & 0x7F;
+    const int data2 = length == 3 ? data[i + 2] & 0x7F : 0;
+
+    switch (messageType) {
+    case 0x90:
+      // Note On with velocity 0 is equivalent to Note Off
+      if (data2 > 0) {
+        handleNoteOn(data1, data2, timeNanos);
+      } else {
+        handleNoteOff(data1, timeNanos);
+      }
+      break;
+    case 0x80:
+      handleNoteOff(data1, timeNanos);
+      break;
+    case 0xB0:
+      handleControlChange(data1, data2, timeNanos);
+      break;
+    default:
+      break; // Pressure, program change and pitch bend are not used yet
+    }
+    i += length;
+  }
+}
+
+void MidiInput::handleNoteOn(int note, int velocity, int64_t timeNanos) {
+  if (mHeld[note]) {
+    return; // Avoid duplicate note-ons
+  }
+  mHeld[note] = true;
+  mEngine.midiNoteOn(note, velocity / 127.0f, timeNanos);
+}
+
+void MidiInput::handleNoteOff(int note, int64_t timeNanos) {
+  if (!mHeld[note]) {
+    return;
+  }
+  mHeld[note] = false;
+  // With the pedal down the note is held until the pedal is released
+  if (mPedalDown) {
+    mSustained[note] = true;
+  } else {
+    mEngine.midiNoteOff(note, timeNanos);
+  }
+}
+
+void MidiInput::handleControlChange(int controller, int value,
+                                    int64_t timeNanos) {
+  if (controller == CC_SUSTAIN_PEDAL) {
+    mPedalDown = value >= SUSTAIN_THRESHOLD;
+    if (!mPedalDown) {
+      for (int note = 0; note < NUM_NOTES; ++note) {
+        if (mSustained[note] && !mHeld[note]) {
+          mEngine.midiNoteOff(note, timeNanos);
+        }
+        mSustained[note] = false;
+      }
+    }
+    return;
+  }
+
+  if (mReaderEnv != nullptr && mControlChangeMethod != nullptr) {
+    mReaderEnv->CallStaticVoidMethod(mEngineClass, mControlChangeMethod,
+                                     controller, value);
+    if (mReaderEnv->ExceptionCheck()) {
+      mReaderEnv->ExceptionClear();
+    }
+  }
+}
+
+void MidiInput::releaseAllNotes(int64_t timeNanos) {
+  for (int note = 0; note < NUM_NOTES; ++note) {
+    if (mHeld[note] || mSustained[note]) {
+      mEngine.midiNoteOff(note, timeNanos);
+    }
+    mHeld[note] = false;
+    mSustained[note] = false;
+  }
+  mPedalDown = false;
+}
+
+} // namespace synthio
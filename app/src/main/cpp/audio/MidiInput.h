@@ -0,0 +1,94 @@
+#ifndef SYNTHIO_MIDI_INPUT_H
+#define SYNTHIO_MIDI_INPUT_H
+
+#include <atomic>
+#include <cstdint>
+#include <jni.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct AMidiDevice;
+struct AMidiOutputPort;
+
+namespace synthio {
+
+class AudioEngine;
+
+/**
+ * Native MIDI input through the NDK AMidi API (Android 10+).
+ *
+ * The Kotlin side still discovers and opens devices through MidiManager,
+ * then hands each MidiDevice to openDevice(). From there the bytes never
+ * touch the JVM: a reader thread polls the output ports, parses notes and
+ * the sustain pedal itself and posts them to the engine stamped with the
+ * MIDI timestamp, so the callback schedules them at the frame they were
+ * played. Other controllers go back to Kotlin through
+ * SynthesizerEngine.onNativeMidiControlChange(), since they drive UI state.
+ *
+ * libamidi is loaded at runtime so the library still loads on older
+ * releases; isAvailable() is false there and the Kotlin path stays in use.
+ * openDevice()/closeDevice()/closeAll() are control-thread calls.
+ */
+class MidiInput {
+public:
+  explicit MidiInput(AudioEngine &engine);
+  ~MidiInput();
+  MidiInput(const MidiInput &) = delete;
+  MidiInput &operator=(const MidiInput &) = delete;
+
+  static bool isAvailable();
+
+  // Opens every output port of a Java MidiDevice that is already open.
+  // Returns false (and opens nothing) if any port fails.
+  bool openDevice(JNIEnv *env, jobject midiDevice, int32_t deviceId,
+                  int32_t numPorts);
+  // Releases the native handles; call before closing the Java device
+  void closeDevice(int32_t deviceId);
+  void closeAll();
+
+private:
+  static constexpr int NUM_NOTES = 128;
+  static constexpr int MAX_MESSAGE_BYTES = 128;
+  static constexpr int POLL_INTERVAL_MICROS = 1000;
+  static constexpr int CC_SUSTAIN_PEDAL = 64;
+  static constexpr int SUSTAIN_THRESHOLD = 64;
+
+  struct Connection {
+    int32_t deviceId;
+    AMidiDevice *device;
+    std::vector<AMidiOutputPort *> ports;
+  };
+
+  void readLoop();
+  void parse(const uint8_t *data, size_t size, int64_t timeNanos);
+  void handleNoteOn(int note, int velocity, int64_t timeNanos);
+  void handleNoteOff(int note, int64_t timeNanos);
+  void handleControlChange(int controller, int value, int64_t timeNanos);
+  void releaseAllNotes(int64_t timeNanos);
+  void stopReader();
+  static void release(Connection &connection);
+
+  AudioEngine &mEngine;
+
+  // Guards mConnections against the reader polling them
+  std::mutex mMutex;
+  std::vector<Connection> mConnections;
+  std::thread mReader;
+  std::atomic<bool> mReaderExit{false};
+
+  // Control-change callback into Kotlin
+  JavaVM *mJavaVM = nullptr;
+  jclass mEngineClass = nullptr; // Global ref
+  jmethodID mControlChangeMethod = nullptr;
+
+  // Reader thread only: key and pedal state
+  bool mHeld[NUM_NOTES] = {};
+  bool mSustained[NUM_NOTES] = {};
+  bool mPedalDown = false;
+  JNIEnv *mReaderEnv = nullptr;
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_MIDI_INPUT_H
@@ -0,0 +1,52 @@
+#ifndef SYNTHIO_NOISE_SOURCE_H
+#define SYNTHIO_NOISE_SOURCE_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace synthio {
+
+/**
+ * White noise for the voices and drums: a 32-bit xorshift generator.
+ *
+ * Four bytes of state instead of std::mt19937's 5 KB, so it sits in the same
+ * cache line as the rest of a voice's per-sample state, and the output is
+ * identical on every standard library. The period (2^32 - 1) is far longer
+ * than any note; the statistical weaknesses of xorshift don't matter for
+ * audio noise.
+ */
+class NoiseSource {
+public:
+  explicit NoiseSource(uint32_t seed = 1) { this->seed(seed); }
+
+  // Restarts the sequence. Seeds are scrambled first, so nearby seeds (voice
+  // i gets seed + i) still give unrelated sequences.
+  void seed(uint32_t seed) {
+    uint32_t x = seed;
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    mState = x != 0 ? x : 0x9E3779B9u; // Zero is xorshift's fixed point
+  }
+
+  // Uniform in [-1, 1)
+  float next() {
+    mState ^= mState << 13;
+    mState ^= mState >> 17;
+    mState ^= mState << 5;
+    // Top 23 bits as the mantissa of a float in [2, 4)
+    const uint32_t bits = (mState >> 9) | 0x40000000u;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value - 3.0f;
+  }
+
+private:
+  uint32_t mState;
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_NOISE_SOURCE_H
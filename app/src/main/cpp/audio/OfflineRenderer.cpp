@@ -0,0 +1,217 @@
+#include "OfflineRenderer.h"
+#include "DSPConfig.h"
+#include "Denormals.h"
+#include <algorithm>
+#include <cmath>
+
+namespace synthio {
+
+OfflineRenderer::OfflineRenderer(float sampleRate) : mSampleRate(sampleRate) {
+  mDrums.setSampleRate(sampleRate);
+}
+
+OfflineRenderer::~OfflineRenderer() { stopDrumWorker(); }
+
+void OfflineRenderer::addLoopTrack(const int16_t *frames, int64_t loopLength,
+                                   float volume) {
+  if (!frames || loopLength <= 0) {
+    return;
+  }
+  mTracks.push_back({frames, loopLength, volume});
+}
+
+void OfflineRenderer::setDrums(const DrumMachine &pattern) {
+  mDrums.copyPatternFrom(pattern);
+  mHasDrums = true;
+}
+
+void OfflineRenderer::start(int64_t numFrames, bool multithreaded) {
+  stopDrumWorker();
+  mNumFrames = std::max<int64_t>(0, numFrames);
+  mMaxTailFrames =
+      mHasDrums ? static_cast<int64_t>(MAX_DRUM_TAIL_SECONDS * mSampleRate) : 0;
+  mPosition = 0;
+  mTailSilent = false;
+  mMultithreaded = multithreaded;
+  mFinished = mNumFrames == 0 || (mTracks.empty() && !mHasDrums);
+
+  mDrumScratch.assign(mHasDrums ? MAX_CHUNK_FRAMES : 0, 0.0f);
+  mMixScratch.assign(MAX_CHUNK_FRAMES * 2, 0.0f);
+
+  if (mHasDrums) {
+    // Bar 1 starts on the downbeat, exactly like LooperStartPlayback's resync
+    mDrums.setEnabled(false);
+    mDrums.setEnabled(true);
+  }
+  if (mMultithreaded && mHasDrums && !mTracks.empty() && !mFinished) {
+    startDrumWorker();
+  }
+}
+
+void OfflineRenderer::startDrumWorker() {
+  mDrumRequest = 0;
+  mDrumResult = 0;
+  mDrumExit = false;
+  mDrumThread = std::thread(&OfflineRenderer::drumLoop, this);
+}
+
+void OfflineRenderer::stopDrumWorker() {
+  if (!mDrumThread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mDrumMutex);
+    mDrumExit = true;
+  }
+  mDrumWake.notify_one();
+  mDrumThread.join();
+}
+
+void OfflineRenderer::drumLoop() {
+  ScopedFlushToZero flushToZero;
+  std::unique_lock<std::mutex> lock(mDrumMutex);
+  while (true) {
+    mDrumWake.wait(lock, [this] { return mDrumExit || mDrumRequest > 0; });
+    if (mDrumExit) {
+      return;
+    }
+    const int count = mDrumRequest;
+    mDrumRequest = 0;
+    lock.unlock();
+    const int done = renderDrums(mDrumScratch.data(), count);
+    lock.lock();
+    mDrumResult = done;
+    mDrumDone.notify_one();
+  }
+}
+
+int OfflineRenderer::renderDrums(float *out, int count) {
+  int done = 0;
+  while (done < count) {
+    int64_t position = mPosition + done;
+    int blockSize = std::min(MAX_BLOCK_SIZE, count - done);
+    if (position < mNumFrames) {
+      blockSize = static_cast<int>(
+          std::min<int64_t>(blockSize, mNumFrames - position));
+    } else if (mDrums.isEnabled()) {
+      mDrums.setEnabled(false); // No new hits after the last bar
+    }
+
+    float *block = out + done;
+    mDrums.processBlock(block, blockSize);
+    done += blockSize;
+
+    // In the tail, stop at the first silent block
+    if (position >= mNumFrames &&
+        blockPeak(block, block, blockSize) < SILENCE_THRESHOLD) {
+      mTailSilent = true;
+      break;
+    }
+  }
+  return done;
+}
+
+void OfflineRenderer::mixTracks(float *interleaved, int64_t begin,
+                                int count) const {
+  for (const auto &track : mTracks) {
+    const float gain = track.volume * LOOP_PLAYBACK_SCALE;
+    int64_t position = begin % track.loopLength;
+    for (int i = 0; i < count; ++i) {
+      interleaved[i * 2] += track.frames[position * 2] * gain;
+      interleaved[i * 2 + 1] += track.frames[position * 2 + 1] * gain;
+      if (++position == track.loopLength) {
+        position = 0;
+      }
+    }
+  }
+}
+
+int OfflineRenderer::renderChunk(float *interleaved, int maxFrames) {
+  if (mFinished) {
+    return 0;
+  }
+
+  int count = static_cast<int>(std::min<int64_t>(
+      std::min(maxFrames, MAX_CHUNK_FRAMES),
+      mNumFrames + mMaxTailFrames - mPosition));
+  if (count <= 0) {
+    mFinished = true;
+    stopDrumWorker();
+    return 0;
+  }
+  std::fill(interleaved, interleaved + count * 2, 0.0f);
+  ScopedFlushToZero flushToZero; // Same FP mode as the live callback
+
+  // Drum stem on a worker while this thread mixes the loop tracks
+  const int trackFrames = static_cast<int>(
+      std::max<int64_t>(0, std::min<int64_t>(count, mNumFrames - mPosition)));
+  int drumFrames = count;
+  const bool drumsOnWorker =
+      mHasDrums && mDrumThread.joinable() && trackFrames > 0;
+  if (drumsOnWorker) {
+    {
+      std::lock_guard<std::mutex> lock(mDrumMutex);
+      mDrumRequest = count;
+      mDrumResult = -1;
+    }
+    mDrumWake.notify_one();
+  } else if (mHasDrums) {
+    drumFrames = renderDrums(mDrumScratch.data(), count);
+  }
+  if (trackFrames > 0) {
+    mixTracks(interleaved, mPosition, trackFrames);
+  }
+  if (drumsOnWorker) {
+    std::unique_lock<std::mutex> lock(mDrumMutex);
+    mDrumDone.wait(lock, [this] { return mDrumResult >= 0; });
+    drumFrames = mDrumResult;
+  }
+
+  if (mHasDrums) {
+    // Loops are exported at unity, so drums keep the live drum/synth balance
+    // relative to them
+    const float drumGain = MIX_DRUM_GAIN / MIX_SYNTH_GAIN;
+    count = drumFrames; // Shorter only when the tail went silent
+    for (int i = 0; i < count; ++i) {
+      float drum = mDrumScratch[i] * drumGain;
+      interleaved[i * 2] += drum;
+      interleaved[i * 2 + 1] += drum;
+    }
+  }
+
+  // Same safety clip as the live output
+  for (int i = 0; i < count * 2; ++i) {
+    interleaved[i] = std::max(-1.0f, std::min(1.0f, interleaved[i]));
+  }
+
+  mPosition += count;
+  if (mPosition >= mNumFrames + mMaxTailFrames || mTailSilent) {
+    mFinished = true;
+    stopDrumWorker();
+  }
+  return count;
+}
+
+int OfflineRenderer::renderChunk(int16_t *interleaved, int maxFrames) {
+  int count = renderChunk(mMixScratch.data(), maxFrames);
+  for (int i = 0; i < count * 2; ++i) {
+    interleaved[i] = toPcm16(mMixScratch[i]);
+  }
+  return count;
+}
+
+std::vector<float> OfflineRenderer::render(int64_t numFrames,
+                                           bool multithreaded) {
+  start(numFrames, multithreaded);
+  std::vector<float> mix;
+  mix.reserve((mNumFrames + mMaxTailFrames) * 2);
+  while (!mFinished) {
+    size_t offset = mix.size();
+    mix.resize(offset + MAX_CHUNK_FRAMES * 2);
+    int count = renderChunk(mix.data() + offset, MAX_CHUNK_FRAMES);
+    mix.resize(offset + count * 2);
+  }
+  return mix;
+}
+
+} // namespace synthio
@@ -0,0 +1,111 @@
+#ifndef SYNTHIO_OFFLINE_RENDERER_H
+#define SYNTHIO_OFFLINE_RENDERER_H
+
+#include "DrumMachine.h"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace synthio {
+
+/**
+ * Faster-than-realtime mixdown for export.
+ *
+ * Owns its own graph (drum machine + loop track sources) and never touches
+ * the Oboe stream, so it can run on any background thread while the live
+ * engine keeps playing. Output is produced in chunks of a caller-chosen
+ * size, so memory stays bounded by the chunk rather than the take length.
+ * Within each chunk the independent stems run in parallel: the stateful
+ * drum sequencer on a worker thread that lives for the whole render, the
+ * loop tracks on the calling thread.
+ *
+ * Output uses the live gain balance between loops and drums. Loop tracks
+ * are recorded after the synth effects, so their tails are already part of
+ * the audio; the drums get a decay tail after the last bar.
+ */
+class OfflineRenderer {
+public:
+  explicit OfflineRenderer(float sampleRate);
+  ~OfflineRenderer();
+  OfflineRenderer(const OfflineRenderer &) = delete;
+  OfflineRenderer &operator=(const OfflineRenderer &) = delete;
+
+  // Loop track stem of interleaved 16-bit stereo frames (the looper's storage
+  // format). The frames are read (not copied) while rendering and must stay
+  // valid until the render finishes; playback wraps at loopLength.
+  void addLoopTrack(const int16_t *frames, int64_t loopLength, float volume);
+
+  // Drum stem: copies the pattern, tempo and levels of the given machine
+  void setDrums(const DrumMachine &pattern);
+
+  // ===== CHUNKED RENDERING =====
+  // Starts a render of numFrames (plus the drum tail). multithreaded = false
+  // keeps every stem on the calling thread.
+  void start(int64_t numFrames, bool multithreaded = true);
+
+  // Renders up to maxFrames (<= MAX_CHUNK_FRAMES) of interleaved stereo.
+  // Returns the number of frames written; 0 once the render is complete.
+  int renderChunk(float *interleaved, int maxFrames);
+  // Same, converted to interleaved 16-bit PCM for the encoders
+  int renderChunk(int16_t *interleaved, int maxFrames);
+
+  bool isFinished() const { return mFinished; }
+  int64_t getFramesRendered() const { return mPosition; }
+
+  // Whole render into one buffer (tests / small renders)
+  std::vector<float> render(int64_t numFrames, bool multithreaded = true);
+
+  static constexpr int MAX_CHUNK_FRAMES = 8192;
+
+private:
+  struct LoopTrackStem {
+    const int16_t *frames;
+    int64_t loopLength;
+    float volume;
+  };
+
+  // Rings out the last hits after the final bar, stopping early once silent
+  static constexpr float MAX_DRUM_TAIL_SECONDS = 2.0f;
+
+  float mSampleRate;
+  std::vector<LoopTrackStem> mTracks;
+  DrumMachine mDrums;
+  bool mHasDrums = false;
+
+  // Render state
+  int64_t mNumFrames = 0;     // Bars to render (tail excluded)
+  int64_t mMaxTailFrames = 0;
+  int64_t mPosition = 0;      // Frames produced so far
+  bool mMultithreaded = true;
+  bool mFinished = true;
+  bool mTailSilent = false;   // Drums decayed before the tail limit
+
+  // Per-chunk scratch (heap, sized once: chunks are too big for the stack)
+  std::vector<float> mDrumScratch;
+  std::vector<float> mMixScratch;
+
+  // Drum worker, started by start() for multithreaded renders with both
+  // stems. renderChunk() posts a chunk's frame count and collects the
+  // result after mixing the tracks.
+  std::thread mDrumThread;
+  std::mutex mDrumMutex;
+  std::condition_variable mDrumWake; // Worker: a chunk or exit
+  std::condition_variable mDrumDone; // Renderer: the chunk's drums are in
+  int mDrumRequest = 0; // Frames to render, 0 = idle
+  int mDrumResult = 0;  // Frames rendered, -1 while pending
+  bool mDrumExit = false;
+  void startDrumWorker();
+  void stopDrumWorker();
+  void drumLoop();
+
+  // Renders up to count drum frames starting at mPosition. Returns the
+  // frames rendered, fewer only once the tail has decayed to silence.
+  int renderDrums(float *out, int count);
+  void mixTracks(float *interleaved, int64_t begin, int count) const;
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_OFFLINE_RENDERER_H
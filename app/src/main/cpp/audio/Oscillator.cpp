@@ -1,4 +1,5 @@
 #include "Oscillator.h"
+#include "FastMath.h"
 #include <algorithm>
 
 namespace synthio {
@@ -39,7 +40,46 @@ void Oscillator::updatePhaseIncrement() {
 
 void Oscillator::reset() { mPhase = 0.0f; }
 
+int Oscillator::getWaveformMask() const {
+  int mask = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (mEnabledWaveforms[i]) {
+      mask |= 1 << i;
+    }
+  }
+  return mask;
+}
+
+const Wavetable *Oscillator::activeWavetable(const float *pulseWidths,
+                                             int numFrames) const {
+  if (!mUseWavetable) {
+    return nullptr;
+  }
+  // Tables are baked at 50% duty cycle
+  if (mEnabledWaveforms[static_cast<int>(Waveform::SQUARE)]) {
+    if (pulseWidths) {
+      for (int i = 0; i < numFrames; ++i) {
+        if (std::max(0.01f, std::min(0.99f, pulseWidths[i])) != 0.5f) {
+          return nullptr;
+        }
+      }
+    } else if (mPulseWidth != 0.5f) {
+      return nullptr;
+    }
+  }
+  return WavetableBank::get(getWaveformMask());
+}
+
 float Oscillator::nextSample() {
+  if (const Wavetable *table = activeWavetable(nullptr, 0)) {
+    float sample = table->lookup(mPhase, mPhaseIncrement);
+    mPhase += mPhaseIncrement;
+    if (mPhase >= 1.0f) {
+      mPhase -= 1.0f;
+    }
+    return sample;
+  }
+
   float sample = 0.0f;
 
   // Sum active waveforms
@@ -76,7 +116,7 @@ float Oscillator::nextSample() {
     // Industry standard "analog" behavior. Instead of hard clipping at 1.0,
     // we saturate using tanh function. This adds pleasant harmonics when driven
     // hot.
-    sample = std::tanh(sample * 1.1f); // Mild drive
+    sample = fastTanh(sample * 1.1f); // Mild drive
   }
 
   // Advance phase
@@ -88,7 +128,72 @@ float Oscillator::nextSample() {
   return sample;
 }
 
-float Oscillator::generateSine() { return std::sin(mPhase * TWO_PI); }
+void Oscillator::processBlock(float *out, const float *frequencies,
+                              const float *pulseWidths, int numFrames) {
+  // One table read per sample covers every layered waveform and its tanh
+  if (const Wavetable *table = activeWavetable(pulseWidths, numFrames)) {
+    for (int i = 0; i < numFrames; ++i) {
+      if (frequencies) {
+        mFrequency = frequencies[i];
+        mPhaseIncrement = mFrequency / mSampleRate;
+      }
+      out[i] = table->lookup(mPhase, mPhaseIncrement);
+      mPhase += mPhaseIncrement;
+      if (mPhase >= 1.0f) {
+        mPhase -= 1.0f;
+      }
+    }
+    if (pulseWidths && numFrames > 0) {
+      mPulseWidth = std::max(0.01f, std::min(0.99f, pulseWidths[numFrames - 1]));
+    }
+    return;
+  }
+
+  // Waveform selection can't change mid-block, so resolve it (and the layer
+  // normalization) once instead of per sample
+  const bool sine = mEnabledWaveforms[static_cast<int>(Waveform::SINE)];
+  const bool square = mEnabledWaveforms[static_cast<int>(Waveform::SQUARE)];
+  const bool saw = mEnabledWaveforms[static_cast<int>(Waveform::SAWTOOTH)];
+  const bool triangle = mEnabledWaveforms[static_cast<int>(Waveform::TRIANGLE)];
+  const int activeCount = sine + square + saw + triangle;
+  const float layerGain =
+      activeCount > 1 ? 1.1f / std::sqrt(static_cast<float>(activeCount))
+                      : 1.0f;
+
+  for (int i = 0; i < numFrames; ++i) {
+    if (frequencies) {
+      mFrequency = frequencies[i];
+      mPhaseIncrement = mFrequency / mSampleRate;
+    }
+    if (pulseWidths) {
+      mPulseWidth = std::max(0.01f, std::min(0.99f, pulseWidths[i]));
+    }
+
+    float sample = 0.0f;
+    if (sine)
+      sample += generateSine();
+    if (square)
+      sample += generateSquare();
+    if (saw)
+      sample += generateSawtooth();
+    if (triangle)
+      sample += generateTriangle();
+
+    // Same gain staging as nextSample(): 1/sqrt(N) plus mild tanh drive
+    if (activeCount > 1) {
+      sample = fastTanh(sample * layerGain);
+    }
+
+    mPhase += mPhaseIncrement;
+    if (mPhase >= 1.0f) {
+      mPhase -= 1.0f;
+    }
+
+    out[i] = sample;
+  }
+}
+
+float Oscillator::generateSine() { return sinTwoPi(mPhase); }
 
 float Oscillator::generateSquare() {
   float sample = (mPhase < mPulseWidth) ? 1.0f : -1.0f;
@@ -2,6 +2,7 @@
 #define SYNTHIO_OSCILLATOR_H
 
 #define _USE_MATH_DEFINES
+#include "Wavetable.h"
 #include <cmath>
 #include <cstdint>
 
@@ -23,10 +24,30 @@ public:
   void setWaveformEnabled(Waveform waveform, bool enabled);
   void setPulseWidth(float pulseWidth); // 0.0 to 1.0
 
+  // Band-limited wavetable mode (default on). While the current
+  // combination's table isn't built yet, or square runs at a pulse width
+  // other than 50% (PWM can't be baked into a fixed table), the oscillator
+  // uses its polyBLEP generators instead.
+  void setWavetableEnabled(bool enabled) { mUseWavetable = enabled; }
+  int getWaveformMask() const;
+  // Table to use for a block (nullptr = polyBLEP path). pulseWidths is the
+  // optional per-frame PW array passed to processBlock.
+  const Wavetable *activeWavetable(const float *pulseWidths,
+                                   int numFrames) const;
+
   float nextSample();
   void reset();
+  void setPhase(float phase) { mPhase = phase - std::floor(phase); } // 0 to 1
+
+  // Block processing: writes numFrames samples to out. frequencies and
+  // pulseWidths are optional per-frame modulation arrays (nullptr = keep the
+  // current value).
+  void processBlock(float *out, const float *frequencies,
+                    const float *pulseWidths, int numFrames);
 
 private:
+  friend class VoiceBank; // Runs the vectorized kernel on this state
+
   float mPhase = 0.0f;
   float mPhaseIncrement = 0.0f;
   float mFrequency = 440.0f;
@@ -36,6 +57,7 @@ private:
   // Waveform state
   bool mEnabledWaveforms[4] = {true, false, false,
                                false}; // Default to SINE only
+  bool mUseWavetable = true;
 
   void updatePhaseIncrement();
 
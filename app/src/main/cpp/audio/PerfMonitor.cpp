@@ -0,0 +1,60 @@
+#include "PerfMonitor.h"
+#include <algorithm>
+
+namespace synthio {
+
+void PerfMonitor::beginCallback(int64_t startNanos, int numFrames,
+                                int sampleRate) {
+  mCallbackStart = startNanos;
+  mBudgetNanos = sampleRate > 0
+                     ? static_cast<int64_t>(numFrames) * 1000000000LL / sampleRate
+                     : 0;
+  std::fill(mStageNanos, mStageNanos + PERF_STAGE_COUNT, 0);
+}
+
+float PerfMonitor::endCallback(int activeVoices, int voiceLimit,
+                               int32_t streamXRuns) {
+  if (mResetRequested.exchange(false, std::memory_order_relaxed)) {
+    mStats = PerfSnapshot{};
+  }
+
+  const float durationMicros = (now() - mCallbackStart) / 1000.0f;
+  const float budgetMicros = mBudgetNanos / 1000.0f;
+  const float load =
+      budgetMicros > 0.0f ? durationMicros / budgetMicros * 100.0f : 0.0f;
+
+  // The first callback seeds the averages instead of ramping up from zero
+  const float smoothing = mStats.callbacks == 0 ? 1.0f : AVERAGE_SMOOTHING;
+  mStats.callbacks++;
+  mStats.activeVoices = activeVoices;
+  mStats.voiceLimit = voiceLimit;
+  mStats.budgetMicros = budgetMicros;
+  mStats.lastLoad = load;
+  mStats.averageLoad += smoothing * (load - mStats.averageLoad);
+  mStats.peakLoad = std::max(mStats.peakLoad, load);
+  mStats.averageCallbackMicros +=
+      smoothing * (durationMicros - mStats.averageCallbackMicros);
+  mStats.maxCallbackMicros = std::max(mStats.maxCallbackMicros, durationMicros);
+  for (int stage = 0; stage < PERF_STAGE_COUNT; ++stage) {
+    mStats.stageMicros[stage] +=
+        smoothing * (mStageNanos[stage] / 1000.0f - mStats.stageMicros[stage]);
+  }
+
+  int bucket = std::min(PERF_HISTOGRAM_BUCKETS - 1, static_cast<int>(load / 10.0f));
+  mStats.loadHistogram[bucket]++;
+
+  // The stream count restarts when the stream is reopened
+  if (streamXRuns >= 0) {
+    if (mLastStreamXRuns >= 0 && streamXRuns >= mLastStreamXRuns) {
+      mStats.xruns += streamXRuns - mLastStreamXRuns;
+    } else if (mLastStreamXRuns >= 0) {
+      mStats.xruns += streamXRuns;
+    }
+    mLastStreamXRuns = streamXRuns;
+  }
+
+  mPublished.store(mStats);
+  return load;
+}
+
+} // namespace synthio
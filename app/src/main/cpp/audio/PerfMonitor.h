@@ -0,0 +1,97 @@
+#ifndef SYNTHIO_PERF_MONITOR_H
+#define SYNTHIO_PERF_MONITOR_H
+
+#include "SeqLock.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace synthio {
+
+// Render stages timed inside the callback
+enum PerfStage : int {
+  PERF_STAGE_POLYPHONY = 0, // Synth voices + chorus, or the Wurlitzer engine
+  PERF_STAGE_EFFECTS,       // Synth tremolo/delay/reverb, bass boost, volume
+  PERF_STAGE_LOOPER,
+  PERF_STAGE_DRUMS, // Drum machine + metronome (may run on a worker)
+  PERF_STAGE_COUNT
+};
+
+// Callback load buckets, each 10% of the burst budget wide; the last one
+// collects every callback that overran the budget
+constexpr int PERF_HISTOGRAM_BUCKETS = 11;
+
+struct PerfSnapshot {
+  uint64_t callbacks = 0;
+  int32_t xruns = 0; // Underruns reported by the stream since reset
+  int32_t activeVoices = 0;
+  int32_t voiceLimit = 0;    // Effective limit, after the CPU governor
+  float budgetMicros = 0.0f; // Duration of the last burst
+  float lastLoad = 0.0f;     // Percent of the burst budget
+  float averageLoad = 0.0f;
+  float peakLoad = 0.0f;
+  float averageCallbackMicros = 0.0f;
+  float maxCallbackMicros = 0.0f;
+  float stageMicros[PERF_STAGE_COUNT] = {}; // Smoothed, per callback
+  uint32_t loadHistogram[PERF_HISTOGRAM_BUCKETS] = {};
+  // Audio-thread safety since startup, filled in by AudioEngine (see
+  // RtCheck.h; the first two stay 0 unless built with SYNTHIO_RT_CHECKS)
+  uint64_t rtAllocations = 0;
+  uint64_t rtLocks = 0;
+  uint64_t rtLogDropped = 0; // RT_LOG messages lost to a full queue
+};
+
+/**
+ * Lock-free callback telemetry.
+ *
+ * The audio thread brackets each callback with beginCallback() /
+ * endCallback() and charges stage times in between; at the end of every
+ * callback the figures are published through a SeqLock, so any thread can
+ * read a consistent snapshot without ever blocking the callback. Maxima and
+ * the histogram accumulate until reset(); averages are smoothed over
+ * roughly half a second.
+ */
+class PerfMonitor {
+public:
+  static int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  // ===== AUDIO THREAD =====
+  void beginCallback(int64_t startNanos, int numFrames, int sampleRate);
+  // Charges the time since stageStart to stage and returns the current time,
+  // ready to start the next stage. The drum stage may be charged from a
+  // worker as long as the callback waits for it before endCallback().
+  int64_t endStage(PerfStage stage, int64_t stageStart) {
+    int64_t time = now();
+    mStageNanos[stage] += time - stageStart;
+    return time;
+  }
+  // streamXRuns: the stream's cumulative underrun count, or -1 if unknown.
+  // Returns this callback's load in percent of the burst budget.
+  float endCallback(int activeVoices, int voiceLimit, int32_t streamXRuns);
+
+  // ===== ANY THREAD =====
+  PerfSnapshot snapshot() const { return mPublished.load(); }
+  // Clears maxima, counters and the histogram at the next callback
+  void reset() { mResetRequested.store(true, std::memory_order_relaxed); }
+
+private:
+  static constexpr float AVERAGE_SMOOTHING = 0.01f;
+
+  // Audio thread
+  PerfSnapshot mStats;
+  int64_t mCallbackStart = 0;
+  int64_t mBudgetNanos = 0;
+  int64_t mStageNanos[PERF_STAGE_COUNT] = {};
+  int32_t mLastStreamXRuns = -1;
+
+  SeqLock<PerfSnapshot> mPublished;
+  std::atomic<bool> mResetRequested{false};
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_PERF_MONITOR_H
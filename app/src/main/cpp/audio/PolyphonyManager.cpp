@@ -1,10 +1,14 @@
 #include "PolyphonyManager.h"
+#include "DSPConfig.h"
+#include "FastMath.h"
 #include <algorithm>
 #include <cmath>
 
 namespace synthio {
 
 PolyphonyManager::PolyphonyManager() {
+  Voice::computeStackRatios(mUnisonVoices, mUnisonDetune, mStackRatios);
+  updateVoiceCoefficients();
   for (auto &voice : mVoices) {
     applyParamsToVoice(voice);
   }
@@ -15,15 +19,18 @@ PolyphonyManager::PolyphonyManager() {
 }
 
 void PolyphonyManager::setSampleRate(float sampleRate) {
+  mSampleRate = sampleRate;
+  updateVoiceCoefficients();
   for (auto &voice : mVoices) {
     voice.setSampleRate(sampleRate);
   }
   mLFO.setSampleRate(sampleRate);
   mChorus.setSampleRate(sampleRate);
+  mAutoGain.setRampTime(AUTO_GAIN_RAMP_TIME, sampleRate);
 }
 
 void PolyphonyManager::noteOn(int midiNote, float frequency) {
-  if (mUnisonEnabled) {
+  if (isVoiceUnison()) {
     noteOnUnison(midiNote, frequency);
     return;
   }
@@ -31,7 +38,8 @@ void PolyphonyManager::noteOn(int midiNote, float frequency) {
   // First check if this note is already playing, if so, retrigger it
   int existingVoice = findVoiceWithNote(midiNote);
   if (existingVoice >= 0) {
-    mVoices[existingVoice].noteOn(midiNote, frequency);
+    applyUnisonStack(mVoices[existingVoice]);
+    triggerVoice(existingVoice, midiNote, frequency);
     mVoiceAge[existingVoice] = ++mAgeCounter;
     return;
   }
@@ -39,18 +47,19 @@ void PolyphonyManager::noteOn(int midiNote, float frequency) {
   // Find a free voice
   int voiceIndex = findFreeVoice();
   if (voiceIndex < 0) {
-    // No free voice, steal the oldest one
-    voiceIndex = stealOldestVoice();
+    // At the voice limit: take over a releasing, old or quiet voice
+    voiceIndex = stealVoice();
   }
 
   applyParamsToVoice(mVoices[voiceIndex]);
-  mVoices[voiceIndex].setDetune(0.0f); // No detune in normal mode
-  mVoices[voiceIndex].noteOn(midiNote, frequency);
+  mVoices[voiceIndex].setDetune(0.0f); // Stacks detune inside the voice
+  applyUnisonStack(mVoices[voiceIndex]);
+  triggerVoice(voiceIndex, midiNote, frequency);
   mVoiceAge[voiceIndex] = ++mAgeCounter;
 }
 
 void PolyphonyManager::noteOff(int midiNote) {
-  if (mUnisonEnabled) {
+  if (isVoiceUnison()) {
     noteOffUnison(midiNote);
     return;
   }
@@ -79,9 +88,9 @@ void PolyphonyManager::allNotesOff() {
 void PolyphonyManager::setWaveform(Waveform waveform) {
   // Exclusive mode logic for legacy support
   for (int i = 0; i < 4; ++i) {
-    mEnabledWaveforms[i] = false;
+    mVoicePatch.waveforms[i] = false;
   }
-  mEnabledWaveforms[static_cast<int>(waveform)] = true;
+  mVoicePatch.waveforms[static_cast<int>(waveform)] = true;
 
   for (auto &voice : mVoices) {
     voice.setWaveform(waveform); // Use voice's exclusive setter
@@ -89,28 +98,41 @@ void PolyphonyManager::setWaveform(Waveform waveform) {
 }
 
 void PolyphonyManager::setWaveformEnabled(Waveform waveform, bool enabled) {
-  mEnabledWaveforms[static_cast<int>(waveform)] = enabled;
+  mVoicePatch.waveforms[static_cast<int>(waveform)] = enabled;
   for (auto &voice : mVoices) {
     voice.setWaveformEnabled(waveform, enabled);
   }
 }
 
 void PolyphonyManager::setPulseWidth(float width) {
-  mPulseWidth = width;
+  mVoicePatch.pulseWidth = width;
   for (auto &voice : mVoices) {
     voice.setPulseWidth(width);
   }
 }
 
+void PolyphonyManager::setWavetableEnabled(bool enabled) {
+  for (auto &voice : mVoices) {
+    voice.setWavetableEnabled(enabled);
+  }
+}
+
+void PolyphonyManager::setFilterQuality(int controlInterval,
+                                        bool oversampling) {
+  for (auto &voice : mVoices) {
+    voice.setFilterQuality(controlInterval, oversampling);
+  }
+}
+
 void PolyphonyManager::setSubOscLevel(float level) {
-  mSubOscLevel = level;
+  mVoicePatch.subOscLevel = level;
   for (auto &voice : mVoices) {
     voice.setSubOscLevel(level);
   }
 }
 
 void PolyphonyManager::setNoiseLevel(float level) {
-  mNoiseLevel = level;
+  mVoicePatch.noiseLevel = level;
   for (auto &voice : mVoices) {
     voice.setNoiseLevel(level);
   }
@@ -118,35 +140,36 @@ void PolyphonyManager::setNoiseLevel(float level) {
 
 // ===== FILTER PARAMETERS =====
 void PolyphonyManager::setFilterCutoff(float cutoffHz) {
-  mFilterCutoff = cutoffHz;
+  mVoicePatch.filterCutoff = cutoffHz;
   for (auto &voice : mVoices) {
     voice.setFilterCutoff(cutoffHz);
   }
 }
 
 void PolyphonyManager::setFilterResonance(float resonance) {
-  mFilterResonance = resonance;
+  mVoicePatch.filterResonance = resonance;
   for (auto &voice : mVoices) {
     voice.setFilterResonance(resonance);
   }
 }
 
 void PolyphonyManager::setFilterEnvelopeAmount(float amount) {
-  mFilterEnvAmount = amount;
+  mVoicePatch.filterEnvAmount = amount;
   for (auto &voice : mVoices) {
     voice.setFilterEnvelopeAmount(amount);
   }
 }
 
 void PolyphonyManager::setFilterKeyTracking(float amount) {
-  mFilterKeyTracking = amount;
+  mVoicePatch.filterKeyTracking = amount;
   for (auto &voice : mVoices) {
     voice.setFilterKeyTracking(amount);
   }
 }
 
 void PolyphonyManager::setHPFCutoff(float cutoffHz) {
-  mHPFCutoff = cutoffHz;
+  mVoicePatch.hpfCutoff = cutoffHz;
+  updateVoiceCoefficients();
   for (auto &voice : mVoices) {
     voice.setHPFCutoff(cutoffHz);
   }
@@ -154,28 +177,31 @@ void PolyphonyManager::setHPFCutoff(float cutoffHz) {
 
 // ===== ENVELOPE (ADSR) =====
 void PolyphonyManager::setAttack(float time) {
-  mAttack = time;
+  mVoicePatch.attack = time;
+  updateVoiceCoefficients();
   for (auto &voice : mVoices) {
     voice.setAttack(time);
   }
 }
 
 void PolyphonyManager::setDecay(float time) {
-  mDecay = time;
+  mVoicePatch.decay = time;
+  updateVoiceCoefficients();
   for (auto &voice : mVoices) {
     voice.setDecay(time);
   }
 }
 
 void PolyphonyManager::setSustain(float level) {
-  mSustain = level;
+  mVoicePatch.sustain = level;
   for (auto &voice : mVoices) {
     voice.setSustain(level);
   }
 }
 
 void PolyphonyManager::setRelease(float time) {
-  mRelease = time;
+  mVoicePatch.release = time;
+  updateVoiceCoefficients();
   for (auto &voice : mVoices) {
     voice.setRelease(time);
   }
@@ -201,14 +227,15 @@ void PolyphonyManager::setChorusMode(int mode) {
 
 // ===== GLIDE/PORTAMENTO =====
 void PolyphonyManager::setGlideTime(float time) {
-  mGlideTime = time;
+  mVoicePatch.glideTime = time;
+  updateVoiceCoefficients();
   for (auto &voice : mVoices) {
     voice.setGlideTime(time);
   }
 }
 
 void PolyphonyManager::setGlideEnabled(bool enabled) {
-  mGlideEnabled = enabled;
+  mVoicePatch.glideEnabled = enabled;
   for (auto &voice : mVoices) {
     voice.setGlideEnabled(enabled);
   }
@@ -224,21 +251,92 @@ void PolyphonyManager::setUnisonEnabled(bool enabled) {
 }
 
 void PolyphonyManager::setUnisonVoices(int count) {
-  mUnisonVoices = std::max(1, std::min(8, count));
+  mUnisonVoices = std::max(1, std::min(MAX_UNISON_STACK, count));
+  Voice::computeStackRatios(mUnisonVoices, mUnisonDetune, mStackRatios);
+  updateUnisonStacks();
 }
 
 void PolyphonyManager::setUnisonDetune(float cents) {
   mUnisonDetune = std::max(0.0f, std::min(50.0f, cents));
+  Voice::computeStackRatios(mUnisonVoices, mUnisonDetune, mStackRatios);
+  updateUnisonStacks();
+}
+
+void PolyphonyManager::setStackedUnisonEnabled(bool enabled) {
+  if (mStackedUnison != enabled && mUnisonEnabled) {
+    // Notes can't move between the two layouts
+    allNotesOff();
+  }
+  mStackedUnison = enabled;
+}
+
+void PolyphonyManager::applyUnisonStack(Voice &voice) {
+  static const float unity = 1.0f;
+  const int count = unisonStackSize();
+  voice.setUnisonStack(count, count > 1 ? mStackRatios : &unity);
+}
+
+void PolyphonyManager::updateUnisonStacks() {
+  // Stacked notes follow voice count and spread while they sound
+  if (!mUnisonEnabled || !mStackedUnison) {
+    return;
+  }
+  for (int n = 0; n < mNumActiveVoices; ++n) {
+    mVoices[mActiveVoices[n]].setUnisonStack(mUnisonVoices, mStackRatios);
+  }
 }
 
 void PolyphonyManager::setMasterGain(float gain) {
   mMasterGain = std::max(0.0f, std::min(1.0f, gain));
 }
 
+// ===== PATCHES =====
+void PolyphonyManager::applyPatch(const SynthPatch &patch,
+                                  const VoiceCoefficients &coefficients) {
+  mVoicePatch = patch.voice;
+  if (coefficients.sampleRate == mSampleRate) {
+    mVoiceCoefficients = coefficients;
+  } else {
+    updateVoiceCoefficients();
+  }
+  for (auto &voice : mVoices) {
+    voice.applyPatch(mVoicePatch, mVoiceCoefficients);
+  }
+
+  mLFO.setRate(patch.lfoRate);
+  mLFO.setPitchDepth(patch.lfoPitchDepth);
+  mLFO.setFilterDepth(patch.lfoFilterDepth);
+  mLFO.setPWMDepth(patch.lfoPWMDepth);
+  mChorus.setMode(static_cast<Chorus::Mode>(patch.chorusMode));
+
+  setUnisonEnabled(patch.unisonEnabled);
+  setUnisonVoices(patch.unisonVoices);
+  setUnisonDetune(patch.unisonDetune);
+}
+
+// ===== VOICE LIMITS =====
+void PolyphonyManager::setPolyphony(int count) {
+  mPolyphony = std::max(1, std::min(MAX_POLYPHONY, count));
+  shedExcessVoices();
+}
+
+void PolyphonyManager::setVoiceBudget(int budget, bool underPressure) {
+  mUnderPressure = underPressure;
+  budget = std::max(1, std::min(MAX_POLYPHONY, budget));
+  if (budget == mVoiceBudget) {
+    return;
+  }
+  bool shrinking = budget < mVoiceBudget;
+  mVoiceBudget = budget;
+  if (shrinking) {
+    shedExcessVoices();
+  }
+}
+
 // ===== UNISON HELPERS =====
 void PolyphonyManager::noteOnUnison(int midiNote, float frequency) {
   // Find how many voices we can allocate for this note
-  int voicesToUse = std::min(mUnisonVoices, MAX_POLYPHONY);
+  int voicesToUse = std::min(mUnisonVoices, getVoiceLimit());
 
   // First, check if this note is already playing in unison
   for (int i = 0; i < MAX_POLYPHONY; ++i) {
@@ -246,7 +344,7 @@ void PolyphonyManager::noteOnUnison(int midiNote, float frequency) {
       // Retrigger existing unison voices for this note
       for (int j = 0; j < MAX_POLYPHONY; ++j) {
         if (mVoices[j].getMidiNote() == midiNote) {
-          mVoices[j].noteOn(midiNote, frequency);
+          triggerVoice(j, midiNote, frequency);
           mVoiceAge[j] = ++mAgeCounter;
         }
       }
@@ -254,21 +352,25 @@ void PolyphonyManager::noteOnUnison(int midiNote, float frequency) {
     }
   }
 
-  // Allocate new voices for unison
+  // Allocate new voices for unison, never stealing back the ones just
+  // stacked for this note
+  bool stacked[MAX_POLYPHONY] = {false};
   int allocatedCount = 0;
   for (int v = 0; v < voicesToUse; ++v) {
     int voiceIndex = findFreeVoice();
     if (voiceIndex < 0) {
-      voiceIndex = stealOldestVoice();
+      voiceIndex = stealVoice(stacked);
     }
+    stacked[voiceIndex] = true;
 
     applyParamsToVoice(mVoices[voiceIndex]);
+    applyUnisonStack(mVoices[voiceIndex]); // A single copy here
 
     // Apply detune spread
     float detune = calculateUnisonDetune(v, voicesToUse);
     mVoices[voiceIndex].setDetune(detune);
 
-    mVoices[voiceIndex].noteOn(midiNote, frequency);
+    triggerVoice(voiceIndex, midiNote, frequency);
     mVoiceAge[voiceIndex] = ++mAgeCounter;
     mUnisonNoteVoices[voiceIndex] = midiNote;
     allocatedCount++;
@@ -300,30 +402,74 @@ float PolyphonyManager::calculateUnisonDetune(int voiceIndex, int totalVoices) {
 // ===== AUDIO PROCESSING =====
 void PolyphonyManager::applyLFOToVoices() {
   // Get LFO modulation values
-  float pitchMod = mLFO.getPitchMod();
+  float pitchRatio = nextPitchRatio(mLFO.getPitchMod());
   float filterMod = mLFO.getFilterMod();
   float pwmMod = mLFO.getPWMMod();
 
   // Apply to all active voices
-  for (auto &voice : mVoices) {
-    if (voice.isActive()) {
-      voice.applyLFOPitchMod(pitchMod);
-      voice.applyLFOFilterMod(filterMod);
-      voice.applyLFOPWMMod(pwmMod);
-    }
+  for (int n = 0; n < mNumActiveVoices; ++n) {
+    Voice &voice = mVoices[mActiveVoices[n]];
+    voice.applyLFOPitchRatio(pitchRatio);
+    voice.applyLFOFilterMod(filterMod);
+    voice.applyLFOPWMMod(pwmMod);
+  }
+}
+
+float PolyphonyManager::nextPitchRatio(float lfoPitchSemitones) {
+  if (mPitchCountdown <= 0) {
+    // Head for the current LFO value over the next segment (one segment of
+    // lag, ~0.3 ms at 48 kHz)
+    float target = fastExp2(lfoPitchSemitones / 12.0f);
+    mPitchRatioStep =
+        (target - mPitchRatio) / static_cast<float>(PITCH_CONTROL_INTERVAL);
+    mPitchCountdown = PITCH_CONTROL_INTERVAL;
+  }
+  mPitchCountdown--;
+  mPitchRatio += mPitchRatioStep;
+  return mPitchRatio;
+}
+
+void PolyphonyManager::buildPitchRatio(const float *lfoPitch,
+                                       float *pitchRatio, int numFrames) {
+  for (int i = 0; i < numFrames; ++i) {
+    pitchRatio[i] = nextPitchRatio(lfoPitch[i]);
   }
 }
 
 int PolyphonyManager::countActiveVoices() {
   int count = 0;
-  for (const auto &voice : mVoices) {
-    if (voice.isActive()) {
+  for (int n = 0; n < mNumActiveVoices; ++n) {
+    if (mVoices[mActiveVoices[n]].isActive()) {
       count++;
     }
   }
   return count;
 }
 
+void PolyphonyManager::triggerVoice(int voiceIndex, int midiNote,
+                                    float frequency) {
+  mVoices[voiceIndex].noteOn(midiNote, frequency);
+  if (!mVoiceListed[voiceIndex]) {
+    mVoiceListed[voiceIndex] = true;
+    mActiveVoices[mNumActiveVoices++] = voiceIndex;
+  }
+}
+
+void PolyphonyManager::pruneIdleVoices() {
+  // Order-preserving compaction, so the render order (and the voice bank's
+  // lane grouping) stays stable while voices come and go
+  int kept = 0;
+  for (int n = 0; n < mNumActiveVoices; ++n) {
+    int index = mActiveVoices[n];
+    if (mVoices[index].isActive()) {
+      mActiveVoices[kept++] = index;
+    } else {
+      mVoiceListed[index] = false;
+    }
+  }
+  mNumActiveVoices = kept;
+}
+
 void PolyphonyManager::nextSample(float &outLeft, float &outRight) {
   // Advance LFO and apply modulation
   mLFO.tick();
@@ -333,12 +479,14 @@ void PolyphonyManager::nextSample(float &outLeft, float &outRight) {
   float sum = 0.0f;
   int activeCount = 0;
 
-  for (auto &voice : mVoices) {
+  for (int n = 0; n < mNumActiveVoices; ++n) {
+    Voice &voice = mVoices[mActiveVoices[n]];
     if (voice.isActive()) {
       sum += voice.nextSample();
       activeCount++;
     }
   }
+  pruneIdleVoices();
 
   // Calculate target auto-gain based on active voice count
   float targetAutoGain = 1.0f;
@@ -347,11 +495,10 @@ void PolyphonyManager::nextSample(float &outLeft, float &outRight) {
   }
 
   // Smooth the auto-gain
-  mCurrentAutoGain = mCurrentAutoGain * mAutoGainSmoothing +
-                     targetAutoGain * (1.0f - mAutoGainSmoothing);
+  mAutoGain.setTarget(targetAutoGain);
 
   // Apply gains
-  sum *= mCurrentAutoGain * mMasterGain;
+  sum *= mAutoGain.nextValue() * mMasterGain;
 
   // Apply soft limiter
   sum = softLimit(sum);
@@ -360,6 +507,94 @@ void PolyphonyManager::nextSample(float &outLeft, float &outRight) {
   mChorus.process(sum, outLeft, outRight);
 }
 
+void PolyphonyManager::processBlock(float *left, float *right,
+                                    int numFrames) {
+  float lfoPitch[MAX_BLOCK_SIZE];
+  float pitchRatio[MAX_BLOCK_SIZE];
+  float lfoFilter[MAX_BLOCK_SIZE];
+  float lfoPWM[MAX_BLOCK_SIZE];
+  float mono[MAX_BLOCK_SIZE];
+
+  // Render the LFO once for the block; every voice reads the same values
+  mLFO.processBlock(lfoPitch, lfoFilter, lfoPWM, numFrames);
+  buildPitchRatio(lfoPitch, pitchRatio, numFrames);
+
+  std::fill(mono, mono + numFrames, 0.0f);
+  int activeCount = 0;
+  if (mWorkerPool && mWorkerPool->isParallel() &&
+      mNumActiveVoices >= MIN_PARALLEL_VOICES) {
+    // The worker takes the larger half, in whole SIMD groups, since this
+    // thread still has the chorus and effects after the voices
+    int groups = (mNumActiveVoices + VoiceBank::LANES - 1) / VoiceBank::LANES;
+    int split = std::min(mNumActiveVoices, (groups / 2) * VoiceBank::LANES);
+    if (!mUseVoiceBank) {
+      split = mNumActiveVoices / 2;
+    }
+
+    float workerMono[MAX_BLOCK_SIZE];
+    std::fill(workerMono, workerMono + numFrames, 0.0f);
+    VoiceJob job{this, &mWorkerVoiceBank, mActiveVoices + split,
+                 mNumActiveVoices - split, workerMono, pitchRatio,
+                 lfoFilter, lfoPWM, numFrames, 0};
+    int handle = mWorkerPool->submit(&renderVoiceJob, &job);
+    activeCount = renderVoices(mVoiceBank, mActiveVoices, split, mono,
+                               pitchRatio, lfoFilter, lfoPWM, numFrames);
+    mWorkerPool->wait(handle);
+
+    activeCount += job.activeCount;
+    for (int i = 0; i < numFrames; ++i) {
+      mono[i] += workerMono[i];
+    }
+  } else {
+    activeCount = renderVoices(mVoiceBank, mActiveVoices, mNumActiveVoices,
+                               mono, pitchRatio, lfoFilter, lfoPWM, numFrames);
+  }
+  pruneIdleVoices();
+
+  // Auto-gain target is taken from the voices active at the block start;
+  // the ramp hides any voice ending mid-block
+  float targetAutoGain = 1.0f;
+  if (activeCount > 1) {
+    targetAutoGain = 1.0f / std::sqrt(static_cast<float>(activeCount));
+  }
+  mAutoGain.setTarget(targetAutoGain);
+
+  const SmoothedParameter::Ramp autoGain = mAutoGain.nextBlock(numFrames);
+  for (int i = 0; i < numFrames; ++i) {
+    mono[i] = softLimit(mono[i] * autoGain.at(i) * mMasterGain);
+  }
+
+  mChorus.processBlock(mono, left, right, numFrames);
+}
+
+int PolyphonyManager::renderVoices(VoiceBank &bank, const int *indices,
+                                   int count, float *out,
+                                   const float *pitchRatio,
+                                   const float *lfoFilter, const float *lfoPWM,
+                                   int numFrames) {
+  if (mUseVoiceBank) {
+    return bank.processBlock(mVoices.data(), indices, count, out, pitchRatio,
+                             lfoFilter, lfoPWM, numFrames);
+  }
+
+  int activeCount = 0;
+  for (int n = 0; n < count; ++n) {
+    Voice &voice = mVoices[indices[n]];
+    if (voice.isActive()) {
+      voice.processBlock(out, pitchRatio, lfoFilter, lfoPWM, numFrames);
+      activeCount++;
+    }
+  }
+  return activeCount;
+}
+
+void PolyphonyManager::renderVoiceJob(void *context) {
+  auto *job = static_cast<VoiceJob *>(context);
+  job->activeCount = job->owner->renderVoices(
+      *job->bank, job->indices, job->count, job->out, job->pitchRatio,
+      job->lfoFilter, job->lfoPWM, job->numFrames);
+}
+
 float PolyphonyManager::nextSample() {
   // Legacy mono output - mix stereo to mono
   float left, right;
@@ -382,12 +617,15 @@ float PolyphonyManager::softLimit(float sample) {
   } else {
     float excess = absSample - threshold - knee;
     float limited = threshold + knee * 0.5f +
-                    (1.0f - threshold - knee * 0.5f) * std::tanh(excess * 2.0f);
+                    (1.0f - threshold - knee * 0.5f) * fastTanh(excess * 2.0f);
     return (sample > 0) ? limited : -limited;
   }
 }
 
 int PolyphonyManager::findFreeVoice() {
+  if (mNumActiveVoices >= getVoiceLimit()) {
+    return -1;
+  }
   for (int i = 0; i < MAX_POLYPHONY; ++i) {
     if (!mVoices[i].isActive()) {
       return i;
@@ -405,39 +643,41 @@ int PolyphonyManager::findVoiceWithNote(int midiNote) {
   return -1;
 }
 
-int PolyphonyManager::stealOldestVoice() {
-  uint64_t minAge = UINT64_MAX;
-  int oldestIndex = 0;
-
+int PolyphonyManager::stealVoice(const bool *excluded) {
+  int index = chooseVoiceToSteal(mVoices.data(), mVoiceAge, MAX_POLYPHONY,
+                                 mUnderPressure, excluded);
+  if (index >= 0) {
+    return index;
+  }
+  // Nothing to steal (everything sounding is excluded): any idle voice
   for (int i = 0; i < MAX_POLYPHONY; ++i) {
-    if (mVoiceAge[i] < minAge) {
-      minAge = mVoiceAge[i];
-      oldestIndex = i;
+    if (!mVoices[i].isActive() && (excluded == nullptr || !excluded[i])) {
+      return i;
     }
   }
+  return 0;
+}
 
-  return oldestIndex;
+void PolyphonyManager::shedExcessVoices() {
+  // Fades releasing voices, then the quietest held ones, until the rest
+  // fit the limit. Shed voices stay listed until their fade ends, which is
+  // far shorter than the governor waits between cuts.
+  bool shed[MAX_POLYPHONY] = {false};
+  int excess = mNumActiveVoices - getVoiceLimit();
+  while (excess-- > 0) {
+    int index = chooseVoiceToSteal(mVoices.data(), mVoiceAge, MAX_POLYPHONY,
+                                   true, shed);
+    if (index < 0) {
+      break;
+    }
+    mVoices[index].shed();
+    mUnisonNoteVoices[index] = -1;
+    shed[index] = true;
+  }
 }
 
 void PolyphonyManager::applyParamsToVoice(Voice &voice) {
-  // Apply all enabled waveforms
-  for (int i = 0; i < 4; ++i) {
-    voice.setWaveformEnabled(static_cast<Waveform>(i), mEnabledWaveforms[i]);
-  }
-  voice.setPulseWidth(mPulseWidth);
-  voice.setSubOscLevel(mSubOscLevel);
-  voice.setNoiseLevel(mNoiseLevel);
-  voice.setFilterCutoff(mFilterCutoff);
-  voice.setFilterResonance(mFilterResonance);
-  voice.setFilterEnvelopeAmount(mFilterEnvAmount);
-  voice.setFilterKeyTracking(mFilterKeyTracking);
-  voice.setHPFCutoff(mHPFCutoff);
-  voice.setAttack(mAttack);
-  voice.setDecay(mDecay);
-  voice.setSustain(mSustain);
-  voice.setRelease(mRelease);
-  voice.setGlideTime(mGlideTime);
-  voice.setGlideEnabled(mGlideEnabled);
+  voice.applyPatch(mVoicePatch, mVoiceCoefficients);
 }
 
 } // namespace synthio
@@ -3,26 +3,43 @@
 
 #include "Chorus.h"
 #include "LFO.h"
+#include "SmoothedParameter.h"
+#include "SynthPatch.h"
 #include "Voice.h"
+#include "VoiceBank.h"
+#include "VoiceStealing.h"
+#include "WorkerPool.h"
+#include <algorithm>
 #include <array>
 #include <cstdint>
 
 namespace synthio {
 
-constexpr int MAX_POLYPHONY =
+// Voice storage. How many of them may sound at once is set at runtime, up
+// to this, and further capped by the CPU governor.
+constexpr int MAX_POLYPHONY = 32;
+constexpr int DEFAULT_POLYPHONY =
     12; // 12 voices for playing 7th chords comfortably
 
 /**
  * Enhanced polyphony manager with Juno-106 style features:
  * - Global LFO with modulation routing
  * - Stereo chorus effect
- * - Unison mode with voice stacking and detuning
+ * - Unison mode with detuned oscillator stacks (or whole-voice stacking)
  */
 class PolyphonyManager {
 public:
   PolyphonyManager();
 
   void setSampleRate(float sampleRate);
+  // Chorus line comes from the engine's effect arena
+  void setEffectArena(EffectArena *arena) { mChorus.setArena(arena); }
+  // Reseeds every voice's noise generator (voice i gets seed + i)
+  void seedNoise(uint32_t seed) {
+    for (int i = 0; i < MAX_POLYPHONY; ++i) {
+      mVoices[i].seedNoise(seed + i);
+    }
+  }
 
   // Note control
   void noteOn(int midiNote, float frequency);
@@ -66,70 +83,165 @@ public:
   void setUnisonEnabled(bool enabled);
   void setUnisonVoices(int count);   // 1-8 voices
   void setUnisonDetune(float cents); // Spread in cents
+  // Stacked unison (default): each note is one voice whose main oscillator
+  // is a stack of detuned copies sharing the filter and envelopes. Off
+  // stacks whole voices instead, one per copy.
+  void setStackedUnisonEnabled(bool enabled);
+  bool isStackedUnisonEnabled() const { return mStackedUnison; }
 
   // Master gain control
   void setMasterGain(float gain);
 
+  // ===== VOICE LIMITS =====
+  // Voices that may sound at once (1 - MAX_POLYPHONY)
+  void setPolyphony(int count);
+  int getPolyphony() const { return mPolyphony; }
+  // CPU budget from the voice governor. Voices over the resulting limit
+  // fade out quickly; under pressure, stealing takes the quietest voice
+  // rather than the oldest.
+  void setVoiceBudget(int budget, bool underPressure);
+  int getVoiceLimit() const { return std::min(mPolyphony, mVoiceBudget); }
+
+  // ===== PATCHES =====
+  // Applies the voice, LFO, chorus and unison parts of a patch in one go.
+  // coefficients are normally prepared off the audio thread for the
+  // current rate; voices re-derive them if the rate has changed since.
+  void applyPatch(const SynthPatch &patch,
+                  const VoiceCoefficients &coefficients);
+
+  // Voice rendering path: vectorized VoiceBank (default when the target has
+  // NEON/SSE) or the scalar per-voice path
+  void setVoiceBankEnabled(bool enabled) { mUseVoiceBank = enabled; }
+  bool isVoiceBankEnabled() const { return mUseVoiceBank; }
+
+  // Voices sounding, including those still releasing
+  int getActiveVoiceCount() const { return mNumActiveVoices; }
+
+  // Render pool for splitting the voice list (audio thread; nullptr = all
+  // voices on the calling thread)
+  void setWorkerPool(WorkerPool *pool) { mWorkerPool = pool; }
+
+  // Oscillator mode: band-limited wavetables (default) or polyBLEP
+  void setWavetableEnabled(bool enabled);
+  // Filter cost/quality for every voice (see QualitySettings)
+  void setFilterQuality(int controlInterval, bool oversampling);
+
   // Audio processing - returns stereo pair
   void nextSample(float &outLeft, float &outRight);
 
   // Legacy mono output (for compatibility)
   float nextSample();
 
+  // Block processing: renders numFrames stereo frames into left/right
+  void processBlock(float *left, float *right, int numFrames);
+
 private:
   std::array<Voice, MAX_POLYPHONY> mVoices;
+  VoiceBank mVoiceBank;
+  bool mUseVoiceBank = kHasSimd;
+
+  // Parallel voice rendering: with at least MIN_PARALLEL_VOICES sounding,
+  // the tail of the active list renders on a pool worker through its own
+  // bank into its own buffer. The voices are disjoint, so no state is shared.
+  static constexpr int MIN_PARALLEL_VOICES = 6;
+  struct VoiceJob {
+    PolyphonyManager *owner;
+    VoiceBank *bank;
+    const int *indices;
+    int count;
+    float *out;
+    const float *pitchRatio;
+    const float *lfoFilter;
+    const float *lfoPWM;
+    int numFrames;
+    int activeCount; // Result
+  };
+  WorkerPool *mWorkerPool = nullptr;
+  VoiceBank mWorkerVoiceBank;
+  static void renderVoiceJob(void *context);
+  int renderVoices(VoiceBank &bank, const int *indices, int count, float *out,
+                   const float *pitchRatio, const float *lfoFilter,
+                   const float *lfoPWM, int numFrames);
   uint64_t mVoiceAge[MAX_POLYPHONY] = {0};
   uint64_t mAgeCounter = 0;
 
+  // Indices of sounding voices, in trigger order. Voices join on noteOn and
+  // leave once their amp envelope reaches IDLE, so render loops only touch
+  // voices that produce output.
+  int mActiveVoices[MAX_POLYPHONY] = {0};
+  int mNumActiveVoices = 0;
+  bool mVoiceListed[MAX_POLYPHONY] = {false};
+
   // Global LFO
   LFO mLFO;
 
+  // LFO pitch as a frequency ratio, shared by every voice. One exp2 per
+  // control segment; the ratio is ramped linearly in between.
+  static constexpr int PITCH_CONTROL_INTERVAL = 16;
+  float mPitchRatio = 1.0f;
+  float mPitchRatioStep = 0.0f;
+  int mPitchCountdown = 0;
+
   // Stereo chorus
   Chorus mChorus;
 
-  // Current parameters
-  bool mEnabledWaveforms[4] = {false, false, true, false}; // Default Sawtooth
-  // Waveform mCurrentWaveform = Waveform::SAWTOOTH; // Removed
-  float mPulseWidth = 0.5f;
-  float mSubOscLevel = 0.0f;
-  float mNoiseLevel = 0.0f;
-  float mFilterCutoff = 10000.0f;
-  float mFilterResonance = 0.0f;
-  float mFilterEnvAmount = 0.3f;
-  float mFilterKeyTracking = 0.0f;
-  float mHPFCutoff = 0.0f;
-  float mAttack = 0.01f;
-  float mDecay = 0.2f;
-  float mSustain = 0.7f;
-  float mRelease = 0.3f;
-  float mGlideTime = 0.0f;
-  bool mGlideEnabled = false;
+  // Current voice parameters and the coefficients derived from them,
+  // copied into a voice whenever it is (re)allocated
+  VoicePatch mVoicePatch;
+  VoiceCoefficients mVoiceCoefficients;
+  float mSampleRate = 48000.0f;
+  void updateVoiceCoefficients() {
+    mVoiceCoefficients = VoiceCoefficients::compute(mVoicePatch, mSampleRate);
+  }
 
   // Unison parameters
   bool mUnisonEnabled = false;
   int mUnisonVoices = 4;
   float mUnisonDetune = 10.0f; // cents
+  bool mStackedUnison = true;
+  // Stack detune ratios for mUnisonVoices / mUnisonDetune, so a note-on
+  // only copies them
+  float mStackRatios[MAX_UNISON_STACK];
 
   // For unison mode: track which voices belong to which note
   int mUnisonNoteVoices[MAX_POLYPHONY] = {-1};
 
   // Gain control
   float mMasterGain = 0.7f;
-  float mCurrentAutoGain = 1.0f;
-  float mAutoGainSmoothing = 0.9995f;
+  // Follows 1/sqrt(active voices); ~40 ms ramps hide voices coming and going
+  static constexpr float AUTO_GAIN_RAMP_TIME = 0.04f;
+  SmoothedParameter mAutoGain{1.0f};
+
+  // Voice limits
+  int mPolyphony = DEFAULT_POLYPHONY;
+  int mVoiceBudget = MAX_POLYPHONY;
+  bool mUnderPressure = false;
+  void shedExcessVoices();
 
+  // Returns -1 once the voice limit is reached
   int findFreeVoice();
   int findVoiceWithNote(int midiNote);
-  int stealOldestVoice();
+  int stealVoice(const bool *excluded = nullptr);
   int countActiveVoices();
+  void triggerVoice(int voiceIndex, int midiNote, float frequency);
+  void pruneIdleVoices();
 
   void applyParamsToVoice(Voice &voice);
   void applyLFOToVoices();
+  float nextPitchRatio(float lfoPitchSemitones);
+  void buildPitchRatio(const float *lfoPitch, float *pitchRatio,
+                       int numFrames);
 
   // Unison helpers
   void noteOnUnison(int midiNote, float frequency);
   void noteOffUnison(int midiNote);
   float calculateUnisonDetune(int voiceIndex, int totalVoices);
+  bool isVoiceUnison() const { return mUnisonEnabled && !mStackedUnison; }
+  int unisonStackSize() const {
+    return mUnisonEnabled && mStackedUnison ? mUnisonVoices : 1;
+  }
+  void updateUnisonStacks();
+  void applyUnisonStack(Voice &voice); // Stack for the next note
 
   // Soft limiter to prevent clipping
   float softLimit(float sample);
@@ -0,0 +1,82 @@
+#include "QualityTier.h"
+#include "Denormals.h"
+#include "PolyphonyManager.h"
+#include <chrono>
+#include <cmath>
+#include <memory>
+
+namespace synthio {
+
+namespace {
+
+// Projected load (percent of one core) of the benchmark voices at the
+// standard tier. High adds a second biquad step per voice sample; eco
+// designs the cutoff a quarter as often and drops half the reverb.
+constexpr float ECO_OVER_LOAD = 25.0f; // Over this: eco
+constexpr float HIGH_UNDER_LOAD = 8.0f; // Under this: high
+
+constexpr int BENCHMARK_BLOCK = 192;
+// Runs on start(), so it is bounded by the time it takes rather than the
+// audio it renders: about 5 ms on any device, at most 0.25 s of audio
+constexpr std::chrono::microseconds BENCHMARK_WORK{5000};
+constexpr float BENCHMARK_MAX_SECONDS = 0.25f;
+constexpr int WARMUP_BLOCKS = 4;
+
+} // namespace
+
+QualitySettings QualitySettings::forTier(QualityTier tier) {
+  switch (tier) {
+  case QualityTier::ECO:
+    return {64, false, false, true, true};
+  case QualityTier::HIGH:
+    return {16, true, true, true, true};
+  case QualityTier::STANDARD:
+  default:
+    return {16, false, true, true, true};
+  }
+}
+
+QualityTier benchmarkQualityTier(float sampleRate) {
+  ScopedFlushToZero flushToZero; // Measure with the audio threads' FP mode
+  // PolyphonyManager is too large for the stack
+  auto synth = std::make_unique<PolyphonyManager>();
+  synth->setSampleRate(sampleRate);
+  synth->seedNoise(1);
+  synth->setWaveform(Waveform::SAWTOOTH);
+  synth->setFilterEnvelopeAmount(0.5f); // Keeps the cutoff design busy
+  synth->setChorusMode(1);
+  for (int v = 0; v < DEFAULT_POLYPHONY; ++v) {
+    int note = 48 + v * 2;
+    synth->noteOn(note, 440.0f * std::pow(2.0f, (note - 69) / 12.0f));
+  }
+
+  float left[BENCHMARK_BLOCK];
+  float right[BENCHMARK_BLOCK];
+  for (int b = 0; b < WARMUP_BLOCKS; ++b) {
+    synth->processBlock(left, right, BENCHMARK_BLOCK);
+  }
+
+  const int maxBlocks =
+      static_cast<int>(BENCHMARK_MAX_SECONDS * sampleRate) / BENCHMARK_BLOCK;
+  const auto start = std::chrono::steady_clock::now();
+  int blocks = 0;
+  std::chrono::duration<float> elapsed{0.0f};
+  while (blocks < maxBlocks && elapsed < BENCHMARK_WORK) {
+    synth->processBlock(left, right, BENCHMARK_BLOCK);
+    ++blocks;
+    elapsed = std::chrono::steady_clock::now() - start;
+  }
+
+  const float audioSeconds =
+      static_cast<float>(blocks * BENCHMARK_BLOCK) / sampleRate;
+  const float load = 100.0f * elapsed.count() / audioSeconds;
+  if (load > ECO_OVER_LOAD) {
+    return QualityTier::ECO;
+  }
+  if (load < HIGH_UNDER_LOAD) {
+    return QualityTier::HIGH;
+  }
+  return QualityTier::STANDARD;
+}
+
+} // namespace synthio
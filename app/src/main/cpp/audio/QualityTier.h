@@ -0,0 +1,36 @@
+#ifndef SYNTHIO_QUALITY_TIER_H
+#define SYNTHIO_QUALITY_TIER_H
+
+namespace synthio {
+
+// How much CPU the DSP may spend for sound quality. Picked automatically
+// from a short benchmark when the engine starts (QUALITY_TIER_AUTO), or set
+// by the user.
+enum class QualityTier { ECO = 0, STANDARD = 1, HIGH = 2 };
+
+constexpr int QUALITY_TIER_AUTO = -1;
+
+// What a tier switches, applied together on the audio thread
+struct QualitySettings {
+  // Samples per filter cutoff design (Filter::setControlInterval)
+  int filterControlInterval;
+  // LPF biquad and saturation at 2x (Filter::setOversampling)
+  bool filterOversampling;
+  // Right-channel reverb bank (Reverb::setStereo)
+  bool stereoReverb;
+  // Band-limited table oscillators and pre-rendered drum hits. They are
+  // both the cheapest and the cleanest path, so every tier turns them on.
+  bool wavetables;
+  bool drumOneShots;
+
+  static QualitySettings forTier(QualityTier tier);
+};
+
+// Times DEFAULT_POLYPHONY standard-tier synth voices for a quarter second
+// of audio on the calling thread (a few milliseconds on most devices) and
+// picks the tier whose cost leaves the callback comfortable headroom.
+QualityTier benchmarkQualityTier(float sampleRate);
+
+} // namespace synthio
+
+#endif // SYNTHIO_QUALITY_TIER_H
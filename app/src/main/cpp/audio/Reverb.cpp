@@ -1,165 +1,299 @@
 #include "Reverb.h"
+#include "DSPConfig.h"
+#include "SimdMath.h"
 #include <algorithm>
 #include <cmath>
 
 namespace synthio {
 
+namespace {
+
+// FDN input polarity per line, so the lines don't start out identical
+alignas(16) constexpr float FDN_INPUT_SIGNS[8] = {1.0f, -1.0f, 1.0f, -1.0f,
+                                                  1.0f, -1.0f, 1.0f, -1.0f};
+
+} // namespace
+
 Reverb::Reverb() {
     initializeFilters();
 }
 
 void Reverb::setSampleRate(float sampleRate) {
     mSampleRate = sampleRate;
+    mMix.setRampTime(PARAMETER_RAMP_TIME, sampleRate);
+    mCombFeedback.setRampTime(PARAMETER_RAMP_TIME, sampleRate);
+    initializeFilters();
+}
+
+void Reverb::setArena(EffectArena* arena) {
+    mMemory.share(arena);
     initializeFilters();
 }
 
 void Reverb::initializeFilters() {
     float sampleRateScale = mSampleRate / 48000.0f;
+    EffectArena& arena = mMemory.beginLayout();
+    int longestLine = 0;
+    int allpassTotal = 0;
     
-    // Initialize comb filters
-    for (int i = 0; i < NUM_COMBS; ++i) {
-        int delaySize = static_cast<int>(COMB_DELAYS[i] * sampleRateScale) + 1;
-        mCombsL[i].buffer.resize(delaySize, 0.0f);
-        mCombsL[i].writePos = 0;
-        mCombsL[i].filterState = 0.0f;
-        
-        // Slight offset for stereo width
-        int delaySizeR = static_cast<int>((COMB_DELAYS[i] + 23) * sampleRateScale) + 1;
-        mCombsR[i].buffer.resize(delaySizeR, 0.0f);
-        mCombsR[i].writePos = 0;
-        mCombsR[i].filterState = 0.0f;
+    auto scaled = [&](int delay) {
+        return std::max(1, static_cast<int>(delay * sampleRateScale));
+    };
+    auto place = [&](Tap& tap, int delay) {
+        tap.line.allocate(arena, static_cast<uint32_t>(delay));
+        tap.delay = static_cast<uint32_t>(delay);
+    };
+    
+    // Comb filters. The FDN overlays the same spans (only one bank runs at
+    // a time), line k on comb k of the left then the right channel.
+    for (int channel = 0; channel < 2; ++channel) {
+        for (int i = 0; i < NUM_COMBS; ++i) {
+            // Slight offset for stereo width
+            int combDelay = scaled(COMB_DELAYS[i] + channel * COMB_STEREO_SPREAD);
+            int fdnDelay = scaled(FDN_DELAYS[channel * NUM_COMBS + i]);
+            Tap& comb = mCombs[channel][i];
+            Tap& fdn = mFdn[channel * NUM_COMBS + i];
+            comb.line.allocate(arena, static_cast<uint32_t>(std::max(combDelay, fdnDelay)));
+            comb.delay = static_cast<uint32_t>(combDelay);
+            fdn.line = comb.line;
+            fdn.delay = static_cast<uint32_t>(fdnDelay);
+            longestLine = std::max(longestLine, std::max(combDelay, fdnDelay));
+        }
     }
     
-    // Initialize allpass filters  
+    // Allpass filters
     for (int i = 0; i < NUM_ALLPASS; ++i) {
-        int delaySize = static_cast<int>(ALLPASS_DELAYS[i] * sampleRateScale) + 1;
-        mAllpassL[i].buffer.resize(delaySize, 0.0f);
-        mAllpassL[i].writePos = 0;
-        
-        int delaySizeR = static_cast<int>((ALLPASS_DELAYS[i] + 11) * sampleRateScale) + 1;
-        mAllpassR[i].buffer.resize(delaySizeR, 0.0f);
-        mAllpassR[i].writePos = 0;
+        int delayL = scaled(ALLPASS_DELAYS[i]);
+        int delayR = scaled(ALLPASS_DELAYS[i] + ALLPASS_STEREO_SPREAD);
+        place(mAllpass[0][i], delayL);
+        place(mAllpass[1][i], delayR);
+        allpassTotal += std::max(delayL, delayR) + 1;
     }
+    
+    mWritePos = 0;
+    mTailFrames = longestLine + 1 + allpassTotal;
+    
+    // Start again from silence
+    reset();
+    mDormant = true;
 }
 
 void Reverb::setSize(float size) {
     mSize = std::max(0.0f, std::min(1.0f, size));
     
     // Update comb filter feedback based on size
-    float feedback = 0.5f + mSize * 0.45f;  // 0.5 to 0.95
-    for (int i = 0; i < NUM_COMBS; ++i) {
-        mCombsL[i].feedback = feedback;
-        mCombsR[i].feedback = feedback;
-    }
+    mCombFeedback.setTarget(0.5f + mSize * 0.45f);  // 0.5 to 0.95
 }
 
 void Reverb::setDamping(float damping) {
     mDamping = std::max(0.0f, std::min(1.0f, damping));
-    
-    for (int i = 0; i < NUM_COMBS; ++i) {
-        mCombsL[i].damping = mDamping;
-        mCombsR[i].damping = mDamping;
-    }
 }
 
 void Reverb::setMix(float mix) {
-    mMix = std::max(0.0f, std::min(1.0f, mix));
+    mMix.setTarget(std::max(0.0f, std::min(1.0f, mix)));
 }
 
-void Reverb::reset() {
-    for (int i = 0; i < NUM_COMBS; ++i) {
-        std::fill(mCombsL[i].buffer.begin(), mCombsL[i].buffer.end(), 0.0f);
-        std::fill(mCombsR[i].buffer.begin(), mCombsR[i].buffer.end(), 0.0f);
-        mCombsL[i].filterState = 0.0f;
-        mCombsR[i].filterState = 0.0f;
+void Reverb::setStereo(bool stereo) {
+    if (stereo && !mStereo) {
+        // The right bank sat idle; don't let its old tail back in
+        clearRight();
     }
-    for (int i = 0; i < NUM_ALLPASS; ++i) {
-        std::fill(mAllpassL[i].buffer.begin(), mAllpassL[i].buffer.end(), 0.0f);
-        std::fill(mAllpassR[i].buffer.begin(), mAllpassR[i].buffer.end(), 0.0f);
+    mStereo = stereo;
+}
+
+void Reverb::setMode(Mode mode) {
+    if (mode == mMode) {
+        return;
     }
+    // The banks share memory: the new one starts from silence
+    clearFdn();
+    mMode = mode;
 }
 
-float Reverb::processComb(CombFilter& comb, float input, int delaySamples) {
-    int bufferSize = static_cast<int>(comb.buffer.size());
-    delaySamples = std::min(delaySamples, bufferSize - 1);
-    
-    // Read from buffer
-    int readPos = comb.writePos - delaySamples;
-    if (readPos < 0) readPos += bufferSize;
-    
-    float delayed = comb.buffer[readPos];
-    
-    // Apply damping (low-pass filter in feedback)
-    comb.filterState = delayed * (1.0f - comb.damping) + comb.filterState * comb.damping;
-    
-    // Write to buffer
-    comb.buffer[comb.writePos] = input + comb.filterState * comb.feedback;
-    
-    // Increment write position
-    comb.writePos++;
-    if (comb.writePos >= bufferSize) comb.writePos = 0;
-    
-    return delayed;
+void Reverb::clearRight() {
+    // In FDN mode the right comb spans are live FDN lines
+    float* memory = mMemory.data();
+    if (mMode == Mode::COMBS) {
+        for (const Tap& comb : mCombs[1]) {
+            comb.line.clear(memory);
+        }
+        std::fill(mCombState[1], mCombState[1] + NUM_COMBS, 0.0f);
+    }
+    for (const Tap& ap : mAllpass[1]) {
+        ap.line.clear(memory);
+    }
+}
+
+void Reverb::clearFdn() {
+    // Also the comb spans and their state
+    float* memory = mMemory.data();
+    for (const Tap& fdn : mFdn) {
+        fdn.line.clear(memory);
+    }
+    std::fill(mFdnState, mFdnState + FDN_LINES, 0.0f);
+    std::fill(mCombState[0], mCombState[0] + NUM_COMBS, 0.0f);
+    std::fill(mCombState[1], mCombState[1] + NUM_COMBS, 0.0f);
 }
 
-float Reverb::processAllpass(AllpassFilter& ap, float input, int delaySamples) {
-    int bufferSize = static_cast<int>(ap.buffer.size());
-    delaySamples = std::min(delaySamples, bufferSize - 1);
+void Reverb::reset() {
+    // The FDN lines overlay the combs
+    float* memory = mMemory.data();
+    for (int channel = 0; channel < 2; ++channel) {
+        for (const Tap& comb : mCombs[channel]) {
+            comb.line.clear(memory);
+        }
+        for (const Tap& ap : mAllpass[channel]) {
+            ap.line.clear(memory);
+        }
+    }
+    std::fill(mCombState[0], mCombState[0] + NUM_COMBS, 0.0f);
+    std::fill(mCombState[1], mCombState[1] + NUM_COMBS, 0.0f);
+    std::fill(mFdnState, mFdnState + FDN_LINES, 0.0f);
+    mSilentFrames = 0;
+}
+
+float Reverb::processCombs(int channel, float input, float feedback) {
+    const Tap* combs = mCombs[channel];
+    alignas(16) float delayed[NUM_COMBS];
+    alignas(16) float written[NUM_COMBS];
+    for (int c = 0; c < NUM_COMBS; ++c) {
+        delayed[c] = read(combs[c]);
+    }
     
-    // Read from buffer
-    int readPos = ap.writePos - delaySamples;
-    if (readPos < 0) readPos += bufferSize;
+    // Damping (low-pass filter in the feedback path) for all four combs
+    const float4 vDelayed = load4(delayed);
+    float4 state = load4(mCombState[channel]);
+    state = add4(mul4(vDelayed, splat4(1.0f - mDamping)),
+                 mul4(state, splat4(mDamping)));
+    store4(mCombState[channel], state);
+    store4(written, add4(splat4(input), mul4(state, splat4(feedback))));
     
-    float delayed = ap.buffer[readPos];
-    float output = -input + delayed;
+    for (int c = 0; c < NUM_COMBS; ++c) {
+        write(combs[c], written[c]);
+    }
+    return delayed[0] + delayed[1] + delayed[2] + delayed[3];
+}
+
+void Reverb::processFdn(float input, float feedback, float& outLeft,
+                        float& outRight) {
+    alignas(16) float delayed[FDN_LINES];
+    alignas(16) float written[FDN_LINES];
+    for (int k = 0; k < FDN_LINES; ++k) {
+        delayed[k] = read(mFdn[k]);
+    }
     
-    // Write to buffer
-    ap.buffer[ap.writePos] = input + delayed * ap.feedback;
+    const float4 pass = splat4(1.0f - mDamping);
+    const float4 keep = splat4(mDamping);
+    const float4 delayedA = load4(delayed);
+    const float4 delayedB = load4(delayed + 4);
+    float4 a = add4(mul4(delayedA, pass), mul4(load4(mFdnState), keep));
+    float4 b = add4(mul4(delayedB, pass), mul4(load4(mFdnState + 4), keep));
+    store4(mFdnState, a);
+    store4(mFdnState + 4, b);
     
-    // Increment write position
-    ap.writePos++;
-    if (ap.writePos >= bufferSize) ap.writePos = 0;
+    // Householder feedback matrix (I - 2/N): orthogonal, so the decay is
+    // set by feedback alone, and it costs one sum instead of a matrix
+    const float4 reflect = splat4((hsum4(a) + hsum4(b)) * (2.0f / FDN_LINES));
+    const float4 gain = splat4(feedback);
+    const float4 in = splat4(input);
+    a = add4(mul4(in, load4(FDN_INPUT_SIGNS)), mul4(sub4(a, reflect), gain));
+    b = add4(mul4(in, load4(FDN_INPUT_SIGNS + 4)), mul4(sub4(b, reflect), gain));
+    store4(written, a);
+    store4(written + 4, b);
+    for (int k = 0; k < FDN_LINES; ++k) {
+        write(mFdn[k], written[k]);
+    }
     
+    // Left from the first four lines, right from the rest
+    outLeft = hsum4(delayedA) * 0.25f;
+    outRight = hsum4(delayedB) * 0.25f;
+    if (!mStereo) {
+        outLeft = outRight = (outLeft + outRight) * 0.5f;
+    }
+}
+
+float Reverb::processAllpasses(int channel, float input) {
+    float output = input;
+    for (const Tap& ap : mAllpass[channel]) {
+        float delayed = read(ap);
+        write(ap, output + delayed * ALLPASS_FEEDBACK);
+        output = -output + delayed;
+    }
     return output;
 }
 
+void Reverb::renderFrame(float input, float feedback, float& wetL, float& wetR) {
+    if (mMode == Mode::FDN) {
+        processFdn(input, feedback, wetL, wetR);
+    } else {
+        // Normalize the comb sum
+        wetL = processCombs(0, input, feedback) * 0.25f;
+        wetR = mStereo ? processCombs(1, input, feedback) * 0.25f : wetL;
+    }
+    
+    // Series allpass filters
+    wetL = processAllpasses(0, wetL);
+    wetR = mStereo ? processAllpasses(1, wetR) : wetL;
+    ++mWritePos;
+}
+
 void Reverb::process(float& left, float& right) {
-    float sampleRateScale = mSampleRate / 48000.0f;
+    // The per-sample path doesn't track the tail
+    mDormant = false;
+    mLines = mMemory.data();
     
     // Mix input to mono for reverb input
     float monoInput = (left + right) * 0.5f;
+    float feedback = mCombFeedback.nextValue();
+    float mix = mMix.nextValue();
     
-    // Process parallel comb filters
-    float combSumL = 0.0f;
-    float combSumR = 0.0f;
+    float wetL, wetR;
+    renderFrame(monoInput, feedback, wetL, wetR);
     
-    for (int i = 0; i < NUM_COMBS; ++i) {
-        int delayL = static_cast<int>(COMB_DELAYS[i] * sampleRateScale);
-        int delayR = static_cast<int>((COMB_DELAYS[i] + 23) * sampleRateScale);
-        
-        combSumL += processComb(mCombsL[i], monoInput, delayL);
-        combSumR += processComb(mCombsR[i], monoInput, delayR);
+    // Mix dry and wet
+    left = left * (1.0f - mix) + wetL * mix;
+    right = right * (1.0f - mix) + wetR * mix;
+}
+
+void Reverb::processBlock(float* left, float* right, int numFrames) {
+    const float inputPeak = blockPeak(left, right, numFrames);
+    if (mDormant) {
+        if (inputPeak < SILENCE_THRESHOLD) {
+            return;  // Cleared buffers: no tail, dry signal is already silent
+        }
+        // Nothing was audible, so changes made while dormant need no ramp
+        mMix.snap();
+        mCombFeedback.snap();
+        mDormant = false;
     }
     
-    // Normalize
-    combSumL *= 0.25f;
-    combSumR *= 0.25f;
+    const SmoothedParameter::Ramp mixRamp = mMix.nextBlock(numFrames);
+    const SmoothedParameter::Ramp feedbackRamp = mCombFeedback.nextBlock(numFrames);
+    mLines = mMemory.data();
+    float wetPeak = 0.0f;
     
-    // Process series allpass filters
-    float wetL = combSumL;
-    float wetR = combSumR;
-    
-    for (int i = 0; i < NUM_ALLPASS; ++i) {
-        int delayL = static_cast<int>(ALLPASS_DELAYS[i] * sampleRateScale);
-        int delayR = static_cast<int>((ALLPASS_DELAYS[i] + 11) * sampleRateScale);
+    for (int i = 0; i < numFrames; ++i) {
+        float monoInput = (left[i] + right[i]) * 0.5f;
+        const float feedback = feedbackRamp.at(i);
+        const float mix = mixRamp.at(i);
         
-        wetL = processAllpass(mAllpassL[i], wetL, delayL);
-        wetR = processAllpass(mAllpassR[i], wetR, delayR);
+        float wetL, wetR;
+        renderFrame(monoInput, feedback, wetL, wetR);
+        wetPeak = std::max(wetPeak, std::max(std::fabs(wetL), std::fabs(wetR)));
+        
+        left[i] = left[i] * (1.0f - mix) + wetL * mix;
+        right[i] = right[i] * (1.0f - mix) + wetR * mix;
     }
     
-    // Mix dry and wet
-    left = left * (1.0f - mMix) + wetL * mMix;
-    right = right * (1.0f - mMix) + wetR * mMix;
+    if (inputPeak < SILENCE_THRESHOLD && wetPeak < SILENCE_THRESHOLD) {
+        mSilentFrames += numFrames;
+        if (mSilentFrames >= mTailFrames) {
+            reset();
+            mDormant = true;
+        }
+    } else {
+        mSilentFrames = 0;
+    }
 }
 
 } // namespace synthio
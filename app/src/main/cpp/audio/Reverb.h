@@ -1,22 +1,38 @@
 #ifndef SYNTHIO_REVERB_H
 #define SYNTHIO_REVERB_H
 
-#include <vector>
-#include <array>
+#include "DelayLine.h"
+#include "SmoothedParameter.h"
+#include <cstdint>
 
 namespace synthio {
 
 /**
  * Simple Schroeder-style reverb suitable for Wurlitzer
- * Uses 4 parallel comb filters + 2 series allpass filters
+ * Uses 4 parallel comb filters + 2 series allpass filters per channel, or
+ * optionally an 8-line feedback delay network in place of the combs
+ *
+ * Every line is a power-of-two DelayLine in the effect arena, read and
+ * written through one shared write counter, so there is no per-line wrap
+ * test. A channel's four combs (or the FDN's eight lines) advance together
+ * as 4-lane vectors.
  */
 class Reverb {
 public:
+    // COMBS: the classic parallel comb bank
+    // FDN: 8 lines mixed through a Householder matrix; a denser, smoother
+    //      tail for the same cost as the stereo comb bank
+    enum class Mode { COMBS = 0, FDN = 1 };
+    
     Reverb();
     
     void setSampleRate(float sampleRate);
     
-    // Room size 0.0 - 1.0
+    // Lines come from the chain's arena (nullptr: a private one). Starts
+    // again from silence.
+    void setArena(EffectArena* arena);
+    
+    // Room size 0.0 - 1.0. Size and mix changes ramp rather than step.
     void setSize(float size);
     
     // Damping (high frequency decay) 0.0 - 1.0
@@ -25,9 +41,24 @@ public:
     // Wet/dry mix 0.0 - 1.0
     void setMix(float mix);
     
+    // Stereo (default) runs a second, offset comb/allpass bank for the right
+    // channel; mono feeds both channels from the left bank at half the cost
+    void setStereo(bool stereo);
+    bool isStereo() const { return mStereo; }
+    
+    // Switching starts the new bank from silence (the old tail stops)
+    void setMode(Mode mode);
+    Mode getMode() const { return mMode; }
+    
     // Process stereo
     void process(float& left, float& right);
     
+    // Block processing (in place). Goes dormant once the input and the
+    // tail have been silent for the longest comb + allpass memory.
+    void processBlock(float* left, float* right, int numFrames);
+    
+    bool isDormant() const { return mDormant; }
+    
     // Clear buffers
     void reset();
 
@@ -35,38 +66,66 @@ private:
     float mSampleRate = 48000.0f;
     float mSize = 0.5f;
     float mDamping = 0.5f;
-    float mMix = 0.3f;
+    bool mStereo = true;
+    Mode mMode = Mode::COMBS;
+    SmoothedParameter mMix{0.3f};
+    SmoothedParameter mCombFeedback{0.7f};  // Derived from mSize, shared by every comb
     
     // Comb filter delays (in samples at 48kHz, scaled for other rates)
     static constexpr int NUM_COMBS = 4;
     static constexpr int COMB_DELAYS[NUM_COMBS] = {1557, 1617, 1491, 1422};
+    static constexpr int COMB_STEREO_SPREAD = 23;
     
     // Allpass filter delays
     static constexpr int NUM_ALLPASS = 2;
     static constexpr int ALLPASS_DELAYS[NUM_ALLPASS] = {225, 556};
+    static constexpr int ALLPASS_STEREO_SPREAD = 11;
+    static constexpr float ALLPASS_FEEDBACK = 0.5f;
     
-    struct CombFilter {
-        std::vector<float> buffer;
-        int writePos = 0;
-        float filterState = 0.0f;
-        float feedback = 0.7f;
-        float damping = 0.5f;
-    };
+    // FDN line delays: mutually prime, spanning the comb lengths
+    static constexpr int FDN_LINES = 8;
+    static constexpr int FDN_DELAYS[FDN_LINES] = {1129, 1279, 1381, 1447,
+                                                  1523, 1597, 1693, 1789};
     
-    struct AllpassFilter {
-        std::vector<float> buffer;
-        int writePos = 0;
-        float feedback = 0.5f;
+    // A line and the fixed delay it is read at
+    struct Tap {
+        DelayLine line;
+        uint32_t delay = 0;
     };
     
-    std::array<CombFilter, NUM_COMBS> mCombsL;
-    std::array<CombFilter, NUM_COMBS> mCombsR;
-    std::array<AllpassFilter, NUM_ALLPASS> mAllpassL;
-    std::array<AllpassFilter, NUM_ALLPASS> mAllpassR;
+    EffectMemory mMemory;
+    float* mLines = nullptr;  // Arena base, looked up per process call
+    uint32_t mWritePos = 0;  // Shared by every line, wraps freely
+    
+    Tap mCombs[2][NUM_COMBS];  // [channel][comb]
+    Tap mAllpass[2][NUM_ALLPASS];
+    Tap mFdn[FDN_LINES];
+    
+    // Damping low-pass state, one per comb / FDN line
+    alignas(16) float mCombState[2][NUM_COMBS] = {};
+    alignas(16) float mFdnState[FDN_LINES] = {};
+    
+    // Tail detection. Fresh (cleared) filters start out dormant.
+    bool mDormant = true;
+    int mSilentFrames = 0;
+    int mTailFrames = 0;  // Frames of silence after which every buffer is stale
     
     void initializeFilters();
-    float processComb(CombFilter& comb, float input, int delaySamples);
-    float processAllpass(AllpassFilter& ap, float input, int delaySamples);
+    void clearRight();
+    void clearFdn();
+    
+    float read(const Tap& tap) const {
+        return tap.line.read(mLines, mWritePos, tap.delay);
+    }
+    void write(const Tap& tap, float value) {
+        tap.line.write(mLines, mWritePos, value);
+    }
+    
+    // One frame of each bank; mWritePos advances after both channels
+    float processCombs(int channel, float input, float feedback);
+    void processFdn(float input, float feedback, float& outLeft, float& outRight);
+    float processAllpasses(int channel, float input);
+    void renderFrame(float input, float feedback, float& wetL, float& wetR);
 };
 
 } // namespace synthio
@@ -0,0 +1,144 @@
+#include "RtCheck.h"
+
+#if defined(SYNTHIO_RT_CHECKS)
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace synthio {
+
+namespace {
+
+thread_local int tAudioDepth = 0;
+std::atomic<uint64_t> sAllocations{0};
+std::atomic<uint64_t> sLocks{0};
+
+} // namespace
+
+AudioThreadScope::AudioThreadScope() { ++tAudioDepth; }
+
+AudioThreadScope::~AudioThreadScope() { --tAudioDepth; }
+
+bool onAudioThread() { return tAudioDepth > 0; }
+
+RtViolations rtViolations() {
+  RtViolations violations;
+  violations.allocations = sAllocations.load(std::memory_order_relaxed);
+  violations.locks = sLocks.load(std::memory_order_relaxed);
+  return violations;
+}
+
+void countAudioThreadLock() {
+  if (tAudioDepth > 0) {
+    sLocks.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+namespace {
+
+void *allocate(size_t size, size_t alignment) {
+  if (tAudioDepth > 0) {
+    sAllocations.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (size == 0) {
+    size = 1;
+  }
+  void *memory = nullptr;
+  if (alignment <= alignof(std::max_align_t)) {
+    memory = std::malloc(size);
+  } else if (posix_memalign(&memory, alignment, size) != 0) {
+    memory = nullptr;
+  }
+  return memory;
+}
+
+void *allocateOrFail(size_t size, size_t alignment) {
+  void *memory = allocate(size, alignment);
+  if (memory == nullptr) {
+#if defined(__cpp_exceptions)
+    throw std::bad_alloc();
+#else
+    std::abort();
+#endif
+  }
+  return memory;
+}
+
+} // namespace
+
+} // namespace synthio
+
+// ===== GLOBAL ALLOCATION =====
+// Every replaceable form, so nothing reaches the library allocator
+// uncounted. Both malloc and posix_memalign memory is released with free.
+
+void *operator new(size_t size) {
+  return synthio::allocateOrFail(size, alignof(std::max_align_t));
+}
+
+void *operator new[](size_t size) {
+  return synthio::allocateOrFail(size, alignof(std::max_align_t));
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+  return synthio::allocateOrFail(size, static_cast<size_t>(alignment));
+}
+
+void *operator new[](size_t size, std::align_val_t alignment) {
+  return synthio::allocateOrFail(size, static_cast<size_t>(alignment));
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return synthio::allocate(size, alignof(std::max_align_t));
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return synthio::allocate(size, alignof(std::max_align_t));
+}
+
+void *operator new(size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+  return synthio::allocate(size, static_cast<size_t>(alignment));
+}
+
+void *operator new[](size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+  return synthio::allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete[](void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void *memory, size_t) noexcept { std::free(memory); }
+
+void operator delete(void *memory, std::align_val_t) noexcept {
+  std::free(memory);
+}
+void operator delete[](void *memory, std::align_val_t) noexcept {
+  std::free(memory);
+}
+void operator delete(void *memory, size_t, std::align_val_t) noexcept {
+  std::free(memory);
+}
+void operator delete[](void *memory, size_t, std::align_val_t) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, const std::nothrow_t &) noexcept {
+  std::free(memory);
+}
+void operator delete[](void *memory, const std::nothrow_t &) noexcept {
+  std::free(memory);
+}
+void operator delete(void *memory, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  std::free(memory);
+}
+void operator delete[](void *memory, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  std::free(memory);
+}
+
+#endif // SYNTHIO_RT_CHECKS
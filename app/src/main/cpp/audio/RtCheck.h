@@ -0,0 +1,75 @@
+#ifndef SYNTHIO_RT_CHECK_H
+#define SYNTHIO_RT_CHECK_H
+
+#include <cstdint>
+#include <mutex>
+
+namespace synthio {
+
+/**
+ * Audio-thread safety checks for debug builds (SYNTHIO_RT_CHECKS, set by
+ * CMake for Debug).
+ *
+ * Code that must stay real-time (the Oboe callback, render workers) runs
+ * inside an AudioThreadScope. While one is active on a thread, every heap
+ * allocation (global operator new, replaced in RtCheck.cpp) and every lock
+ * of a synthio::Mutex is counted, and the counts show up in the perf stats
+ * so a regression is visible without a profiler. Locks that pair with a
+ * condition_variable stay std::mutex and aren't counted; none of them is
+ * taken by the audio thread.
+ *
+ * In release builds the scope and the counters compile away and Mutex is
+ * std::mutex.
+ */
+struct RtViolations {
+  uint64_t allocations = 0;
+  uint64_t locks = 0;
+};
+
+#if defined(SYNTHIO_RT_CHECKS)
+
+class AudioThreadScope {
+public:
+  AudioThreadScope();
+  ~AudioThreadScope();
+  AudioThreadScope(const AudioThreadScope &) = delete;
+  AudioThreadScope &operator=(const AudioThreadScope &) = delete;
+};
+
+bool onAudioThread();
+RtViolations rtViolations();
+void countAudioThreadLock();
+
+class Mutex {
+public:
+  void lock() {
+    countAudioThreadLock();
+    mMutex.lock();
+  }
+  bool try_lock() {
+    countAudioThreadLock();
+    return mMutex.try_lock();
+  }
+  void unlock() { mMutex.unlock(); }
+
+private:
+  std::mutex mMutex;
+};
+
+#else
+
+class AudioThreadScope {
+public:
+  AudioThreadScope() {}
+};
+
+inline bool onAudioThread() { return false; }
+inline RtViolations rtViolations() { return {}; }
+
+using Mutex = std::mutex;
+
+#endif
+
+} // namespace synthio
+
+#endif // SYNTHIO_RT_CHECK_H
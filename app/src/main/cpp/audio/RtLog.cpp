@@ -0,0 +1,133 @@
+#include "RtLog.h"
+#include <chrono>
+#include <thread>
+
+#if defined(__ANDROID__)
+#include <android/log.h>
+#endif
+
+namespace synthio {
+
+namespace {
+
+constexpr int FLUSH_INTERVAL_MS = 20;
+constexpr size_t LINE_BYTES = 256;
+
+std::thread sFlusher;
+std::atomic<bool> sFlusherRunning{false};
+
+void writeLine(RtLog::Level level, const char *tag, const char *text) {
+#if defined(__ANDROID__)
+  __android_log_write(level == RtLog::ERROR ? ANDROID_LOG_ERROR
+                                            : ANDROID_LOG_INFO,
+                      tag, text);
+#elif defined(SYNTHIO_HOST_LOGGING)
+  std::fprintf(stderr, "%s/%s: %s\n", level == RtLog::ERROR ? "E" : "I", tag,
+               text);
+#else
+  (void)level;
+  (void)tag;
+  (void)text;
+#endif
+}
+
+} // namespace
+
+// Bounded multi-producer ring (Vyukov): each record's sequence says whose
+// turn it is. A record is free for the producer that claims position p when
+// sequence == p, holds a finished message when sequence == p + 1, and is
+// handed back for the next lap (p + CAPACITY) once flushed. Producers only
+// contend on enqueue, with a compare-exchange and never a wait.
+struct RtLogRing {
+  RtLog::Record records[RtLog::CAPACITY];
+  std::atomic<uint32_t> enqueue{0};
+  uint32_t dequeue = 0; // Flushing thread only
+  std::atomic<uint32_t> dropped{0};
+
+  RtLogRing() {
+    for (uint32_t i = 0; i < RtLog::CAPACITY; ++i) {
+      records[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+};
+
+static_assert((RtLog::CAPACITY & (RtLog::CAPACITY - 1)) == 0,
+              "RtLog::CAPACITY must be a power of two");
+
+static RtLogRing &ring() {
+  static RtLogRing sRing;
+  return sRing;
+}
+
+RtLog::Record *RtLog::claim() {
+  RtLogRing &r = ring();
+  uint32_t position = r.enqueue.load(std::memory_order_relaxed);
+  while (true) {
+    Record &record = r.records[position & (CAPACITY - 1)];
+    const uint32_t sequence = record.sequence.load(std::memory_order_acquire);
+    const int32_t lag = static_cast<int32_t>(sequence - position);
+    if (lag == 0) {
+      if (r.enqueue.compare_exchange_weak(position, position + 1,
+                                          std::memory_order_relaxed)) {
+        record.position = position;
+        return &record;
+      }
+      // position was reloaded by the failed exchange
+    } else if (lag < 0) {
+      // Still holds last lap's message: the flusher is behind
+      r.dropped.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    } else {
+      position = r.enqueue.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void RtLog::publish(Record *record) {
+  record->sequence.store(record->position + 1, std::memory_order_release);
+}
+
+void RtLog::flush() {
+  RtLogRing &r = ring();
+  char line[LINE_BYTES];
+  while (true) {
+    Record &record = r.records[r.dequeue & (CAPACITY - 1)];
+    if (record.sequence.load(std::memory_order_acquire) != r.dequeue + 1) {
+      return; // Empty, or the next producer hasn't finished its record
+    }
+    record.print(record, line, sizeof(line));
+    writeLine(record.level, record.tag, line);
+    record.sequence.store(r.dequeue + CAPACITY, std::memory_order_release);
+    ++r.dequeue;
+  }
+}
+
+uint32_t RtLog::droppedCount() {
+  return ring().dropped.load(std::memory_order_relaxed);
+}
+
+void RtLog::start() {
+  if (sFlusherRunning.exchange(true)) {
+    return;
+  }
+  ring(); // Construct before any audio thread can post
+  sFlusher = std::thread([] {
+    while (sFlusherRunning.load(std::memory_order_acquire)) {
+      flush();
+      std::this_thread::sleep_for(
+          std::chrono::milliseconds(FLUSH_INTERVAL_MS));
+    }
+  });
+}
+
+void RtLog::stop() {
+  if (!sFlusherRunning.exchange(false)) {
+    return;
+  }
+  if (sFlusher.joinable()) {
+    sFlusher.join();
+  }
+  flush();
+}
+
+} // namespace synthio
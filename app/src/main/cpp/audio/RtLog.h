@@ -0,0 +1,118 @@
+#ifndef SYNTHIO_RT_LOG_H
+#define SYNTHIO_RT_LOG_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+namespace synthio {
+
+/**
+ * Logging that is safe on the audio thread (RT_LOGI / RT_LOGE in Log.h).
+ *
+ * Posting doesn't format or allocate anything: the tag, the format string
+ * and the raw argument bytes are copied into a fixed-size record of a
+ * lock-free ring, and a background thread formats the records and writes
+ * them to logcat. A full ring drops the record (and counts it) instead of
+ * waiting. Since the record is read later on another thread, the tag and
+ * format must be string literals and the arguments numbers or pointers to
+ * static strings.
+ *
+ * Any number of threads may post; one thread flushes.
+ */
+class RtLog {
+public:
+  enum Level { INFO, ERROR };
+
+  static constexpr int CAPACITY = 256; // Records, a power of two
+  static constexpr int ARG_BYTES = 48;
+
+  // Flusher thread (control threads). Records posted while it is stopped
+  // wait in the ring.
+  static void start();
+  static void stop();
+
+  // Formats and writes out everything posted so far. One caller at a time:
+  // the flusher thread, or whoever stopped it.
+  static void flush();
+
+  // Records lost to a full ring since startup
+  static uint32_t droppedCount();
+
+  template <typename... Args>
+  static void post(Level level, const char *tag, const char *format,
+                   Args... args) {
+    static_assert((ARG_BYTES >= (sizeof(Args) + ... + 0)),
+                  "Too many arguments for one log record");
+    static_assert((... && (std::is_arithmetic<Args>::value ||
+                           std::is_same<Args, const char *>::value)),
+                  "Log arguments must be numbers or static strings");
+    Record *record = claim();
+    if (record == nullptr) {
+      return;
+    }
+    record->level = level;
+    record->tag = tag;
+    record->format = format;
+    record->print = &print<Args...>;
+    size_t offset = 0;
+    (store(record->args, offset, args), ...);
+    (void)offset; // Unused without arguments
+    publish(record);
+  }
+
+private:
+  friend struct RtLogRing;
+
+  struct Record {
+    std::atomic<uint32_t> sequence; // Ring bookkeeping, see RtLog.cpp
+    uint32_t position;
+    Level level;
+    const char *tag;
+    const char *format;
+    void (*print)(const Record &record, char *out, size_t size);
+    alignas(8) unsigned char args[ARG_BYTES];
+  };
+
+  template <typename T>
+  static void store(unsigned char *bytes, size_t &offset, T value) {
+    std::memcpy(bytes + offset, &value, sizeof(T));
+    offset += sizeof(T);
+  }
+
+  template <typename T>
+  static T load(const unsigned char *bytes, size_t &offset) {
+    T value;
+    std::memcpy(&value, bytes + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+  }
+
+  template <typename... Args>
+  static void print(const Record &record, char *out, size_t size) {
+    if constexpr (sizeof...(Args) == 0) {
+      std::snprintf(out, size, "%s", record.format);
+    } else {
+      size_t offset = 0;
+      // Braced initialization loads the arguments in order
+      std::tuple<Args...> args{load<Args>(record.args, offset)...};
+      std::apply(
+          [&](Args... values) {
+            std::snprintf(out, size, record.format, values...);
+          },
+          args);
+    }
+  }
+
+  // nullptr when the ring is full
+  static Record *claim();
+  static void publish(Record *record);
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_RT_LOG_H
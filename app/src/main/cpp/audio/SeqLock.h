@@ -0,0 +1,80 @@
+#ifndef SYNTHIO_SEQ_LOCK_H
+#define SYNTHIO_SEQ_LOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+namespace synthio {
+
+/**
+ * Single-writer sequence lock for publishing a small snapshot.
+ *
+ * The writer (the audio callback) never waits: it bumps the sequence to an
+ * odd value, stores the payload and bumps it back to even. Readers copy the
+ * payload and retry if the sequence was odd or changed underneath them, so
+ * they always get a snapshot taken as a whole. The payload is stored as
+ * relaxed atomic words, which keeps the racing copy well defined.
+ */
+template <typename T> class SeqLock {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SeqLock payload must be trivially copyable");
+
+public:
+  SeqLock() {
+    T initial{};
+    store(initial);
+  }
+
+  SeqLock(const SeqLock &) = delete;
+  SeqLock &operator=(const SeqLock &) = delete;
+
+  // Single writer only. Wait-free.
+  void store(const T &value) {
+    uint64_t words[WORDS] = {};
+    std::memcpy(words, &value, sizeof(T));
+
+    uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+    mSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; ++i) {
+      mWords[i].store(words[i], std::memory_order_relaxed);
+    }
+    mSequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  // Any thread. Retries while a store is in flight.
+  T load() const {
+    uint64_t words[WORDS];
+    for (;;) {
+      uint32_t before = mSequence.load(std::memory_order_acquire);
+      if (before & 1) {
+        std::this_thread::yield();
+        continue;
+      }
+      for (size_t i = 0; i < WORDS; ++i) {
+        words[i] = mWords[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (mSequence.load(std::memory_order_relaxed) == before) {
+        break;
+      }
+    }
+
+    T value;
+    std::memcpy(&value, words, sizeof(T));
+    return value;
+  }
+
+private:
+  static constexpr size_t WORDS = (sizeof(T) + 7) / 8;
+
+  std::atomic<uint32_t> mSequence{0};
+  std::atomic<uint64_t> mWords[WORDS];
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_SEQ_LOCK_H
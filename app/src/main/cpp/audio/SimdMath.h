@@ -0,0 +1,188 @@
+#ifndef SYNTHIO_SIMD_MATH_H
+#define SYNTHIO_SIMD_MATH_H
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SYNTHIO_SIMD_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64) || defined(__x86_64__)
+#include <emmintrin.h>
+#define SYNTHIO_SIMD_SSE 1
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define SYNTHIO_SIMD_WASM 1
+#endif
+
+namespace synthio {
+
+/**
+ * Minimal 4-lane float vector used by the vectorized DSP kernels.
+ *
+ * NEON on ARM (armeabi-v7a / arm64-v8a), SSE2 on the x86 emulator images,
+ * SIMD128 in the WebAssembly build (-msimd128) and a plain scalar struct
+ * everywhere else, so the kernels build on any host.
+ * Only the operations the kernels actually need are provided.
+ */
+#if defined(SYNTHIO_SIMD_NEON)
+using float4 = float32x4_t;
+using mask4 = uint32x4_t;
+constexpr bool kHasSimd = true;
+
+inline float4 load4(const float *p) { return vld1q_f32(p); }
+inline void store4(float *p, float4 v) { vst1q_f32(p, v); }
+inline float4 splat4(float x) { return vdupq_n_f32(x); }
+inline float4 add4(float4 a, float4 b) { return vaddq_f32(a, b); }
+inline float4 sub4(float4 a, float4 b) { return vsubq_f32(a, b); }
+inline float4 mul4(float4 a, float4 b) { return vmulq_f32(a, b); }
+inline float4 min4(float4 a, float4 b) { return vminq_f32(a, b); }
+inline float4 max4(float4 a, float4 b) { return vmaxq_f32(a, b); }
+inline float4 abs4(float4 a) { return vabsq_f32(a); }
+inline float4 div4(float4 a, float4 b) {
+#if defined(__aarch64__)
+  return vdivq_f32(a, b);
+#else
+  // ARMv7 has no vector divide: reciprocal estimate + two Newton steps
+  float4 r = vrecpeq_f32(b);
+  r = vmulq_f32(vrecpsq_f32(b, r), r);
+  r = vmulq_f32(vrecpsq_f32(b, r), r);
+  return vmulq_f32(a, r);
+#endif
+}
+inline mask4 lt4(float4 a, float4 b) { return vcltq_f32(a, b); }
+inline mask4 le4(float4 a, float4 b) { return vcleq_f32(a, b); }
+inline mask4 gt4(float4 a, float4 b) { return vcgtq_f32(a, b); }
+inline mask4 ge4(float4 a, float4 b) { return vcgeq_f32(a, b); }
+inline mask4 and4(mask4 a, mask4 b) { return vandq_u32(a, b); }
+// Lane-wise (m ? a : b)
+inline float4 select4(mask4 m, float4 a, float4 b) { return vbslq_f32(m, a, b); }
+inline bool anyTrue4(mask4 m) {
+  uint32x2_t folded = vorr_u32(vget_low_u32(m), vget_high_u32(m));
+  return (vget_lane_u32(folded, 0) | vget_lane_u32(folded, 1)) != 0;
+}
+
+#elif defined(SYNTHIO_SIMD_SSE)
+using float4 = __m128;
+using mask4 = __m128;
+constexpr bool kHasSimd = true;
+
+inline float4 load4(const float *p) { return _mm_loadu_ps(p); }
+inline void store4(float *p, float4 v) { _mm_storeu_ps(p, v); }
+inline float4 splat4(float x) { return _mm_set1_ps(x); }
+inline float4 add4(float4 a, float4 b) { return _mm_add_ps(a, b); }
+inline float4 sub4(float4 a, float4 b) { return _mm_sub_ps(a, b); }
+inline float4 mul4(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+inline float4 div4(float4 a, float4 b) { return _mm_div_ps(a, b); }
+inline float4 min4(float4 a, float4 b) { return _mm_min_ps(a, b); }
+inline float4 max4(float4 a, float4 b) { return _mm_max_ps(a, b); }
+inline float4 abs4(float4 a) {
+  return _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+}
+inline mask4 lt4(float4 a, float4 b) { return _mm_cmplt_ps(a, b); }
+inline mask4 le4(float4 a, float4 b) { return _mm_cmple_ps(a, b); }
+inline mask4 gt4(float4 a, float4 b) { return _mm_cmpgt_ps(a, b); }
+inline mask4 ge4(float4 a, float4 b) { return _mm_cmpge_ps(a, b); }
+inline mask4 and4(mask4 a, mask4 b) { return _mm_and_ps(a, b); }
+inline float4 select4(mask4 m, float4 a, float4 b) {
+  return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+inline bool anyTrue4(mask4 m) { return _mm_movemask_ps(m) != 0; }
+
+#elif defined(SYNTHIO_SIMD_WASM)
+using float4 = v128_t;
+using mask4 = v128_t;
+constexpr bool kHasSimd = true;
+
+inline float4 load4(const float *p) { return wasm_v128_load(p); }
+inline void store4(float *p, float4 v) { wasm_v128_store(p, v); }
+inline float4 splat4(float x) { return wasm_f32x4_splat(x); }
+inline float4 add4(float4 a, float4 b) { return wasm_f32x4_add(a, b); }
+inline float4 sub4(float4 a, float4 b) { return wasm_f32x4_sub(a, b); }
+inline float4 mul4(float4 a, float4 b) { return wasm_f32x4_mul(a, b); }
+inline float4 div4(float4 a, float4 b) { return wasm_f32x4_div(a, b); }
+// pmin/pmax(b, a) are (a < b ? a : b) / (a > b ? a : b), like the scalar
+// path; the IEEE min/max would differ on NaN and signed zeros
+inline float4 min4(float4 a, float4 b) { return wasm_f32x4_pmin(b, a); }
+inline float4 max4(float4 a, float4 b) { return wasm_f32x4_pmax(b, a); }
+inline float4 abs4(float4 a) { return wasm_f32x4_abs(a); }
+inline mask4 lt4(float4 a, float4 b) { return wasm_f32x4_lt(a, b); }
+inline mask4 le4(float4 a, float4 b) { return wasm_f32x4_le(a, b); }
+inline mask4 gt4(float4 a, float4 b) { return wasm_f32x4_gt(a, b); }
+inline mask4 ge4(float4 a, float4 b) { return wasm_f32x4_ge(a, b); }
+inline mask4 and4(mask4 a, mask4 b) { return wasm_v128_and(a, b); }
+inline float4 select4(mask4 m, float4 a, float4 b) {
+  return wasm_v128_bitselect(a, b, m);
+}
+inline bool anyTrue4(mask4 m) { return wasm_v128_any_true(m); }
+
+#else
+struct float4 {
+  float v[4];
+};
+struct mask4 {
+  bool v[4];
+};
+constexpr bool kHasSimd = false;
+
+#define SYNTHIO_LANEWISE(expr)                                                 \
+  float4 r;                                                                    \
+  for (int i = 0; i < 4; ++i)                                                  \
+    r.v[i] = (expr);                                                           \
+  return r
+#define SYNTHIO_LANEMASK(expr)                                                 \
+  mask4 r;                                                                     \
+  for (int i = 0; i < 4; ++i)                                                  \
+    r.v[i] = (expr);                                                           \
+  return r
+
+inline float4 load4(const float *p) { SYNTHIO_LANEWISE(p[i]); }
+inline void store4(float *p, float4 v) { std::memcpy(p, v.v, sizeof(v.v)); }
+inline float4 splat4(float x) { SYNTHIO_LANEWISE(x); }
+inline float4 add4(float4 a, float4 b) { SYNTHIO_LANEWISE(a.v[i] + b.v[i]); }
+inline float4 sub4(float4 a, float4 b) { SYNTHIO_LANEWISE(a.v[i] - b.v[i]); }
+inline float4 mul4(float4 a, float4 b) { SYNTHIO_LANEWISE(a.v[i] * b.v[i]); }
+inline float4 div4(float4 a, float4 b) { SYNTHIO_LANEWISE(a.v[i] / b.v[i]); }
+inline float4 min4(float4 a, float4 b) {
+  SYNTHIO_LANEWISE(a.v[i] < b.v[i] ? a.v[i] : b.v[i]);
+}
+inline float4 max4(float4 a, float4 b) {
+  SYNTHIO_LANEWISE(a.v[i] > b.v[i] ? a.v[i] : b.v[i]);
+}
+inline float4 abs4(float4 a) {
+  SYNTHIO_LANEWISE(a.v[i] < 0.0f ? -a.v[i] : a.v[i]);
+}
+inline mask4 lt4(float4 a, float4 b) { SYNTHIO_LANEMASK(a.v[i] < b.v[i]); }
+inline mask4 le4(float4 a, float4 b) { SYNTHIO_LANEMASK(a.v[i] <= b.v[i]); }
+inline mask4 gt4(float4 a, float4 b) { SYNTHIO_LANEMASK(a.v[i] > b.v[i]); }
+inline mask4 ge4(float4 a, float4 b) { SYNTHIO_LANEMASK(a.v[i] >= b.v[i]); }
+inline mask4 and4(mask4 a, mask4 b) { SYNTHIO_LANEMASK(a.v[i] && b.v[i]); }
+inline float4 select4(mask4 m, float4 a, float4 b) {
+  SYNTHIO_LANEWISE(m.v[i] ? a.v[i] : b.v[i]);
+}
+inline bool anyTrue4(mask4 m) { return m.v[0] || m.v[1] || m.v[2] || m.v[3]; }
+
+#undef SYNTHIO_LANEWISE
+#undef SYNTHIO_LANEMASK
+#endif
+
+// a * b + c (kept as separate ops so NEON/SSE/scalar round identically)
+inline float4 madd4(float4 a, float4 b, float4 c) {
+  return add4(mul4(a, b), c);
+}
+
+// Gather element i of four separate arrays into one vector
+inline float4 gather4(const float *const *src, int i) {
+  alignas(16) float lanes[4] = {src[0][i], src[1][i], src[2][i], src[3][i]};
+  return load4(lanes);
+}
+
+inline float hsum4(float4 v) {
+  alignas(16) float lanes[4];
+  store4(lanes, v);
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+} // namespace synthio
+
+#endif // SYNTHIO_SIMD_MATH_H
@@ -0,0 +1,146 @@
+#ifndef SYNTHIO_SMOOTHED_PARAMETER_H
+#define SYNTHIO_SMOOTHED_PARAMETER_H
+
+namespace synthio {
+
+// Ramp length for user-facing gains and mixes: long enough to hide the
+// step, short enough that a knob still feels direct
+constexpr float PARAMETER_RAMP_TIME = 0.02f; // 20 ms
+
+/**
+ * A parameter that moves to a new value along a linear ramp instead of
+ * jumping.
+ *
+ * The ramp advances once per block: nextBlock() hands back the start value
+ * and a per-frame increment, so the inner loop is a plain multiply-add that
+ * vectorizes, and a parameter at rest costs one branch per block. A ramp
+ * that would end inside a block is stretched to the block's last frame, so
+ * every block is a single straight segment.
+ *
+ * Setters and processing run on the audio thread (parameter changes arrive
+ * through the engine's event queue); there is no internal synchronization.
+ */
+class SmoothedParameter {
+public:
+  // Value of frame i of a block is start + step * (i + 1); the last frame
+  // lands on the value the next block starts from
+  struct Ramp {
+    float start;
+    float step;
+
+    bool isConstant() const { return step == 0.0f; }
+    float at(int frame) const {
+      return start + step * static_cast<float>(frame + 1);
+    }
+  };
+
+  explicit SmoothedParameter(float value = 0.0f)
+      : mCurrent(value), mTarget(value) {}
+
+  void setRampTime(float seconds, float sampleRate) {
+    setRampFrames(static_cast<int>(seconds * sampleRate));
+  }
+
+  void setRampFrames(int frames) { mRampFrames = frames < 1 ? 1 : frames; }
+
+  // Starts a ramp from wherever the value is now
+  void setTarget(float target) {
+    if (target == mTarget) {
+      return;
+    }
+    mTarget = target;
+    mRemaining = mRampFrames;
+  }
+
+  // Jumps straight to the target, e.g. while the output is silent anyway
+  void snap() {
+    mCurrent = mTarget;
+    mRemaining = 0;
+  }
+
+  void snap(float value) {
+    mTarget = value;
+    snap();
+  }
+
+  float getTarget() const { return mTarget; }
+  float getCurrent() const { return mCurrent; }
+  bool isSmoothing() const { return mRemaining > 0; }
+
+  Ramp nextBlock(int numFrames) {
+    const float start = mCurrent;
+    if (mRemaining <= 0) {
+      return {start, 0.0f};
+    }
+    float step;
+    if (mRemaining <= numFrames) {
+      step = (mTarget - start) / static_cast<float>(numFrames);
+      mCurrent = mTarget;
+      mRemaining = 0;
+    } else {
+      step = (mTarget - start) / static_cast<float>(mRemaining);
+      mCurrent = start + step * static_cast<float>(numFrames);
+      mRemaining -= numFrames;
+    }
+    return {start, step};
+  }
+
+  // Per-sample advance for the legacy process() paths
+  float nextValue() {
+    if (mRemaining > 0) {
+      mCurrent += (mTarget - mCurrent) / static_cast<float>(mRemaining);
+      if (--mRemaining == 0) {
+        mCurrent = mTarget;
+      }
+    }
+    return mCurrent;
+  }
+
+  // Writes this block's values into out
+  void fill(float *out, int numFrames) {
+    const Ramp ramp = nextBlock(numFrames);
+    for (int i = 0; i < numFrames; ++i) {
+      out[i] = ramp.at(i);
+    }
+  }
+
+  // Multiplies a mono or stereo block by the parameter, in place
+  void applyGain(float *buffer, int numFrames) {
+    const Ramp ramp = nextBlock(numFrames);
+    if (ramp.isConstant()) {
+      for (int i = 0; i < numFrames; ++i) {
+        buffer[i] *= ramp.start;
+      }
+    } else {
+      for (int i = 0; i < numFrames; ++i) {
+        buffer[i] *= ramp.at(i);
+      }
+    }
+  }
+
+  void applyGain(float *left, float *right, int numFrames) {
+    const Ramp ramp = nextBlock(numFrames);
+    if (ramp.isConstant()) {
+      for (int i = 0; i < numFrames; ++i) {
+        left[i] *= ramp.start;
+        right[i] *= ramp.start;
+      }
+    } else {
+      for (int i = 0; i < numFrames; ++i) {
+        const float gain = ramp.at(i);
+        left[i] *= gain;
+        right[i] *= gain;
+      }
+    }
+  }
+
+private:
+  float mCurrent;
+  float mTarget;
+  int mRampFrames = static_cast<int>(PARAMETER_RAMP_TIME * 48000.0f);
+  int mRemaining = 0;
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_SMOOTHED_PARAMETER_H
@@ -0,0 +1,21 @@
+#include "SynthPatch.h"
+#include "Filter.h"
+#include "Voice.h"
+#include <algorithm>
+
+namespace synthio {
+
+VoiceCoefficients VoiceCoefficients::compute(const VoicePatch &voice,
+                                             float sampleRate) {
+  VoiceCoefficients result;
+  result.ampRates = Envelope::computeRates(voice.attack, voice.decay,
+                                           voice.release, sampleRate);
+  result.hpfCoeff = Filter::computeHPFCoefficient(
+      std::max(0.0f, std::min(1000.0f, voice.hpfCutoff)), sampleRate);
+  result.glideCoeff = Voice::computeGlideCoefficient(
+      std::max(0.0f, std::min(2.0f, voice.glideTime)), sampleRate);
+  result.sampleRate = sampleRate;
+  return result;
+}
+
+} // namespace synthio
@@ -0,0 +1,72 @@
+#ifndef SYNTHIO_SYNTH_PATCH_H
+#define SYNTHIO_SYNTH_PATCH_H
+
+#include "Envelope.h"
+
+namespace synthio {
+
+// Settings every synth voice shares
+struct VoicePatch {
+  bool waveforms[4] = {false, false, true, false}; // Default Sawtooth
+  float pulseWidth = 0.5f;
+  float subOscLevel = 0.0f;
+  float noiseLevel = 0.0f;
+  float filterCutoff = 10000.0f;
+  float filterResonance = 0.0f;
+  float filterEnvAmount = 0.3f;
+  float filterKeyTracking = 0.0f;
+  float hpfCutoff = 0.0f;
+  float attack = 0.01f;
+  float decay = 0.2f;
+  float sustain = 0.7f;
+  float release = 0.3f;
+  float glideTime = 0.0f;
+  bool glideEnabled = false;
+};
+
+// Coefficients derived from a VoicePatch at one sample rate. Computed once
+// per change and copied into each voice, instead of every voice (and every
+// note-on) redoing the divisions and exponentials.
+struct VoiceCoefficients {
+  Envelope::Rates ampRates;
+  float hpfCoeff = 0.0f;
+  float glideCoeff = 1.0f;
+  float sampleRate = 0.0f;
+
+  static VoiceCoefficients compute(const VoicePatch &voice, float sampleRate);
+};
+
+// A complete synth preset as the UI submits it: voice settings, global
+// modulation and the synth's own effects chain
+struct SynthPatch {
+  VoicePatch voice;
+
+  float lfoRate = 1.0f;
+  float lfoPitchDepth = 0.0f;
+  float lfoFilterDepth = 0.0f;
+  float lfoPWMDepth = 0.0f;
+  int chorusMode = 0;
+
+  bool unisonEnabled = false;
+  int unisonVoices = 4;
+  float unisonDetune = 10.0f;
+
+  float tremoloRate = 5.0f;
+  float tremoloDepth = 0.5f;
+  float reverbSize = 0.5f;
+  float reverbMix = 0.3f;
+  float delayTime = 0.25f;
+  float delayFeedback = 0.3f;
+  float delayMix = 0.3f;
+  float volume = 0.7f;
+};
+
+// A patch plus everything the audio thread would otherwise derive from it
+struct PreparedPatch {
+  SynthPatch patch;
+  VoiceCoefficients coefficients;
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_SYNTH_PATCH_H
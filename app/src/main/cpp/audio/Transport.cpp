@@ -0,0 +1,100 @@
+#include "Transport.h"
+#include <algorithm>
+#include <cmath>
+
+namespace synthio {
+
+Transport::Transport() { updateSamplesPerStep(); }
+
+void Transport::setSampleRate(float sampleRate) {
+  // Same fraction of the current step at the new rate
+  const double scale = sampleRate / mSampleRate;
+  mSampleRate = sampleRate;
+  updateSamplesPerStep();
+  mFramesToNextStep *= scale;
+}
+
+void Transport::setBPM(float bpm) {
+  const double previous = mSamplesPerStep;
+  mBPM = std::max(MIN_BPM, std::min(MAX_BPM, bpm));
+  updateSamplesPerStep();
+  // Keep the phase within the step: what remains of it rescales
+  mFramesToNextStep *= mSamplesPerStep / previous;
+}
+
+void Transport::updateSamplesPerStep() {
+  mSamplesPerStep = mSampleRate * 60.0 / mBPM / STEPS_PER_BEAT;
+}
+
+void Transport::start() {
+  mRunning = true;
+  locate(0.0);
+}
+
+void Transport::locate(double steps) {
+  const double whole = std::floor(steps);
+  const double fraction = steps - whole;
+  mStep = static_cast<int>(whole) % STEPS_PER_BAR;
+  if (mStep < 0) {
+    mStep += STEPS_PER_BAR;
+  }
+  if (fraction == 0.0) {
+    mStepPending = true;
+    mFramesToNextStep = mSamplesPerStep;
+  } else {
+    mStepPending = false;
+    mFramesToNextStep = (1.0 - fraction) * mSamplesPerStep;
+  }
+}
+
+int Transport::advance(int numFrames, int64_t loopStart,
+                       TransportEvent *events) {
+  if (!mRunning) {
+    return 0;
+  }
+
+  int count = 0;
+  auto emit = [&](int frame, int step) {
+    if (count < MAX_EVENTS) {
+      events[count++] = {frame, step};
+    }
+  };
+
+  if (mStepPending) {
+    mStepPending = false;
+    emit(0, mStep);
+  }
+
+  int restart = loopStart >= 0 && loopStart < numFrames
+                    ? static_cast<int>(loopStart)
+                    : -1;
+  for (;;) {
+    // First frame at or after the next step's exact position
+    const int next = static_cast<int>(std::ceil(mFramesToNextStep));
+    if (restart >= 0 && restart <= next) {
+      const double stepStart = mFramesToNextStep - mSamplesPerStep;
+      const bool justStarted =
+          mStep == 0 && restart - stepStart < mSamplesPerStep * 0.5;
+      if (count > 0 && events[count - 1].frame == restart) {
+        events[count - 1].step = 0; // Replaces a step on the same frame
+      } else if (!justStarted) {
+        emit(restart, 0);
+      }
+      mStep = 0;
+      mFramesToNextStep = restart + mSamplesPerStep;
+      restart = -1;
+      continue;
+    }
+    if (next >= numFrames) {
+      break;
+    }
+    mStep = (mStep + 1) % STEPS_PER_BAR;
+    emit(next, mStep);
+    mFramesToNextStep += mSamplesPerStep;
+  }
+
+  mFramesToNextStep -= numFrames;
+  return count;
+}
+
+} // namespace synthio
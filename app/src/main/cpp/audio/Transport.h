@@ -0,0 +1,85 @@
+#ifndef SYNTHIO_TRANSPORT_H
+#define SYNTHIO_TRANSPORT_H
+
+#include <cstdint>
+
+namespace synthio {
+
+// A 16th-note step that starts on a given frame of the block being rendered
+struct TransportEvent {
+  int frame; // Offset into the block
+  int step;  // 0-15 within the bar; a beat starts on every fourth
+};
+
+/**
+ * Sample-accurate musical clock: one bar of 16th-note steps at the current
+ * tempo.
+ *
+ * advance() is called once per block, before the block is rendered, and
+ * lists the steps that start inside it with their exact frame. Consumers
+ * (drum machine, metronome) then render uninterrupted sub-blocks between
+ * those frames instead of testing a counter every sample. A step starts on
+ * the first frame at or after its exact (fractional) position, so the grid
+ * never drifts however the tempo divides the sample rate.
+ *
+ * Tempo and sample-rate changes keep the position within the current step,
+ * so a change mid-bar shortens or stretches the step in progress rather than
+ * jumping. Setters and advance() run on the audio thread.
+ */
+class Transport {
+public:
+  static constexpr int STEPS_PER_BEAT = 4;
+  static constexpr int BEATS_PER_BAR = 4;
+  static constexpr int STEPS_PER_BAR = STEPS_PER_BEAT * BEATS_PER_BAR;
+  static constexpr float MIN_BPM = 30.0f;
+  static constexpr float MAX_BPM = 300.0f;
+  // Events one advance() reports at most; a MAX_BLOCK_SIZE block holds one
+  // step and a loop restart at any supported tempo
+  static constexpr int MAX_EVENTS = 16;
+
+  Transport();
+
+  void setSampleRate(float sampleRate);
+  void setBPM(float bpm);
+  float getBPM() const { return mBPM; }
+  double getSamplesPerStep() const { return mSamplesPerStep; }
+
+  // Starts (or restarts) at the top of the bar: step 0 lands on the first
+  // frame of the next block
+  void start();
+  void stop() { mRunning = false; }
+  bool isRunning() const { return mRunning; }
+
+  // Moves to a position in steps from the top of the bar. A whole step
+  // starts on the next frame; a fractional one waits for the next step.
+  void locate(double steps);
+
+  int getStep() const { return mStep; }
+
+  // Advances numFrames and writes the steps starting in them, in frame
+  // order, to events (at least MAX_EVENTS entries); returns the count.
+  //
+  // A loopStart in [0, numFrames) is where an external loop (the looper)
+  // returns to its first beat: the bar restarts on that frame, so the grid
+  // follows the loop exactly rather than drifting against it. When the bar
+  // already started within the last half step, only the phase is corrected,
+  // so the downbeat doesn't sound twice.
+  int advance(int numFrames, int64_t loopStart, TransportEvent *events);
+
+private:
+  float mSampleRate = 48000.0f;
+  float mBPM = 100.0f;
+  double mSamplesPerStep = 0.0;
+
+  bool mRunning = false;
+  bool mStepPending = false; // mStep starts on the next block's first frame
+  int mStep = 0;
+  // Frames from the next block's first frame to the start of the next step
+  double mFramesToNextStep = 0.0;
+
+  void updateSamplesPerStep();
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_TRANSPORT_H
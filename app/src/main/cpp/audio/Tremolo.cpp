@@ -1,5 +1,7 @@
 #define _USE_MATH_DEFINES
 #include "Tremolo.h"
+#include "DSPConfig.h"
+#include "FastMath.h"
 #include <cmath>
 #include <algorithm>
 
@@ -43,7 +45,7 @@ float Tremolo::process(float input) {
     
     // Generate LFO with sine wave
     // LDR response is slightly asymmetric - faster attack than release
-    float lfoValue = std::sin(mPhase * 2.0f * static_cast<float>(M_PI));
+    float lfoValue = sinTwoPi(mPhase);
     
     // Map sine (-1 to 1) to modulation amount
     // Wurlitzer 200A tremolo ranges from subtle wobble to deep pulsing
@@ -68,7 +70,7 @@ void Tremolo::process(float& left, float& right) {
     }
     
     // Generate LFO
-    float lfoValue = std::sin(mPhase * 2.0f * static_cast<float>(M_PI));
+    float lfoValue = sinTwoPi(mPhase);
     
     // Wurlitzer 200A tremolo with increased range
     float modRange = mDepth * 0.70f;
@@ -84,4 +86,53 @@ void Tremolo::process(float& left, float& right) {
     if (mPhase >= 1.0f) mPhase -= 1.0f;
 }
 
+float Tremolo::nextModulation() {
+    float lfoValue = sinTwoPi(mPhase);
+    float modRange = mDepth * 0.70f;
+    float targetMod = 1.0f - modRange * 0.5f * (1.0f - lfoValue);
+    mCurrentMod = mCurrentMod * mSmoothingCoeff + targetMod * (1.0f - mSmoothingCoeff);
+    
+    mPhase += mPhaseIncrement;
+    if (mPhase >= 1.0f) mPhase -= 1.0f;
+    
+    return mCurrentMod;
+}
+
+void Tremolo::skipFrames(int numFrames) {
+    // A gain modulator has no tail, so only the phase needs to stay in time
+    mPhase += mPhaseIncrement * static_cast<float>(numFrames);
+    mPhase -= std::floor(mPhase);
+}
+
+void Tremolo::processBlock(float* left, float* right, int numFrames) {
+    // Skip processing if depth is 0
+    if (mDepth < 0.001f) {
+        return;
+    }
+    if (blockPeak(left, right, numFrames) < SILENCE_THRESHOLD) {
+        skipFrames(numFrames);
+        return;
+    }
+    
+    for (int i = 0; i < numFrames; ++i) {
+        float mod = nextModulation();
+        left[i] *= mod;
+        right[i] *= mod;
+    }
+}
+
+void Tremolo::processBlock(float* buffer, int numFrames) {
+    if (mDepth < 0.001f) {
+        return;
+    }
+    if (blockPeak(buffer, buffer, numFrames) < SILENCE_THRESHOLD) {
+        skipFrames(numFrames);
+        return;
+    }
+    
+    for (int i = 0; i < numFrames; ++i) {
+        buffer[i] *= nextModulation();
+    }
+}
+
 } // namespace synthio
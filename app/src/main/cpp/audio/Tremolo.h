@@ -26,6 +26,11 @@ public:
     
     // Process mono sample
     float process(float input);
+    
+    // Block processing (in place), stereo and mono. Silent blocks only
+    // advance the LFO phase.
+    void processBlock(float* left, float* right, int numFrames);
+    void processBlock(float* buffer, int numFrames);
 
 private:
     float mSampleRate = 48000.0f;
@@ -40,6 +45,12 @@ private:
     float mSmoothingCoeff = 0.999f;
     
     void updatePhaseIncrement();
+    
+    // Keeps the LFO running through a silent block without rendering it
+    void skipFrames(int numFrames);
+    
+    // Advances the LFO one sample and returns the smoothed gain
+    float nextModulation();
 };
 
 } // namespace synthio
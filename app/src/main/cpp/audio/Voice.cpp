@@ -1,10 +1,15 @@
 #include "Voice.h"
+#include "FastMath.h"
+#include "VoiceStealing.h"
 #include <algorithm>
 #include <cmath>
+#include <random>
 
 namespace synthio {
 
-Voice::Voice() : mRng(std::random_device{}()) {
+Voice::Voice() : mNoise(std::random_device{}()) {
+  std::fill(mStackRatio, mStackRatio + MAX_UNISON_STACK, 1.0f);
+
   // Default envelope settings for a nice synth sound
   mAmpEnvelope.setAttack(0.01f);
   mAmpEnvelope.setDecay(0.2f);
@@ -24,6 +29,9 @@ Voice::Voice() : mRng(std::random_device{}()) {
 void Voice::setSampleRate(float sampleRate) {
   mSampleRate = sampleRate;
   mOscillator.setSampleRate(sampleRate);
+  for (Oscillator &osc : mStack) {
+    osc.setSampleRate(sampleRate);
+  }
   mSubOscillator.setSampleRate(sampleRate);
   mFilter.setSampleRate(sampleRate);
   mAmpEnvelope.setSampleRate(sampleRate);
@@ -55,6 +63,7 @@ void Voice::noteOn(int midiNote, float frequency) {
 
   mOscillator.reset();
   mSubOscillator.reset();
+  resetStackPhases(0);
   mFilter.reset();
   mAmpEnvelope.gate(true);
   mFilterEnvelope.gate(true);
@@ -67,12 +76,32 @@ void Voice::noteOff() {
   mState = VoiceState::RELEASING;
 }
 
+void Voice::shed() {
+  mAmpEnvelope.fadeOut(VOICE_SHED_TIME);
+  mFilterEnvelope.gate(false);
+  mState = VoiceState::RELEASING;
+}
+
 void Voice::setWaveform(Waveform waveform) {
   mOscillator.setWaveform(waveform);
+  for (Oscillator &osc : mStack) {
+    osc.setWaveform(waveform);
+  }
 }
 
 void Voice::setWaveformEnabled(Waveform waveform, bool enabled) {
   mOscillator.setWaveformEnabled(waveform, enabled);
+  for (Oscillator &osc : mStack) {
+    osc.setWaveformEnabled(waveform, enabled);
+  }
+}
+
+void Voice::setWavetableEnabled(bool enabled) {
+  mOscillator.setWavetableEnabled(enabled);
+  mSubOscillator.setWavetableEnabled(enabled);
+  for (Oscillator &osc : mStack) {
+    osc.setWavetableEnabled(enabled);
+  }
 }
 
 void Voice::setPulseWidth(float width) {
@@ -101,6 +130,11 @@ void Voice::setFilterKeyTracking(float amount) {
 
 void Voice::setHPFCutoff(float cutoffHz) { mFilter.setHPFCutoff(cutoffHz); }
 
+void Voice::setFilterQuality(int controlInterval, bool oversampling) {
+  mFilter.setControlInterval(controlInterval);
+  mFilter.setOversampling(oversampling);
+}
+
 void Voice::setAttack(float time) { mAmpEnvelope.setAttack(time); }
 
 void Voice::setDecay(float time) { mAmpEnvelope.setDecay(time); }
@@ -122,17 +156,60 @@ void Voice::setGlideEnabled(bool enabled) {
 }
 
 void Voice::updateGlideCoefficient() {
-  if (mGlideTime <= 0.0f) {
-    mGlideCoeff = 1.0f; // Instant
+  mGlideCoeff = computeGlideCoefficient(mGlideTime, mSampleRate);
+}
+
+float Voice::computeGlideCoefficient(float time, float sampleRate) {
+  if (time <= 0.0f) {
+    return 1.0f; // Instant
+  }
+  // Exponential glide: freq = current + (target - current) * (1 - e^(-t/tau))
+  // Per sample: the coefficient determines how much to move toward target
+  float tau = time / 5.0f; // Time constant (reach ~99% in 5*tau)
+  return 1.0f - std::exp(-1.0f / (tau * sampleRate));
+}
+
+void Voice::applyPatch(const VoicePatch &patch,
+                       const VoiceCoefficients &coefficients) {
+  if (coefficients.sampleRate != mSampleRate) {
+    // Prepared for another rate (the stream reopened meanwhile): derive
+    // everything here instead
+    VoiceCoefficients local = VoiceCoefficients::compute(patch, mSampleRate);
+    applyPatch(patch, local);
+    return;
+  }
+
+  for (int i = 0; i < 4; ++i) {
+    setWaveformEnabled(static_cast<Waveform>(i), patch.waveforms[i]);
+  }
+  setPulseWidth(patch.pulseWidth);
+  setSubOscLevel(patch.subOscLevel);
+  setNoiseLevel(patch.noiseLevel);
+
+  mFilterBaseCutoff = patch.filterCutoff;
+  mFilterEnvAmount = patch.filterEnvAmount;
+  if (mState != VoiceState::IDLE) {
+    mFilter.rampResonance(patch.filterResonance);
   } else {
-    // Exponential glide: freq = current + (target - current) * (1 - e^(-t/tau))
-    // Per sample: mGlideCoeff determines how much to move toward target
-    float tau = mGlideTime / 5.0f; // Time constant (reach ~99% in 5*tau)
-    mGlideCoeff = 1.0f - std::exp(-1.0f / (tau * mSampleRate));
+    mFilter.setResonance(patch.filterResonance);
   }
+  mFilter.setKeyTracking(patch.filterKeyTracking);
+  mFilter.setHPFCutoff(patch.hpfCutoff, coefficients.hpfCoeff);
+
+  mAmpEnvelope.setADSR(patch.attack, patch.decay, patch.sustain,
+                       patch.release, coefficients.ampRates);
+
+  mGlideTime = std::max(0.0f, std::min(2.0f, patch.glideTime));
+  mGlideCoeff = coefficients.glideCoeff;
+  setGlideEnabled(patch.glideEnabled);
 }
 
-void Voice::applyLFOPitchMod(float semitones) { mLFOPitchMod = semitones; }
+void Voice::applyLFOPitchMod(float semitones) {
+  mLFOPitchMod = semitones;
+  mLFOPitchRatio = fastExp2(semitones / 12.0f);
+}
+
+void Voice::applyLFOPitchRatio(float ratio) { mLFOPitchRatio = ratio; }
 
 void Voice::applyLFOFilterMod(float amount) { mLFOFilterMod = amount; }
 
@@ -141,10 +218,40 @@ void Voice::applyLFOPWMMod(float amount) { mLFOPWMMod = amount; }
 void Voice::setDetune(float cents) {
   // Convert cents to frequency ratio
   // 100 cents = 1 semitone, ratio = 2^(cents/1200)
-  mDetuneRatio = std::pow(2.0f, cents / 1200.0f);
+  mDetuneRatio = fastExp2(cents / 1200.0f);
 }
 
-float Voice::generateNoise() { return mNoiseDist(mRng); }
+void Voice::computeStackRatios(int count, float spreadCents, float *ratios) {
+  count = std::max(1, std::min(MAX_UNISON_STACK, count));
+  // Same spread as the one-voice-per-copy unison: evenly from -spread to
+  // +spread, centre copy (odd counts) undetuned
+  const float step =
+      count > 1 ? spreadCents * 2.0f / static_cast<float>(count - 1) : 0.0f;
+  for (int k = 0; k < count; ++k) {
+    const float cents = count > 1 ? -spreadCents + step * k : 0.0f;
+    ratios[k] = std::pow(2.0f, cents / 1200.0f);
+  }
+}
+
+void Voice::setUnisonStack(int count, const float *ratios) {
+  count = std::max(1, std::min(MAX_UNISON_STACK, count));
+  std::copy(ratios, ratios + count, mStackRatio);
+  if (count > mStackSize && mState != VoiceState::IDLE) {
+    resetStackPhases(mStackSize);
+  }
+  mStackSize = count;
+  mStackGain = 1.0f / std::sqrt(static_cast<float>(count));
+}
+
+void Voice::resetStackPhases(int first) {
+  // Golden-ratio offsets: no two copies start in phase, and the result is
+  // the same every note (unlike free-running or random phases)
+  for (int k = first; k < MAX_UNISON_STACK; ++k) {
+    mStack[k].setPhase(static_cast<float>(k) * 0.618034f);
+  }
+}
+
+float Voice::generateNoise() { return mNoise.next(); }
 
 float Voice::nextSample() {
   if (mState == VoiceState::IDLE) {
@@ -159,8 +266,7 @@ float Voice::nextSample() {
   }
 
   // Apply LFO pitch modulation
-  float pitchModRatio = std::pow(2.0f, mLFOPitchMod / 12.0f);
-  float modulatedFreq = mCurrentFrequency * mDetuneRatio * pitchModRatio;
+  float modulatedFreq = mCurrentFrequency * mDetuneRatio * mLFOPitchRatio;
 
   // Update oscillator frequencies
   mOscillator.setFrequency(modulatedFreq);
@@ -172,7 +278,17 @@ float Voice::nextSample() {
   mOscillator.setPulseWidth(modulatedPW);
 
   // Generate main oscillator sample
-  float mainOsc = mOscillator.nextSample();
+  float mainOsc = 0.0f;
+  if (mStackSize > 1) {
+    for (int k = 0; k < mStackSize; ++k) {
+      mStack[k].setFrequency(modulatedFreq * mStackRatio[k]);
+      mStack[k].setPulseWidth(modulatedPW);
+      mainOsc += mStack[k].nextSample();
+    }
+    mainOsc *= mStackGain;
+  } else {
+    mainOsc = mOscillator.nextSample();
+  }
 
   // Generate sub-oscillator sample
   float subOsc = mSubOscillator.nextSample() * mSubOscLevel;
@@ -214,4 +330,103 @@ float Voice::nextSample() {
   return sample;
 }
 
+void Voice::prepareBlock(VoiceControlBlock &control, const float *pitchRatio,
+                         const float *lfoFilter, const float *lfoPWM,
+                         int numFrames) {
+  float filterEnv[MAX_BLOCK_SIZE];
+
+  // Pitch and pulse width per frame (glide, detune, LFO)
+  const bool glide = mGlideEnabled && mGlideTime > 0.0f;
+  for (int i = 0; i < numFrames; ++i) {
+    if (glide) {
+      mCurrentFrequency += (mTargetFrequency - mCurrentFrequency) * mGlideCoeff;
+    } else {
+      mCurrentFrequency = mTargetFrequency;
+    }
+    control.frequency[i] = mCurrentFrequency * mDetuneRatio * pitchRatio[i];
+    control.pulseWidth[i] =
+        std::max(0.1f, std::min(0.9f, mBasePulseWidth + lfoPWM[i]));
+  }
+
+  mAmpEnvelope.processBlock(control.ampEnv, numFrames);
+  mFilterEnvelope.processBlock(filterEnv, numFrames);
+
+  // Noise is only drawn when it's audible
+  if (mNoiseLevel > 0.0f) {
+    for (int i = 0; i < numFrames; ++i) {
+      control.noise[i] = generateNoise() * mNoiseLevel;
+    }
+  } else {
+    std::fill(control.noise, control.noise + numFrames, 0.0f);
+  }
+
+  // Modulate filter cutoff with envelope and LFO
+  for (int i = 0; i < numFrames; ++i) {
+    float envMod = filterEnv[i] * mFilterEnvAmount * 10000.0f;
+    float lfoMod = lfoFilter[i] * 5000.0f; // LFO can sweep ±5kHz
+    control.cutoff[i] = std::max(
+        20.0f, std::min(20000.0f, mFilterBaseCutoff + envMod + lfoMod));
+  }
+}
+
+void Voice::finishBlock() {
+  if (!mAmpEnvelope.isActive()) {
+    mState = VoiceState::IDLE;
+    mMidiNote = -1;
+    mFirstNote = true; // Reset for next note sequence
+  }
+}
+
+void Voice::processBlock(float *out, const float *pitchRatio,
+                         const float *lfoFilter, const float *lfoPWM,
+                         int numFrames) {
+  if (mState == VoiceState::IDLE) {
+    return;
+  }
+
+  VoiceControlBlock control;
+  prepareBlock(control, pitchRatio, lfoFilter, lfoPWM, numFrames);
+
+  float subFreq[MAX_BLOCK_SIZE];
+  float osc[MAX_BLOCK_SIZE];
+  float sub[MAX_BLOCK_SIZE];
+  for (int i = 0; i < numFrames; ++i) {
+    subFreq[i] = control.frequency[i] * 0.5f;
+  }
+
+  if (mStackSize > 1) {
+    float stackFreq[MAX_BLOCK_SIZE];
+    float copy[MAX_BLOCK_SIZE];
+    std::fill(osc, osc + numFrames, 0.0f);
+    for (int k = 0; k < mStackSize; ++k) {
+      for (int i = 0; i < numFrames; ++i) {
+        stackFreq[i] = control.frequency[i] * mStackRatio[k];
+      }
+      mStack[k].processBlock(copy, stackFreq, control.pulseWidth, numFrames);
+      for (int i = 0; i < numFrames; ++i) {
+        osc[i] += copy[i] * mStackGain;
+      }
+    }
+  } else {
+    mOscillator.processBlock(osc, control.frequency, control.pulseWidth,
+                             numFrames);
+  }
+  mSubOscillator.processBlock(sub, subFreq, nullptr, numFrames);
+
+  // Mix sources (before filter)
+  const float mixLevel = getMixLevel();
+  for (int i = 0; i < numFrames; ++i) {
+    osc[i] = (osc[i] + sub[i] * mSubOscLevel + control.noise[i]) / mixLevel;
+  }
+
+  mFilter.processBlock(osc, control.cutoff, numFrames);
+
+  // VCA (the amp envelope outputs 0 once it reaches IDLE mid-block)
+  for (int i = 0; i < numFrames; ++i) {
+    out[i] += osc[i] * control.ampEnv[i];
+  }
+
+  finishBlock();
+}
+
 } // namespace synthio
@@ -1,15 +1,30 @@
 #ifndef SYNTHIO_VOICE_H
 #define SYNTHIO_VOICE_H
 
+#include "DSPConfig.h"
 #include "Envelope.h"
 #include "Filter.h"
 #include "Oscillator.h"
-#include <random>
+#include "NoiseSource.h"
+#include "SynthPatch.h"
 
 namespace synthio {
 
 enum class VoiceState { IDLE, ACTIVE, RELEASING };
 
+// Detuned copies of the main oscillator one voice can stack for unison
+constexpr int MAX_UNISON_STACK = 8;
+
+// Per-frame control signals for one block of a voice. Built by
+// Voice::prepareBlock and consumed by either the scalar path or VoiceBank.
+struct VoiceControlBlock {
+  float frequency[MAX_BLOCK_SIZE];  // Main oscillator (sub = half)
+  float pulseWidth[MAX_BLOCK_SIZE]; // Modulated PW
+  float noise[MAX_BLOCK_SIZE];      // Noise, already scaled by level
+  float ampEnv[MAX_BLOCK_SIZE];     // VCA envelope
+  float cutoff[MAX_BLOCK_SIZE];     // Modulated filter cutoff (Hz)
+};
+
 /**
  * Enhanced voice with Juno-106 style features:
  * - Sub-oscillator (square wave, one octave below)
@@ -17,21 +32,33 @@ enum class VoiceState { IDLE, ACTIVE, RELEASING };
  * - Glide/Portamento
  * - LFO modulation inputs
  * - Key tracking for filter
+ *
+ * Members are laid out hot first: what every rendered block reads and writes
+ * fills the leading cache lines, the unison copies come next (touched only
+ * while stacking), and settings only read by setters and note events come
+ * last. Voices are cache-line aligned so neighbours in the voice array never
+ * share a line.
  */
-class Voice {
+class alignas(64) Voice {
 public:
   Voice();
 
   void setSampleRate(float sampleRate);
 
+  // Restarts the noise sequence from seed (reproducible renders)
+  void seedNoise(uint32_t seed) { mNoise.seed(seed); }
+
   // Note control
   void noteOn(int midiNote, float frequency);
   void noteOff();
+  // Fades out within VOICE_SHED_TIME; for voices over the voice limit
+  void shed();
 
   // Oscillator Parameters
   void setWaveform(Waveform waveform);
   void setWaveformEnabled(Waveform waveform, bool enabled);
   void setPulseWidth(float width); // For square wave PWM
+  void setWavetableEnabled(bool enabled);
 
   // Sub-oscillator
   void setSubOscLevel(float level); // 0.0 to 1.0
@@ -45,6 +72,8 @@ public:
   void setFilterEnvelopeAmount(float amount);
   void setFilterKeyTracking(float amount);
   void setHPFCutoff(float cutoffHz);
+  // Filter control interval and 2x oversampling (quality tier)
+  void setFilterQuality(int controlInterval, bool oversampling);
 
   // ADSR
   void setAttack(float time);
@@ -55,46 +84,78 @@ public:
   // Glide (Portamento)
   void setGlideTime(float time); // 0 = off, up to 2 seconds
   void setGlideEnabled(bool enabled);
+  static float computeGlideCoefficient(float time, float sampleRate);
+
+  // Every shared setting at once, with coefficients computed for this
+  // voice's sample rate. A sounding voice ramps its resonance to the new
+  // value instead of jumping.
+  void applyPatch(const VoicePatch &patch,
+                  const VoiceCoefficients &coefficients);
 
   // LFO modulation inputs (applied from global LFO)
   void applyLFOPitchMod(float semitones);
+  void applyLFOPitchRatio(float ratio); // Same, already as 2^(st/12)
   void applyLFOFilterMod(float amount); // -1 to 1
   void applyLFOPWMMod(float amount);    // -0.4 to 0.4
 
   // Unison detuning (for unison mode)
   void setDetune(float cents); // Detune amount in cents
 
+  // Stacked unison: the main oscillator becomes count copies spread evenly
+  // across +/- spreadCents, summed before the voice's one filter and VCA.
+  // count 1 is a plain single oscillator. Copies added while the voice is
+  // sounding start from their spread phase. ratios holds count frequency
+  // ratios from computeStackRatios(), worked out once per spread/count
+  // change rather than on every note.
+  void setUnisonStack(int count, const float *ratios);
+  static void computeStackRatios(int count, float spreadCents, float *ratios);
+  int getUnisonStackSize() const { return mStackSize; }
+
   // Processing
   float nextSample();
 
+  // Block processing: adds numFrames samples to out. pitchRatio is the
+  // per-frame LFO pitch multiplier (shared by every voice, see
+  // PolyphonyManager::buildPitchRatio); lfoFilter/lfoPWM are the raw filter
+  // and PWM modulation from the global LFO.
+  void processBlock(float *out, const float *pitchRatio, const float *lfoFilter,
+                    const float *lfoPWM, int numFrames);
+
+  // Block stages used by processBlock() and the vectorized VoiceBank:
+  // prepareBlock runs every control-rate stage (glide, LFO, envelopes, noise,
+  // cutoff modulation); finishBlock retires the voice once its amp envelope
+  // has ended.
+  void prepareBlock(VoiceControlBlock &control, const float *pitchRatio,
+                    const float *lfoFilter, const float *lfoPWM,
+                    int numFrames);
+  void finishBlock();
+
+  // Source mix normalization (sub and noise levels are global)
+  float getSubOscLevel() const { return mSubOscLevel; }
+  float getMixLevel() const {
+    return 1.0f + mSubOscLevel * 0.5f + mNoiseLevel * 0.5f;
+  }
+
   // State queries
   bool isActive() const { return mState != VoiceState::IDLE; }
   int getMidiNote() const { return mMidiNote; }
   VoiceState getState() const { return mState; }
+  bool isReleasing() const { return mState == VoiceState::RELEASING; }
+  float getLevel() const { return mAmpEnvelope.getLevel(); }
   float getFrequency() const { return mTargetFrequency; }
 
 private:
-  // Oscillators
-  Oscillator mOscillator;
-  Oscillator mSubOscillator; // Sub-osc (always square, one octave below)
-
-  // Filter and envelopes
-  Filter mFilter;
-  Envelope mAmpEnvelope;
-  Envelope mFilterEnvelope;
-
-  // Noise generator
-  std::mt19937 mRng;
-  std::uniform_real_distribution<float> mNoiseDist{-1.0f, 1.0f};
-  float mNoiseLevel = 0.0f;
-
-  // Sub-oscillator level
-  float mSubOscLevel = 0.0f;
+  friend class VoiceBank; // Loads/stores oscillator and filter state
 
-  // State
+  // ===== HOT: every block =====
   VoiceState mState = VoiceState::IDLE;
   int mMidiNote = -1;
-  float mSampleRate = 48000.0f;
+
+  // Oscillators
+  Oscillator mOscillator;
+  Oscillator mSubOscillator; // Sub-osc (always square, one octave below)
+  int mStackSize = 1;
+  float mStackGain = 1.0f; // 1 / sqrt(mStackSize), keeps the level steady
 
   // Frequency and glide
   float mTargetFrequency = 440.0f;
@@ -102,10 +163,12 @@ private:
   float mGlideTime = 0.0f;
   float mGlideCoeff = 1.0f; // Exponential glide coefficient
   bool mGlideEnabled = false;
-  bool mFirstNote = true;
+  float mDetuneRatio = 1.0f; // Detune for unison
 
-  // Detune for unison
-  float mDetuneRatio = 1.0f;
+  // Source levels and noise generator
+  float mSubOscLevel = 0.0f;
+  float mNoiseLevel = 0.0f;
+  NoiseSource mNoise;
 
   // Filter modulation
   float mFilterBaseCutoff = 10000.0f;
@@ -113,13 +176,30 @@ private:
 
   // LFO modulation values (set externally)
   float mLFOPitchMod = 0.0f;  // In semitones
+  float mLFOPitchRatio = 1.0f; // 2^(mLFOPitchMod / 12)
   float mLFOFilterMod = 0.0f; // -1 to 1
   float mLFOPWMMod = 0.0f;    // -0.4 to 0.4
   float mBasePulseWidth = 0.5f;
 
+  // Envelopes and filter
+  Envelope mAmpEnvelope;
+  Envelope mFilterEnvelope;
+  Filter mFilter;
+
+  // ===== WARM: unison stacking only =====
+  // Replaces mOscillator while mStackSize > 1. The copies track every
+  // oscillator setting; only phase and detune ratio differ.
+  Oscillator mStack[MAX_UNISON_STACK];
+  float mStackRatio[MAX_UNISON_STACK];
+
+  // ===== COLD: setters and note events =====
+  float mSampleRate = 48000.0f;
+  bool mFirstNote = true;
+
   // Helper methods
   void updateGlideCoefficient();
   float generateNoise();
+  void resetStackPhases(int first);
 };
 
 } // namespace synthio
@@ -0,0 +1,495 @@
+#include "VoiceBank.h"
+#include "Denormals.h"
+#include "FastMath.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace synthio {
+
+namespace {
+
+// Waveform selection shared by every lane of an oscillator kernel
+struct WaveformSet {
+  bool sine, square, saw, triangle;
+  int count;
+  float layerGain; // 1.1 / sqrt(N), same staging as Oscillator
+};
+
+WaveformSet waveformSet(const bool enabled[4]) {
+  WaveformSet set;
+  set.sine = enabled[static_cast<int>(Waveform::SINE)];
+  set.square = enabled[static_cast<int>(Waveform::SQUARE)];
+  set.saw = enabled[static_cast<int>(Waveform::SAWTOOTH)];
+  set.triangle = enabled[static_cast<int>(Waveform::TRIANGLE)];
+  set.count = set.sine + set.square + set.saw + set.triangle;
+  set.layerGain = set.count > 1
+                      ? 1.1f / std::sqrt(static_cast<float>(set.count))
+                      : 1.0f;
+  return set;
+}
+
+// Oscillator::polyBlep for four lanes
+inline float4 polyBlep4(float4 t, float4 dt) {
+  const float4 one = splat4(1.0f);
+  float4 u = div4(t, dt);
+  float4 head = sub4(add4(u, u), add4(mul4(u, u), one));
+  float4 v = div4(sub4(t, one), dt);
+  float4 tail = add4(add4(mul4(v, v), add4(v, v)), one);
+  return select4(lt4(t, dt), head,
+                 select4(gt4(t, sub4(one, dt)), tail, splat4(0.0f)));
+}
+
+// One sample of Oscillator::nextSample for four lanes (phase not advanced)
+inline float4 oscillator4(const WaveformSet &set, float4 phase, float4 dt,
+                          float4 pulseWidth) {
+  const float4 one = splat4(1.0f);
+  float4 sample = splat4(0.0f);
+
+  if (set.sine) {
+    sample = add4(sample, sinTwoPi4(phase));
+  }
+  if (set.square) {
+    float4 sq = select4(lt4(phase, pulseWidth), one, splat4(-1.0f));
+    // fmod(phase - pw + 1, 1): the argument is always in (0, 2)
+    float4 shifted = add4(sub4(phase, pulseWidth), one);
+    shifted = select4(ge4(shifted, one), sub4(shifted, one), shifted);
+    sq = add4(sq, polyBlep4(phase, dt));
+    sq = sub4(sq, polyBlep4(shifted, dt));
+    sample = add4(sample, sq);
+  }
+  if (set.saw) {
+    float4 saw = sub4(mul4(splat4(2.0f), phase), one);
+    sample = add4(sample, sub4(saw, polyBlep4(phase, dt)));
+  }
+  if (set.triangle) {
+    float4 rising = sub4(mul4(splat4(4.0f), phase), one);
+    float4 falling = sub4(splat4(3.0f), mul4(splat4(4.0f), phase));
+    sample = add4(sample, select4(lt4(phase, splat4(0.5f)), rising, falling));
+  }
+
+  if (set.count > 1) {
+    sample = tanh4(mul4(sample, splat4(set.layerGain)));
+  }
+  return sample;
+}
+
+// Wavetable::lookup for four lanes (the table read itself is a gather)
+inline float4 wavetable4(const Wavetable &table, float4 phase, float4 dt) {
+  alignas(16) float phases[4], dts[4], out[4];
+  store4(phases, phase);
+  store4(dts, dt);
+  for (int lane = 0; lane < 4; ++lane) {
+    out[lane] = table.lookup(phases[lane], dts[lane]);
+  }
+  return load4(out);
+}
+
+inline float4 advancePhase4(float4 phase, float4 dt) {
+  const float4 one = splat4(1.0f);
+  phase = add4(phase, dt);
+  return select4(ge4(phase, one), sub4(phase, one), phase);
+}
+
+// Filter::softSaturate for four lanes
+inline float4 softSaturate4(float4 x) {
+  const float4 threshold = splat4(0.8f);
+  float4 absX = abs4(x);
+  mask4 over = gt4(absX, threshold);
+  if (!anyTrue4(over)) {
+    return x; // Common case: every lane is in the transparent region
+  }
+  float4 excess = sub4(absX, threshold);
+  float4 compressed = madd4(splat4(0.2f), tanh4(mul4(excess, splat4(3.0f))),
+                            threshold);
+  float4 negative = sub4(splat4(0.0f), compressed);
+  float4 saturated =
+      select4(gt4(x, splat4(0.0f)), compressed, negative);
+  return select4(over, saturated, x);
+}
+
+// Zero NaN state, plus the manual denormal flush on targets without an FTZ
+// mode, matching Filter::lowPass
+inline float4 sanitize4(float4 y) {
+  float4 absY = abs4(y);
+  mask4 keep = le4(absY, splat4(FLT_MAX)); // False for NaN
+#if !SYNTHIO_HAS_FTZ
+  keep = and4(keep, ge4(absY, splat4(1e-20f)));
+#endif
+  return select4(keep, y, splat4(0.0f));
+}
+
+// Silent, finite inputs for lanes without a voice
+void fillIdleLane(VoiceControlBlock &control, FilterCoefficientBlock &coeffs,
+                  int numFrames) {
+  std::fill(control.frequency, control.frequency + numFrames, 440.0f);
+  std::fill(control.pulseWidth, control.pulseWidth + numFrames, 0.5f);
+  std::fill(control.noise, control.noise + numFrames, 0.0f);
+  std::fill(control.ampEnv, control.ampEnv + numFrames, 0.0f);
+  std::fill(coeffs.a0, coeffs.a0 + numFrames, 0.0f);
+  std::fill(coeffs.a1, coeffs.a1 + numFrames, 0.0f);
+  std::fill(coeffs.a2, coeffs.a2 + numFrames, 0.0f);
+  std::fill(coeffs.b1, coeffs.b1 + numFrames, 0.0f);
+  std::fill(coeffs.b2, coeffs.b2 + numFrames, 0.0f);
+}
+
+} // namespace
+
+int VoiceBank::processBlock(Voice *voices, const int *voiceIndices,
+                            int numIndices, float *out,
+                            const float *pitchRatio, const float *lfoFilter,
+                            const float *lfoPWM, int numFrames) {
+  if (numFrames <= 0) {
+    return 0;
+  }
+
+  Voice *group[LANES];
+  int lanes = 0;
+  int activeCount = 0;
+
+  for (int n = 0; n < numIndices; ++n) {
+    Voice &voice = voices[voiceIndices[n]];
+    if (!voice.isActive()) {
+      continue;
+    }
+    activeCount++;
+    group[lanes++] = &voice;
+    if (lanes == LANES) {
+      renderGroup(group, lanes, out, pitchRatio, lfoFilter, lfoPWM, numFrames);
+      lanes = 0;
+    }
+  }
+  if (lanes > 0) {
+    renderGroup(group, lanes, out, pitchRatio, lfoFilter, lfoPWM, numFrames);
+  }
+  return activeCount;
+}
+
+void VoiceBank::renderGroup(Voice *const *group, int numLanes, float *out,
+                            const float *pitchRatio, const float *lfoFilter,
+                            const float *lfoPWM, int numFrames) {
+  // ===== Control rate (scalar, per voice) =====
+  for (int lane = 0; lane < LANES; ++lane) {
+    if (lane < numLanes) {
+      Voice &voice = *group[lane];
+      voice.prepareBlock(mControl[lane], pitchRatio, lfoFilter, lfoPWM,
+                         numFrames);
+      voice.mFilter.computeCoefficients(mControl[lane].cutoff,
+                                        mCoefficients[lane], numFrames);
+    } else {
+      fillIdleLane(mControl[lane], mCoefficients[lane], numFrames);
+    }
+  }
+
+  // ===== Load lane state =====
+  alignas(16) float phase[LANES] = {}, subPhase[LANES] = {};
+  alignas(16) float subPW[LANES] = {};
+  alignas(16) float x1[LANES] = {}, x2[LANES] = {};
+  alignas(16) float y1[LANES] = {}, y2[LANES] = {};
+  alignas(16) float dcState[LANES] = {}, hpfState[LANES] = {};
+  alignas(16) float sampleRate[LANES], subLevel[LANES] = {};
+  alignas(16) float mixLevel[LANES], gainComp[LANES], hpfCoeff[LANES] = {};
+  alignas(16) float bassBoost[LANES] = {}, bassMode[LANES] = {};
+  alignas(16) float up[3][LANES] = {}, down[5][LANES] = {};
+
+  for (int lane = 0; lane < LANES; ++lane) {
+    sampleRate[lane] = 48000.0f;
+    mixLevel[lane] = 1.0f;
+    gainComp[lane] = 1.0f;
+    subPW[lane] = 0.5f;
+    if (lane >= numLanes) {
+      continue;
+    }
+    const Voice &voice = *group[lane];
+    const Filter &filter = voice.mFilter;
+    phase[lane] = voice.mOscillator.mPhase;
+    subPhase[lane] = voice.mSubOscillator.mPhase;
+    subPW[lane] = voice.mSubOscillator.mPulseWidth;
+    sampleRate[lane] = voice.mOscillator.mSampleRate;
+    subLevel[lane] = voice.getSubOscLevel();
+    mixLevel[lane] = voice.getMixLevel();
+    x1[lane] = filter.mX1;
+    x2[lane] = filter.mX2;
+    y1[lane] = filter.mY1;
+    y2[lane] = filter.mY2;
+    dcState[lane] = filter.mDCBlockState;
+    hpfState[lane] = filter.mHPFState;
+    gainComp[lane] = 1.0f / (1.0f + filter.mResonance * 2.0f);
+    hpfCoeff[lane] = filter.mHPFCoeff;
+    bassBoost[lane] = filter.mBassBoostAmount;
+    bassMode[lane] = filter.mHPFCutoff < 1.0f ? 1.0f : 0.0f;
+    for (int k = 0; k < 3; ++k) {
+      up[k][lane] = filter.mUpHistory[k];
+    }
+    for (int k = 0; k < 5; ++k) {
+      down[k][lane] = filter.mDownHistory[k];
+    }
+  }
+
+  // Oversampling is global (set with the quality tier on every voice)
+  const bool oversample = group[0]->mFilter.mOversample;
+
+  // A stacked lane in the group moves every lane's main oscillator out of
+  // the loop: stacks render vectorized across their copies, the rest
+  // through their own oscillator
+  bool preRendered = false;
+  for (int lane = 0; lane < numLanes; ++lane) {
+    preRendered = preRendered || group[lane]->mStackSize > 1;
+  }
+  const float *mainOscs[LANES];
+  for (int lane = 0; lane < LANES; ++lane) {
+    mainOscs[lane] = mMainOsc[lane];
+    if (!preRendered) {
+      continue;
+    }
+    if (lane >= numLanes) {
+      std::fill(mMainOsc[lane], mMainOsc[lane] + numFrames, 0.0f);
+    } else if (group[lane]->mStackSize > 1) {
+      renderStack(*group[lane], mControl[lane], mMainOsc[lane], numFrames);
+    } else {
+      group[lane]->mOscillator.processBlock(mMainOsc[lane],
+                                            mControl[lane].frequency,
+                                            mControl[lane].pulseWidth,
+                                            numFrames);
+    }
+  }
+
+  // Waveform selection is global (PolyphonyManager sets it on every voice)
+  const WaveformSet mainSet =
+      waveformSet(group[0]->mOscillator.mEnabledWaveforms);
+  const WaveformSet subSet =
+      waveformSet(group[0]->mSubOscillator.mEnabledWaveforms);
+
+  // Wavetables are used only when every lane can use the same one
+  const Wavetable *mainTable = group[0]->mOscillator.activeWavetable(
+      mControl[0].pulseWidth, numFrames);
+  const Wavetable *subTable =
+      group[0]->mSubOscillator.activeWavetable(nullptr, numFrames);
+  for (int lane = 1; lane < numLanes; ++lane) {
+    const Voice &voice = *group[lane];
+    if (voice.mOscillator.activeWavetable(mControl[lane].pulseWidth,
+                                          numFrames) != mainTable) {
+      mainTable = nullptr;
+    }
+    if (voice.mSubOscillator.activeWavetable(nullptr, numFrames) != subTable) {
+      subTable = nullptr;
+    }
+  }
+
+  float4 vPhase = load4(phase), vSubPhase = load4(subPhase);
+  float4 vX1 = load4(x1), vX2 = load4(x2);
+  float4 vY1 = load4(y1), vY2 = load4(y2);
+  float4 vDC = load4(dcState), vHPF = load4(hpfState);
+  const float4 vSampleRate = load4(sampleRate);
+  const float4 vSubPW = min4(max4(load4(subPW), splat4(0.01f)), splat4(0.99f));
+  const float4 vSubLevel = load4(subLevel), vMixLevel = load4(mixLevel);
+  const float4 vGainComp = load4(gainComp), vHPFCoeff = load4(hpfCoeff);
+  const float4 vBassBoost = load4(bassBoost);
+  const mask4 vBassMode = gt4(load4(bassMode), splat4(0.5f));
+  float4 vUp0 = load4(up[0]), vUp1 = load4(up[1]), vUp2 = load4(up[2]);
+  float4 vDown0 = load4(down[0]), vDown1 = load4(down[1]);
+  float4 vDown2 = load4(down[2]), vDown3 = load4(down[3]);
+  float4 vDown4 = load4(down[4]);
+
+  const float *freqs[LANES], *pws[LANES], *noises[LANES], *amps[LANES];
+  const float *a0s[LANES], *a1s[LANES], *a2s[LANES], *b1s[LANES], *b2s[LANES];
+  for (int lane = 0; lane < LANES; ++lane) {
+    freqs[lane] = mControl[lane].frequency;
+    pws[lane] = mControl[lane].pulseWidth;
+    noises[lane] = mControl[lane].noise;
+    amps[lane] = mControl[lane].ampEnv;
+    a0s[lane] = mCoefficients[lane].a0;
+    a1s[lane] = mCoefficients[lane].a1;
+    a2s[lane] = mCoefficients[lane].a2;
+    b1s[lane] = mCoefficients[lane].b1;
+    b2s[lane] = mCoefficients[lane].b2;
+  }
+
+  float4 vFreq = splat4(440.0f), vDt = splat4(0.0f), vPW = splat4(0.5f);
+
+  // ===== Audio rate (4 voices per vector) =====
+  for (int i = 0; i < numFrames; ++i) {
+    vFreq = gather4(freqs, i);
+    vDt = div4(vFreq, vSampleRate);
+    float4 vSubDt = div4(mul4(vFreq, splat4(0.5f)), vSampleRate);
+    vPW = min4(max4(gather4(pws, i), splat4(0.01f)), splat4(0.99f));
+
+    // Oscillators
+    float4 mainOsc = preRendered ? gather4(mainOscs, i)
+                     : mainTable ? wavetable4(*mainTable, vPhase, vDt)
+                                 : oscillator4(mainSet, vPhase, vDt, vPW);
+    float4 subOsc = subTable ? wavetable4(*subTable, vSubPhase, vSubDt)
+                             : oscillator4(subSet, vSubPhase, vSubDt, vSubPW);
+    vPhase = advancePhase4(vPhase, vDt);
+    vSubPhase = advancePhase4(vSubPhase, vSubDt);
+
+    // Source mix (before filter)
+    float4 input = madd4(subOsc, vSubLevel, mainOsc);
+    input = div4(add4(input, gather4(noises, i)), vMixLevel);
+
+    // Low-pass biquad (Direct Form I)
+    const float4 a0 = gather4(a0s, i), a1 = gather4(a1s, i);
+    const float4 a2 = gather4(a2s, i), b1 = gather4(b1s, i);
+    const float4 b2 = gather4(b2s, i);
+    auto lowPass = [&](float4 x) {
+      float4 y = mul4(a0, x);
+      y = madd4(a1, vX1, y);
+      y = madd4(a2, vX2, y);
+      y = sub4(y, mul4(b1, vY1));
+      y = sub4(y, mul4(b2, vY2));
+      y = softSaturate4(y);
+
+      vX2 = vX1;
+      vX1 = x;
+      vY2 = vY1;
+      vY1 = softSaturate4(y);
+      vY1 = sanitize4(vY1); // vY2 was sanitized as the previous vY1
+      return y;
+    };
+
+    float4 lpf;
+    if (oversample) {
+      // Filter::lowPassOversampled: halfband up, two biquad steps at twice
+      // the rate, halfband down
+      float4 mid = sub4(mul4(splat4(9.0f), add4(vUp0, vUp1)), add4(vUp2, input));
+      mid = mul4(mid, splat4(1.0f / 16.0f));
+      const float4 first = lowPass(vUp1);
+      const float4 second = lowPass(mid);
+      vUp2 = vUp1;
+      vUp1 = vUp0;
+      vUp0 = input;
+
+      lpf = madd4(splat4(9.0f), add4(vDown0, vDown2),
+                  mul4(splat4(16.0f), vDown1));
+      lpf = mul4(sub4(lpf, add4(second, vDown4)), splat4(1.0f / 32.0f));
+      vDown4 = vDown2;
+      vDown3 = vDown1;
+      vDown2 = vDown0;
+      vDown1 = first;
+      vDown0 = second;
+    } else {
+      lpf = lowPass(input);
+    }
+
+    lpf = mul4(lpf, vGainComp);
+
+    // Bass boost (DC blocked) or one-pole HPF, chosen per lane
+    float4 dcNext = madd4(vDC, splat4(0.999f), mul4(lpf, splat4(0.001f)));
+    float4 hpfNext = madd4(vHPFCoeff, sub4(lpf, vHPF), vHPF);
+    vDC = select4(vBassMode, dcNext, vDC);
+    vHPF = select4(vBassMode, vHPF, hpfNext);
+    float4 filtered = select4(vBassMode, mul4(sub4(lpf, dcNext), vBassBoost),
+                              sub4(lpf, hpfNext));
+
+    // VCA and voice sum
+    out[i] += hsum4(mul4(filtered, gather4(amps, i)));
+  }
+
+  // ===== Store lane state =====
+  alignas(16) float freqOut[LANES], dtOut[LANES], pwOut[LANES];
+  store4(phase, vPhase);
+  store4(subPhase, vSubPhase);
+  store4(x1, vX1);
+  store4(x2, vX2);
+  store4(y1, vY1);
+  store4(y2, vY2);
+  store4(dcState, vDC);
+  store4(hpfState, vHPF);
+  store4(up[0], vUp0);
+  store4(up[1], vUp1);
+  store4(up[2], vUp2);
+  store4(down[0], vDown0);
+  store4(down[1], vDown1);
+  store4(down[2], vDown2);
+  store4(down[3], vDown3);
+  store4(down[4], vDown4);
+  store4(freqOut, vFreq);
+  store4(dtOut, vDt);
+  store4(pwOut, vPW);
+
+  for (int lane = 0; lane < numLanes; ++lane) {
+    Voice &voice = *group[lane];
+    Oscillator &osc = voice.mOscillator;
+    Oscillator &subOsc = voice.mSubOscillator;
+    Filter &filter = voice.mFilter;
+
+    if (!preRendered) {
+      osc.mPhase = phase[lane];
+      osc.mFrequency = freqOut[lane];
+      osc.mPhaseIncrement = dtOut[lane];
+      osc.mPulseWidth = pwOut[lane];
+    }
+    subOsc.mPhase = subPhase[lane];
+    subOsc.mFrequency = freqOut[lane] * 0.5f;
+    subOsc.mPhaseIncrement = subOsc.mFrequency / subOsc.mSampleRate;
+    filter.mX1 = x1[lane];
+    filter.mX2 = x2[lane];
+    filter.mY1 = y1[lane];
+    filter.mY2 = y2[lane];
+    filter.mDCBlockState = dcState[lane];
+    filter.mHPFState = hpfState[lane];
+    for (int k = 0; k < 3; ++k) {
+      filter.mUpHistory[k] = up[k][lane];
+    }
+    for (int k = 0; k < 5; ++k) {
+      filter.mDownHistory[k] = down[k][lane];
+    }
+
+    voice.finishBlock();
+  }
+}
+
+void VoiceBank::renderStack(Voice &voice, const VoiceControlBlock &control,
+                            float *out, int numFrames) {
+  // Every copy shares waveform, pulse width and table; only phase and
+  // detune differ
+  const Oscillator &shape = voice.mStack[0];
+  const WaveformSet set = waveformSet(shape.mEnabledWaveforms);
+  const Wavetable *table = shape.activeWavetable(control.pulseWidth, numFrames);
+  const float4 vSampleRate = splat4(shape.mSampleRate);
+  std::fill(out, out + numFrames, 0.0f);
+
+  for (int first = 0; first < voice.mStackSize; first += LANES) {
+    // Unused lanes run an undetuned copy at zero weight (a zero increment
+    // would divide by zero in polyBLEP)
+    alignas(16) float phase[LANES] = {}, ratio[LANES], weight[LANES] = {};
+    for (int lane = 0; lane < LANES; ++lane) {
+      const int k = first + lane;
+      ratio[lane] = 1.0f;
+      if (k < voice.mStackSize) {
+        phase[lane] = voice.mStack[k].mPhase;
+        ratio[lane] = voice.mStackRatio[k];
+        weight[lane] = voice.mStackGain;
+      }
+    }
+
+    float4 vPhase = load4(phase);
+    const float4 vRatio = load4(ratio), vWeight = load4(weight);
+    for (int i = 0; i < numFrames; ++i) {
+      // Rounded like the scalar copies, (frequency * ratio) / rate, so the
+      // phases don't drift apart over a held note
+      const float4 vDt =
+          div4(mul4(splat4(control.frequency[i]), vRatio), vSampleRate);
+      const float pw = std::max(0.01f, std::min(0.99f, control.pulseWidth[i]));
+      float4 sample = table ? wavetable4(*table, vPhase, vDt)
+                            : oscillator4(set, vPhase, vDt, splat4(pw));
+      out[i] += hsum4(mul4(sample, vWeight));
+      vPhase = advancePhase4(vPhase, vDt);
+    }
+
+    store4(phase, vPhase);
+    const float lastFreq = control.frequency[numFrames - 1];
+    const float lastPW =
+        std::max(0.01f, std::min(0.99f, control.pulseWidth[numFrames - 1]));
+    for (int lane = 0; lane < LANES && first + lane < voice.mStackSize;
+         ++lane) {
+      Oscillator &osc = voice.mStack[first + lane];
+      osc.mPhase = phase[lane];
+      osc.mFrequency = lastFreq * voice.mStackRatio[first + lane];
+      osc.mPhaseIncrement = osc.mFrequency / osc.mSampleRate;
+      osc.mPulseWidth = lastPW;
+    }
+  }
+}
+
+} // namespace synthio
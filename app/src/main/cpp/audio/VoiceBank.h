@@ -0,0 +1,57 @@
+#ifndef SYNTHIO_VOICE_BANK_H
+#define SYNTHIO_VOICE_BANK_H
+
+#include "Filter.h"
+#include "SimdMath.h"
+#include "Voice.h"
+
+namespace synthio {
+
+/**
+ * Vectorized renderer for a set of Voices.
+ *
+ * Active voices are packed four at a time into SIMD lanes (NEON on ARM, SSE
+ * on x86). Control-rate work (glide, LFO, envelopes, noise, cutoff smoothing)
+ * still runs per voice through Voice::prepareBlock; the audio-rate kernels -
+ * main and sub oscillators, source mix, biquad LPF, HPF/bass boost and VCA -
+ * run in struct-of-arrays form with one lane per voice.
+ *
+ * Voice objects remain the owners of all state: each group's oscillator
+ * phases and filter history are loaded into vectors at the block start and
+ * written back at the end, so the scalar Voice::processBlock path can be
+ * swapped in at any block boundary. Output matches the scalar path to within
+ * 1.2e-4 after the effect chain, which synthio_bench --parity enforces.
+ *
+ * Voices with a unison stack render their main oscillator ahead of the
+ * audio-rate loop, vectorized across the stack's copies rather than across
+ * voices (four detuned phases per vector), and the loop then picks the
+ * result up like any other per-lane input.
+ */
+class VoiceBank {
+public:
+  static constexpr int LANES = 4;
+
+  // Adds the mono sum of the listed voices (indices into voices) to out,
+  // skipping any that are idle. Returns the number of voices that were
+  // active at the start of the block.
+  int processBlock(Voice *voices, const int *voiceIndices, int numIndices,
+                   float *out,
+                   const float *pitchRatio, const float *lfoFilter,
+                   const float *lfoPWM, int numFrames);
+
+private:
+  VoiceControlBlock mControl[LANES];
+  FilterCoefficientBlock mCoefficients[LANES];
+  float mMainOsc[LANES][MAX_BLOCK_SIZE]; // Pre-rendered main oscillators
+
+  void renderStack(Voice &voice, const VoiceControlBlock &control,
+                   float *out, int numFrames);
+
+  void renderGroup(Voice *const *group, int numLanes, float *out,
+                   const float *pitchRatio, const float *lfoFilter,
+                   const float *lfoPWM, int numFrames);
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_VOICE_BANK_H
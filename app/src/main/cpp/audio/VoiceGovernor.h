@@ -0,0 +1,70 @@
+#ifndef SYNTHIO_VOICE_GOVERNOR_H
+#define SYNTHIO_VOICE_GOVERNOR_H
+
+namespace synthio {
+
+/**
+ * Keeps the number of sounding voices inside the callback's CPU budget.
+ *
+ * Fed the load of every callback (percent of the burst budget). When the
+ * smoothed load stays high it cuts the voice budget below the voices that
+ * are sounding, so the engines shed their quietest voices instead of the
+ * stream underrunning; once the load has been comfortable for a while the
+ * budget grows back one voice at a time. Near the limit it also reports
+ * pressure, which makes voice stealing favour quiet and releasing voices.
+ *
+ * Audio thread only.
+ */
+class VoiceGovernor {
+public:
+  explicit VoiceGovernor(int maxBudget) : mMaxBudget(maxBudget), mBudget(maxBudget) {}
+
+  // After each callback: load in percent, voices sounding, burst length
+  void update(float loadPercent, int activeVoices, int numFrames,
+              int sampleRate) {
+    mLoad += LOAD_SMOOTHING * (loadPercent - mLoad);
+    const float seconds =
+        sampleRate > 0 ? static_cast<float>(numFrames) / sampleRate : 0.0f;
+    mHoldoff -= seconds;
+
+    if (mLoad > SHED_LOAD && mHoldoff <= 0.0f) {
+      // Shed in proportion to the voice count, then wait for the load to
+      // show the effect before shedding again
+      const int cut = activeVoices / 4 > 1 ? activeVoices / 4 : 1;
+      const int budget = activeVoices - cut;
+      mBudget = budget > MIN_BUDGET ? budget : MIN_BUDGET;
+      mHoldoff = SHED_HOLDOFF_SECONDS;
+      mComfortable = 0.0f;
+    } else if (mLoad < RECOVER_LOAD && mBudget < mMaxBudget) {
+      mComfortable += seconds;
+      if (mComfortable >= RECOVER_STEP_SECONDS) {
+        mBudget++;
+        mComfortable = 0.0f;
+      }
+    } else {
+      mComfortable = 0.0f;
+    }
+  }
+
+  int getBudget() const { return mBudget; }
+  bool isUnderPressure() const { return mLoad > PRESSURE_LOAD; }
+
+private:
+  static constexpr float LOAD_SMOOTHING = 0.2f; // Rides over single spikes
+  static constexpr float PRESSURE_LOAD = 70.0f;
+  static constexpr float SHED_LOAD = 85.0f;
+  static constexpr float RECOVER_LOAD = 50.0f;
+  static constexpr float SHED_HOLDOFF_SECONDS = 0.1f;
+  static constexpr float RECOVER_STEP_SECONDS = 0.5f;
+  static constexpr int MIN_BUDGET = 4;
+
+  int mMaxBudget;
+  int mBudget;
+  float mLoad = 0.0f;
+  float mHoldoff = 0.0f;
+  float mComfortable = 0.0f;
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_VOICE_GOVERNOR_H
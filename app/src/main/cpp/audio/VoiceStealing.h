@@ -0,0 +1,44 @@
+#ifndef SYNTHIO_VOICE_STEALING_H
+#define SYNTHIO_VOICE_STEALING_H
+
+#include <cstdint>
+
+namespace synthio {
+
+// Fade applied to voices dropped because the voice limit shrank
+constexpr float VOICE_SHED_TIME = 0.01f; // 10 ms
+
+// Picks the sounding voice to take over when the voice limit is reached.
+// Releasing voices go first, quietest first, since they are already on
+// their way out; otherwise the oldest held voice, or the quietest one when
+// the CPU budget is nearly exhausted. Voices flagged in excluded (e.g. the
+// ones just stacked for a unison note) are never chosen. Returns -1 if no
+// voice qualifies.
+//
+// VoiceT needs isActive(), isReleasing() and getLevel().
+template <typename VoiceT>
+int chooseVoiceToSteal(const VoiceT *voices, const uint64_t *ages, int count,
+                       bool underPressure, const bool *excluded = nullptr) {
+  int releasing = -1;
+  int held = -1;
+  for (int i = 0; i < count; ++i) {
+    const VoiceT &voice = voices[i];
+    if (!voice.isActive() || (excluded != nullptr && excluded[i])) {
+      continue;
+    }
+    if (voice.isReleasing()) {
+      if (releasing < 0 || voice.getLevel() < voices[releasing].getLevel()) {
+        releasing = i;
+      }
+    } else if (held < 0 ||
+               (underPressure ? voice.getLevel() < voices[held].getLevel()
+                              : ages[i] < ages[held])) {
+      held = i;
+    }
+  }
+  return releasing >= 0 ? releasing : held;
+}
+
+} // namespace synthio
+
+#endif // SYNTHIO_VOICE_STEALING_H
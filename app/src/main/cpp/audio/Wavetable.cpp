@@ -0,0 +1,144 @@
+#include "Wavetable.h"
+#include "FastMath.h"
+#include "Oscillator.h"
+#include "RtCheck.h"
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace synthio {
+
+namespace {
+
+constexpr int N = Wavetable::TABLE_SIZE;
+constexpr int MAX_HARMONIC = N / 2 - 1; // Harmonics used for the source shape
+constexpr int TOP_HARMONIC = 512;       // Harmonics kept at level 0
+
+std::atomic<const Wavetable *> sTables[WavetableBank::NUM_COMBINATIONS];
+Mutex sBuildMutex; // Serializes builders (control threads only)
+
+bool hasWaveform(int mask, Waveform waveform) {
+  return (mask & (1 << static_cast<int>(waveform))) != 0;
+}
+
+// Builds the table for one combination:
+// 1. Additive synthesis of each enabled waveform at full table resolution
+// 2. Oscillator gain staging (1/sqrt(N) with tanh drive) when layering
+// 3. DFT of the result, then per-level resynthesis with the harmonics cut
+//    to that level's limit (so the tanh's extra partials are band-limited too)
+void buildTable(int mask, float (*levels)[N + 1]) {
+  std::vector<float> sinTable(N), cosTable(N), shape(N, 0.0f);
+  for (int k = 0; k < N; ++k) {
+    double angle = 2.0 * M_PI * k / N;
+    sinTable[k] = static_cast<float>(std::sin(angle));
+    cosTable[k] = static_cast<float>(std::cos(angle));
+  }
+
+  const bool sine = hasWaveform(mask, Waveform::SINE);
+  const bool square = hasWaveform(mask, Waveform::SQUARE);
+  const bool saw = hasWaveform(mask, Waveform::SAWTOOTH);
+  const bool triangle = hasWaveform(mask, Waveform::TRIANGLE);
+  const int activeCount = sine + square + saw + triangle;
+
+  for (int n = 1; n <= MAX_HARMONIC; ++n) {
+    // Fourier series matching Oscillator's naive shapes:
+    //   square   +1/-1 at 50%:  4/pi * sum_odd sin(n x) / n
+    //   saw      2*phase - 1:   -2/pi * sum sin(n x) / n
+    //   triangle 4*phase - 1:   -8/pi^2 * sum_odd cos(n x) / n^2
+    float sinAmp = 0.0f;
+    float cosAmp = 0.0f;
+    if (sine && n == 1) {
+      sinAmp += 1.0f;
+    }
+    if (square && (n & 1)) {
+      sinAmp += static_cast<float>(4.0 / (M_PI * n));
+    }
+    if (saw) {
+      sinAmp -= static_cast<float>(2.0 / (M_PI * n));
+    }
+    if (triangle && (n & 1)) {
+      cosAmp -= static_cast<float>(8.0 / (M_PI * M_PI * n * n));
+    }
+    if (sinAmp == 0.0f && cosAmp == 0.0f) {
+      continue;
+    }
+    for (int k = 0; k < N; ++k) {
+      int index = (n * k) & (N - 1);
+      shape[k] += sinAmp * sinTable[index] + cosAmp * cosTable[index];
+    }
+  }
+
+  if (activeCount > 1) {
+    // Same staging as Oscillator::nextSample, baked in
+    const float layerGain = 1.1f / std::sqrt(static_cast<float>(activeCount));
+    for (int k = 0; k < N; ++k) {
+      shape[k] = fastTanh(shape[k] * layerGain);
+    }
+  }
+
+  // Spectrum of the final shape
+  std::vector<float> re(TOP_HARMONIC + 1, 0.0f), im(TOP_HARMONIC + 1, 0.0f);
+  for (int n = 0; n <= TOP_HARMONIC; ++n) {
+    double sumRe = 0.0, sumIm = 0.0;
+    for (int k = 0; k < N; ++k) {
+      int index = (n * k) & (N - 1);
+      sumRe += shape[k] * cosTable[index];
+      sumIm += shape[k] * sinTable[index];
+    }
+    float scale = (n == 0) ? 1.0f / N : 2.0f / N;
+    re[n] = static_cast<float>(sumRe * scale);
+    im[n] = static_cast<float>(sumIm * scale);
+  }
+
+  // Resynthesize each level with its harmonic limit
+  for (int level = 0; level < Wavetable::NUM_LEVELS; ++level) {
+    const int harmonics = TOP_HARMONIC >> level;
+    float *out = levels[level];
+    for (int k = 0; k < N; ++k) {
+      out[k] = re[0];
+    }
+    for (int n = 1; n <= harmonics; ++n) {
+      if (re[n] == 0.0f && im[n] == 0.0f) {
+        continue;
+      }
+      for (int k = 0; k < N; ++k) {
+        int index = (n * k) & (N - 1);
+        out[k] += re[n] * cosTable[index] + im[n] * sinTable[index];
+      }
+    }
+    out[N] = out[0]; // Guard sample
+  }
+}
+
+} // namespace
+
+void WavetableBank::prepare(int waveformMask) {
+  if (waveformMask <= 0 || waveformMask >= NUM_COMBINATIONS) {
+    return; // Nothing enabled: the oscillator is silent anyway
+  }
+  if (sTables[waveformMask].load(std::memory_order_acquire)) {
+    return;
+  }
+
+  std::lock_guard<Mutex> lock(sBuildMutex);
+  if (sTables[waveformMask].load(std::memory_order_relaxed)) {
+    return; // Built by another thread while we waited
+  }
+
+  // Tables live for the lifetime of the process, so the audio thread can
+  // hold raw pointers without any reclamation scheme
+  auto table = std::make_unique<Wavetable>();
+  buildTable(waveformMask, table->mLevels);
+  sTables[waveformMask].store(table.release(), std::memory_order_release);
+}
+
+const Wavetable *WavetableBank::get(int waveformMask) {
+  if (waveformMask <= 0 || waveformMask >= NUM_COMBINATIONS) {
+    return nullptr;
+  }
+  return sTables[waveformMask].load(std::memory_order_acquire);
+}
+
+} // namespace synthio
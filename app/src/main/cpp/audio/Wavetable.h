@@ -0,0 +1,69 @@
+#ifndef SYNTHIO_WAVETABLE_H
+#define SYNTHIO_WAVETABLE_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace synthio {
+
+/**
+ * Band-limited, mipmapped single-cycle wavetable.
+ *
+ * Each table holds one waveform combination (any mix of sine / square /
+ * saw / triangle) with the oscillator's layer gain staging and tanh soft clip
+ * already baked in, then re-band-limited. Level m keeps harmonics up to
+ * 512 >> m, so picking the level from the phase increment's binary exponent
+ * keeps every partial below Nyquist with one table read per sample.
+ */
+class Wavetable {
+public:
+  static constexpr int TABLE_SIZE = 2048;
+  static constexpr int TABLE_MASK = TABLE_SIZE - 1;
+  static constexpr int NUM_LEVELS = 10; // 512, 256, ... 1 harmonics
+
+  // Linear-interpolated lookup. phase in [0, 1), increment = freq / rate.
+  float lookup(float phase, float increment) const {
+    const float *table = mLevels[levelFor(increment)];
+    float position = phase * TABLE_SIZE;
+    int index = static_cast<int>(position);
+    float frac = position - static_cast<float>(index);
+    index &= TABLE_MASK;
+    return table[index] + (table[index + 1] - table[index]) * frac;
+  }
+
+  // Smallest level whose top harmonic stays below Nyquist: level m holds
+  // 2^(9-m) harmonics, which is alias-free while increment <= 2^(m-10).
+  static int levelFor(float increment) {
+    uint32_t bits;
+    std::memcpy(&bits, &increment, sizeof(bits));
+    int exponent = static_cast<int>((bits >> 23) & 0xff) - 126; // frexp()
+    int level = exponent + 10;
+    return level < 0 ? 0 : (level >= NUM_LEVELS ? NUM_LEVELS - 1 : level);
+  }
+
+private:
+  friend class WavetableBank;
+  // One guard sample per level so lookup() never wraps mid-interpolation
+  float mLevels[NUM_LEVELS][TABLE_SIZE + 1];
+};
+
+/**
+ * Process-wide cache of wavetables, one per waveform combination (bitmask
+ * of Waveform values).
+ *
+ * prepare() builds a table (a few milliseconds) and must only be called from
+ * control threads. get() is lock-free and safe on the audio thread; it
+ * returns nullptr until the combination has been prepared, in which case
+ * oscillators keep using their polyBLEP path.
+ */
+class WavetableBank {
+public:
+  static constexpr int NUM_COMBINATIONS = 16;
+
+  static void prepare(int waveformMask);
+  static const Wavetable *get(int waveformMask);
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_WAVETABLE_H
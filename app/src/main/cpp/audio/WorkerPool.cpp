@@ -0,0 +1,232 @@
+#include "WorkerPool.h"
+#include "Denormals.h"
+#include "Futex.h"
+#include "RtCheck.h"
+#include <algorithm>
+#include <cstdio>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#define LOG_TAG "SynthIO_WorkerPool"
+#include "Log.h"
+
+namespace synthio {
+
+namespace {
+
+// Consecutive blocks with an inline fallback before the pool backs off
+constexpr int FALLBACK_STREAK_LIMIT = 8;
+constexpr int SPINS_BEFORE_SLEEP = 2000;
+constexpr int ANDROID_PRIORITY_AUDIO = -16;
+
+inline void cpuRelax() {
+#if defined(__aarch64__) || defined(__arm__)
+  asm volatile("yield");
+#elif defined(__x86_64__) || defined(__i386__)
+  asm volatile("pause");
+#endif
+}
+
+#if !defined(__EMSCRIPTEN__)
+long cpuMaxFrequency(int cpu) {
+  char path[96];
+  snprintf(path, sizeof(path),
+           "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    return 0;
+  }
+  long frequency = 0;
+  if (fscanf(file, "%ld", &frequency) != 1) {
+    frequency = 0;
+  }
+  fclose(file);
+  return frequency;
+}
+#endif
+
+} // namespace
+
+WorkerPool::~WorkerPool() { stop(); }
+
+bool WorkerPool::start(int numWorkers) {
+  stop();
+#if defined(__EMSCRIPTEN__)
+  numWorkers = 0; // Single-threaded AudioWorklet: everything runs inline
+#endif
+  numWorkers = std::max(0, std::min(MAX_WORKERS, numWorkers));
+  if (numWorkers == 0) {
+    return false;
+  }
+
+  mRunning.store(true, std::memory_order_release);
+  for (int i = 0; i < numWorkers; ++i) {
+    mThreads.emplace_back(&WorkerPool::workerLoop, this);
+  }
+  LOGI("Render worker pool started with %d workers", numWorkers);
+  return true;
+}
+
+void WorkerPool::stop() {
+  if (mThreads.empty()) {
+    return;
+  }
+  mRunning.store(false, std::memory_order_release);
+  mWakeCount.fetch_add(1, std::memory_order_acq_rel);
+  futexWake(mWakeCount, MAX_WORKERS);
+  for (auto &thread : mThreads) {
+    thread.join();
+  }
+  mThreads.clear();
+  LOGI("Render worker pool stopped");
+}
+
+int WorkerPool::submit(JobFunction function, void *context) {
+  if (!isParallel() || mNumJobs >= MAX_JOBS) {
+    function(context);
+    return -1;
+  }
+
+  int index = mNumJobs++;
+  Job &job = mJobs[index];
+  job.function = function;
+  job.context = context;
+  job.state.store(PENDING, std::memory_order_release);
+  mPublished.store(mNumJobs, std::memory_order_release);
+  wake();
+  return index;
+}
+
+void WorkerPool::wait(int job) {
+  if (job < 0 || job >= mNumJobs) {
+    return; // Ran inline
+  }
+
+  Job &entry = mJobs[job];
+  if (tryRun(entry)) {
+    // No worker got to it in time
+    mInlineFallbacks.fetch_add(1, std::memory_order_relaxed);
+    mFallbackThisBlock = true;
+    return;
+  }
+  while (entry.state.load(std::memory_order_acquire) != DONE) {
+    cpuRelax();
+  }
+}
+
+void WorkerPool::waitAll() {
+  for (int i = 0; i < mNumJobs; ++i) {
+    wait(i);
+  }
+  for (int i = 0; i < mNumJobs; ++i) {
+    mJobs[i].state.store(FREE, std::memory_order_relaxed);
+  }
+  mPublished.store(0, std::memory_order_release);
+  mNumJobs = 0;
+
+  // Workers that keep missing their jobs mean the pool is behind: render
+  // single-threaded for a while instead of paying the dispatch cost
+  if (mBackoff > 0) {
+    --mBackoff;
+  } else if (mFallbackThisBlock) {
+    if (++mFallbackStreak >= FALLBACK_STREAK_LIMIT) {
+      mFallbackStreak = 0;
+      mBackoff = BACKOFF_BLOCKS;
+    }
+  } else {
+    mFallbackStreak = 0;
+  }
+  mFallbackThisBlock = false;
+}
+
+bool WorkerPool::tryRun(Job &job) {
+  int expected = PENDING;
+  if (!job.state.compare_exchange_strong(expected, RUNNING,
+                                         std::memory_order_acq_rel)) {
+    return false;
+  }
+  job.function(job.context);
+  job.state.store(DONE, std::memory_order_release);
+  return true;
+}
+
+void WorkerPool::wake() {
+  mWakeCount.fetch_add(1, std::memory_order_acq_rel);
+  futexWake(mWakeCount, 1);
+}
+
+void WorkerPool::workerLoop() {
+  configureWorkerThread();
+  AudioThreadScope audioThread; // Workers run callback stages
+  ScopedFlushToZero flushToZero; // Same FP mode as the callback
+
+  while (mRunning.load(std::memory_order_acquire)) {
+    // Sample the wake word before scanning so a submit that lands after
+    // the scan makes the futex wait return immediately
+    int seen = mWakeCount.load(std::memory_order_acquire);
+
+    bool ran = false;
+    int published = mPublished.load(std::memory_order_acquire);
+    for (int i = 0; i < published; ++i) {
+      if (mJobs[i].state.load(std::memory_order_relaxed) == PENDING &&
+          tryRun(mJobs[i])) {
+        ran = true;
+      }
+    }
+    if (ran) {
+      continue;
+    }
+
+    // Blocks often submit several jobs back to back: spin briefly before
+    // paying for a futex sleep
+    for (int spin = 0; spin < SPINS_BEFORE_SLEEP; ++spin) {
+      if (mWakeCount.load(std::memory_order_acquire) != seen) {
+        break;
+      }
+      cpuRelax();
+    }
+    if (mWakeCount.load(std::memory_order_acquire) == seen) {
+      futexWait(mWakeCount, seen);
+    }
+  }
+}
+
+void WorkerPool::configureWorkerThread() {
+#if !defined(__EMSCRIPTEN__)
+  // Pin to the fastest cluster when the CPUs are heterogeneous
+  const int numCpus = static_cast<int>(sysconf(_SC_NPROCESSORS_CONF));
+  long fastest = 0;
+  long slowest = 0;
+  for (int cpu = 0; cpu < numCpus && cpu < CPU_SETSIZE; ++cpu) {
+    long frequency = cpuMaxFrequency(cpu);
+    if (frequency <= 0) {
+      continue;
+    }
+    fastest = std::max(fastest, frequency);
+    slowest = slowest == 0 ? frequency : std::min(slowest, frequency);
+  }
+  if (fastest > slowest) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < numCpus && cpu < CPU_SETSIZE; ++cpu) {
+      if (cpuMaxFrequency(cpu) > slowest) {
+        CPU_SET(cpu, &set);
+      }
+    }
+    sched_setaffinity(0, sizeof(set), &set);
+  }
+
+  // SCHED_FIFO like the audio callback if permitted, else the audio nice
+  // level apps may use
+  sched_param param{};
+  param.sched_priority = 2;
+  if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)),
+                ANDROID_PRIORITY_AUDIO);
+  }
+#endif
+}
+
+} // namespace synthio
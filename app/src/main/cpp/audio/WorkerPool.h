@@ -0,0 +1,100 @@
+#ifndef SYNTHIO_WORKER_POOL_H
+#define SYNTHIO_WORKER_POOL_H
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace synthio {
+
+/**
+ * Small pool of real-time helper threads for the render graph.
+ *
+ * The audio thread submits independent stages of the current block as jobs
+ * (a function pointer plus context, no allocation) and later waits on them.
+ * Waiting never blocks on a worker that has not picked a job up yet: an
+ * unclaimed job is simply run inline, so the worst case is the plain
+ * single-threaded render. Only jobs a worker is already executing are spun
+ * on. When that fallback hits several blocks in a row the pool is behind
+ * (typically its workers are not being scheduled in time), and submit()
+ * runs everything inline for a while before trying the workers again.
+ *
+ * Workers sleep on a futex between blocks, are pinned to the fastest CPU
+ * cluster and raised to audio priority where the platform allows it.
+ * start()/stop() are control-thread operations and must not overlap with
+ * the audio thread using the pool.
+ */
+class WorkerPool {
+public:
+  using JobFunction = void (*)(void *context);
+
+  static constexpr int MAX_WORKERS = 3;
+  static constexpr int MAX_JOBS = 8; // Per block, between waitAll() calls
+
+  WorkerPool() = default;
+  ~WorkerPool();
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  // Starts numWorkers threads (clamped to MAX_WORKERS). Returns false if no
+  // thread could be started.
+  bool start(int numWorkers);
+  void stop();
+  bool isRunning() const { return mRunning.load(std::memory_order_acquire); }
+  int getNumWorkers() const { return static_cast<int>(mThreads.size()); }
+
+  // ===== AUDIO THREAD =====
+  // Queues a job and returns its handle for wait(). Runs it inline (and
+  // returns a completed handle) when the pool is stopped, full or behind.
+  int submit(JobFunction function, void *context);
+  // Returns once the job has run (inline if no worker has claimed it yet)
+  void wait(int job);
+  // Waits for every job of this block and recycles the job slots
+  void waitAll();
+
+  // False while stopped or backing off: callers can skip splitting their
+  // work when it would run inline anyway
+  bool isParallel() const {
+    return mBackoff == 0 && mRunning.load(std::memory_order_relaxed);
+  }
+
+  // Jobs the audio thread had to run itself because no worker was ready
+  uint64_t getInlineFallbacks() const {
+    return mInlineFallbacks.load(std::memory_order_relaxed);
+  }
+
+private:
+  enum JobState : int { FREE, PENDING, RUNNING, DONE };
+
+  struct Job {
+    std::atomic<int> state{FREE};
+    JobFunction function = nullptr;
+    void *context = nullptr;
+  };
+
+  // Blocks rendered inline once the pool is found to be behind
+  static constexpr int BACKOFF_BLOCKS = 256;
+
+  Job mJobs[MAX_JOBS];
+  // Audio thread only
+  int mNumJobs = 0;
+  int mBackoff = 0;         // Blocks left to run inline
+  int mFallbackStreak = 0;  // Consecutive blocks with an inline fallback
+  bool mFallbackThisBlock = false;
+
+  std::atomic<int> mPublished{0}; // Jobs visible to workers
+  std::atomic<int> mWakeCount{0}; // Futex word, bumped on every submit
+  std::atomic<bool> mRunning{false};
+  std::atomic<uint64_t> mInlineFallbacks{0};
+  std::vector<std::thread> mThreads;
+
+  void workerLoop();
+  bool tryRun(Job &job); // Claims and runs a pending job
+  void wake();
+  static void configureWorkerThread();
+};
+
+} // namespace synthio
+
+#endif // SYNTHIO_WORKER_POOL_H
@@ -1,4 +1,6 @@
 #include "WurlitzerEngine.h"
+#include "DSPConfig.h"
+#include "FastMath.h"
 #include <algorithm>
 #include <cmath>
 
@@ -12,6 +14,12 @@ WurlitzerEngine::WurlitzerEngine() {
     mReverb.setMix(0.0f);     // Off by default
     mDelay.setTime(0.25f);
     mDelay.setMix(0.0f);      // Off by default
+    
+    // Fixed seeds keep renders reproducible; one per voice keeps chords'
+    // hammer transients uncorrelated
+    for (int i = 0; i < WURLI_MAX_VOICES; ++i) {
+        mVoices[i].seedNoise(42 + i);
+    }
 }
 
 void WurlitzerEngine::setSampleRate(float sampleRate) {
@@ -25,6 +33,13 @@ void WurlitzerEngine::setSampleRate(float sampleRate) {
     mChorus.setSampleRate(sampleRate);
     mReverb.setSampleRate(sampleRate);
     mDelay.setSampleRate(sampleRate);
+    mVolume.setRampTime(PARAMETER_RAMP_TIME, sampleRate);
+}
+
+void WurlitzerEngine::setEffectArena(EffectArena* arena) {
+    mChorus.setArena(arena);
+    mReverb.setArena(arena);
+    mDelay.setArena(arena);
 }
 
 void WurlitzerEngine::noteOn(int midiNote, float frequency, float velocity) {
@@ -39,7 +54,7 @@ void WurlitzerEngine::noteOn(int midiNote, float frequency, float velocity) {
     // Find free voice
     int voiceIndex = findFreeVoice();
     if (voiceIndex < 0) {
-        voiceIndex = stealOldestVoice();
+        voiceIndex = stealVoice();
     }
     
     mVoices[voiceIndex].noteOn(midiNote, frequency, velocity);
@@ -82,6 +97,14 @@ void WurlitzerEngine::setReverbMix(float mix) {
     mReverb.setMix(mix);
 }
 
+void WurlitzerEngine::setReverbStereo(bool stereo) {
+    mReverb.setStereo(stereo);
+}
+
+void WurlitzerEngine::setReverbMode(Reverb::Mode mode) {
+    mReverb.setMode(mode);
+}
+
 void WurlitzerEngine::setDelayTime(float time) {
     mDelay.setTime(time);
 }
@@ -95,7 +118,7 @@ void WurlitzerEngine::setDelayMix(float mix) {
 }
 
 void WurlitzerEngine::setVolume(float volume) {
-    mVolume = std::max(0.0f, std::min(1.0f, volume));
+    mVolume.setTarget(std::max(0.0f, std::min(1.0f, volume)));
 }
 
 void WurlitzerEngine::process(float& outLeft, float& outRight) {
@@ -116,7 +139,7 @@ void WurlitzerEngine::process(float& outLeft, float& outRight) {
     }
     
     // Apply volume
-    sum *= mVolume;
+    sum *= mVolume.nextValue();
     
     // ===== EFFECT CHAIN (authentic Wurlitzer signal flow) =====
     
@@ -134,11 +157,109 @@ void WurlitzerEngine::process(float& outLeft, float& outRight) {
     mReverb.process(outLeft, outRight);
     
     // Soft limit to prevent clipping
-    outLeft = std::tanh(outLeft);
-    outRight = std::tanh(outRight);
+    outLeft = fastTanh(outLeft);
+    outRight = fastTanh(outRight);
+}
+
+void WurlitzerEngine::processBlock(float* left, float* right, int numFrames) {
+    float mono[MAX_BLOCK_SIZE];
+    std::fill(mono, mono + numFrames, 0.0f);
+    
+    int activeCount = 0;
+    if (mUseVoiceBank) {
+        WurlitzerVoice* active[WURLI_MAX_VOICES];
+        for (auto& voice : mVoices) {
+            if (voice.isActive()) {
+                active[activeCount++] = &voice;
+            }
+        }
+        for (int first = 0; first < activeCount; first += WurlitzerVoice::LANES) {
+            int lanes = std::min(WurlitzerVoice::LANES, activeCount - first);
+            WurlitzerVoice::processGroup(active + first, lanes, mControl, mono,
+                                         numFrames);
+        }
+    } else {
+        for (auto& voice : mVoices) {
+            if (voice.isActive()) {
+                voice.processBlock(mono, numFrames);
+                activeCount++;
+            }
+        }
+    }
+    
+    // Auto-gain compensation for polyphony, plus volume
+    float voiceGain = 1.0f;
+    if (activeCount > 1) {
+        voiceGain /= std::sqrt(static_cast<float>(activeCount));
+    }
+    const SmoothedParameter::Ramp volume = mVolume.nextBlock(numFrames);
+    for (int i = 0; i < numFrames; ++i) {
+        mono[i] *= volume.at(i) * voiceGain;
+    }
+    
+    // Same effect chain as process(): tremolo -> chorus -> delay -> reverb
+    mTremolo.processBlock(mono, numFrames);
+    mChorus.processBlock(mono, left, right, numFrames);
+    mDelay.processBlock(left, right, numFrames);
+    mReverb.processBlock(left, right, numFrames);
+    
+    int i = 0;
+    for (; i + 4 <= numFrames; i += 4) {
+        store4(left + i, tanh4(load4(left + i)));
+        store4(right + i, tanh4(load4(right + i)));
+    }
+    for (; i < numFrames; ++i) {
+        left[i] = fastTanh(left[i]);
+        right[i] = fastTanh(right[i]);
+    }
+}
+
+int WurlitzerEngine::getActiveVoiceCount() const {
+    int count = 0;
+    for (const auto& voice : mVoices) {
+        if (voice.isActive()) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+void WurlitzerEngine::setPolyphony(int count) {
+    mPolyphony = std::max(1, std::min(WURLI_MAX_VOICES, count));
+    shedExcessVoices();
+}
+
+void WurlitzerEngine::setVoiceBudget(int budget, bool underPressure) {
+    mUnderPressure = underPressure;
+    budget = std::max(1, std::min(WURLI_MAX_VOICES, budget));
+    if (budget == mVoiceBudget) {
+        return;
+    }
+    bool shrinking = budget < mVoiceBudget;
+    mVoiceBudget = budget;
+    if (shrinking) {
+        shedExcessVoices();
+    }
+}
+
+void WurlitzerEngine::shedExcessVoices() {
+    bool shed[WURLI_MAX_VOICES] = {false};
+    int excess = getActiveVoiceCount() - getVoiceLimit();
+    while (excess-- > 0) {
+        int index = chooseVoiceToSteal(mVoices.data(), mVoiceAge, WURLI_MAX_VOICES,
+                                       true, shed);
+        if (index < 0) {
+            break;
+        }
+        mVoices[index].shed();
+        shed[index] = true;
+    }
 }
 
 int WurlitzerEngine::findFreeVoice() {
+    if (getActiveVoiceCount() >= getVoiceLimit()) {
+        return -1;
+    }
     for (int i = 0; i < WURLI_MAX_VOICES; ++i) {
         if (!mVoices[i].isActive()) {
             return i;
@@ -156,18 +277,10 @@ int WurlitzerEngine::findVoiceWithNote(int midiNote) {
     return -1;
 }
 
-int WurlitzerEngine::stealOldestVoice() {
-    uint64_t oldestAge = UINT64_MAX;
-    int oldestIndex = 0;
-    
-    for (int i = 0; i < WURLI_MAX_VOICES; ++i) {
-        if (mVoiceAge[i] < oldestAge) {
-            oldestAge = mVoiceAge[i];
-            oldestIndex = i;
-        }
-    }
-    
-    return oldestIndex;
+int WurlitzerEngine::stealVoice() {
+    int index = chooseVoiceToSteal(mVoices.data(), mVoiceAge, WURLI_MAX_VOICES,
+                                   mUnderPressure);
+    return index >= 0 ? index : 0;
 }
 
 } // namespace synthio
@@ -6,12 +6,18 @@
 #include "Reverb.h"
 #include "Delay.h"
 #include "Chorus.h"
+#include "SimdMath.h"
+#include "SmoothedParameter.h"
+#include "VoiceStealing.h"
+#include <algorithm>
 #include <array>
 #include <cstdint>
 
 namespace synthio {
 
-constexpr int WURLI_MAX_VOICES = 12;
+// Voice storage; the number that may sound at once is set at runtime
+constexpr int WURLI_MAX_VOICES = 32;
+constexpr int WURLI_DEFAULT_POLYPHONY = 12;
 
 /**
  * Wurlitzer 200A polyphonic engine
@@ -23,6 +29,9 @@ public:
     
     void setSampleRate(float sampleRate);
     
+    // Chorus, delay and reverb lines come from the engine's effect arena
+    void setEffectArena(EffectArena* arena);
+    
     // Note control
     void noteOn(int midiNote, float frequency, float velocity);
     void noteOff(int midiNote);
@@ -34,6 +43,8 @@ public:
     void setChorusMode(int mode);  // 0=off, 1=I, 2=II
     void setReverbSize(float size);
     void setReverbMix(float mix);
+    void setReverbStereo(bool stereo);
+    void setReverbMode(Reverb::Mode mode);
     void setDelayTime(float time);
     void setDelayFeedback(float feedback);
     void setDelayMix(float mix);
@@ -41,6 +52,23 @@ public:
     
     // Audio processing - stereo output
     void process(float& outLeft, float& outRight);
+    
+    // Block processing: renders numFrames stereo frames into left/right
+    void processBlock(float* left, float* right, int numFrames);
+    
+    // Voices sounding, including those still releasing
+    int getActiveVoiceCount() const;
+    
+    // Voices that may sound at once (1 - WURLI_MAX_VOICES), and the CPU
+    // budget from the voice governor; see PolyphonyManager
+    void setPolyphony(int count);
+    void setVoiceBudget(int budget, bool underPressure);
+    int getVoiceLimit() const { return std::min(mPolyphony, mVoiceBudget); }
+    
+    // Voice rendering path: all active voices across SIMD lanes (default
+    // when the target has NEON/SSE) or one scalar voice at a time
+    void setVoiceBankEnabled(bool enabled) { mUseVoiceBank = enabled; }
+    bool isVoiceBankEnabled() const { return mUseVoiceBank; }
 
 private:
     std::array<WurlitzerVoice, WURLI_MAX_VOICES> mVoices;
@@ -53,12 +81,21 @@ private:
     Reverb mReverb;
     Delay mDelay;
     
-    float mVolume = 0.7f;
+    SmoothedParameter mVolume{0.7f};
     float mSampleRate = 48000.0f;
     
+    bool mUseVoiceBank = kHasSimd;
+    WurlitzerVoice::ControlBlock mControl[WurlitzerVoice::LANES];
+    
+    int mPolyphony = WURLI_DEFAULT_POLYPHONY;
+    int mVoiceBudget = WURLI_MAX_VOICES;
+    bool mUnderPressure = false;
+    void shedExcessVoices();
+    
+    // Returns -1 once the voice limit is reached
     int findFreeVoice();
     int findVoiceWithNote(int midiNote);
-    int stealOldestVoice();
+    int stealVoice();
 };
 
 } // namespace synthio
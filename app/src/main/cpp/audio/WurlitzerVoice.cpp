@@ -1,8 +1,9 @@
 #define _USE_MATH_DEFINES
 #include "WurlitzerVoice.h"
+#include "FastMath.h"
+#include "VoiceStealing.h"
 #include <cmath>
 #include <algorithm>
-#include <random>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -77,6 +78,19 @@ WurlitzerVoice::WurlitzerVoice() {
 
 void WurlitzerVoice::setSampleRate(float sampleRate) {
     mSampleRate = sampleRate;
+    updateRotation();
+}
+
+void WurlitzerVoice::updateRotation() {
+    double angle = 2.0 * M_PI * mFrequency / mSampleRate;
+    mRotationRe = static_cast<float>(std::cos(angle));
+    mRotationIm = static_cast<float>(std::sin(angle));
+}
+
+void WurlitzerVoice::resyncPartials() {
+    float angle = mPhase1 * 2.0f * static_cast<float>(M_PI);
+    mPartialRe = std::cos(angle);
+    mPartialIm = std::sin(angle);
 }
 
 void WurlitzerVoice::noteOn(int midiNote, float frequency, float velocity) {
@@ -88,10 +102,10 @@ void WurlitzerVoice::noteOn(int midiNote, float frequency, float velocity) {
     
     // Reset oscillator phases
     mPhase1 = 0.0f;
-    mPhase2 = 0.0f;
-    mPhase3 = 0.0f;
-    mPhase4 = 0.0f;
     mPhaseNoise = 0.0f;
+    mPartialRe = 1.0f;
+    mPartialIm = 0.0f;
+    updateRotation();
     
     // Reset state
     mFeedback = 0.0f;
@@ -109,6 +123,13 @@ void WurlitzerVoice::noteOff() {
     mTineEnv.release();
 }
 
+void WurlitzerVoice::shed() {
+    noteOff();
+    // The release is exponential; ~8 time constants reach the cut-off level
+    float shedRate = 8.0f / (VOICE_SHED_TIME * mSampleRate);
+    mAmpEnv.releaseRate = std::max(mAmpEnv.releaseRate, shedRate);
+}
+
 void WurlitzerVoice::setupEnvelopes(float velocity) {
     // Smooth, warm, buttery Wurlitzer character
     // Gentle attack, rich sustain, relaxing tone
@@ -145,7 +166,11 @@ void WurlitzerVoice::setupEnvelopes(float velocity) {
 }
 
 float WurlitzerVoice::sine(float phase) {
-    return std::sin(phase * 2.0f * static_cast<float>(M_PI));
+    // Bark and feedback keep the phase within one cycle of [0, 1), as in
+    // the vectorized path
+    if (phase < 0.0f) phase += 1.0f;
+    if (phase >= 1.0f) phase -= 1.0f;
+    return sinTwoPi(phase);
 }
 
 float WurlitzerVoice::softClip(float x) {
@@ -157,9 +182,7 @@ float WurlitzerVoice::softClip(float x) {
 
 float WurlitzerVoice::generateHammerNoise() {
     // Simple noise for hammer impact transient
-    static std::mt19937 rng(42);
-    static std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
-    return dist(rng);
+    return mHammerNoise.next();
 }
 
 float WurlitzerVoice::nextSample() {
@@ -180,33 +203,40 @@ float WurlitzerVoice::nextSample() {
     // Calculate phase increments
     float phaseInc = mFrequency / mSampleRate;
     
+    // ===== PARTIALS =====
+    // Harmonics 2, 3, 5 and 6 as powers of the fundamental's phasor
+    float re2 = mPartialRe * mPartialRe - mPartialIm * mPartialIm;
+    float im2 = 2.0f * mPartialRe * mPartialIm;
+    float re3 = re2 * mPartialRe - im2 * mPartialIm;
+    float im3 = re2 * mPartialIm + im2 * mPartialRe;
+    float sine5 = im3 * re2 + re3 * im2;
+    float sine6 = 2.0f * re3 * im3;
+    
     // ===== GENTLE ATTACK COLORATION =====
     // Subtle FM modulation for warmth, not aggressive "zing"
-    float barkMod = sine(mPhase4) * mBarkIntensity * barkEnv * 0.8f;  // Reduced modulation
+    float barkMod = sine6 * mBarkIntensity * barkEnv * 0.8f;  // Reduced modulation
     
     // Very subtle hammer transient - almost imperceptible
     float hammerNoise = generateHammerNoise() * barkEnv * barkEnv * 0.03f * mBarkIntensity;
     
     // ===== MAIN OSCILLATORS WITH FM MODULATION =====
-    // Fundamental with bark modulation and slight feedback
+    // Fundamental with bark modulation and slight feedback; the only
+    // partial that needs a real sine, since its phase is modulated
     float fundamental = sine(mPhase1 + barkMod + mFeedback * FEEDBACK_AMOUNT);
     fundamental *= mFundamentalLevel * ampEnv;
     
     // 2nd harmonic (octave) - decays with harmonic envelope
-    // Slight inharmonicity from real reed behavior
-    float second = sine(mPhase2 * TINE_INHARMONICITY);
-    second *= mSecondHarmonicLevel * harmonicEnv * ampEnv;
+    float second = im2 * mSecondHarmonicLevel * harmonicEnv * ampEnv;
     
     // 3rd harmonic - crucial for Wurlitzer's "reedy" character
     // This is what distinguishes it from Rhodes
-    float third = sine(mPhase3 * TINE_INHARMONICITY * TINE_INHARMONICITY);
-    third *= mThirdHarmonicLevel * harmonicEnv * ampEnv;
+    float third = im3 * mThirdHarmonicLevel * harmonicEnv * ampEnv;
     
     // ===== TINE RESONANCE =====
     // Gentle bell-like quality from metal reed vibration
     // Soft, warm overtones
-    float tineResonance = sine(mPhase1 * 4.997f) * 0.025f;  // ~5th partial (softer)
-    tineResonance += sine(mPhase1 * 5.994f) * 0.015f;       // ~6th partial (softer)
+    float tineResonance = sine5 * 0.025f;  // 5th partial (softer)
+    tineResonance += sine6 * 0.015f;       // 6th partial (softer)
     tineResonance *= tineEnv * ampEnv * (0.6f + mVelocity * 0.3f);
     
     // ===== MIX ALL COMPONENTS =====
@@ -228,19 +258,201 @@ float WurlitzerVoice::nextSample() {
     
     // ===== ADVANCE PHASES =====
     mPhase1 += phaseInc;
-    mPhase2 += phaseInc * 2.0f;   // Octave
-    mPhase3 += phaseInc * 3.0f;   // 3rd harmonic
-    mPhase4 += phaseInc * 6.0f;   // FM modulator (higher frequency for bark)
+    float re = mPartialRe * mRotationRe - mPartialIm * mRotationIm;
+    mPartialIm = mPartialRe * mRotationIm + mPartialIm * mRotationRe;
+    mPartialRe = re;
     
-    // Wrap phases to prevent overflow
-    if (mPhase1 >= 1.0f) mPhase1 -= 1.0f;
-    if (mPhase2 >= 1.0f) mPhase2 -= 1.0f;
-    if (mPhase3 >= 1.0f) mPhase3 -= 1.0f;
-    if (mPhase4 >= 1.0f) mPhase4 -= 1.0f;
+    // Wrap the phase, re-deriving the phasor once per cycle
+    if (mPhase1 >= 1.0f) {
+        mPhase1 -= 1.0f;
+        resyncPartials();
+    }
     
     return sample;
 }
 
+void WurlitzerVoice::processBlock(float* out, int numFrames) {
+    for (int i = 0; i < numFrames && mActive; ++i) {
+        out[i] += nextSample();
+    }
+}
+
+// ========== Vectorized rendering ==========
+
+int WurlitzerVoice::prepareBlock(ControlBlock& control, int numFrames) {
+    int active = 0;
+    for (; active < numFrames; ++active) {
+        float ampEnv = mAmpEnv.process();
+        float barkEnv = mBarkEnv.process();
+        float harmonicEnv = mHarmonicEnv.process();
+        float tineEnv = mTineEnv.process();
+        if (!mAmpEnv.isActive()) {
+            mActive = false;
+            break;
+        }
+        control.amp[active] = ampEnv;
+        control.bark[active] = barkEnv;
+        control.harmonic[active] = harmonicEnv;
+        control.tine[active] = tineEnv;
+        control.noise[active] =
+            generateHammerNoise() * barkEnv * barkEnv * 0.03f * mBarkIntensity;
+    }
+    // Frames after the voice ends render silence and are discarded
+    std::fill(control.amp + active, control.amp + numFrames, 0.0f);
+    std::fill(control.bark + active, control.bark + numFrames, 0.0f);
+    std::fill(control.harmonic + active, control.harmonic + numFrames, 0.0f);
+    std::fill(control.tine + active, control.tine + numFrames, 0.0f);
+    std::fill(control.noise + active, control.noise + numFrames, 0.0f);
+    return active;
+}
+
+namespace {
+
+// WurlitzerVoice::softClip for four lanes
+inline float4 softClip4(float4 x) {
+    const float4 one = splat4(1.0f);
+    float4 absX = abs4(x);
+    float4 clipped = sub4(one, div4(one, add4(absX, one)));
+    clipped = select4(lt4(x, splat4(0.0f)), sub4(splat4(0.0f), clipped), clipped);
+    float4 cubic = sub4(x, mul4(mul4(x, mul4(x, x)), splat4(1.0f / 6.0f)));
+    return select4(gt4(absX, one), clipped, cubic);
+}
+
+} // namespace
+
+void WurlitzerVoice::processGroup(WurlitzerVoice* const* voices, int numLanes,
+                                  ControlBlock* control, float* out,
+                                  int numFrames) {
+    // Lane state; idle lanes stay silent and are never written back
+    alignas(16) float phase[LANES] = {}, inc[LANES] = {};
+    alignas(16) float partialRe[LANES] = {1.0f, 1.0f, 1.0f, 1.0f};
+    alignas(16) float partialIm[LANES] = {};
+    alignas(16) float rotationRe[LANES] = {1.0f, 1.0f, 1.0f, 1.0f};
+    alignas(16) float rotationIm[LANES] = {};
+    alignas(16) float feedback[LANES] = {}, dcState[LANES] = {};
+    alignas(16) float fundamentalLevel[LANES] = {}, secondLevel[LANES] = {};
+    alignas(16) float thirdLevel[LANES] = {}, barkIntensity[LANES] = {};
+    alignas(16) float tineGain[LANES] = {};
+    int activeFrames[LANES] = {};
+    const float* amp[LANES];
+    const float* bark[LANES];
+    const float* harmonic[LANES];
+    const float* tine[LANES];
+    const float* noise[LANES];
+    
+    for (int lane = 0; lane < LANES; ++lane) {
+        ControlBlock& block = control[lane < numLanes ? lane : 0];
+        amp[lane] = block.amp;
+        bark[lane] = block.bark;
+        harmonic[lane] = block.harmonic;
+        tine[lane] = block.tine;
+        noise[lane] = block.noise;
+        if (lane >= numLanes) {
+            continue;
+        }
+        WurlitzerVoice& voice = *voices[lane];
+        activeFrames[lane] = voice.prepareBlock(block, numFrames);
+        voice.resyncPartials();
+        phase[lane] = voice.mPhase1;
+        inc[lane] = voice.mFrequency / voice.mSampleRate;
+        partialRe[lane] = voice.mPartialRe;
+        partialIm[lane] = voice.mPartialIm;
+        rotationRe[lane] = voice.mRotationRe;
+        rotationIm[lane] = voice.mRotationIm;
+        feedback[lane] = voice.mFeedback;
+        dcState[lane] = voice.mDCBlocker;
+        fundamentalLevel[lane] = voice.mFundamentalLevel;
+        secondLevel[lane] = voice.mSecondHarmonicLevel;
+        thirdLevel[lane] = voice.mThirdHarmonicLevel;
+        barkIntensity[lane] = voice.mBarkIntensity;
+        tineGain[lane] = 0.6f + voice.mVelocity * 0.3f;
+    }
+    int framesToRender = 0;
+    for (int lane = 0; lane < numLanes; ++lane) {
+        framesToRender = std::max(framesToRender, activeFrames[lane]);
+    }
+    
+    float4 vPhase = load4(phase), vInc = load4(inc);
+    float4 vRe = load4(partialRe), vIm = load4(partialIm);
+    const float4 vRotRe = load4(rotationRe), vRotIm = load4(rotationIm);
+    float4 vFeedback = load4(feedback), vDC = load4(dcState);
+    const float4 vFundamental = load4(fundamentalLevel);
+    const float4 vSecond = load4(secondLevel), vThird = load4(thirdLevel);
+    const float4 vBarkIntensity = load4(barkIntensity);
+    const float4 vTineGain = load4(tineGain);
+    const float4 zero = splat4(0.0f), one = splat4(1.0f), two = splat4(2.0f);
+    
+    alignas(16) float lanes[LANES];
+    for (int i = 0; i < framesToRender; ++i) {
+        float4 ampEnv = gather4(amp, i);
+        float4 harmonicEnv = gather4(harmonic, i);
+        
+        float4 re2 = sub4(mul4(vRe, vRe), mul4(vIm, vIm));
+        float4 im2 = mul4(two, mul4(vRe, vIm));
+        float4 re3 = sub4(mul4(re2, vRe), mul4(im2, vIm));
+        float4 im3 = add4(mul4(re2, vIm), mul4(im2, vRe));
+        float4 sine5 = add4(mul4(im3, re2), mul4(re3, im2));
+        float4 sine6 = mul4(two, mul4(re3, im3));
+        
+        float4 barkMod = mul4(mul4(mul4(sine6, vBarkIntensity), gather4(bark, i)),
+                              splat4(0.8f));
+        
+        // Bark and feedback keep the modulated phase within one cycle of
+        // the fundamental's
+        float4 arg = add4(add4(vPhase, barkMod),
+                          mul4(vFeedback, splat4(FEEDBACK_AMOUNT)));
+        arg = select4(lt4(arg, zero), add4(arg, one), arg);
+        arg = select4(ge4(arg, one), sub4(arg, one), arg);
+        float4 fundamental = mul4(mul4(sinTwoPi4(arg), vFundamental), ampEnv);
+        
+        float4 second = mul4(mul4(mul4(im2, vSecond), harmonicEnv), ampEnv);
+        float4 third = mul4(mul4(mul4(im3, vThird), harmonicEnv), ampEnv);
+        float4 tineResonance = madd4(sine6, splat4(0.015f),
+                                     mul4(sine5, splat4(0.025f)));
+        tineResonance = mul4(mul4(mul4(tineResonance, gather4(tine, i)), ampEnv),
+                             vTineGain);
+        
+        float4 sample = add4(add4(add4(fundamental, second), add4(third, tineResonance)),
+                             gather4(noise, i));
+        sample = mul4(softClip4(mul4(sample, splat4(1.1f))), splat4(0.85f));
+        
+        float4 dcBlocked = sub4(sample, vDC);
+        vDC = madd4(vDC, splat4(0.999f), mul4(sample, splat4(0.001f)));
+        vFeedback = dcBlocked;
+        
+        vPhase = add4(vPhase, vInc);
+        vPhase = select4(ge4(vPhase, one), sub4(vPhase, one), vPhase);
+        float4 re = sub4(mul4(vRe, vRotRe), mul4(vIm, vRotIm));
+        vIm = add4(mul4(vRe, vRotIm), mul4(vIm, vRotRe));
+        vRe = re;
+        
+        store4(lanes, dcBlocked);
+        for (int lane = 0; lane < numLanes; ++lane) {
+            if (i < activeFrames[lane]) {
+                out[i] += lanes[lane];
+            }
+        }
+    }
+    
+    store4(phase, vPhase);
+    store4(partialRe, vRe);
+    store4(partialIm, vIm);
+    store4(feedback, vFeedback);
+    store4(dcState, vDC);
+    for (int lane = 0; lane < numLanes; ++lane) {
+        WurlitzerVoice& voice = *voices[lane];
+        if (!voice.mActive) {
+            continue; // Ended this block; noteOn() resets everything
+        }
+        voice.mPhase1 = phase[lane];
+        voice.mPartialRe = partialRe[lane];
+        voice.mPartialIm = partialIm[lane];
+        voice.mFeedback = feedback[lane];
+        voice.mLastSample = feedback[lane];
+        voice.mDCBlocker = dcState[lane];
+    }
+}
+
 bool WurlitzerVoice::isActive() const {
     return mActive;
 }
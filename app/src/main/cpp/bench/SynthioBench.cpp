@@ -0,0 +1,926 @@
+// Desktop benchmark and golden-output check for the DSP core.
+//
+// Renders canned scenarios through the same classes the Android engine uses
+// (linked from synthio_dsp, no Oboe), reports the cost of each stage in
+// nanoseconds per output frame, and optionally compares the rendered audio
+// with reference WAVs so DSP changes can't silently alter the sound.
+//
+//   synthio_bench [--seconds N] [--block N] [--only NAME]
+//                 [--tier eco|standard|high]
+//                 [--golden DIR [--update-golden] [--tolerance LSB]]
+//                 [--scalar]
+//   synthio_bench --math
+//   synthio_bench --parity [--seconds N] [--block N] [--only NAME]
+//
+// Goldens are recorded with --update-golden from a known-good build and are
+// only comparable for the same --seconds/--block/--tier and a similar
+// toolchain (libm's transcendentals still differ between them). --scalar
+// renders the synth voices through the scalar path instead of VoiceBank;
+// its goldens are kept as NAME-scalar.wav.
+//
+// On Linux and Android each scenario also reports L1 data-cache read misses
+// per frame, when perf events are accessible (perf_event_paranoid <= 2).
+//
+// --math instead sweeps the FastMath.h kernels against double-precision
+// libm, checks each against its documented error bound (and the float4
+// variants against the scalar ones) and reports the cost per call.
+//
+// --parity renders every scenario that has both voice paths twice, with
+// the vectorized bank and with the scalar voices, and fails if any output
+// sample differs by more than the scenario's documented tolerance (pad12,
+// unison8 and wurli).
+
+#include "DSPConfig.h"
+#include "Delay.h"
+#include "Denormals.h"
+#include "DrumMachine.h"
+#include "FastMath.h"
+#include "Looper.h"
+#include "PerfMonitor.h"
+#include "PolyphonyManager.h"
+#include "QualityTier.h"
+#include "Reverb.h"
+#include "RtCheck.h"
+#include "Tremolo.h"
+#include "Wavetable.h"
+#include "WurlitzerEngine.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <sys/stat.h>
+#include <vector>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace synthio;
+
+namespace {
+
+constexpr int SAMPLE_RATE = 48000;
+constexpr uint32_t NOISE_SEED = 0x5EED;
+
+float midiToFrequency(int note) {
+  return 440.0f * std::pow(2.0f, (note - 69) / 12.0f);
+}
+
+// Index of the period the block starting at frame enters, or -1 if no period
+// starts inside it. Events land on the first block of their period.
+int64_t periodStart(int64_t frame, int numFrames, int64_t period) {
+  int64_t offset = frame % period;
+  if (offset == 0) {
+    return frame / period;
+  }
+  return offset + numFrames > period ? frame / period + 1 : -1;
+}
+
+// ===== STAGE TIMING =====
+
+// Accumulates time per named stage; mark() charges the time since the
+// previous mark (or begin()) to the given stage
+class StageTimer {
+public:
+  // Reserved so the first marks don't allocate inside the render
+  StageTimer() { mStages.reserve(8); }
+
+  void begin() { mLast = PerfMonitor::now(); }
+
+  void mark(const char *stage) {
+    int64_t now = PerfMonitor::now();
+    for (auto &entry : mStages) {
+      if (entry.name == stage) {
+        entry.nanos += now - mLast;
+        mLast = now;
+        return;
+      }
+    }
+    mStages.push_back({stage, now - mLast});
+    mLast = now;
+  }
+
+  struct Entry {
+    std::string name;
+    int64_t nanos;
+  };
+  const std::vector<Entry> &stages() const { return mStages; }
+
+private:
+  std::vector<Entry> mStages;
+  int64_t mLast = 0;
+};
+
+// Counts L1 data-cache read misses of the calling thread between start()
+// and stop(). available() is false where perf events can't be opened.
+class CacheMissCounter {
+public:
+  CacheMissCounter() {
+#if defined(__linux__)
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_L1D |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    mFd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+  ~CacheMissCounter() {
+#if defined(__linux__)
+    if (mFd >= 0) {
+      close(mFd);
+    }
+#endif
+  }
+  CacheMissCounter(const CacheMissCounter &) = delete;
+  CacheMissCounter &operator=(const CacheMissCounter &) = delete;
+
+  bool available() const { return mFd >= 0; }
+
+  void start() {
+#if defined(__linux__)
+    if (mFd >= 0) {
+      ioctl(mFd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(mFd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  // Returns the misses since start(), or -1 if unavailable
+  int64_t stop() {
+    int64_t count = -1;
+#if defined(__linux__)
+    if (mFd >= 0) {
+      ioctl(mFd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(mFd, &count, sizeof(count)) != sizeof(count)) {
+        count = -1;
+      }
+    }
+#endif
+    return count;
+  }
+
+private:
+  int mFd = -1;
+};
+
+// ===== SCENARIOS =====
+
+class Scenario {
+public:
+  virtual ~Scenario() = default;
+  virtual const char *name() const = 0;
+  virtual const char *description() const = 0;
+  // Quality tier settings, applied before prepare()
+  virtual void setQuality(const QualitySettings &) {}
+  // Vectorized voice bank (the default) or scalar voices, applied before
+  // prepare(); false if the scenario has only one path
+  virtual bool setVoiceBankEnabled(bool) { return false; }
+  // Largest output difference between the two paths
+  virtual float voiceBankTolerance() const { return 0.0f; }
+  // Untimed setup (recording loops, priming notes)
+  virtual void prepare() {}
+  // Renders one block of stereo output starting at frame, marking stages
+  virtual void render(float *left, float *right, int numFrames, int64_t frame,
+                      StageTimer &timer) = 0;
+};
+
+// Synth chain as the engine runs it: voices + chorus, then the effects
+class SynthScenario : public Scenario {
+public:
+  SynthScenario() {
+    mSynth.setSampleRate(SAMPLE_RATE);
+    mSynth.seedNoise(NOISE_SEED);
+    mTremolo.setSampleRate(SAMPLE_RATE);
+    mDelay.setSampleRate(SAMPLE_RATE);
+    mReverb.setSampleRate(SAMPLE_RATE);
+  }
+
+  void setQuality(const QualitySettings &settings) override {
+    mSynth.setFilterQuality(settings.filterControlInterval,
+                            settings.filterOversampling);
+    mReverb.setStereo(settings.stereoReverb);
+  }
+
+  bool setVoiceBankEnabled(bool enabled) override {
+    mSynth.setVoiceBankEnabled(enabled);
+    return true;
+  }
+  // VoiceBank's documented bound against the scalar voices
+  float voiceBankTolerance() const override { return 1.2e-4f; }
+
+  void render(float *left, float *right, int numFrames, int64_t frame,
+              StageTimer &timer) override {
+    trigger(frame, numFrames);
+    timer.mark("control");
+    mSynth.processBlock(left, right, numFrames);
+    timer.mark("voices");
+    mTremolo.processBlock(left, right, numFrames);
+    mDelay.processBlock(left, right, numFrames);
+    mReverb.processBlock(left, right, numFrames);
+    timer.mark("effects");
+  }
+
+protected:
+  // Note events for the block starting at frame
+  virtual void trigger(int64_t frame, int numFrames) = 0;
+
+  PolyphonyManager mSynth;
+  Tremolo mTremolo;
+  Delay mDelay;
+  Reverb mReverb;
+};
+
+// 12-voice saw pad; the chord is re-struck every second so the filter
+// envelope keeps sweeping
+class PadScenario : public SynthScenario {
+public:
+  const char *name() const override { return "pad12"; }
+  const char *description() const override {
+    return "12-voice saw pad, filter envelope sweep, chorus + reverb";
+  }
+
+  void prepare() override {
+    mSynth.setWaveform(Waveform::SAWTOOTH);
+    mSynth.setFilterCutoff(400.0f);
+    mSynth.setFilterResonance(0.4f);
+    mSynth.setFilterEnvelopeAmount(0.8f);
+    mSynth.setAttack(0.05f);
+    mSynth.setDecay(0.6f);
+    mSynth.setSustain(0.5f);
+    mSynth.setRelease(0.4f);
+    mSynth.setLFORate(0.5f);
+    mSynth.setLFOFilterDepth(0.3f);
+    mSynth.setChorusMode(1);
+    mReverb.setSize(0.6f);
+    mReverb.setMix(0.25f);
+  }
+
+protected:
+  void trigger(int64_t frame, int numFrames) override {
+    static const int CHORD[DEFAULT_POLYPHONY] = {36, 43, 48, 52, 55, 59,
+                                             60, 64, 67, 71, 72, 76};
+    if (periodStart(frame, numFrames, SAMPLE_RATE) >= 0) {
+      for (int note : CHORD) {
+        mSynth.noteOff(note);
+        mSynth.noteOn(note, midiToFrequency(note));
+      }
+    }
+  }
+};
+
+// One sustained note, then a second, with 8 detuned unison voices each
+class UnisonScenario : public SynthScenario {
+public:
+  const char *name() const override { return "unison8"; }
+  const char *description() const override {
+    return "Unison x8 saw lead, delay + reverb";
+  }
+
+  void prepare() override {
+    mSynth.setWaveform(Waveform::SAWTOOTH);
+    mSynth.setUnisonEnabled(true);
+    mSynth.setUnisonVoices(8);
+    mSynth.setUnisonDetune(15.0f);
+    mSynth.setFilterCutoff(3000.0f);
+    mDelay.setTime(0.3f);
+    mDelay.setFeedback(0.35f);
+    mDelay.setMix(0.2f);
+    mReverb.setMix(0.15f);
+  }
+
+protected:
+  void trigger(int64_t frame, int numFrames) override {
+    int64_t step = periodStart(frame, numFrames, SAMPLE_RATE / 2);
+    if (step >= 0) {
+      int previous = step % 2 ? 57 : 64;
+      int next = step % 2 ? 64 : 57;
+      mSynth.noteOff(previous);
+      mSynth.noteOn(next, midiToFrequency(next));
+    }
+  }
+};
+
+// Wurlitzer engine (voices plus its built-in effects)
+class WurlitzerScenario : public Scenario {
+public:
+  const char *name() const override { return "wurli"; }
+  const char *description() const override {
+    return "Wurlitzer 7th chords with tremolo + reverb";
+  }
+
+  void prepare() override {
+    mWurli.setSampleRate(SAMPLE_RATE);
+    mWurli.setTremoloDepth(0.4f);
+    mWurli.setReverbSize(0.5f);
+    mWurli.setReverbMix(0.3f);
+  }
+
+  void setQuality(const QualitySettings &settings) override {
+    mWurli.setReverbStereo(settings.stereoReverb);
+  }
+
+  bool setVoiceBankEnabled(bool enabled) override {
+    mWurli.setVoiceBankEnabled(enabled);
+    return true;
+  }
+  // WurlitzerVoice::processGroup's bound against processBlock
+  float voiceBankTolerance() const override { return 4e-5f; }
+
+  void render(float *left, float *right, int numFrames, int64_t frame,
+              StageTimer &timer) override {
+    static const int CHORDS[2][4] = {{48, 52, 55, 58}, {53, 57, 60, 63}};
+    int64_t period = periodStart(frame, numFrames, SAMPLE_RATE);
+    if (period >= 0) {
+      int chord = static_cast<int>(period % 2);
+      for (int note : CHORDS[1 - chord]) {
+        mWurli.noteOff(note);
+      }
+      for (int note : CHORDS[chord]) {
+        mWurli.noteOn(note, midiToFrequency(note), 0.8f);
+      }
+    }
+    timer.mark("control");
+    mWurli.processBlock(left, right, numFrames);
+    timer.mark("wurlitzer");
+  }
+
+private:
+  WurlitzerEngine mWurli;
+};
+
+// Drum machine with every instrument and 16th hi-hats, from the one-shot
+// cache or synthesized per sample
+class DrumScenario : public Scenario {
+public:
+  explicit DrumScenario(bool oneShots) : mOneShots(oneShots) {}
+
+  const char *name() const override {
+    return mOneShots ? "drums" : "drums_synth";
+  }
+  const char *description() const override {
+    return mOneShots ? "Drum pattern: kick, snare, 16th hi-hats at 120 BPM"
+                     : "Same pattern, synthesized per sample";
+  }
+
+  void prepare() override {
+    mDrums.setSampleRate(SAMPLE_RATE);
+    mDrums.seedNoise(NOISE_SEED);
+    mDrums.setOneShotsEnabled(mOneShots);
+    mDrums.setBPM(120.0f);
+    mDrums.setKickEnabled(true);
+    mDrums.setSnareEnabled(true);
+    mDrums.setHiHatEnabled(true);
+    mDrums.setHiHat16thNotes(true);
+    mDrums.setEnabled(true);
+  }
+
+  void render(float *left, float *right, int numFrames, int64_t,
+              StageTimer &timer) override {
+    mDrums.processBlock(left, numFrames);
+    std::copy(left, left + numFrames, right);
+    timer.mark("drums");
+  }
+
+private:
+  bool mOneShots;
+  DrumMachine mDrums;
+};
+
+// Four looper tracks recorded from a synth line, then played back
+class LooperScenario : public Scenario {
+public:
+  static constexpr int NUM_TRACKS = 4;
+
+  const char *name() const override { return "looper4"; }
+  const char *description() const override {
+    return "4-track looper playback, 2 bars at 120 BPM";
+  }
+
+  void prepare() override {
+    mLooper.setSampleRate(SAMPLE_RATE);
+    mLooper.setBPM(120.0f);
+    mLooper.setBarCount(2);
+    mSource.setSampleRate(SAMPLE_RATE);
+    mSource.seedNoise(NOISE_SEED);
+    mSource.setWaveform(Waveform::SQUARE);
+    mSource.setFilterCutoff(2000.0f);
+
+    float synthL[MAX_BLOCK_SIZE], synthR[MAX_BLOCK_SIZE];
+    float loopL[MAX_BLOCK_SIZE], loopR[MAX_BLOCK_SIZE];
+    for (int track = 0; track < NUM_TRACKS; ++track) {
+      int note = 48 + track * 7;
+      mSource.noteOn(note, midiToFrequency(note));
+      mLooper.startRecordingTrack(track);
+      while (mLooper.getState() == Looper::State::PRE_COUNT ||
+             mLooper.getState() == Looper::State::RECORDING) {
+        mSource.processBlock(synthL, synthR, MAX_BLOCK_SIZE);
+        mLooper.processBlock(synthL, synthR, loopL, loopR, MAX_BLOCK_SIZE);
+      }
+      mSource.noteOff(note);
+      mLooper.setTrackVolume(track, 0.25f); // Four full-scale takes would clip
+    }
+    if (!mLooper.isPlaying()) {
+      mLooper.startPlayback();
+    }
+    // Playback reads the premix once its worker has built it
+    for (int wait = 0; wait < 1000 && !mLooper.isPremixReady(); ++wait) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::fill(mSilence, mSilence + MAX_BLOCK_SIZE, 0.0f);
+  }
+
+  void render(float *left, float *right, int numFrames, int64_t,
+              StageTimer &timer) override {
+    mLooper.processBlock(mSilence, mSilence, left, right, numFrames);
+    timer.mark("looper");
+  }
+
+private:
+  Looper mLooper;
+  PolyphonyManager mSource;
+  float mSilence[MAX_BLOCK_SIZE];
+};
+
+// ===== WAV I/O =====
+
+void writeLE(FILE *file, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    fputc(static_cast<int>((value >> (8 * i)) & 0xFF), file);
+  }
+}
+
+bool writeWav(const std::string &path, const std::vector<int16_t> &samples) {
+  FILE *file = fopen(path.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  const uint32_t dataBytes = static_cast<uint32_t>(samples.size() * 2);
+  fwrite("RIFF", 1, 4, file);
+  writeLE(file, 36 + dataBytes, 4);
+  fwrite("WAVEfmt ", 1, 8, file);
+  writeLE(file, 16, 4);
+  writeLE(file, 1, 2); // PCM
+  writeLE(file, 2, 2); // Stereo
+  writeLE(file, SAMPLE_RATE, 4);
+  writeLE(file, SAMPLE_RATE * 4, 4);
+  writeLE(file, 4, 2);
+  writeLE(file, 16, 2);
+  fwrite("data", 1, 4, file);
+  writeLE(file, dataBytes, 4);
+  for (int16_t sample : samples) {
+    writeLE(file, static_cast<uint16_t>(sample), 2);
+  }
+  bool ok = ferror(file) == 0;
+  fclose(file);
+  return ok;
+}
+
+// Reads 16-bit stereo PCM written by writeWav (or any tool emitting the
+// same format); skips unknown chunks
+bool readWav(const std::string &path, std::vector<int16_t> &samples) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  std::vector<uint8_t> bytes;
+  uint8_t buffer[65536];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    bytes.insert(bytes.end(), buffer, buffer + count);
+  }
+  fclose(file);
+
+  auto read32 = [&](size_t at) {
+    return static_cast<uint32_t>(bytes[at]) | bytes[at + 1] << 8 |
+           bytes[at + 2] << 16 | static_cast<uint32_t>(bytes[at + 3]) << 24;
+  };
+  if (bytes.size() < 12 || memcmp(bytes.data(), "RIFF", 4) != 0 ||
+      memcmp(bytes.data() + 8, "WAVE", 4) != 0) {
+    return false;
+  }
+  size_t at = 12;
+  bool formatOk = false;
+  while (at + 8 <= bytes.size()) {
+    uint32_t size = read32(at + 4);
+    const uint8_t *body = bytes.data() + at + 8;
+    if (at + 8 + size > bytes.size()) {
+      return false;
+    }
+    if (memcmp(bytes.data() + at, "fmt ", 4) == 0 && size >= 16) {
+      formatOk = (body[0] | body[1] << 8) == 1 && (body[2] | body[3] << 8) == 2 &&
+                 (body[14] | body[15] << 8) == 16;
+    } else if (memcmp(bytes.data() + at, "data", 4) == 0) {
+      if (!formatOk) {
+        return false;
+      }
+      samples.resize(size / 2);
+      for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = static_cast<int16_t>(body[i * 2] | body[i * 2 + 1] << 8);
+      }
+      return true;
+    }
+    at += 8 + size + (size & 1);
+  }
+  return false;
+}
+
+// ===== MATH KERNELS =====
+
+enum class ErrorKind {
+  ABSOLUTE,
+  RELATIVE,
+  ABSOLUTE_BELOW_ONE, // Absolute for |result| <= 1, relative above
+};
+
+struct MathKernel {
+  const char *name;
+  double lo, hi; // Swept domain
+  double bound;  // Documented maximum error
+  ErrorKind kind;
+  float (*fast)(float);
+  float (*libm)(float);       // The float call it replaces, for timing
+  double (*reference)(double);
+  float4 (*vector)(float4); // nullptr when there is no float4 form
+};
+
+bool runMathChecks() {
+  static const MathKernel kernels[] = {
+      {"sinTwoPi", 0.0, 1.0, 3e-7, ErrorKind::ABSOLUTE, sinTwoPi,
+       [](float x) { return std::sin(x * 6.28318530717958647692f); },
+       [](double x) { return std::sin(x * 2.0 * M_PI); }, sinTwoPi4},
+      {"fastTanh", -12.0, 12.0, 1.2e-4, ErrorKind::ABSOLUTE, fastTanh,
+       [](float x) { return std::tanh(x); },
+       [](double x) { return std::tanh(x); }, tanh4},
+      {"fastExp2", -126.0, 127.0, 3e-7, ErrorKind::RELATIVE, fastExp2,
+       [](float x) { return std::exp2(x); },
+       [](double x) { return std::exp2(x); }, nullptr},
+      {"fastLog2", 1e-30, 1e30, 3e-7, ErrorKind::ABSOLUTE_BELOW_ONE, fastLog2,
+       [](float x) { return std::log2(x); },
+       [](double x) { return std::log2(x); }, nullptr},
+  };
+  constexpr int POINTS = 1 << 20;
+  constexpr int TIMING_REPEATS = 16;
+
+  bool ok = true;
+  std::vector<float> inputs(POINTS);
+  std::vector<float> outputs(POINTS);
+  volatile float sink = 0.0f; // Keeps the timed loop from being elided
+  printf("%-10s %12s %12s %10s %10s\n", "kernel", "max error", "bound",
+         "ns/call", "libm ns");
+  for (const MathKernel &kernel : kernels) {
+    // log2 is swept geometrically so every octave is covered
+    const bool geometric = kernel.lo > 0.0 && kernel.hi / kernel.lo > 1e3;
+    for (int i = 0; i < POINTS; ++i) {
+      const double t = static_cast<double>(i) / POINTS;
+      inputs[i] = static_cast<float>(
+          geometric ? kernel.lo * std::pow(kernel.hi / kernel.lo, t)
+                    : kernel.lo + (kernel.hi - kernel.lo) * t);
+    }
+
+    double maxError = 0.0;
+    bool vectorMatches = true;
+    for (int i = 0; i < POINTS; ++i) {
+      const double exact = kernel.reference(inputs[i]);
+      double error = std::abs(kernel.fast(inputs[i]) - exact);
+      if (kernel.kind == ErrorKind::RELATIVE) {
+        error /= std::abs(exact);
+      } else if (kernel.kind == ErrorKind::ABSOLUTE_BELOW_ONE) {
+        error /= std::max(1.0, std::abs(exact));
+      }
+      maxError = std::max(maxError, error);
+    }
+    if (kernel.vector) {
+      for (int i = 0; i + 4 <= POINTS; i += 4) {
+        alignas(16) float lanes[4];
+        store4(lanes, kernel.vector(load4(&inputs[i])));
+        for (int lane = 0; lane < 4; ++lane) {
+          vectorMatches = vectorMatches && lanes[lane] == kernel.fast(inputs[i + lane]);
+        }
+      }
+    }
+
+    auto timeCalls = [&](float (*function)(float)) {
+      const int64_t start = PerfMonitor::now();
+      for (int r = 0; r < TIMING_REPEATS; ++r) {
+        for (int i = 0; i < POINTS; ++i) {
+          outputs[i] = function(inputs[i]);
+        }
+        sink = outputs[r];
+      }
+      return static_cast<double>(PerfMonitor::now() - start) /
+             (static_cast<double>(POINTS) * TIMING_REPEATS);
+    };
+    const double nsPerCall = timeCalls(kernel.fast);
+    const double libmNsPerCall = timeCalls(kernel.libm);
+
+    const bool pass = maxError <= kernel.bound && vectorMatches;
+    printf("%-10s %12.3g %12.3g %10.2f %10.2f%s%s\n", kernel.name, maxError,
+           kernel.bound, nsPerCall, libmNsPerCall, pass ? "" : "  FAIL",
+           vectorMatches ? "" : " (float4 differs from scalar)");
+    ok = ok && pass;
+  }
+  (void)sink;
+  return ok;
+}
+
+// ===== DRIVER =====
+
+struct Options {
+  double seconds = 4.0;
+  int blockSize = MAX_BLOCK_SIZE;
+  std::string only;
+  QualityTier tier = QualityTier::STANDARD;
+  std::string goldenDir;
+  bool updateGolden = false;
+  int tolerance = 4; // LSB, absorbs compiler/ISA rounding differences
+  bool scalar = false;
+  bool math = false;
+  bool parity = false;
+};
+
+bool parseOptions(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--seconds" && hasValue) {
+      options.seconds = std::atof(argv[++i]);
+    } else if (arg == "--block" && hasValue) {
+      options.blockSize = std::max(1, std::min(MAX_BLOCK_SIZE, std::atoi(argv[++i])));
+    } else if (arg == "--only" && hasValue) {
+      options.only = argv[++i];
+    } else if (arg == "--tier" && hasValue) {
+      std::string tier = argv[++i];
+      if (tier == "eco") {
+        options.tier = QualityTier::ECO;
+      } else if (tier == "high") {
+        options.tier = QualityTier::HIGH;
+      } else if (tier != "standard") {
+        fprintf(stderr, "unknown tier %s\n", tier.c_str());
+        return false;
+      }
+    } else if (arg == "--golden" && hasValue) {
+      options.goldenDir = argv[++i];
+    } else if (arg == "--update-golden") {
+      options.updateGolden = true;
+    } else if (arg == "--tolerance" && hasValue) {
+      options.tolerance = std::atoi(argv[++i]);
+    } else if (arg == "--scalar") {
+      options.scalar = true;
+    } else if (arg == "--math") {
+      options.math = true;
+    } else if (arg == "--parity") {
+      options.parity = true;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--seconds N] [--block N] [--only NAME]\n"
+              "       [--tier eco|standard|high]\n"
+              "       [--golden DIR [--update-golden] [--tolerance LSB]]\n"
+              "       [--scalar]\n"
+              "       %s --math\n"
+              "       %s --parity [--seconds N] [--block N] [--only NAME]\n",
+              argv[0], argv[0], argv[0]);
+      return false;
+    }
+  }
+  return options.seconds > 0.0;
+}
+
+// Returns false if the golden comparison failed
+bool runScenario(Scenario &scenario, const Options &options) {
+  scenario.setQuality(QualitySettings::forTier(options.tier));
+  const bool scalar = options.scalar && scenario.setVoiceBankEnabled(false);
+  scenario.prepare();
+
+  const int64_t numFrames = static_cast<int64_t>(options.seconds * SAMPLE_RATE);
+  std::vector<int16_t> pcm(static_cast<size_t>(numFrames) * 2);
+  float left[MAX_BLOCK_SIZE], right[MAX_BLOCK_SIZE];
+
+  StageTimer timer;
+  CacheMissCounter cacheMisses;
+#if defined(SYNTHIO_RT_CHECKS)
+  const RtViolations before = rtViolations();
+#endif
+  cacheMisses.start();
+  const int64_t start = PerfMonitor::now();
+  for (int64_t frame = 0; frame < numFrames; frame += options.blockSize) {
+    int count = static_cast<int>(std::min<int64_t>(options.blockSize, numFrames - frame));
+    timer.begin();
+    {
+      AudioThreadScope audioThread; // Render counts as the audio thread
+      ScopedFlushToZero flushToZero;  // With the callback's FP mode
+      scenario.render(left, right, count, frame, timer);
+    }
+    for (int i = 0; i < count; ++i) {
+      pcm[(frame + i) * 2] = toPcm16(left[i]);
+      pcm[(frame + i) * 2 + 1] = toPcm16(right[i]);
+    }
+  }
+  const int64_t elapsed = PerfMonitor::now() - start;
+  const int64_t misses = cacheMisses.stop();
+
+  printf("%-10s %s%s\n", scenario.name(), scenario.description(),
+         scalar ? " (scalar voices)" : "");
+  int64_t staged = 0;
+  for (const auto &stage : timer.stages()) {
+    printf("  %-12s %9.1f ns/frame\n", stage.name.c_str(),
+           static_cast<double>(stage.nanos) / numFrames);
+    staged += stage.nanos;
+  }
+  const double realtimeNanos = 1e9 * numFrames / SAMPLE_RATE;
+  printf("  %-12s %9.1f ns/frame  (%.0fx realtime, %.1f%% of one core)\n",
+         "total", static_cast<double>(staged) / numFrames,
+         realtimeNanos / std::max<int64_t>(1, elapsed),
+         100.0 * elapsed / realtimeNanos);
+  if (misses >= 0) {
+    printf("  %-12s %9.2f /frame\n", "L1D misses",
+           static_cast<double>(misses) / numFrames);
+  }
+#if defined(SYNTHIO_RT_CHECKS)
+  const RtViolations after = rtViolations();
+  printf("  %-12s %llu allocations, %llu locks\n", "audio thread",
+         static_cast<unsigned long long>(after.allocations - before.allocations),
+         static_cast<unsigned long long>(after.locks - before.locks));
+#endif
+
+  if (options.goldenDir.empty()) {
+    return true;
+  }
+  const std::string path = options.goldenDir + "/" + scenario.name() +
+                           (scalar ? "-scalar" : "") + ".wav";
+  if (options.updateGolden) {
+    bool written = writeWav(path, pcm);
+    printf("  golden       %s %s\n", written ? "wrote" : "FAILED to write",
+           path.c_str());
+    return written;
+  }
+
+  std::vector<int16_t> golden;
+  if (!readWav(path, golden)) {
+    printf("  golden       MISSING %s (run with --update-golden)\n", path.c_str());
+    return false;
+  }
+  if (golden.size() != pcm.size()) {
+    printf("  golden       MISMATCH length %zu vs %zu frames\n",
+           golden.size() / 2, pcm.size() / 2);
+    return false;
+  }
+  int maxDiff = 0;
+  double sumSquares = 0.0;
+  for (size_t i = 0; i < pcm.size(); ++i) {
+    int diff = std::abs(pcm[i] - golden[i]);
+    maxDiff = std::max(maxDiff, diff);
+    sumSquares += static_cast<double>(diff) * diff;
+  }
+  bool match = maxDiff <= options.tolerance;
+  printf("  golden       %s (max %d LSB, rms %.3f LSB)\n", match ? "ok" : "MISMATCH",
+         maxDiff, std::sqrt(sumSquares / pcm.size()));
+  return match;
+}
+
+// ===== VOICE PATH PARITY =====
+
+// Renders numFrames of scenario into interleaved float stereo
+void renderToBuffer(Scenario &scenario, const Options &options,
+                    int64_t numFrames, std::vector<float> &out) {
+  out.assign(static_cast<size_t>(numFrames) * 2, 0.0f);
+  float left[MAX_BLOCK_SIZE], right[MAX_BLOCK_SIZE];
+  StageTimer timer;
+  for (int64_t frame = 0; frame < numFrames; frame += options.blockSize) {
+    int count = static_cast<int>(std::min<int64_t>(options.blockSize, numFrames - frame));
+    timer.begin();
+    {
+      ScopedFlushToZero flushToZero;
+      scenario.render(left, right, count, frame, timer);
+    }
+    for (int i = 0; i < count; ++i) {
+      out[(frame + i) * 2] = left[i];
+      out[(frame + i) * 2 + 1] = right[i];
+    }
+  }
+}
+
+// Returns false if the two paths of a scenario drift apart beyond its
+// tolerance. bank and scalar are fresh instances of the same scenario.
+bool runParity(Scenario &bank, Scenario &scalar, const Options &options) {
+  const QualitySettings settings = QualitySettings::forTier(options.tier);
+  bank.setQuality(settings);
+  scalar.setQuality(settings);
+  bank.setVoiceBankEnabled(true);
+  scalar.setVoiceBankEnabled(false);
+  bank.prepare();
+  scalar.prepare();
+
+  const int64_t numFrames = static_cast<int64_t>(options.seconds * SAMPLE_RATE);
+  std::vector<float> bankOut, scalarOut;
+  renderToBuffer(bank, options, numFrames, bankOut);
+  renderToBuffer(scalar, options, numFrames, scalarOut);
+
+  double maxError = 0.0;
+  double sumSquares = 0.0;
+  for (size_t i = 0; i < bankOut.size(); ++i) {
+    double error = std::abs(static_cast<double>(bankOut[i]) - scalarOut[i]);
+    maxError = std::max(maxError, error);
+    sumSquares += error * error;
+  }
+  const float bound = bank.voiceBankTolerance();
+  const bool pass = maxError <= bound;
+  printf("%-10s %12.3g %12.3g %12.3g%s\n", bank.name(), maxError,
+         std::sqrt(sumSquares / std::max<size_t>(1, bankOut.size())), bound,
+         pass ? "" : "  FAIL");
+  return pass;
+}
+
+std::vector<std::unique_ptr<Scenario>> makeScenarios() {
+  std::vector<std::unique_ptr<Scenario>> scenarios;
+  scenarios.emplace_back(new PadScenario());
+  scenarios.emplace_back(new UnisonScenario());
+  scenarios.emplace_back(new WurlitzerScenario());
+  scenarios.emplace_back(new DrumScenario(true));
+  scenarios.emplace_back(new DrumScenario(false));
+  scenarios.emplace_back(new LooperScenario());
+  return scenarios;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    return 2;
+  }
+  if (options.math) {
+    return runMathChecks() ? 0 : 1;
+  }
+
+  // A golden run that compares against nothing must not pass
+  if (!options.goldenDir.empty()) {
+    struct stat info;
+    if (options.updateGolden) {
+      mkdir(options.goldenDir.c_str(), 0755); // Fine if it already exists
+    } else if (stat(options.goldenDir.c_str(), &info) != 0 ||
+               !S_ISDIR(info.st_mode)) {
+      fprintf(stderr, "no golden directory %s (record one with "
+                      "--update-golden)\n",
+              options.goldenDir.c_str());
+      return 1;
+    }
+  }
+
+  // The engine builds these on a background thread; here they are built
+  // up front so every scenario renders with wavetables from the first block
+  for (int mask = 1; mask < WavetableBank::NUM_COMBINATIONS; ++mask) {
+    WavetableBank::prepare(mask);
+  }
+
+  std::vector<std::unique_ptr<Scenario>> scenarios = makeScenarios();
+
+  bool ok = true;
+  bool ran = false;
+  if (options.parity) {
+    // A second set renders the scalar path from the same starting state
+    std::vector<std::unique_ptr<Scenario>> scalar = makeScenarios();
+    for (size_t i = 0; i < scenarios.size(); ++i) {
+      if ((!options.only.empty() && options.only != scenarios[i]->name()) ||
+          !scenarios[i]->setVoiceBankEnabled(true)) {
+        continue;
+      }
+      if (!ran) {
+        printf("%-10s %12s %12s %12s\n", "scenario", "max error",
+               "rms error", "bound");
+      }
+      ran = true;
+      ok = runParity(*scenarios[i], *scalar[i], options) && ok;
+    }
+    if (!ran) {
+      fprintf(stderr, "no scenario with both voice paths%s%s\n",
+              options.only.empty() ? "" : " named ", options.only.c_str());
+      return 2;
+    }
+    return ok ? 0 : 1;
+  }
+
+  for (auto &scenario : scenarios) {
+    if (!options.only.empty() && options.only != scenario->name()) {
+      continue;
+    }
+    ran = true;
+    ok = runScenario(*scenario, options) && ok;
+  }
+  if (!ran) {
+    fprintf(stderr, "no scenario named %s\n", options.only.c_str());
+    return 2;
+  }
+  return ok ? 0 : 1;
+}
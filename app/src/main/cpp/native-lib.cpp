@@ -1,8 +1,10 @@
 #include "audio/AudioEngine.h"
+#include "audio/MidiInput.h"
 #include <jni.h>
 #include <memory>
 
 static std::unique_ptr<synthio::AudioEngine> gAudioEngine;
+static std::unique_ptr<synthio::MidiInput> gMidiInput;
 
 extern "C" {
 
@@ -10,11 +12,13 @@ JNIEXPORT void JNICALL
 Java_com_synthio_app_audio_SynthesizerEngine_nativeCreate(JNIEnv *env,
                                                           jobject thiz) {
   gAudioEngine = std::make_unique<synthio::AudioEngine>();
+  gMidiInput = std::make_unique<synthio::MidiInput>(*gAudioEngine);
 }
 
 JNIEXPORT void JNICALL
 Java_com_synthio_app_audio_SynthesizerEngine_nativeDestroy(JNIEnv *env,
                                                            jobject thiz) {
+  gMidiInput.reset();
   gAudioEngine.reset();
 }
 
@@ -42,6 +46,61 @@ JNIEXPORT void JNICALL Java_com_synthio_app_audio_SynthesizerEngine_nativeStop(
   }
 }
 
+// ===== OUTPUT LATENCY =====
+
+JNIEXPORT void JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeSetBluetoothOutput(
+    JNIEnv *env, jobject thiz, jboolean bluetooth) {
+  if (gAudioEngine) {
+    gAudioEngine->setBluetoothOutput(bluetooth);
+  }
+}
+
+JNIEXPORT jdouble JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeGetOutputLatencyMillis(
+    JNIEnv *env, jobject thiz) {
+  if (gAudioEngine) {
+    return gAudioEngine->getOutputLatencyMillis();
+  }
+  return -1.0;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeGetOutputDeviceId(
+    JNIEnv *env, jobject thiz) {
+  if (gAudioEngine) {
+    return gAudioEngine->getOutputDeviceId();
+  }
+  return 0;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeGetBufferSizeFrames(
+    JNIEnv *env, jobject thiz) {
+  if (gAudioEngine) {
+    return gAudioEngine->getBufferSizeFrames();
+  }
+  return 0;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeIsExclusiveStream(
+    JNIEnv *env, jobject thiz) {
+  if (gAudioEngine) {
+    return gAudioEngine->isExclusiveStream();
+  }
+  return false;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeGetSampleRate(
+    JNIEnv *env, jobject thiz) {
+  if (gAudioEngine) {
+    return gAudioEngine->getSampleRate();
+  }
+  return 0;
+}
+
 JNIEXPORT void JNICALL
 Java_com_synthio_app_audio_SynthesizerEngine_nativeNoteOn(JNIEnv *env,
                                                           jobject thiz,
@@ -266,6 +325,14 @@ Java_com_synthio_app_audio_SynthesizerEngine_nativeSetSynthReverbMix(
   }
 }
 
+JNIEXPORT void JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeSetReverbMode(
+    JNIEnv *env, jobject thiz, jint mode) {
+  if (gAudioEngine) {
+    gAudioEngine->setReverbMode(mode);
+  }
+}
+
 JNIEXPORT void JNICALL
 Java_com_synthio_app_audio_SynthesizerEngine_nativeSetSynthDelayTime(
     JNIEnv *env, jobject thiz, jfloat time) {
@@ -336,6 +403,74 @@ Java_com_synthio_app_audio_SynthesizerEngine_nativeSetUnisonDetune(
   }
 }
 
+JNIEXPORT void JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeSetStackedUnisonEnabled(
+    JNIEnv *env, jobject thiz, jboolean enabled) {
+  if (gAudioEngine) {
+    gAudioEngine->setStackedUnisonEnabled(enabled);
+  }
+}
+
+// ===== VOICE RENDERING =====
+
+JNIEXPORT void JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeSetSimdVoicesEnabled(
+    JNIEnv *env, jobject thiz, jboolean enabled) {
+  if (gAudioEngine) {
+    gAudioEngine->setSimdVoicesEnabled(enabled);
+  }
+}
+
+JNIEXPORT void JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeSetWavetablesEnabled(
+    JNIEnv *env, jobject thiz, jboolean enabled) {
+  if (gAudioEngine) {
+    gAudioEngine->setWavetablesEnabled(enabled);
+  }
+}
+
+JNIEXPORT void JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeSetQualityTier(
+    JNIEnv *env, jobject thiz, jint tier) {
+  if (gAudioEngine) {
+    gAudioEngine->setQualityTier(tier);
+  }
+}
+
+JNIEXPORT jint JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeGetQualityTier(
+    JNIEnv *env, jobject thiz) {
+  if (gAudioEngine) {
+    return gAudioEngine->getQualityTier();
+  }
+  return 0;
+}
+
+JNIEXPORT void JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeSetPolyphony(JNIEnv *env,
+                                                                jobject thiz,
+                                                                jint count) {
+  if (gAudioEngine) {
+    gAudioEngine->setPolyphony(count);
+  }
+}
+
+JNIEXPORT void JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeSetMultiCoreRenderingEnabled(
+    JNIEnv *env, jobject thiz, jboolean enabled) {
+  if (gAudioEngine) {
+    gAudioEngine->setMultiCoreRenderingEnabled(enabled);
+  }
+}
+
+JNIEXPORT void JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeSetDrumOneShotsEnabled(
+    JNIEnv *env, jobject thiz, jboolean enabled) {
+  if (gAudioEngine) {
+    gAudioEngine->setDrumOneShotsEnabled(enabled);
+  }
+}
+
 // ===== VOLUME CONTROLS =====
 
 JNIEXPORT void JNICALL
@@ -611,6 +746,15 @@ Java_com_synthio_app_audio_SynthesizerEngine_nativeLooperClearTrack(
   }
 }
 
+JNIEXPORT jboolean JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeLooperBounceTracks(
+    JNIEnv *env, jobject thiz, jint trackMask) {
+  if (gAudioEngine) {
+    return gAudioEngine->looperBounceTracks(trackMask);
+  }
+  return false;
+}
+
 JNIEXPORT void JNICALL
 Java_com_synthio_app_audio_SynthesizerEngine_nativeLooperClearAllTracks(
     JNIEnv *env, jobject thiz) {
@@ -722,6 +866,52 @@ Java_com_synthio_app_audio_SynthesizerEngine_nativeLooperGetBarCount(
   return 4; // Default
 }
 
+// ===== LOOPER CAPACITY =====
+
+JNIEXPORT jboolean JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeLooperConfigure(
+    JNIEnv *env, jobject thiz, jint trackCount, jint maxBars,
+    jlong memoryBudget, jstring sessionPath) {
+  if (!gAudioEngine) {
+    return false;
+  }
+  const char *path =
+      sessionPath ? env->GetStringUTFChars(sessionPath, nullptr) : nullptr;
+  bool ok =
+      gAudioEngine->looperConfigure(trackCount, maxBars, memoryBudget, path);
+  if (path) {
+    env->ReleaseStringUTFChars(sessionPath, path);
+  }
+  return ok;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeLooperSaveSession(
+    JNIEnv *env, jobject thiz, jboolean wait) {
+  if (gAudioEngine) {
+    return gAudioEngine->looperSaveSession(wait);
+  }
+  return false;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeLooperGetTrackCount(
+    JNIEnv *env, jobject thiz) {
+  if (gAudioEngine) {
+    return gAudioEngine->looperGetTrackCount();
+  }
+  return 0;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeLooperGetMaxBars(
+    JNIEnv *env, jobject thiz) {
+  if (gAudioEngine) {
+    return gAudioEngine->looperGetMaxBars();
+  }
+  return 0;
+}
+
 JNIEXPORT jfloatArray JNICALL
 Java_com_synthio_app_audio_SynthesizerEngine_nativeLooperGetMixedBuffer(
     JNIEnv *env, jobject thiz, jint trackMask) {
@@ -744,6 +934,30 @@ Java_com_synthio_app_audio_SynthesizerEngine_nativeLooperGetMixedBuffer(
   return result;
 }
 
+// ===== STREAMING EXPORT =====
+// Rendered and encoded natively straight into the file descriptor, so the
+// audio never passes through the JVM heap. Kotlin keeps ownership of fd.
+JNIEXPORT jlong JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeExportToFile(
+    JNIEnv *env, jobject thiz, jint fd, jint format, jint trackMask,
+    jboolean includeDrums, jint bars) {
+  if (gAudioEngine) {
+    return gAudioEngine->exportToFile(
+        fd, static_cast<synthio::AudioEngine::ExportFormat>(format),
+        trackMask, includeDrums, bars);
+  }
+  return -1;
+}
+
+JNIEXPORT jfloat JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeGetExportProgress(
+    JNIEnv *env, jobject thiz) {
+  if (gAudioEngine) {
+    return gAudioEngine->getExportProgress();
+  }
+  return 0.0f;
+}
+
 JNIEXPORT jlong JNICALL
 Java_com_synthio_app_audio_SynthesizerEngine_nativeLooperGetBufferSize(
     JNIEnv *env, jobject thiz) {
@@ -753,4 +967,178 @@ Java_com_synthio_app_audio_SynthesizerEngine_nativeLooperGetBufferSize(
   return 0;
 }
 
+// ===== PERFORMANCE STATS =====
+// Flat snapshot for the Kotlin side; the layout must match
+// SynthesizerEngine.PerfStats.fromArray:
+// [0] callbacks, [1] xruns, [2] active voices, [3] budget us,
+// [4] last load %, [5] average load %, [6] peak load %,
+// [7] average callback us, [8] max callback us, [9] voice limit,
+// [10..] per-stage us (polyphony, effects, looper, drums),
+// then the load histogram (10% buckets, last = overruns), then audio-thread
+// allocations, audio-thread locks (debug builds) and dropped RT log messages.
+JNIEXPORT jdoubleArray JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeGetPerfStats(JNIEnv *env,
+                                                                jobject thiz) {
+  if (!gAudioEngine) {
+    return nullptr;
+  }
+
+  synthio::PerfSnapshot stats = gAudioEngine->getPerfStats();
+  constexpr int STAGE_OFFSET = 10;
+  constexpr int HISTOGRAM_OFFSET = STAGE_OFFSET + synthio::PERF_STAGE_COUNT;
+  constexpr int SAFETY_OFFSET =
+      HISTOGRAM_OFFSET + synthio::PERF_HISTOGRAM_BUCKETS;
+  constexpr int SIZE = SAFETY_OFFSET + 3;
+
+  jdouble values[SIZE] = {
+      static_cast<jdouble>(stats.callbacks), static_cast<jdouble>(stats.xruns),
+      static_cast<jdouble>(stats.activeVoices), stats.budgetMicros,
+      stats.lastLoad, stats.averageLoad, stats.peakLoad,
+      stats.averageCallbackMicros, stats.maxCallbackMicros,
+      static_cast<jdouble>(stats.voiceLimit)};
+  for (int i = 0; i < synthio::PERF_STAGE_COUNT; ++i) {
+    values[STAGE_OFFSET + i] = stats.stageMicros[i];
+  }
+  for (int i = 0; i < synthio::PERF_HISTOGRAM_BUCKETS; ++i) {
+    values[HISTOGRAM_OFFSET + i] = stats.loadHistogram[i];
+  }
+  values[SAFETY_OFFSET] = static_cast<jdouble>(stats.rtAllocations);
+  values[SAFETY_OFFSET + 1] = static_cast<jdouble>(stats.rtLocks);
+  values[SAFETY_OFFSET + 2] = static_cast<jdouble>(stats.rtLogDropped);
+
+  jdoubleArray result = env->NewDoubleArray(SIZE);
+  if (result == nullptr) {
+    return nullptr; // Out of memory
+  }
+  env->SetDoubleArrayRegion(result, 0, SIZE, values);
+  return result;
+}
+
+JNIEXPORT void JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeResetPerfStats(JNIEnv *env,
+                                                                  jobject thiz) {
+  if (gAudioEngine) {
+    gAudioEngine->resetPerfStats();
+  }
+}
+
+// ===== PATCHES =====
+
+// Layout written by SynthPatch.toArray() on the Kotlin side
+enum PatchField : int {
+  PATCH_WAVEFORMS = 0, // Four 0/1 flags: sine, square, sawtooth, triangle
+  PATCH_PULSE_WIDTH = 4,
+  PATCH_SUB_OSC_LEVEL,
+  PATCH_NOISE_LEVEL,
+  PATCH_FILTER_CUTOFF,
+  PATCH_FILTER_RESONANCE,
+  PATCH_FILTER_ENV_AMOUNT,
+  PATCH_FILTER_KEY_TRACKING,
+  PATCH_HPF_CUTOFF,
+  PATCH_ATTACK,
+  PATCH_DECAY,
+  PATCH_SUSTAIN,
+  PATCH_RELEASE,
+  PATCH_GLIDE_TIME,
+  PATCH_GLIDE_ENABLED,
+  PATCH_LFO_RATE,
+  PATCH_LFO_PITCH_DEPTH,
+  PATCH_LFO_FILTER_DEPTH,
+  PATCH_LFO_PWM_DEPTH,
+  PATCH_CHORUS_MODE,
+  PATCH_UNISON_ENABLED,
+  PATCH_UNISON_VOICES,
+  PATCH_UNISON_DETUNE,
+  PATCH_TREMOLO_RATE,
+  PATCH_TREMOLO_DEPTH,
+  PATCH_REVERB_SIZE,
+  PATCH_REVERB_MIX,
+  PATCH_DELAY_TIME,
+  PATCH_DELAY_FEEDBACK,
+  PATCH_DELAY_MIX,
+  PATCH_VOLUME,
+  PATCH_FIELD_COUNT
+};
+
+JNIEXPORT jboolean JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeSetPatch(
+    JNIEnv *env, jobject thiz, jfloatArray values) {
+  if (!gAudioEngine || env->GetArrayLength(values) < PATCH_FIELD_COUNT) {
+    return false;
+  }
+  jfloat v[PATCH_FIELD_COUNT];
+  env->GetFloatArrayRegion(values, 0, PATCH_FIELD_COUNT, v);
+
+  synthio::SynthPatch patch;
+  synthio::VoicePatch &voice = patch.voice;
+  for (int i = 0; i < 4; ++i) {
+    voice.waveforms[i] = v[PATCH_WAVEFORMS + i] != 0.0f;
+  }
+  voice.pulseWidth = v[PATCH_PULSE_WIDTH];
+  voice.subOscLevel = v[PATCH_SUB_OSC_LEVEL];
+  voice.noiseLevel = v[PATCH_NOISE_LEVEL];
+  voice.filterCutoff = v[PATCH_FILTER_CUTOFF];
+  voice.filterResonance = v[PATCH_FILTER_RESONANCE];
+  voice.filterEnvAmount = v[PATCH_FILTER_ENV_AMOUNT];
+  voice.filterKeyTracking = v[PATCH_FILTER_KEY_TRACKING];
+  voice.hpfCutoff = v[PATCH_HPF_CUTOFF];
+  voice.attack = v[PATCH_ATTACK];
+  voice.decay = v[PATCH_DECAY];
+  voice.sustain = v[PATCH_SUSTAIN];
+  voice.release = v[PATCH_RELEASE];
+  voice.glideTime = v[PATCH_GLIDE_TIME];
+  voice.glideEnabled = v[PATCH_GLIDE_ENABLED] != 0.0f;
+  patch.lfoRate = v[PATCH_LFO_RATE];
+  patch.lfoPitchDepth = v[PATCH_LFO_PITCH_DEPTH];
+  patch.lfoFilterDepth = v[PATCH_LFO_FILTER_DEPTH];
+  patch.lfoPWMDepth = v[PATCH_LFO_PWM_DEPTH];
+  patch.chorusMode = static_cast<int>(v[PATCH_CHORUS_MODE]);
+  patch.unisonEnabled = v[PATCH_UNISON_ENABLED] != 0.0f;
+  patch.unisonVoices = static_cast<int>(v[PATCH_UNISON_VOICES]);
+  patch.unisonDetune = v[PATCH_UNISON_DETUNE];
+  patch.tremoloRate = v[PATCH_TREMOLO_RATE];
+  patch.tremoloDepth = v[PATCH_TREMOLO_DEPTH];
+  patch.reverbSize = v[PATCH_REVERB_SIZE];
+  patch.reverbMix = v[PATCH_REVERB_MIX];
+  patch.delayTime = v[PATCH_DELAY_TIME];
+  patch.delayFeedback = v[PATCH_DELAY_FEEDBACK];
+  patch.delayMix = v[PATCH_DELAY_MIX];
+  patch.volume = v[PATCH_VOLUME];
+  return gAudioEngine->setPatch(patch);
+}
+
+// ===== NATIVE MIDI INPUT =====
+
+JNIEXPORT jboolean JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeIsMidiInputAvailable(
+    JNIEnv *env, jobject thiz) {
+  return synthio::MidiInput::isAvailable();
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeMidiOpenDevice(
+    JNIEnv *env, jobject thiz, jobject midiDevice, jint deviceId,
+    jint numPorts) {
+  if (gMidiInput) {
+    return gMidiInput->openDevice(env, midiDevice, deviceId, numPorts);
+  }
+  return false;
+}
+
+JNIEXPORT void JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeMidiCloseDevice(
+    JNIEnv *env, jobject thiz, jint deviceId) {
+  if (gMidiInput) {
+    gMidiInput->closeDevice(deviceId);
+  }
+}
+
+JNIEXPORT void JNICALL
+Java_com_synthio_app_audio_SynthesizerEngine_nativeMidiCloseAll(JNIEnv *env,
+                                                                jobject thiz) {
+  if (gMidiInput) {
+    gMidiInput->closeAll();
+  }
+}
+
 } // extern "C"
@@ -0,0 +1,342 @@
+// WebAssembly build of the DSP core for the web app.
+//
+// Drives the same classes as the Android engine's live path (synth voices
+// or the Wurlitzer, the synth effects chain, bass boost and the drum
+// machine, with the same gain staging) so the browser sounds like the app.
+// The AudioWorklet (web/public/worklets/synthio-processor.js) calls in on
+// its render thread for both control messages and rendering, so nothing
+// here needs the Android engine's event queue, threads or Oboe. There is no
+// looper or export on the web.
+//
+// Output is rendered straight into two static block buffers in linear
+// memory that the worklet reads through Float32Array views:
+//
+//   synthio_init(sampleRate)
+//   synthio_note_on / synthio_note_off / synthio_set_param ...
+//   synthio_render(numFrames)   // <= MAX_BLOCK_SIZE
+//   synthio_output_left() / synthio_output_right()
+//
+// Built with -msimd128, which selects the wasm SIMD path of SimdMath.h.
+
+#include "DSPConfig.h"
+#include "Delay.h"
+#include "DrumMachine.h"
+#include "PolyphonyManager.h"
+#include "QualityTier.h"
+#include "Reverb.h"
+#include "SmoothedParameter.h"
+#include "Tremolo.h"
+#include "Wavetable.h"
+#include "WurlitzerEngine.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+#define SYNTHIO_EXPORT(name) extern "C" __attribute__((export_name(name)))
+
+namespace synthio {
+namespace {
+
+// Parameter ids for synthio_set_param; the worklet keeps the same table
+enum WebParam : int {
+  PARAM_WAVEFORM = 0, // Waveform enum value
+  PARAM_ATTACK,
+  PARAM_DECAY,
+  PARAM_SUSTAIN,
+  PARAM_RELEASE,
+  PARAM_FILTER_CUTOFF, // Hz
+  PARAM_FILTER_RESONANCE, // 0-1
+  PARAM_FILTER_ENV_AMOUNT,
+  PARAM_LFO_RATE,
+  PARAM_LFO_PITCH_DEPTH,
+  PARAM_LFO_FILTER_DEPTH,
+  PARAM_CHORUS_MODE, // 0=off, 1=I, 2=II
+  PARAM_TREMOLO_RATE,
+  PARAM_TREMOLO_DEPTH,
+  PARAM_DELAY_TIME, // Seconds
+  PARAM_DELAY_FEEDBACK,
+  PARAM_DELAY_MIX,
+  PARAM_REVERB_SIZE,
+  PARAM_REVERB_MIX,
+  PARAM_VOLUME,
+  PARAM_WURLITZER_MODE, // 0/1
+  PARAM_DRUMS_ENABLED,  // 0/1
+  PARAM_DRUM_BPM,
+  PARAM_QUALITY_TIER,   // QualityTier value
+};
+
+class WebEngine {
+public:
+  explicit WebEngine(float sampleRate) {
+    mPolyphonyManager.setEffectArena(&mEffectArena);
+    mWurlitzerEngine.setEffectArena(&mEffectArena);
+    mSynthDelay.setArena(&mEffectArena);
+    mSynthReverb.setArena(&mEffectArena);
+
+    mPolyphonyManager.setSampleRate(sampleRate);
+    mWurlitzerEngine.setSampleRate(sampleRate);
+    mDrumMachine.setSampleRate(sampleRate);
+    mSynthTremolo.setSampleRate(sampleRate);
+    mSynthDelay.setSampleRate(sampleRate);
+    mSynthReverb.setSampleRate(sampleRate);
+    mVolume.setRampTime(PARAMETER_RAMP_TIME, sampleRate);
+
+    // Same effect defaults as AudioEngine (all off)
+    mSynthTremolo.setRate(5.0f);
+    mSynthTremolo.setDepth(0.0f);
+    mSynthDelay.setTime(0.3f);
+    mSynthDelay.setFeedback(0.3f);
+    mSynthDelay.setMix(0.0f);
+    mSynthReverb.setSize(0.5f);
+    mSynthReverb.setMix(0.0f);
+    applyQualityTier(QualityTier::STANDARD);
+
+    // This runs in the worklet's constructor on the render thread, which
+    // has no background threads to hand the build to. Only the default saw
+    // and the square are built here; the web UI selects one waveform at a
+    // time, and each other table is built when it is first chosen.
+    WavetableBank::prepare(waveformMask(Waveform::SAWTOOTH));
+    WavetableBank::prepare(waveformMask(Waveform::SQUARE));
+  }
+
+  void noteOn(int midiNote, float velocity) {
+    const float frequency =
+        440.0f * std::pow(2.0f, (static_cast<float>(midiNote) - 69.0f) / 12.0f);
+    if (mWurlitzerMode) {
+      mWurlitzerEngine.noteOn(midiNote, frequency, velocity);
+    } else {
+      mPolyphonyManager.noteOn(midiNote, frequency);
+    }
+  }
+
+  void noteOff(int midiNote) {
+    if (mWurlitzerMode) {
+      mWurlitzerEngine.noteOff(midiNote);
+    } else {
+      mPolyphonyManager.noteOff(midiNote);
+    }
+  }
+
+  void allNotesOff() {
+    mPolyphonyManager.allNotesOff();
+    mWurlitzerEngine.allNotesOff();
+  }
+
+  void setParam(int param, float value) {
+    switch (param) {
+    case PARAM_WAVEFORM: {
+      const auto waveform =
+          static_cast<Waveform>(std::clamp(static_cast<int>(value), 0, 3));
+      // One table (a few ms) between blocks; a no-op once built
+      WavetableBank::prepare(waveformMask(waveform));
+      mPolyphonyManager.setWaveform(waveform);
+      break;
+    }
+    case PARAM_ATTACK:
+      mPolyphonyManager.setAttack(value);
+      break;
+    case PARAM_DECAY:
+      mPolyphonyManager.setDecay(value);
+      break;
+    case PARAM_SUSTAIN:
+      mPolyphonyManager.setSustain(value);
+      break;
+    case PARAM_RELEASE:
+      mPolyphonyManager.setRelease(value);
+      break;
+    case PARAM_FILTER_CUTOFF:
+      mPolyphonyManager.setFilterCutoff(value);
+      break;
+    case PARAM_FILTER_RESONANCE:
+      mPolyphonyManager.setFilterResonance(value);
+      break;
+    case PARAM_FILTER_ENV_AMOUNT:
+      mPolyphonyManager.setFilterEnvelopeAmount(value);
+      break;
+    case PARAM_LFO_RATE:
+      mPolyphonyManager.setLFORate(value);
+      break;
+    case PARAM_LFO_PITCH_DEPTH:
+      mPolyphonyManager.setLFOPitchDepth(value);
+      break;
+    case PARAM_LFO_FILTER_DEPTH:
+      mPolyphonyManager.setLFOFilterDepth(value);
+      break;
+    case PARAM_CHORUS_MODE:
+      mPolyphonyManager.setChorusMode(static_cast<int>(value));
+      mWurlitzerEngine.setChorusMode(static_cast<int>(value));
+      break;
+    case PARAM_TREMOLO_RATE:
+      mSynthTremolo.setRate(value);
+      break;
+    case PARAM_TREMOLO_DEPTH:
+      mSynthTremolo.setDepth(value);
+      break;
+    case PARAM_DELAY_TIME:
+      mSynthDelay.setTime(value);
+      break;
+    case PARAM_DELAY_FEEDBACK:
+      mSynthDelay.setFeedback(value);
+      break;
+    case PARAM_DELAY_MIX:
+      mSynthDelay.setMix(value);
+      break;
+    case PARAM_REVERB_SIZE:
+      mSynthReverb.setSize(value);
+      break;
+    case PARAM_REVERB_MIX:
+      mSynthReverb.setMix(value);
+      break;
+    case PARAM_VOLUME:
+      mVolume.setTarget(std::clamp(value, 0.0f, 1.0f));
+      break;
+    case PARAM_WURLITZER_MODE:
+      allNotesOff();
+      mWurlitzerMode = value != 0.0f;
+      break;
+    case PARAM_DRUMS_ENABLED:
+      mDrumsEnabled = value != 0.0f;
+      mDrumMachine.setEnabled(mDrumsEnabled);
+      break;
+    case PARAM_DRUM_BPM:
+      mDrumMachine.setBPM(value);
+      break;
+    case PARAM_QUALITY_TIER:
+      applyQualityTier(static_cast<QualityTier>(
+          std::clamp(static_cast<int>(value),
+                     static_cast<int>(QualityTier::ECO),
+                     static_cast<int>(QualityTier::HIGH))));
+      break;
+    default:
+      break;
+    }
+  }
+
+  // Mirrors AudioEngine::renderBlock without the looper and metronome
+  void render(int numFrames) {
+    numFrames = std::clamp(numFrames, 0, MAX_BLOCK_SIZE);
+    float *left = mOutputL;
+    float *right = mOutputR;
+
+    if (mDrumsEnabled) {
+      mDrumMachine.processBlock(mDrums, numFrames);
+    } else {
+      std::fill(mDrums, mDrums + numFrames, 0.0f);
+    }
+
+    if (mWurlitzerMode) {
+      mWurlitzerEngine.processBlock(left, right, numFrames);
+    } else {
+      mPolyphonyManager.processBlock(left, right, numFrames);
+      mSynthTremolo.processBlock(left, right, numFrames);
+      mSynthDelay.processBlock(left, right, numFrames);
+      mSynthReverb.processBlock(left, right, numFrames);
+
+      for (int i = 0; i < numFrames; ++i) {
+        mBassL += BASS_CUTOFF * (left[i] - mBassL);
+        mBassR += BASS_CUTOFF * (right[i] - mBassR);
+        left[i] += mBassL * BASS_BOOST_AMOUNT;
+        right[i] += mBassR * BASS_BOOST_AMOUNT;
+      }
+    }
+    mVolume.applyGain(left, right, numFrames);
+
+    for (int i = 0; i < numFrames; ++i) {
+      const float drum = mDrums[i] * MIX_DRUM_GAIN;
+      left[i] = std::clamp(left[i] * MIX_SYNTH_GAIN + drum, -1.0f, 1.0f);
+      right[i] = std::clamp(right[i] * MIX_SYNTH_GAIN + drum, -1.0f, 1.0f);
+    }
+  }
+
+  float *outputLeft() { return mOutputL; }
+  float *outputRight() { return mOutputR; }
+
+private:
+  static constexpr float BASS_CUTOFF = 0.02f;
+  static constexpr float BASS_BOOST_AMOUNT = 0.4f;
+
+  EffectArena mEffectArena;
+  PolyphonyManager mPolyphonyManager;
+  WurlitzerEngine mWurlitzerEngine;
+  DrumMachine mDrumMachine;
+  Tremolo mSynthTremolo;
+  Delay mSynthDelay;
+  Reverb mSynthReverb;
+  // The page's master GainNode sets the listening level, so this starts at
+  // unity rather than the app's 0.7
+  SmoothedParameter mVolume{1.0f};
+  bool mWurlitzerMode = false;
+  bool mDrumsEnabled = false;
+  float mBassL = 0.0f;
+  float mBassR = 0.0f;
+
+  alignas(16) float mOutputL[MAX_BLOCK_SIZE] = {};
+  alignas(16) float mOutputR[MAX_BLOCK_SIZE] = {};
+  alignas(16) float mDrums[MAX_BLOCK_SIZE] = {};
+
+  static int waveformMask(Waveform waveform) {
+    return 1 << static_cast<int>(waveform);
+  }
+
+  void applyQualityTier(QualityTier tier) {
+    const QualitySettings settings = QualitySettings::forTier(tier);
+    mPolyphonyManager.setFilterQuality(settings.filterControlInterval,
+                                       settings.filterOversampling);
+    mPolyphonyManager.setWavetableEnabled(settings.wavetables);
+    mDrumMachine.setOneShotsEnabled(settings.drumOneShots);
+    mSynthReverb.setStereo(settings.stereoReverb);
+    mWurlitzerEngine.setReverbStereo(settings.stereoReverb);
+  }
+};
+
+std::unique_ptr<WebEngine> gEngine;
+
+} // namespace
+} // namespace synthio
+
+using synthio::gEngine;
+
+SYNTHIO_EXPORT("synthio_init") int synthio_init(float sampleRate) {
+  gEngine = std::make_unique<synthio::WebEngine>(sampleRate);
+  return synthio::MAX_BLOCK_SIZE;
+}
+
+SYNTHIO_EXPORT("synthio_output_left") float *synthio_output_left() {
+  return gEngine ? gEngine->outputLeft() : nullptr;
+}
+
+SYNTHIO_EXPORT("synthio_output_right") float *synthio_output_right() {
+  return gEngine ? gEngine->outputRight() : nullptr;
+}
+
+SYNTHIO_EXPORT("synthio_render") void synthio_render(int numFrames) {
+  if (gEngine) {
+    gEngine->render(numFrames);
+  }
+}
+
+SYNTHIO_EXPORT("synthio_note_on")
+void synthio_note_on(int midiNote, float velocity) {
+  if (gEngine) {
+    gEngine->noteOn(midiNote, velocity);
+  }
+}
+
+SYNTHIO_EXPORT("synthio_note_off") void synthio_note_off(int midiNote) {
+  if (gEngine) {
+    gEngine->noteOff(midiNote);
+  }
+}
+
+SYNTHIO_EXPORT("synthio_all_notes_off") void synthio_all_notes_off() {
+  if (gEngine) {
+    gEngine->allNotesOff();
+  }
+}
+
+SYNTHIO_EXPORT("synthio_set_param") void synthio_set_param(int param,
+                                                           float value) {
+  if (gEngine) {
+    gEngine->setParam(param, value);
+  }
+}
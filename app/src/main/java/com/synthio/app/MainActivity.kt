@@ -52,6 +52,8 @@ class MainActivity : ComponentActivity() {
                 
                 // Start/stop engine with lifecycle - inside setContent to avoid race condition
                 DisposableEffect(synthViewModel) {
+                    // Context first: the looper session file lives in app storage
+                    synthViewModel.initContext(context)
                     synthViewModel.startEngine()
                     onDispose {
                         synthViewModel.stopEngine()
@@ -5,14 +5,17 @@ import android.content.Context
 import android.net.Uri
 import android.os.Build
 import android.os.Environment
+import android.os.ParcelFileDescriptor
 import android.provider.MediaStore
 import android.util.Log
 import com.synthio.app.data.ExportDatabase
 import com.synthio.app.data.ExportedFile
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.isActive
+import kotlinx.coroutines.launch
 import kotlinx.coroutines.withContext
 import java.io.File
-import java.io.FileOutputStream
 import java.text.SimpleDateFormat
 import java.util.*
 
@@ -25,6 +28,7 @@ class AudioExportService(private val context: Context) {
     companion object {
         private const val TAG = "AudioExportService"
         private const val EXPORTS_DIR = "exports"
+        private const val PROGRESS_POLL_MS = 100L
     }
     
     private val database by lazy { ExportDatabase.getDatabase(context) }
@@ -48,15 +52,6 @@ class AudioExportService(private val context: Context) {
         try {
             onProgress(0.1f)
             
-            // Get audio buffer from native
-            val buffer = SynthesizerEngine.looperGetMixedBuffer(trackMask)
-            if (buffer == null || buffer.isEmpty()) {
-                Log.e(TAG, "Failed to get audio buffer, no content")
-                return@withContext null
-            }
-            
-            onProgress(0.3f)
-            
             // Create exports directory if needed
             val exportsDir = File(context.filesDir, EXPORTS_DIR)
             if (!exportsDir.exists()) {
@@ -69,21 +64,42 @@ class AudioExportService(private val context: Context) {
             val filename = "SynthIO_Loop_$timestamp.$extension"
             val file = File(exportsDir, filename)
             
-            onProgress(0.4f)
-            
-            // Encode and save to internal storage
-            FileOutputStream(file).use { outputStream ->
-                if (quality == "compressed") {
-                    AacEncoder.encode(buffer, outputStream)
-                } else {
-                    WavEncoder.encode(buffer, outputStream)
+            // Render and encode the mixdown natively (tracks + optional
+            // drums, offline) straight into the file, polling its progress
+            val format = if (quality == "compressed") {
+                SynthesizerEngine.EXPORT_AAC
+            } else {
+                SynthesizerEngine.EXPORT_WAV
+            }
+            val progressPoller = launch {
+                while (isActive) {
+                    delay(PROGRESS_POLL_MS)
+                    onProgress(0.1f + 0.8f * SynthesizerEngine.exportGetProgress())
                 }
             }
+            val framesWritten = try {
+                ParcelFileDescriptor.open(
+                    file,
+                    ParcelFileDescriptor.MODE_WRITE_ONLY or
+                        ParcelFileDescriptor.MODE_CREATE or
+                        ParcelFileDescriptor.MODE_TRUNCATE
+                ).use { descriptor ->
+                    SynthesizerEngine.exportToFile(descriptor.fd, format, trackMask, includeDrums)
+                }
+            } finally {
+                progressPoller.cancel()
+            }
+            
+            if (framesWritten <= 0) {
+                Log.e(TAG, if (framesWritten == 0L) "Nothing to export, no content" else "Export encoding failed")
+                file.delete()
+                return@withContext null
+            }
             
             onProgress(0.9f)
             
             // Calculate metadata
-            val durationMs = WavEncoder.calculateDurationMs(buffer.size)
+            val durationMs = framesWritten * 1000L / SynthesizerEngine.getSampleRate()
             val fileSize = file.length()
             
             // Create database record
@@ -0,0 +1,97 @@
+package com.synthio.app.audio
+
+import android.annotation.SuppressLint
+import android.content.Context
+import android.media.AudioDeviceCallback
+import android.media.AudioDeviceInfo
+import android.media.AudioManager
+import android.os.Handler
+import android.os.Looper
+import android.util.Log
+
+/**
+ * Watches the audio outputs and reports whether playback goes to Bluetooth.
+ *
+ * The engine uses this to pick the stream type: wired and built-in outputs
+ * can take an exclusive low-latency stream, Bluetooth stays shared. The
+ * answer comes from the device the stream is actually routed to
+ * ([routedDeviceId]), so a paired headset that isn't playing doesn't count.
+ * Until a stream is open (id 0) any Bluetooth output is taken as the route,
+ * since media follows a connected Bluetooth device.
+ */
+class AudioRouteMonitor(
+    context: Context,
+    private val routedDeviceId: () -> Int
+) {
+
+    companion object {
+        private const val TAG = "AudioRouteMonitor"
+
+        // Newer types are plain ints, safe to compare on older releases
+        @SuppressLint("InlinedApi")
+        private val BLUETOOTH_TYPES = setOf(
+            AudioDeviceInfo.TYPE_BLUETOOTH_A2DP,
+            AudioDeviceInfo.TYPE_BLUETOOTH_SCO,
+            AudioDeviceInfo.TYPE_HEARING_AID,
+            AudioDeviceInfo.TYPE_BLE_HEADSET,
+            AudioDeviceInfo.TYPE_BLE_SPEAKER
+        )
+
+        // The stream moves to a new device some time after the device
+        // callback, so the route is checked again once it has settled
+        private const val ROUTE_SETTLE_MS = 500L
+    }
+
+    private val audioManager = context.getSystemService(AudioManager::class.java)
+    private val handler = Handler(Looper.getMainLooper())
+    private val settledUpdate = Runnable { update() }
+    private var isBluetooth: Boolean? = null
+
+    // Called on the main thread whenever the route type changes
+    var onRouteChanged: ((Boolean) -> Unit)? = null
+
+    private val deviceCallback = object : AudioDeviceCallback() {
+        override fun onAudioDevicesAdded(addedDevices: Array<out AudioDeviceInfo>) {
+            onDevicesChanged()
+        }
+
+        override fun onAudioDevicesRemoved(removedDevices: Array<out AudioDeviceInfo>) {
+            onDevicesChanged()
+        }
+    }
+
+    fun isBluetoothOutput(): Boolean {
+        val outputs = audioManager?.getDevices(AudioManager.GET_DEVICES_OUTPUTS) ?: return false
+        val routed = routedDeviceId().let { id -> outputs.firstOrNull { it.id == id } }
+        if (routed != null) {
+            return routed.type in BLUETOOTH_TYPES
+        }
+        return outputs.any { it.type in BLUETOOTH_TYPES }
+    }
+
+    /** Start listening; the current route is reported right away */
+    fun start() {
+        audioManager?.registerAudioDeviceCallback(deviceCallback, handler)
+    }
+
+    fun stop() {
+        audioManager?.unregisterAudioDeviceCallback(deviceCallback)
+        handler.removeCallbacks(settledUpdate)
+        isBluetooth = null
+    }
+
+    private fun onDevicesChanged() {
+        update()
+        handler.removeCallbacks(settledUpdate)
+        handler.postDelayed(settledUpdate, ROUTE_SETTLE_MS)
+    }
+
+    private fun update() {
+        val bluetooth = isBluetoothOutput()
+        if (bluetooth != isBluetooth) {
+            isBluetooth = bluetooth
+            Log.i(TAG, "Output route: ${if (bluetooth) "Bluetooth" else "wired/built-in"}")
+            onRouteChanged?.invoke(bluetooth)
+        }
+    }
+}
@@ -58,13 +58,12 @@ data class ExportJob(
      */
     fun getTrackDescription(): String {
         val tracks = mutableListOf<Int>()
-        for (i in 0 until 4) {
+        for (i in 0 until Int.SIZE_BITS - 1) {
             if ((trackMask and (1 shl i)) != 0) {
                 tracks.add(i + 1)
             }
         }
         return when {
-            tracks.size == 4 -> "All Tracks"
             tracks.size == 1 -> "Track ${tracks[0]}"
             else -> "Tracks ${tracks.joinToString(", ")}"
         }
@@ -25,6 +25,11 @@ import kotlinx.coroutines.flow.asStateFlow
  * 
  * All incoming MIDI notes are routed to the synthesizer engine,
  * supporting the full 128-note MIDI range regardless of the UI keyboard display.
+ *
+ * On Android 10+ the device's ports are read natively (AMidi): notes and the
+ * sustain pedal reach the audio thread without a JVM hop, and only other
+ * controllers come back here through onControlChange. Older releases use
+ * the MidiReceiver below.
  */
 class MidiHandler(private val context: Context) {
     
@@ -53,6 +58,7 @@ class MidiHandler(private val context: Context) {
     private var midiManager: MidiManager? = null
     private val openDevices = mutableMapOf<MidiDeviceInfo, MidiDevice>()
     private val openPorts = mutableListOf<MidiOutputPort>()
+    private val nativeDevices = mutableSetOf<MidiDeviceInfo>()
     
     // Callback for MIDI note events
     var onNoteOn: ((Int, Int) -> Unit)? = null  // (midiNote, velocity)
@@ -170,6 +176,11 @@ class MidiHandler(private val context: Context) {
         _isMidiAvailable.value = true
         Log.i(TAG, "MIDI support initialized")
         
+        // Controllers from the native path arrive on its reader thread
+        SynthesizerEngine.onMidiControlChange = { controller, value ->
+            handler.post { onControlChange?.invoke(controller, value) }
+        }
+        
         // Register device callback to detect connections/disconnections
         midiManager?.registerDeviceCallback(deviceCallback, handler)
         
@@ -213,6 +224,13 @@ class MidiHandler(private val context: Context) {
             if (device != null) {
                 openDevices[deviceInfo] = device
                 
+                if (SynthesizerEngine.openNativeMidiDevice(device, deviceInfo.id, deviceInfo.outputPortCount)) {
+                    nativeDevices.add(deviceInfo)
+                    Log.i(TAG, "Native MIDI input from ${getDeviceName(deviceInfo)}")
+                    _isDeviceConnected.value = true
+                    return@openDevice
+                }
+                
                 // Open all output ports (MIDI out from device = MIDI input to us)
                 for (i in 0 until deviceInfo.outputPortCount) {
                     val port = device.openOutputPort(i)
@@ -236,6 +254,10 @@ class MidiHandler(private val context: Context) {
     fun disconnectFromDevice(deviceInfo: MidiDeviceInfo) {
         val device = openDevices.remove(deviceInfo) ?: return
         
+        if (nativeDevices.remove(deviceInfo)) {
+            SynthesizerEngine.closeNativeMidiDevice(deviceInfo.id)
+        }
+        
         try {
             device.close()
             Log.i(TAG, "Disconnected from: ${getDeviceName(deviceInfo)}")
@@ -296,6 +318,11 @@ class MidiHandler(private val context: Context) {
         }
         openPorts.clear()
         
+        // Native handles go before the devices they were created from
+        SynthesizerEngine.closeAllNativeMidi()
+        SynthesizerEngine.onMidiControlChange = null
+        nativeDevices.clear()
+        
         // Close all open devices
         for ((_, device) in openDevices) {
             try {
@@ -1,5 +1,8 @@
 package com.synthio.app.audio
 
+import android.media.midi.MidiDevice
+import android.os.Build
+
 /**
  * Kotlin wrapper for the native audio engine.
  * Singleton pattern for global access.
@@ -51,6 +54,58 @@ object SynthesizerEngine {
         }
     }
     
+    // ===== OUTPUT LATENCY =====
+    
+    /**
+     * Tell the engine whether audio is routed to Bluetooth. Wired and
+     * built-in outputs get an exclusive (MMAP) stream with a one-burst buffer;
+     * Bluetooth stays on a shared stream. Reopens the stream if needed.
+     */
+    fun setBluetoothOutput(bluetooth: Boolean) {
+        if (isCreated) {
+            nativeSetBluetoothOutput(bluetooth)
+        }
+    }
+    
+    /** Measured output latency in milliseconds, or null while unknown */
+    fun getOutputLatencyMillis(): Double? {
+        if (isRunning) {
+            return nativeGetOutputLatencyMillis().takeIf { it >= 0.0 }
+        }
+        return null
+    }
+    
+    /** AudioDeviceInfo id the stream is routed to, 0 while no stream is open */
+    fun getOutputDeviceId(): Int {
+        if (isCreated) {
+            return nativeGetOutputDeviceId()
+        }
+        return 0
+    }
+    
+    /** Current stream buffer size (grows when the device underruns) */
+    fun getBufferSizeFrames(): Int {
+        if (isRunning) {
+            return nativeGetBufferSizeFrames()
+        }
+        return 0
+    }
+    
+    fun isExclusiveStream(): Boolean {
+        if (isRunning) {
+            return nativeIsExclusiveStream()
+        }
+        return false
+    }
+    
+    /** Rate the engine runs at; follows the output device's native rate */
+    fun getSampleRate(): Int {
+        if (isRunning) {
+            return nativeGetSampleRate()
+        }
+        return 0
+    }
+    
     fun noteOn(midiNote: Int, frequency: Float) {
         if (isRunning) {
             nativeNoteOn(midiNote, frequency)
@@ -69,6 +124,66 @@ object SynthesizerEngine {
         }
     }
     
+    // ===== NATIVE MIDI INPUT =====
+    
+    /**
+     * Controllers other than the sustain pedal read by the native MIDI path.
+     * Called on the native reader thread.
+     */
+    var onMidiControlChange: ((Int, Int) -> Unit)? = null
+    
+    /** True when MIDI input can bypass the JVM (AMidi, Android 10+) */
+    fun isNativeMidiAvailable(): Boolean {
+        if (isCreated && Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) {
+            return nativeIsMidiInputAvailable()
+        }
+        return false
+    }
+    
+    /**
+     * Read every output port of an open device natively: notes and the
+     * sustain pedal go straight to the audio thread with their MIDI
+     * timestamps. Returns false if the Java path should be used instead.
+     */
+    fun openNativeMidiDevice(device: MidiDevice, deviceId: Int, numPorts: Int): Boolean {
+        if (isNativeMidiAvailable()) {
+            return nativeMidiOpenDevice(device, deviceId, numPorts)
+        }
+        return false
+    }
+    
+    /** Release the native ports; call before closing the device */
+    fun closeNativeMidiDevice(deviceId: Int) {
+        if (isCreated) {
+            nativeMidiCloseDevice(deviceId)
+        }
+    }
+    
+    fun closeAllNativeMidi() {
+        if (isCreated) {
+            nativeMidiCloseAll()
+        }
+    }
+    
+    @JvmStatic
+    private fun onNativeMidiControlChange(controller: Int, value: Int) {
+        onMidiControlChange?.invoke(controller, value)
+    }
+    
+    // ===== PATCHES =====
+    
+    /**
+     * Apply a whole synth preset in one call. The engine derives the voice
+     * coefficients off the audio thread and swaps the patch in at once, so a
+     * preset change doesn't crunch the way a burst of single setters does.
+     */
+    fun setPatch(patch: SynthPatch): Boolean {
+        if (isCreated) {
+            return nativeSetPatch(patch.toArray())
+        }
+        return false
+    }
+    
     // ===== OSCILLATOR PARAMETERS =====
     
     fun setWaveform(waveform: Waveform) {
@@ -209,6 +324,16 @@ object SynthesizerEngine {
         }
     }
     
+    /**
+     * Reverb algorithm for the synth and Wurlitzer: 0 = comb bank (default),
+     * 1 = 8-line feedback delay network (denser tail, same cost).
+     */
+    fun setReverbMode(mode: Int) {
+        if (isCreated) {
+            nativeSetReverbMode(mode)
+        }
+    }
+    
     fun setSynthDelay(time: Float, feedback: Float, mix: Float) {
         if (isCreated) {
             nativeSetSynthDelayTime(time)
@@ -251,6 +376,87 @@ object SynthesizerEngine {
         }
     }
     
+    /**
+     * Unison as detuned oscillator stacks inside one voice per note (default),
+     * or as one whole voice per unison copy.
+     */
+    fun setStackedUnisonEnabled(enabled: Boolean) {
+        if (isCreated) {
+            nativeSetStackedUnisonEnabled(enabled)
+        }
+    }
+    
+    // ===== VOICE RENDERING =====
+    
+    /** Switch between the vectorized (NEON/SSE) voice bank and the scalar voice path. */
+    fun setSimdVoicesEnabled(enabled: Boolean) {
+        if (isCreated) {
+            nativeSetSimdVoicesEnabled(enabled)
+        }
+    }
+    
+    /** Switch oscillators between band-limited wavetables and the polyBLEP generators. */
+    fun setWavetablesEnabled(enabled: Boolean) {
+        if (isCreated) {
+            nativeSetWavetablesEnabled(enabled)
+        }
+    }
+    
+    /**
+     * Render the drum bus and half of the sounding voices on helper cores.
+     * On by default on devices with 4 or more CPUs.
+     */
+    fun setMultiCoreRenderingEnabled(enabled: Boolean) {
+        if (isCreated) {
+            nativeSetMultiCoreRenderingEnabled(enabled)
+        }
+    }
+    
+    /**
+     * Voices that may sound at once, synth and Wurlitzer (1-32, default 12).
+     * When callbacks run short of CPU the engine lowers this on its own and
+     * fades the quietest voices; see PerfStats.voiceLimit.
+     */
+    fun setPolyphony(count: Int) {
+        if (isCreated) {
+            nativeSetPolyphony(count)
+        }
+    }
+    
+    // ===== QUALITY =====
+    
+    const val QUALITY_AUTO = -1
+    const val QUALITY_ECO = 0
+    const val QUALITY_STANDARD = 1
+    const val QUALITY_HIGH = 2
+    
+    /**
+     * DSP quality tier: QUALITY_ECO (coarser filter modulation, mono reverb),
+     * QUALITY_STANDARD, QUALITY_HIGH (2x oversampled filter saturation), or
+     * QUALITY_AUTO (default) for the tier a short benchmark picks when the
+     * engine first starts.
+     */
+    fun setQualityTier(tier: Int) {
+        if (isCreated) {
+            nativeSetQualityTier(tier)
+        }
+    }
+    
+    /** Tier in effect (never QUALITY_AUTO) */
+    fun getQualityTier(): Int {
+        if (isCreated) {
+            return nativeGetQualityTier()
+        }
+        return QUALITY_STANDARD
+    }
+    
+    /** Play pre-rendered drum hits instead of synthesizing every sample. On by default. */
+    fun setDrumOneShotsEnabled(enabled: Boolean) {
+        if (isCreated) {
+            nativeSetDrumOneShotsEnabled(enabled)
+        }
+    }
+    
     // ===== VOLUME CONTROLS =====
     
     fun setSynthVolume(volume: Float) {
@@ -455,6 +661,21 @@ object SynthesizerEngine {
         }
     }
     
+    /**
+     * Merge the selected tracks (unmuted ones, at their current volumes) into
+     * one empty track, or the lowest selected track when all are in use, and
+     * free the others. The mix runs in the background;
+     * the looper state callback fires once the merged track replaces them.
+     * @param trackMask Bitmask of tracks to merge (bit 0 = track 0, etc.)
+     * @return false if the request couldn't be queued
+     */
+    fun looperBounceTracks(trackMask: Int): Boolean {
+        if (isCreated) {
+            return nativeLooperBounceTracks(trackMask)
+        }
+        return false
+    }
+    
     fun looperCancelRecording() {
         if (isCreated) {
             nativeLooperCancelRecording()
@@ -534,6 +755,52 @@ object SynthesizerEngine {
         return 4 // Default
     }
     
+    /**
+     * Reserve looper storage for [trackCount] tracks of up to [maxBars] bars,
+     * limited to [memoryBudgetBytes]. Only allowed while the engine is stopped
+     * (between create() and start()); clears all tracks.
+     * With a [sessionPath] the tracks live in that memory-mapped file: a session
+     * already stored there is reopened with its tracks (and its own layout).
+     * @return false if refused or if not even one bar per track fits
+     */
+    fun looperConfigure(
+        trackCount: Int,
+        maxBars: Int,
+        memoryBudgetBytes: Long,
+        sessionPath: String? = null
+    ): Boolean {
+        if (isCreated && !isRunning) {
+            return nativeLooperConfigure(trackCount, maxBars, memoryBudgetBytes, sessionPath)
+        }
+        return false
+    }
+    
+    /**
+     * Flush the looper session file to disk. Track changes are already written
+     * to the mapping as they happen; this only forces the writeback.
+     */
+    fun looperSaveSession(wait: Boolean = false): Boolean {
+        if (isCreated) {
+            return nativeLooperSaveSession(wait)
+        }
+        return false
+    }
+    
+    fun looperGetTrackCount(): Int {
+        if (isCreated) {
+            return nativeLooperGetTrackCount()
+        }
+        return 0
+    }
+    
+    /** Longest loop that fits the reserved storage at the current tempo */
+    fun looperGetMaxBars(): Int {
+        if (isCreated) {
+            return nativeLooperGetMaxBars()
+        }
+        return 0
+    }
+    
     /**
      * Get mixed audio buffer for export.
      * @param trackMask Bitmask of tracks to include (bit 0 = track 0, etc.)
@@ -546,6 +813,38 @@ object SynthesizerEngine {
         return null
     }
     
+    const val EXPORT_WAV = 0
+    const val EXPORT_AAC = 1
+    
+    /**
+     * Export a mixdown, rendered offline faster than realtime, straight into
+     * a file. Unlike looperGetMixedBuffer this includes the drum pattern and
+     * its decay tail, and can render more bars than the loop (tracks repeat).
+     * Rendering and encoding run natively and overlap, and the audio never
+     * passes through the JVM heap. Blocking; call from a background
+     * dispatcher and poll exportGetProgress() from elsewhere.
+     * @param fd Writable file descriptor, positioned at 0; stays owned by the caller
+     * @param format EXPORT_WAV (16-bit PCM) or EXPORT_AAC (ADTS stream)
+     * @param trackMask Bitmask of tracks to include (bit 0 = track 0, etc.)
+     * @param includeDrums Whether to render the drum machine pattern
+     * @param bars Number of bars to render, or 0 for one loop length
+     * @return Frames written (at getSampleRate()), 0 if nothing to export, -1 on failure
+     */
+    fun exportToFile(fd: Int, format: Int, trackMask: Int, includeDrums: Boolean, bars: Int = 0): Long {
+        if (isCreated) {
+            return nativeExportToFile(fd, format, trackMask, includeDrums, bars)
+        }
+        return -1
+    }
+    
+    /** Progress of the running export, 0.0 to 1.0 */
+    fun exportGetProgress(): Float {
+        if (isCreated) {
+            return nativeGetExportProgress()
+        }
+        return 0f
+    }
+    
     /**
      * Get the size of the loop buffer (interleaved stereo samples)
      */
@@ -556,6 +855,23 @@ object SynthesizerEngine {
         return 0
     }
     
+    // ===== PERFORMANCE STATS =====
+    
+    /** Latest audio callback telemetry, or null if the engine is not created */
+    fun getPerfStats(): PerfStats? {
+        if (isCreated) {
+            return nativeGetPerfStats()?.let { PerfStats.fromArray(it) }
+        }
+        return null
+    }
+    
+    /** Clear the peak, xrun and histogram counters */
+    fun resetPerfStats() {
+        if (isCreated) {
+            nativeResetPerfStats()
+        }
+    }
+    
     // ===== NATIVE FUNCTION DECLARATIONS =====
     
     private external fun nativeCreate()
@@ -566,6 +882,23 @@ object SynthesizerEngine {
     private external fun nativeNoteOff(midiNote: Int)
     private external fun nativeAllNotesOff()
     
+    // Native MIDI input
+    private external fun nativeIsMidiInputAvailable(): Boolean
+    private external fun nativeMidiOpenDevice(device: MidiDevice, deviceId: Int, numPorts: Int): Boolean
+    private external fun nativeMidiCloseDevice(deviceId: Int)
+    private external fun nativeMidiCloseAll()
+    
+    // Output latency
+    private external fun nativeSetBluetoothOutput(bluetooth: Boolean)
+    private external fun nativeGetOutputLatencyMillis(): Double
+    private external fun nativeGetOutputDeviceId(): Int
+    private external fun nativeGetBufferSizeFrames(): Int
+    private external fun nativeIsExclusiveStream(): Boolean
+    private external fun nativeGetSampleRate(): Int
+    
+    // Patches
+    private external fun nativeSetPatch(values: FloatArray): Boolean
+    
     // Oscillator
     private external fun nativeSetWaveform(waveform: Int)
     private external fun nativeToggleWaveform(waveform: Int, enabled: Boolean)
@@ -600,6 +933,7 @@ object SynthesizerEngine {
     private external fun nativeSetSynthTremoloDepth(depth: Float)
     private external fun nativeSetSynthReverbSize(size: Float)
     private external fun nativeSetSynthReverbMix(mix: Float)
+    private external fun nativeSetReverbMode(mode: Int)
     private external fun nativeSetSynthDelayTime(time: Float)
     private external fun nativeSetSynthDelayFeedback(feedback: Float)
     private external fun nativeSetSynthDelayMix(mix: Float)
@@ -612,6 +946,16 @@ object SynthesizerEngine {
     private external fun nativeSetUnisonEnabled(enabled: Boolean)
     private external fun nativeSetUnisonVoices(count: Int)
     private external fun nativeSetUnisonDetune(cents: Float)
+    private external fun nativeSetStackedUnisonEnabled(enabled: Boolean)
+    
+    // Voice rendering
+    private external fun nativeSetSimdVoicesEnabled(enabled: Boolean)
+    private external fun nativeSetWavetablesEnabled(enabled: Boolean)
+    private external fun nativeSetMultiCoreRenderingEnabled(enabled: Boolean)
+    private external fun nativeSetPolyphony(count: Int)
+    private external fun nativeSetQualityTier(tier: Int)
+    private external fun nativeGetQualityTier(): Int
+    private external fun nativeSetDrumOneShotsEnabled(enabled: Boolean)
     
     // Volume
     private external fun nativeSetSynthVolume(volume: Float)
@@ -655,6 +999,7 @@ object SynthesizerEngine {
     // Multi-track looper
     private external fun nativeLooperStartRecordingTrack(trackIndex: Int)
     private external fun nativeLooperClearTrack(trackIndex: Int)
+    private external fun nativeLooperBounceTracks(trackMask: Int): Boolean
     private external fun nativeLooperClearAllTracks()
     private external fun nativeLooperCancelRecording()
     private external fun nativeLooperSetTrackVolume(trackIndex: Int, volume: Float)
@@ -668,8 +1013,150 @@ object SynthesizerEngine {
     private external fun nativeLooperGetUsedTrackCount(): Int
     private external fun nativeLooperSetBarCount(bars: Int)
     private external fun nativeLooperGetBarCount(): Int
+    private external fun nativeLooperConfigure(
+        trackCount: Int,
+        maxBars: Int,
+        memoryBudget: Long,
+        sessionPath: String?
+    ): Boolean
+    private external fun nativeLooperSaveSession(wait: Boolean): Boolean
+    private external fun nativeLooperGetTrackCount(): Int
+    private external fun nativeLooperGetMaxBars(): Int
     private external fun nativeLooperGetMixedBuffer(trackMask: Int): FloatArray?
     private external fun nativeLooperGetBufferSize(): Long
+    private external fun nativeExportToFile(
+        fd: Int,
+        format: Int,
+        trackMask: Int,
+        includeDrums: Boolean,
+        bars: Int
+    ): Long
+    private external fun nativeGetExportProgress(): Float
+    
+    // Performance stats
+    private external fun nativeGetPerfStats(): DoubleArray?
+    private external fun nativeResetPerfStats()
+}
+
+/**
+ * Snapshot of the native callback telemetry.
+ * Loads are percentages of the burst budget (the time one callback's frames
+ * last); stage times are smoothed per-callback averages.
+ */
+data class PerfStats(
+    val callbacks: Long,
+    val xruns: Int,
+    val activeVoices: Int,
+    val budgetMicros: Float,
+    val lastLoad: Float,
+    val averageLoad: Float,
+    val peakLoad: Float,
+    val averageCallbackMicros: Float,
+    val maxCallbackMicros: Float,
+    /** Voices allowed to sound right now, after the CPU governor */
+    val voiceLimit: Int,
+    val polyphonyMicros: Float,
+    val effectsMicros: Float,
+    val looperMicros: Float,
+    val drumsMicros: Float,
+    /** Callback counts per 10% load bucket; the last bucket counts overruns */
+    val loadHistogram: List<Long>,
+    /** Heap allocations on the audio thread since startup (debug builds only) */
+    val rtAllocations: Long,
+    /** Mutex locks taken on the audio thread since startup (debug builds only) */
+    val rtLocks: Long,
+    /** Audio-thread log messages lost because the log queue was full */
+    val droppedLogs: Long
+) {
+    companion object {
+        private const val STAGE_OFFSET = 10
+        private const val HISTOGRAM_OFFSET = STAGE_OFFSET + 4
+        private const val HISTOGRAM_BUCKETS = 11
+        private const val SAFETY_OFFSET = HISTOGRAM_OFFSET + HISTOGRAM_BUCKETS
+        
+        // Layout written by nativeGetPerfStats
+        fun fromArray(values: DoubleArray): PerfStats {
+            return PerfStats(
+                callbacks = values[0].toLong(),
+                xruns = values[1].toInt(),
+                activeVoices = values[2].toInt(),
+                budgetMicros = values[3].toFloat(),
+                lastLoad = values[4].toFloat(),
+                averageLoad = values[5].toFloat(),
+                peakLoad = values[6].toFloat(),
+                averageCallbackMicros = values[7].toFloat(),
+                maxCallbackMicros = values[8].toFloat(),
+                voiceLimit = values[9].toInt(),
+                polyphonyMicros = values[STAGE_OFFSET].toFloat(),
+                effectsMicros = values[STAGE_OFFSET + 1].toFloat(),
+                looperMicros = values[STAGE_OFFSET + 2].toFloat(),
+                drumsMicros = values[STAGE_OFFSET + 3].toFloat(),
+                loadHistogram = (HISTOGRAM_OFFSET until SAFETY_OFFSET).map { values[it].toLong() },
+                rtAllocations = values[SAFETY_OFFSET].toLong(),
+                rtLocks = values[SAFETY_OFFSET + 1].toLong(),
+                droppedLogs = values[SAFETY_OFFSET + 2].toLong()
+            )
+        }
+    }
+}
+
+/**
+ * Complete synth preset: voice, modulation and the synth effects chain.
+ * Submitted with SynthesizerEngine.setPatch().
+ */
+data class SynthPatch(
+    val waveforms: Set<Waveform> = setOf(Waveform.SAWTOOTH),
+    val pulseWidth: Float = 0.5f,
+    val subOscLevel: Float = 0.0f,
+    val noiseLevel: Float = 0.0f,
+    val filterCutoff: Float = 10000f,
+    val filterResonance: Float = 0.0f,
+    val filterEnvelopeAmount: Float = 0.3f,
+    val filterKeyTracking: Float = 0.0f,
+    val hpfCutoff: Float = 0.0f,
+    val attack: Float = 0.01f,
+    val decay: Float = 0.2f,
+    val sustain: Float = 0.7f,
+    val release: Float = 0.3f,
+    val glideTime: Float = 0.0f,
+    val glideEnabled: Boolean = false,
+    val lfoRate: Float = 1.0f,
+    val lfoPitchDepth: Float = 0.0f,
+    val lfoFilterDepth: Float = 0.0f,
+    val lfoPWMDepth: Float = 0.0f,
+    val chorusMode: ChorusMode = ChorusMode.OFF,
+    val unisonEnabled: Boolean = false,
+    val unisonVoices: Int = 4,
+    val unisonDetune: Float = 10.0f,
+    val tremoloRate: Float = 5.0f,
+    val tremoloDepth: Float = 0.0f,
+    val reverbSize: Float = 0.3f,
+    val reverbMix: Float = 0.0f,
+    val delayTime: Float = 0.25f,
+    val delayFeedback: Float = 0.3f,
+    val delayMix: Float = 0.0f,
+    val volume: Float = 0.7f
+) {
+    // Layout read by nativeSetPatch
+    fun toArray(): FloatArray {
+        fun flag(value: Boolean) = if (value) 1f else 0f
+        return floatArrayOf(
+            flag(Waveform.SINE in waveforms),
+            flag(Waveform.SQUARE in waveforms),
+            flag(Waveform.SAWTOOTH in waveforms),
+            flag(Waveform.TRIANGLE in waveforms),
+            pulseWidth, subOscLevel, noiseLevel,
+            filterCutoff, filterResonance, filterEnvelopeAmount, filterKeyTracking, hpfCutoff,
+            attack, decay, sustain, release,
+            glideTime, flag(glideEnabled),
+            lfoRate, lfoPitchDepth, lfoFilterDepth, lfoPWMDepth,
+            chorusMode.ordinal.toFloat(),
+            flag(unisonEnabled), unisonVoices.toFloat(), unisonDetune,
+            tremoloRate, tremoloDepth, reverbSize, reverbMix,
+            delayTime, delayFeedback, delayMix,
+            volume
+        )
+    }
 }
 
 enum class Waveform {
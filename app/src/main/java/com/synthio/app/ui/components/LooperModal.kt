@@ -6,8 +6,10 @@ import androidx.compose.foundation.background
 import androidx.compose.foundation.border
 import androidx.compose.foundation.clickable
 import androidx.compose.foundation.layout.*
+import androidx.compose.foundation.rememberScrollState
 import androidx.compose.foundation.shape.CircleShape
 import androidx.compose.foundation.shape.RoundedCornerShape
+import androidx.compose.foundation.verticalScroll
 import androidx.compose.material.icons.Icons
 import androidx.compose.material.icons.filled.Close
 import androidx.compose.material.icons.filled.Delete
@@ -51,6 +53,7 @@ fun LooperModal(
     metronomeVolume: Float,
     onMetronomeVolumeChange: (Float) -> Unit,
     barCount: Int = 4,
+    maxBarCount: Int = 8,
     onBarCountChange: (Int) -> Unit = {},
     onOpenExport: () -> Unit = {}
 ) {
@@ -62,7 +65,7 @@ fun LooperModal(
     
     val hasAnyContent = tracks.any { it.hasContent }
     val usedTrackCount = tracks.count { it.hasContent }
-    val allTracksFull = usedTrackCount >= 4
+    val allTracksFull = usedTrackCount >= tracks.size
     val isRecording = looperState == LooperState.RECORDING || looperState == LooperState.PRE_COUNT
     
     // Use a full-screen Box instead of Dialog to allow Sandbox z-ordering
@@ -166,7 +169,8 @@ fun LooperModal(
                     horizontalArrangement = Arrangement.spacedBy(4.dp),
                     modifier = Modifier.weight(1f)
                 ) {
-                    (1..8).forEach { bars ->
+                    // Every count up to 8, then whole phrases (12, 16, ...)
+                    (1..maxBarCount).filter { it <= 8 || it % 4 == 0 }.forEach { bars ->
                         val isSelected = barCount == bars
                         Box(
                             modifier = Modifier
@@ -220,7 +224,10 @@ fun LooperModal(
                 // Track rows
                 Column(
                     verticalArrangement = Arrangement.spacedBy(12.dp),
-                    modifier = Modifier.fillMaxWidth()
+                    modifier = Modifier
+                        .fillMaxWidth()
+                        .weight(1f, fill = false)
+                        .verticalScroll(rememberScrollState())
                 ) {
                     tracks.forEachIndexed { index, track ->
                         LooperTrackRow(
@@ -333,7 +340,7 @@ private fun LooperTrackRow(
         if (isDarkMode) DarkPastelMint else PastelMint,
         if (isDarkMode) DarkPastelLavender else PastelLavender
     )
-    val trackColor = trackColors.getOrElse(trackIndex) { accentColor }
+    val trackColor = trackColors[trackIndex % trackColors.size]
     
     val borderColor = if (isRecording) Color.Red else trackColor.copy(alpha = 0.5f)
     val borderWidth = if (isRecording) 2.dp else 1.dp
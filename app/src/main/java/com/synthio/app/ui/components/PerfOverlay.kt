@@ -0,0 +1,133 @@
+package com.synthio.app.ui.components
+
+import androidx.compose.foundation.background
+import androidx.compose.foundation.clickable
+import androidx.compose.foundation.layout.*
+import androidx.compose.material3.Text
+import androidx.compose.runtime.Composable
+import androidx.compose.ui.Alignment
+import androidx.compose.ui.Modifier
+import androidx.compose.ui.draw.clip
+import androidx.compose.ui.graphics.Color
+import androidx.compose.ui.text.font.FontFamily
+import androidx.compose.ui.unit.dp
+import androidx.compose.ui.unit.sp
+import com.synthio.app.audio.PerfStats
+import com.synthio.app.ui.theme.*
+import kotlin.math.roundToInt
+
+/**
+ * Debug overlay with the audio callback telemetry: load against the burst
+ * budget, per-stage cost, voices, xruns, output latency and the load
+ * histogram.
+ * Tap to reset the peaks and counters.
+ */
+@Composable
+fun PerfOverlay(
+    stats: PerfStats?,
+    outputLatencyMillis: Double?,
+    bufferFrames: Int,
+    isExclusiveStream: Boolean,
+    sampleRate: Int,
+    isDarkMode: Boolean,
+    onReset: () -> Unit,
+    modifier: Modifier = Modifier
+) {
+    val backgroundColor = if (isDarkMode) DarkSurfaceCard else SurfaceWhite
+    val textColor = if (isDarkMode) DarkTextPrimary else TextPrimary
+    val secondaryTextColor = if (isDarkMode) DarkTextSecondary else TextSecondary
+    val barColor = if (isDarkMode) DarkPastelMint else PastelMint
+    val overrunColor = if (isDarkMode) DarkPastelCoral else PastelCoral
+    val textStyle = SynthTypography.keyLabel.copy(
+        color = textColor,
+        fontFamily = FontFamily.Monospace,
+        fontSize = 10.sp
+    )
+
+    Column(
+        modifier = modifier
+            .width(180.dp)
+            .clip(SynthShapes.small)
+            .background(backgroundColor.copy(alpha = 0.85f))
+            .clickable { onReset() }
+            .padding(8.dp),
+        verticalArrangement = Arrangement.spacedBy(2.dp)
+    ) {
+        if (stats == null || stats.callbacks == 0L) {
+            Text(text = "Audio idle", style = textStyle)
+            return@Column
+        }
+
+        Text(
+            text = "Load ${stats.averageLoad.roundToInt()}% " +
+                "(peak ${stats.peakLoad.roundToInt()}%)",
+            style = textStyle
+        )
+        Text(
+            text = "Callback ${stats.averageCallbackMicros.roundToInt()}/" +
+                "${stats.budgetMicros.roundToInt()} us " +
+                "(max ${stats.maxCallbackMicros.roundToInt()})",
+            style = textStyle
+        )
+        Text(
+            text = "Latency ${outputLatencyMillis?.roundToInt()?.let { "$it ms" } ?: "--"} " +
+                "${if (isExclusiveStream) "excl" else "shared"} $bufferFrames fr",
+            style = textStyle
+        )
+        Text(
+            text = "Rate ${sampleRate / 1000.0} kHz",
+            style = textStyle.copy(color = secondaryTextColor)
+        )
+        Text(
+            text = "Voices ${stats.activeVoices}  XRuns ${stats.xruns}",
+            style = textStyle.copy(color = if (stats.xruns > 0) overrunColor else textColor)
+        )
+        Text(
+            text = "Poly ${stats.polyphonyMicros.roundToInt()} " +
+                "Fx ${stats.effectsMicros.roundToInt()} us",
+            style = textStyle.copy(color = secondaryTextColor)
+        )
+        Text(
+            text = "Loop ${stats.looperMicros.roundToInt()} " +
+                "Drums ${stats.drumsMicros.roundToInt()} us",
+            style = textStyle.copy(color = secondaryTextColor)
+        )
+        // Audio-thread safety: allocations and locks are only counted in debug
+        // builds, so anything non-zero here is a real-time bug
+        val rtViolations = stats.rtAllocations + stats.rtLocks
+        if (rtViolations > 0 || stats.droppedLogs > 0) {
+            Text(
+                text = "RT alloc ${stats.rtAllocations} lock ${stats.rtLocks} " +
+                    "log- ${stats.droppedLogs}",
+                style = textStyle.copy(color = if (rtViolations > 0) overrunColor else secondaryTextColor)
+            )
+        }
+
+        // Load histogram, 10% per bar; the last bar counts overruns
+        val maxCount = (stats.loadHistogram.maxOrNull() ?: 0L).coerceAtLeast(1L)
+        Row(
+            verticalAlignment = Alignment.Bottom,
+            horizontalArrangement = Arrangement.spacedBy(2.dp),
+            modifier = Modifier
+                .fillMaxWidth()
+                .height(24.dp)
+                .padding(top = 4.dp)
+        ) {
+            stats.loadHistogram.forEachIndexed { index, count ->
+                val fraction = count.toFloat() / maxCount
+                Box(
+                    modifier = Modifier
+                        .weight(1f)
+                        .fillMaxHeight(fraction.coerceAtLeast(0.05f))
+                        .background(
+                            when {
+                                count == 0L -> Color.Transparent
+                                index == stats.loadHistogram.lastIndex -> overrunColor
+                                else -> barColor
+                            }
+                        )
+                )
+            }
+        }
+    }
+}
@@ -81,6 +81,9 @@ fun SideMenuContent(
     hasActiveExports: Boolean = false,
     exportCount: Int = 0,
     onOpenExports: () -> Unit = {},
+    // Debug
+    isPerfOverlayVisible: Boolean = false,
+    onPerfOverlayToggle: () -> Unit = {},
     onCloseMenu: () -> Unit,
     modifier: Modifier = Modifier
 ) {
@@ -387,6 +390,28 @@ fun SideMenuContent(
                     }
                 }
             }
+            
+            // Performance overlay toggle
+            Row(
+                verticalAlignment = Alignment.CenterVertically,
+                horizontalArrangement = Arrangement.SpaceBetween,
+                modifier = Modifier.fillMaxWidth()
+            ) {
+                Text(
+                    text = "Performance Overlay",
+                    style = SynthTypography.label.copy(color = textColor)
+                )
+                Switch(
+                    checked = isPerfOverlayVisible,
+                    onCheckedChange = { onPerfOverlayToggle() },
+                    colors = SwitchDefaults.colors(
+                        checkedThumbColor = accentColor,
+                        checkedTrackColor = accentLightColor,
+                        uncheckedThumbColor = if (isDarkMode) DarkPastelLavender else PastelLavender,
+                        uncheckedTrackColor = if (isDarkMode) DarkPastelLavenderDark else PastelLavenderLight
+                    )
+                )
+            }
         }
         
         Spacer(modifier = Modifier.height(16.dp))
@@ -195,6 +195,9 @@ fun SynthesizerScreen(
                         scope.launch { drawerState.close() }
                         viewModel.openExportsPage()
                     },
+                    // Debug
+                    isPerfOverlayVisible = viewModel.showPerfOverlay,
+                    onPerfOverlayToggle = { viewModel.togglePerfOverlay() },
                     onCloseMenu = { scope.launch { drawerState.close() } }
                 )
             }
@@ -1221,6 +1224,7 @@ fun SynthesizerScreen(
                 metronomeVolume = viewModel.metronomeVolume,
                 onMetronomeVolumeChange = { viewModel.updateMetronomeVolume(it) },
                 barCount = viewModel.looperBarCount,
+                maxBarCount = viewModel.looperMaxBars,
                 onBarCountChange = { viewModel.updateLooperBarCount(it) },
                 onOpenExport = { viewModel.openExportModal() }
             )
@@ -1292,6 +1296,33 @@ fun SynthesizerScreen(
             )
         }
         
+        // Performance overlay (debug) - polled while visible
+        if (viewModel.showPerfOverlay) {
+            LaunchedEffect(Unit) {
+                while (true) {
+                    viewModel.updatePerfStats()
+                    delay(250) // Poll at 4Hz
+                }
+            }
+            Box(
+                modifier = Modifier
+                    .fillMaxSize()
+                    .systemBarsPadding()
+                    .padding(8.dp),
+                contentAlignment = Alignment.TopEnd
+            ) {
+                PerfOverlay(
+                    stats = viewModel.perfStats,
+                    outputLatencyMillis = viewModel.outputLatencyMillis,
+                    bufferFrames = viewModel.streamBufferFrames,
+                    isExclusiveStream = viewModel.isExclusiveStream,
+                    sampleRate = viewModel.streamSampleRate,
+                    isDarkMode = isDark,
+                    onReset = { viewModel.resetPerfStats() }
+                )
+            }
+        }
+        
         // Snackbar for notifications - Z-ordered on top of everything
     Box(modifier = Modifier.fillMaxSize(), contentAlignment = Alignment.BottomCenter) {
         SnackbarHost(
@@ -1,5 +1,6 @@
 package com.synthio.app.viewmodel
 
+import android.app.ActivityManager
 import android.content.Context
 import android.net.Uri
 import androidx.compose.runtime.getValue
@@ -11,6 +12,7 @@ import androidx.compose.runtime.setValue
 import androidx.lifecycle.ViewModel
 import androidx.lifecycle.viewModelScope
 import com.synthio.app.audio.AudioExportService
+import com.synthio.app.audio.AudioRouteMonitor
 import com.synthio.app.audio.ChorusMode
 import com.synthio.app.audio.LooperState
 import com.synthio.app.audio.MidiHandler
@@ -18,6 +20,8 @@ import com.synthio.app.audio.MusicConstants
 import com.synthio.app.audio.MusicConstants.ChordType
 import com.synthio.app.audio.MusicConstants.KeySignature
 import com.synthio.app.audio.MusicConstants.KeyboardNote
+import com.synthio.app.audio.PerfStats
+import com.synthio.app.audio.SynthPatch
 import com.synthio.app.audio.SynthesizerEngine
 import com.synthio.app.audio.Waveform
 import com.synthio.app.audio.ExportJob
@@ -52,6 +56,8 @@ class SynthViewModel : ViewModel() {
     // ===== MIDI =====
     private var midiHandler: MidiHandler? = null
     
+    private var routeMonitor: AudioRouteMonitor? = null
+    
     // Track MIDI notes separately from UI keyboard notes
     private val activeMidiNotes = mutableSetOf<Int>()
     
@@ -242,10 +248,14 @@ class SynthViewModel : ViewModel() {
     var metronomeVolume by mutableFloatStateOf(0.5f)
         private set
     
-    // Looper bar count (1-8 bars)
+    // Looper bar count (1-looperMaxBars bars)
     var looperBarCount by mutableIntStateOf(4)
         private set
     
+    // Longest loop the reserved looper storage holds at the current tempo
+    var looperMaxBars by mutableIntStateOf(8)
+        private set
+    
     // Dialog for confirming bar count change when loops exist
     var showBarCountChangeDialog by mutableStateOf(false)
         private set
@@ -293,7 +303,7 @@ class SynthViewModel : ViewModel() {
         private set
     
     // Multi-track looper state
-    var loopTracks by mutableStateOf(List(4) { LoopTrackState() })
+    var loopTracks by mutableStateOf(List(LOOPER_TRACK_COUNT) { LoopTrackState() })
         private set
     
     var showLooperModal by mutableStateOf(false)
@@ -331,17 +341,75 @@ class SynthViewModel : ViewModel() {
     var showExportsPage by mutableStateOf(false)
         private set
     
+    // ===== PERFORMANCE OVERLAY =====
+    var showPerfOverlay by mutableStateOf(false)
+        private set
+    
+    var perfStats by mutableStateOf<PerfStats?>(null)
+        private set
+    
+    var outputLatencyMillis by mutableStateOf<Double?>(null)
+        private set
+    
+    var streamBufferFrames by mutableIntStateOf(0)
+        private set
+    
+    var isExclusiveStream by mutableStateOf(false)
+        private set
+    
+    var streamSampleRate by mutableIntStateOf(0)
+        private set
+    
     // Track currently playing notes to handle chord mode note offs
     private val activeNotes = mutableMapOf<KeyboardNote, List<Int>>()
     
     fun startEngine() {
         SynthesizerEngine.create()
+        // Storage is reserved before start (refused while running). With a
+        // session file this reopens the tracks saved by the last run.
+        val sessionPath = looperSessionFile()?.absolutePath
+        val budget = if (sessionPath != null) LOOPER_SESSION_BUDGET else looperMemoryBudget()
+        SynthesizerEngine.looperConfigure(LOOPER_TRACK_COUNT, LOOPER_MAX_BARS, budget, sessionPath)
+        // The route decides between an exclusive and a shared stream, so it
+        // is known before the stream opens and followed afterwards
+        val monitor = routeMonitor ?: appContext?.let {
+            AudioRouteMonitor(it) { SynthesizerEngine.getOutputDeviceId() }
+        }
+        routeMonitor = monitor
+        monitor?.let {
+            SynthesizerEngine.setBluetoothOutput(it.isBluetoothOutput())
+            it.onRouteChanged = { bluetooth -> SynthesizerEngine.setBluetoothOutput(bluetooth) }
+        }
         SynthesizerEngine.start()
+        monitor?.start()
         applyAllParameters()
+        looperBarCount = SynthesizerEngine.looperGetBarCount()
+        updateLooperState()
+    }
+    
+    private fun looperSessionFile(): java.io.File? {
+        val dir = java.io.File(appContext?.filesDir ?: return null, "looper")
+        if (!dir.isDirectory && !dir.mkdirs()) return null
+        return java.io.File(dir, "session.loop")
+    }
+    
+    /**
+     * Looper storage budget scaled to the device, used when there is no session
+     * file: the worst case is reserved up front and only committed as tracks
+     * are recorded.
+     */
+    private fun looperMemoryBudget(): Long {
+        val activityManager = appContext?.getSystemService(ActivityManager::class.java)
+            ?: return LOOPER_MIN_BUDGET
+        if (activityManager.isLowRamDevice) return LOOPER_MIN_BUDGET
+        val budget = activityManager.memoryClass * 1024L * 1024L / 2
+        return budget.coerceIn(LOOPER_MIN_BUDGET, LOOPER_MAX_BUDGET)
     }
     
     fun stopEngine() {
         SynthesizerEngine.allNotesOff()
+        SynthesizerEngine.looperSaveSession()
+        routeMonitor?.stop()
         SynthesizerEngine.stop()
         SynthesizerEngine.destroy()
         releaseMidi()
@@ -938,7 +1006,7 @@ class SynthViewModel : ViewModel() {
             showBarCountChangeDialog = true
         } else {
             // No loops, just change directly
-            looperBarCount = bars.coerceIn(1, 8)
+            looperBarCount = bars.coerceIn(1, looperMaxBars)
             SynthesizerEngine.looperSetBarCount(looperBarCount)
         }
     }
@@ -949,8 +1017,8 @@ class SynthViewModel : ViewModel() {
             SynthesizerEngine.looperClearTrack(index)
         }
         // Update loopTracks to show all are now empty
-        loopTracks = List(4) { LoopTrackState() }
-        looperBarCount = pendingBarCount.coerceIn(1, 8)
+        loopTracks = List(loopTracks.size) { LoopTrackState() }
+        looperBarCount = pendingBarCount.coerceIn(1, looperMaxBars)
         SynthesizerEngine.looperSetBarCount(looperBarCount)
         showBarCountChangeDialog = false
     }
@@ -964,6 +1032,7 @@ class SynthViewModel : ViewModel() {
     fun loopButtonClicked() {
         // ALWAYS show looper modal to let user pick track
         // User requested removing the default "start recording track 0" logic
+        refreshLoopTrackStates()
         showLooperModal = true
     }
     
@@ -1012,6 +1081,7 @@ class SynthViewModel : ViewModel() {
     // ===== MULTI-TRACK LOOPER =====
     
     fun showLooperModalDialog() {
+        refreshLoopTrackStates()
         showLooperModal = true
     }
     
@@ -1079,7 +1149,11 @@ class SynthViewModel : ViewModel() {
     }
     
     fun refreshLoopTrackStates() {
-        loopTracks = List(4) { index ->
+        val trackCount = SynthesizerEngine.looperGetTrackCount()
+        if (trackCount > 0) {
+            looperMaxBars = SynthesizerEngine.looperGetMaxBars().coerceAtLeast(1)
+        }
+        loopTracks = List(if (trackCount > 0) trackCount else loopTracks.size) { index ->
             LoopTrackState(
                 hasContent = SynthesizerEngine.looperTrackHasContent(index),
                 volume = SynthesizerEngine.looperGetTrackVolume(index),
@@ -1124,50 +1198,45 @@ class SynthViewModel : ViewModel() {
         SynthesizerEngine.setWurliVolume(volume)
     }
     
+    /** The synth settings currently shown, as one patch */
+    fun currentPatch(): SynthPatch = SynthPatch(
+        waveforms = activeWaveforms.toSet(),
+        pulseWidth = pulseWidth,
+        subOscLevel = subOscLevel,
+        noiseLevel = noiseLevel,
+        filterCutoff = filterCutoff,
+        filterResonance = filterResonance,
+        filterKeyTracking = filterKeyTracking,
+        hpfCutoff = hpfCutoff,
+        attack = attack,
+        decay = decay,
+        sustain = sustain,
+        release = release,
+        glideTime = glideTime,
+        glideEnabled = glideEnabled,
+        lfoRate = lfoRate,
+        lfoPitchDepth = lfoPitchDepth,
+        lfoFilterDepth = lfoFilterDepth,
+        lfoPWMDepth = lfoPWMDepth,
+        chorusMode = chorusMode,
+        unisonEnabled = unisonEnabled,
+        unisonVoices = unisonVoices,
+        unisonDetune = unisonDetune,
+        tremoloRate = synthTremoloRate,
+        tremoloDepth = synthTremoloDepth,
+        reverbSize = synthReverbSize,
+        reverbMix = synthReverbMix,
+        delayTime = synthDelayTime,
+        delayFeedback = synthDelayFeedback,
+        delayMix = synthDelayMix,
+        volume = synthVolume
+    )
+    
     private fun applyAllParameters() {
-        // Oscillator
-        SynthesizerEngine.setWaveform(waveform)
-        SynthesizerEngine.setPulseWidth(pulseWidth)
-        SynthesizerEngine.setSubOscLevel(subOscLevel)
-        SynthesizerEngine.setNoiseLevel(noiseLevel)
-        
-        // Filter
-        SynthesizerEngine.setFilterCutoff(filterCutoff)
-        SynthesizerEngine.setFilterResonance(filterResonance)
-        SynthesizerEngine.setFilterKeyTracking(filterKeyTracking)
-        SynthesizerEngine.setHPFCutoff(hpfCutoff)
-        
-        // Envelope
-        SynthesizerEngine.setAttack(attack)
-        SynthesizerEngine.setDecay(decay)
-        SynthesizerEngine.setSustain(sustain)
-        SynthesizerEngine.setRelease(release)
-        
-        // LFO
-        SynthesizerEngine.setLFORate(lfoRate)
-        SynthesizerEngine.setLFOPitchDepth(lfoPitchDepth)
-        SynthesizerEngine.setLFOFilterDepth(lfoFilterDepth)
-        SynthesizerEngine.setLFOPWMDepth(lfoPWMDepth)
-        
-        // Chorus
-        SynthesizerEngine.setChorusMode(chorusMode)
-        
-        // Glide
-        SynthesizerEngine.setGlideEnabled(glideEnabled)
-        SynthesizerEngine.setGlideTime(glideTime)
-        
-        // Unison
-        SynthesizerEngine.setUnisonEnabled(unisonEnabled)
-        SynthesizerEngine.setUnisonVoices(unisonVoices)
-        SynthesizerEngine.setUnisonDetune(unisonDetune)
-        
-        // Synth Effects
-        SynthesizerEngine.setSynthTremolo(synthTremoloRate, synthTremoloDepth)
-        SynthesizerEngine.setSynthReverb(synthReverbSize, synthReverbMix)
-        SynthesizerEngine.setSynthDelay(synthDelayTime, synthDelayFeedback, synthDelayMix)
+        // Synth voice, modulation and effects in one patch
+        SynthesizerEngine.setPatch(currentPatch())
         
         // Volume
-        SynthesizerEngine.setSynthVolume(synthVolume)
         SynthesizerEngine.setDrumVolume(drumVolume)
         SynthesizerEngine.setMetronomeVolume(metronomeVolume)
         
@@ -1372,8 +1441,42 @@ class SynthViewModel : ViewModel() {
         showExportsPage = false
     }
     
+    fun togglePerfOverlay() {
+        showPerfOverlay = !showPerfOverlay
+        if (showPerfOverlay) {
+            // Start each viewing from fresh peaks and histogram
+            SynthesizerEngine.resetPerfStats()
+        }
+    }
+    
+    /** Poll the native telemetry (called periodically while the overlay is shown) */
+    fun updatePerfStats() {
+        perfStats = SynthesizerEngine.getPerfStats()
+        outputLatencyMillis = SynthesizerEngine.getOutputLatencyMillis()
+        streamBufferFrames = SynthesizerEngine.getBufferSizeFrames()
+        isExclusiveStream = SynthesizerEngine.isExclusiveStream()
+        streamSampleRate = SynthesizerEngine.getSampleRate()
+    }
+    
+    fun resetPerfStats() {
+        SynthesizerEngine.resetPerfStats()
+        updatePerfStats()
+    }
+    
     override fun onCleared() {
         super.onCleared()
         stopEngine()
     }
+    
+    companion object {
+        // Looper capacity requested from the engine; the budget decides how
+        // many bars actually fit at a given tempo
+        private const val LOOPER_TRACK_COUNT = 8
+        private const val LOOPER_MAX_BARS = 16
+        private const val LOOPER_MIN_BUDGET = 32L * 1024 * 1024
+        private const val LOOPER_MAX_BUDGET = 128L * 1024 * 1024
+        // Session files are sparse and paged in on demand, so their budget is
+        // disk space rather than RAM
+        private const val LOOPER_SESSION_BUDGET = 512L * 1024 * 1024
+    }
 }
@@ -0,0 +1,181 @@
+/**
+ * Synth.io AudioWorklet Processor (WebAssembly)
+ * Runs the app's native DSP core (app/src/main/cpp, built to
+ * /wasm/synthio.wasm with SIMD128) on the audio thread, so the web synth
+ * sounds like the Android one and gets its full effects chain.
+ *
+ * The main thread compiles the module and hands it over in
+ * processorOptions.wasmModule; it is instantiated here synchronously. The
+ * engine renders each block into two buffers in its linear memory, which
+ * are copied straight into the outputs. Accepts the same messages as
+ * synth-processor.js (the plain JavaScript fallback).
+ *
+ * Note: AudioWorklet processors must be pure JavaScript (no TypeScript)
+ */
+
+// Parameter ids, matching WebParam in app/src/main/cpp/wasm/SynthioWasm.cpp
+const PARAMS = {
+    waveform: 0,
+    attack: 1,
+    decay: 2,
+    sustain: 3,
+    release: 4,
+    filterCutoff: 5,
+    filterResonance: 6,
+    filterEnvAmount: 7,
+    lfoRate: 8,
+    lfoAmount: 9, // Vibrato depth
+    lfoFilterDepth: 10,
+    chorusMode: 11,
+    tremoloRate: 12,
+    tremoloDepth: 13,
+    delayTime: 14,
+    delayFeedback: 15,
+    delayMix: 16,
+    reverbSize: 17,
+    reverbMix: 18,
+    volume: 19,
+    wurlitzer: 20,
+    drums: 21,
+    drumBpm: 22,
+    qualityTier: 23,
+};
+
+const WAVEFORMS = { sine: 0, square: 1, sawtooth: 2, triangle: 3 };
+
+// The web UI's resonance knob is a biquad Q (0.1-20); the engine's biquad
+// LPF takes 0-1 (Q 0.707-15, self-oscillating above 0.95), so the knob
+// tops out just below that
+const MAX_Q = 20;
+const MAX_RESONANCE = 0.95;
+
+class SynthioProcessor extends AudioWorkletProcessor {
+    constructor(options) {
+        super();
+
+        const processorOptions = options.processorOptions || {};
+        this.engine = null;
+
+        try {
+            this.instantiate(processorOptions.wasmModule);
+            this.maxBlock = this.engine.synthio_init(processorOptions.sampleRate || sampleRate);
+            this.refreshViews();
+            this.port.postMessage({ type: 'ready' });
+        } catch (error) {
+            this.engine = null;
+            this.port.postMessage({ type: 'error', data: { message: String(error) } });
+        }
+
+        this.port.onmessage = (event) => {
+            if (this.engine) {
+                this.handleMessage(event.data);
+            }
+        };
+    }
+
+    instantiate(module) {
+        // Standalone build: the only imports are WASI/Emscripten runtime
+        // hooks the DSP never relies on. Writes are accepted and dropped.
+        let memory = null;
+        const imports = {};
+        for (const entry of WebAssembly.Module.imports(module)) {
+            if (entry.kind !== 'function') continue;
+            imports[entry.module] = imports[entry.module] || {};
+            imports[entry.module][entry.name] = this.importStub(entry.name, () => memory);
+        }
+
+        const instance = new WebAssembly.Instance(module, imports);
+        this.engine = instance.exports;
+        memory = this.engine.memory;
+        if (this.engine._initialize) {
+            this.engine._initialize(); // Static constructors
+        }
+    }
+
+    importStub(name, getMemory) {
+        switch (name) {
+            case 'fd_write':
+                return (fd, iovs, iovsLength, writtenPtr) => {
+                    const view = new DataView(getMemory().buffer);
+                    let written = 0;
+                    for (let i = 0; i < iovsLength; i++) {
+                        written += view.getUint32(iovs + i * 8 + 4, true);
+                    }
+                    view.setUint32(writtenPtr, written, true);
+                    return 0;
+                };
+            case 'proc_exit':
+                return (code) => {
+                    throw new Error(`synthio.wasm exited (${code})`);
+                };
+            case 'emscripten_notify_memory_growth':
+                return () => this.refreshViews();
+            default:
+                return () => 0;
+        }
+    }
+
+    // Float32Array views on the engine's output buffers. Growing the memory
+    // detaches the old ArrayBuffer, so they are rebuilt when that happens.
+    refreshViews() {
+        if (!this.engine || this.maxBlock === undefined) return;
+        const buffer = this.engine.memory.buffer;
+        this.left = new Float32Array(buffer, this.engine.synthio_output_left(), this.maxBlock);
+        this.right = new Float32Array(buffer, this.engine.synthio_output_right(), this.maxBlock);
+    }
+
+    handleMessage({ type, data }) {
+        switch (type) {
+            case 'noteOn':
+                this.engine.synthio_note_on(data.note, data.velocity ?? 1);
+                break;
+            case 'noteOff':
+                this.engine.synthio_note_off(data.note);
+                break;
+            case 'setParam':
+                this.setParameter(data.param, data.value);
+                break;
+            case 'allNotesOff':
+                this.engine.synthio_all_notes_off();
+                break;
+        }
+    }
+
+    setParameter(param, value) {
+        const id = PARAMS[param];
+        if (id === undefined) return;
+
+        if (param === 'waveform') {
+            value = WAVEFORMS[value] ?? WAVEFORMS.sawtooth;
+        } else if (param === 'filterResonance') {
+            value = Math.min(1, Math.max(0, value / MAX_Q)) * MAX_RESONANCE;
+        } else if (typeof value === 'boolean') {
+            value = value ? 1 : 0;
+        }
+        this.engine.synthio_set_param(id, value);
+    }
+
+    process(inputs, outputs) {
+        const output = outputs[0];
+        const left = output[0];
+        const right = output[1];
+
+        if (!left || !right || !this.engine) return true;
+
+        // The render quantum is 128 frames, within one engine block; larger
+        // quanta are split
+        for (let offset = 0; offset < left.length; offset += this.maxBlock) {
+            const count = Math.min(this.maxBlock, left.length - offset);
+            this.engine.synthio_render(count);
+            if (this.left.length === 0) {
+                this.refreshViews();
+            }
+            left.set(this.left.subarray(0, count), offset);
+            right.set(this.right.subarray(0, count), offset);
+        }
+
+        return true;
+    }
+}
+
+registerProcessor('synthio-processor', SynthioProcessor);
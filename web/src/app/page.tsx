@@ -49,7 +49,7 @@ export default function Home() {
       const ctx = await initAudioContext({ sampleRate: 48000 });
       await loadSynthWorklet(ctx);
 
-      const synth = createSynthNode(ctx);
+      const synth = await createSynthNode(ctx);
       const master = createMasterGain(ctx, masterVolume);
 
       synth.connect(master);
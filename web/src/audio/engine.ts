@@ -5,6 +5,10 @@
 
 let audioContext: AudioContext | null = null;
 let isWorkletLoaded = false;
+// The native DSP core compiled to WebAssembly (npm run build:wasm). Null
+// when it is missing or the browser lacks wasm SIMD: the JavaScript synth
+// is used instead.
+let synthModule: WebAssembly.Module | null = null;
 
 export interface AudioEngineConfig {
   sampleRate?: number;
@@ -42,6 +46,23 @@ export function getAudioContext(): AudioContext | null {
   return audioContext;
 }
 
+/**
+ * Compile the WebAssembly DSP core. Compiling validates the module, so a
+ * browser without SIMD128 support rejects it here.
+ */
+async function compileSynthModule(): Promise<WebAssembly.Module | null> {
+  try {
+    const response = await fetch('/wasm/synthio.wasm');
+    if (!response.ok) {
+      throw new Error(`HTTP ${response.status}`);
+    }
+    return await WebAssembly.compile(await response.arrayBuffer());
+  } catch (error) {
+    console.warn('[AudioEngine] Native DSP unavailable, using the JavaScript synth:', error);
+    return null;
+  }
+}
+
 /**
  * Load the synthesizer AudioWorklet processor
  */
@@ -49,33 +70,82 @@ export async function loadSynthWorklet(ctx: AudioContext): Promise<void> {
   if (isWorkletLoaded) return;
 
   try {
-    await ctx.audioWorklet.addModule('/worklets/synth-processor.js');
+    synthModule = await compileSynthModule();
+    await ctx.audioWorklet.addModule(
+      synthModule ? '/worklets/synthio-processor.js' : '/worklets/synth-processor.js'
+    );
     isWorkletLoaded = true;
-    console.log('[AudioEngine] Synth worklet loaded successfully');
+    console.log(`[AudioEngine] Synth worklet loaded successfully (${synthModule ? 'wasm' : 'js'})`);
   } catch (error) {
     console.error('[AudioEngine] Failed to load synth worklet:', error);
     throw error;
   }
 }
 
-/**
- * Create and connect the main synth node
- */
-export function createSynthNode(ctx: AudioContext): AudioWorkletNode {
-  if (!isWorkletLoaded) {
-    throw new Error('Synth worklet not loaded. Call loadSynthWorklet first.');
-  }
+// How long to wait for the wasm processor to report in. It is constructed
+// on the rendering thread, which may not run while the context is suspended;
+// the node is kept in that case.
+const NATIVE_START_TIMEOUT_MS = 2000;
 
-  const synthNode = new AudioWorkletNode(ctx, 'synth-processor', {
+function createProcessorNode(ctx: AudioContext, name: string): AudioWorkletNode {
+  // Both processors take the same messages
+  return new AudioWorkletNode(ctx, name, {
     numberOfInputs: 0,
     numberOfOutputs: 1,
     outputChannelCount: [2], // Stereo
     processorOptions: {
       sampleRate: ctx.sampleRate,
+      wasmModule: synthModule, // Structured-cloned into the worklet
     },
   });
+}
+
+/**
+ * Wait for the wasm processor's 'ready' or 'error' message. Resolves with
+ * the error message, or null once it started (or never answered).
+ */
+function waitForNativeStart(node: AudioWorkletNode): Promise<string | null> {
+  return new Promise((resolve) => {
+    const finish = (failure: string | null) => {
+      clearTimeout(timer);
+      node.port.removeEventListener('message', onMessage);
+      resolve(failure);
+    };
+    const onMessage = (event: MessageEvent) => {
+      if (event.data?.type === 'ready') {
+        finish(null);
+      } else if (event.data?.type === 'error') {
+        finish(String(event.data.data?.message));
+      }
+    };
+    const timer = setTimeout(() => finish(null), NATIVE_START_TIMEOUT_MS);
+    node.port.addEventListener('message', onMessage);
+    node.port.start();
+  });
+}
+
+/**
+ * Create and connect the main synth node. Falls back to the JavaScript synth
+ * if the native DSP fails to start inside the worklet.
+ */
+export async function createSynthNode(ctx: AudioContext): Promise<AudioWorkletNode> {
+  if (!isWorkletLoaded) {
+    throw new Error('Synth worklet not loaded. Call loadSynthWorklet first.');
+  }
+
+  if (synthModule) {
+    const nativeNode = createProcessorNode(ctx, 'synthio-processor');
+    const failure = await waitForNativeStart(nativeNode);
+    if (failure === null) {
+      return nativeNode;
+    }
+    console.error('[AudioEngine] Native DSP failed to start, using the JavaScript synth:', failure);
+    nativeNode.port.close();
+    synthModule = null;
+    await ctx.audioWorklet.addModule('/worklets/synth-processor.js');
+  }
 
-  return synthNode;
+  return createProcessorNode(ctx, 'synth-processor');
 }
 
 /**
@@ -131,5 +201,6 @@ export async function disposeAudioContext(): Promise<void> {
     await audioContext.close();
     audioContext = null;
     isWorkletLoaded = false;
+    synthModule = null;
   }
 }